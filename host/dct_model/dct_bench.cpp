@@ -0,0 +1,335 @@
+/*
+ * dct_bench.cpp
+ *
+ * Runs the unmodified dct_fifo.c against DctFifoModel and reports how many
+ * 8x8 blocks a second each way of driving the DCT gets through, and the AXI
+ * accesses each block costs. Every block's coefficients are checked against
+ * DctFifoModel::compress.
+ *
+ *  per_block  the loop of the original compression-main2: dct_init, one
+ *             block per packet and a wait for each, plus the wait for the
+ *             coefficients that dct_receive assumed were already there
+ *  batched    dct_compress_step's loop without DCT_ASYNC: packets of up to
+ *             -b blocks, never straddling a sector, with up to -d blocks in
+ *             the DCT at once
+ *  async      dct_compress_step's loop with DCT_ASYNC: dct_submit and
+ *             dct_process_completions, with the model playing the FIFO
+ *             interrupt. When neither has anything to do the CPU waits for
+ *             the next interrupt, that time is reported as idle
+ *  sd_stream  the same with SD_DCT_STREAM: the SD controller streams a
+ *             sector of blocks into the DCT every -s cycles, sd_bench's
+ *             time for sd_stream_dct, and dct_expect lines up the callbacks.
+ *             As in main.c the stream may only send DCT_MAX_PIPELINE_BLOCKS
+ *             blocks ahead of the completed ones
+ *
+ * A run that loses coefficients to a full RX FIFO leaves dct_receive_block
+ * waiting for an EOF that never comes, or the interrupt driven loops waiting
+ * for an interrupt. The model reports that as a stall and the run is counted
+ * as failed.
+ *
+ * Usage: dct_bench [-n blocks] [-b batch] [-d depth] [-s cycles] [-w] [--csv label]
+ *  -w gives every block the full 66 coefficients, as an image of noise would
+ *  --csv prints one line per test for dct_bench.csv instead of the table
+ */
+
+#include <csetjmp>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "dct_fifo_model.h"
+
+extern "C" {
+#include "dct_fifo.h"
+}
+
+namespace {
+
+const uint32_t BLOCKS_PER_SECTOR = 7; // SD_BLOCKS_PER_SECTOR
+const uint32_t SD_SECTOR_CYCLES = 16620; // sd_stream_dct in sd_bench.csv
+const int MAX_REPORTED = 8; // mismatches printed per run
+
+struct Result {
+	const char* name;
+	uint32_t blocks;
+	uint32_t batch;
+	uint32_t depth;
+	DctModelStats stats;
+	int errors;
+	bool stalled;
+};
+
+// the run in progress, kept out of the frames a stall jumps over
+std::vector<uint8_t> image;
+std::vector<uint16_t> rx_coeff;
+std::vector<uint32_t> rx_len;
+bool worst_case = false;
+int n_errors = 0;
+int run_errors = 0; // n_errors when the run started
+std::jmp_buf stall_jmp;
+
+void fill_image(uint32_t blocks) {
+	image.resize((size_t)blocks * DCT_BLOCK_PIXELS);
+	for (size_t i = 0; i < image.size(); i++) {
+		image[i] = (uint8_t)((i / DCT_BLOCK_PIXELS) * 31 + (i % DCT_BLOCK_PIXELS) * 7 + 3);
+	}
+}
+
+uint8_t* block(uint32_t b) {
+	return &image[(size_t)b * DCT_BLOCK_PIXELS];
+}
+
+void check(const char* name, uint32_t b, const u16* coeff, uint32_t len) {
+	uint16_t expected[DctFifoModel::kMaxCoeff];
+	uint32_t n = DctFifoModel::compress(block(b), worst_case, expected);
+
+	if (len != n || std::memcmp(coeff, expected, n * sizeof(uint16_t)) != 0) {
+		if (n_errors - run_errors < MAX_REPORTED) {
+			std::fprintf(stderr, "%s: block %u has %u coefficients, expected %u%s\n",
+					name, b, len, n, len == n ? " but they differ" : "");
+		}
+		n_errors++;
+	}
+}
+
+uint32_t cb_block = 0;
+const char* run_name;
+
+void block_done(void* ref, u16* coeff, u32 len) {
+	if ((uintptr_t)ref != cb_block) {
+		std::fprintf(stderr, "%s: block %u came back in place of %u\n",
+				run_name, (unsigned)(uintptr_t)ref, cb_block);
+		n_errors++;
+	}
+	check(run_name, (uint32_t)(uintptr_t)ref, coeff, len);
+	cb_block++;
+}
+
+void stalled() {
+	std::longjmp(stall_jmp, 1);
+}
+
+DctFifoModel* model;
+
+// One test on a fresh model and FIFO
+template <typename Fn>
+Result run(const char* name, uint32_t blocks, uint32_t batch, uint32_t depth, Fn body) {
+	Result r = {name, blocks, batch, depth, DctModelStats(), 0, false};
+
+	run_name = name;
+
+	model = new DctFifoModel(DCT_PIXELS_PER_WORD, worst_case);
+	model->on_stall(stalled);
+	xil_io_detach_all();
+	xil_io_attach(DctFifoModel::kBaseAddr, DctFifoModel::kSize, model);
+	if (dct_init() != XST_SUCCESS) {
+		std::fprintf(stderr, "%s: dct_init failed\n", name);
+		n_errors++;
+	}
+	run_errors = n_errors;
+	if (setjmp(stall_jmp) == 0) {
+		body();
+	}
+	else {
+		std::fprintf(stderr, "%s: stalled waiting for the DCT, %llu words lost\n",
+				name, (unsigned long long)model->stats().rx_dropped);
+		r.stalled = true;
+		n_errors++;
+	}
+	r.stats = model->stats();
+	r.errors = n_errors - run_errors;
+	xil_io_detach_all();
+	delete model;
+	return r;
+}
+
+Result bench_per_block(uint32_t blocks) {
+	return run("per_block", blocks, 1, 1, [&]() {
+		rx_coeff.assign(DCT_MAX_BLOCK_COEFF, 0);
+		for (uint32_t b = 0; b < blocks; b++) {
+			dct_init();
+			dct_transmit(block(b), DCT_BLOCK_PIXELS);
+			while (!dct_transmit_done()) {
+			}
+			while (!XLlFifo_iRxOccupancy(&dct_fifo)) {
+			}
+			check("per_block", b, rx_coeff.data(), dct_receive(rx_coeff.data()));
+		}
+	});
+}
+
+Result bench_batched(uint32_t blocks, uint32_t batch, uint32_t depth) {
+	return run("batched", blocks, batch, depth, [&]() {
+		uint32_t tx_block = 0;
+		uint32_t rx_block = 0;
+		uint32_t n_tx, n_rx;
+
+		rx_coeff.assign((size_t)batch * DCT_MAX_BLOCK_COEFF, 0);
+		rx_len.assign(batch, 0);
+		while (rx_block < blocks) {
+			while (tx_block < blocks && tx_block + batch <= rx_block + depth) {
+				n_tx = BLOCKS_PER_SECTOR - tx_block % BLOCKS_PER_SECTOR;
+				if (n_tx > batch) {
+					n_tx = batch;
+				}
+				if (n_tx > blocks - tx_block) {
+					n_tx = blocks - tx_block;
+				}
+				dct_transmit_blocks(block(tx_block), n_tx);
+				tx_block += n_tx;
+			}
+
+			n_rx = tx_block - rx_block;
+			if (n_rx > batch) {
+				n_rx = batch;
+			}
+			dct_receive_blocks(rx_coeff.data(), n_rx, rx_len.data());
+			for (uint32_t i = 0; i < n_rx; i++) {
+				check("batched", rx_block + i, &rx_coeff[(size_t)i * DCT_MAX_BLOCK_COEFF], rx_len[i]);
+			}
+			rx_block += n_rx;
+		}
+	});
+}
+
+Result bench_async(uint32_t blocks) {
+	return run("async", blocks, 1, DCT_MAX_PIPELINE_BLOCKS, [&]() {
+		uint32_t tx_block = 0;
+
+		cb_block = 0;
+		dct_async_init();
+		model->connect_irq(dct_fifo_intr_handler, NULL);
+		model->enable_irq(true);
+		while (cb_block < blocks) {
+			while (tx_block < blocks &&
+					dct_submit(block(tx_block), block_done, (void*)(uintptr_t)tx_block) == XST_SUCCESS) {
+				tx_block++;
+			}
+			if (dct_process_completions() == 0 && !model->wait_for_irq()) {
+				stalled();
+			}
+		}
+		model->enable_irq(false);
+	});
+}
+
+Result bench_sd_stream(uint32_t blocks, uint32_t sector_cycles) {
+	return run("sd_stream", blocks, 1, DCT_MAX_PIPELINE_BLOCKS, [&]() {
+		uint32_t tx_block = 0;
+		uint32_t credit = DCT_MAX_PIPELINE_BLOCKS;
+		uint32_t n_done;
+
+		cb_block = 0;
+		dct_async_init();
+		model->connect_irq(dct_fifo_intr_handler, NULL);
+		model->enable_irq(true);
+		model->stream_sectors(image.data(), blocks, BLOCKS_PER_SECTOR, sector_cycles, credit);
+		while (cb_block < blocks) {
+			while (tx_block < blocks &&
+					dct_expect(block_done, (void*)(uintptr_t)tx_block) == XST_SUCCESS) {
+				tx_block++;
+			}
+			n_done = dct_process_completions();
+			// sd_stream_dct_credit only writes a new count
+			if (dct_completed() + DCT_MAX_PIPELINE_BLOCKS != credit) {
+				credit = dct_completed() + DCT_MAX_PIPELINE_BLOCKS;
+				model->stream_credit(credit);
+			}
+			if (n_done == 0 && !model->wait_for_irq()) {
+				stalled();
+			}
+		}
+		model->enable_irq(false);
+	});
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+	uint32_t blocks = 1024;
+	// main.c's DCT_BATCH_BLOCKS and DCT_PIPELINE_DEPTH
+	uint32_t batch = 1;
+	uint32_t depth = DCT_MAX_PIPELINE_BLOCKS;
+	uint32_t sector_cycles = SD_SECTOR_CYCLES;
+	const char* csv_label = NULL;
+
+	for (int i = 1; i < argc; i++) {
+		if (std::strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+			blocks = std::strtoul(argv[++i], NULL, 0);
+		}
+		else if (std::strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+			batch = std::strtoul(argv[++i], NULL, 0);
+		}
+		else if (std::strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+			depth = std::strtoul(argv[++i], NULL, 0);
+		}
+		else if (std::strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+			sector_cycles = std::strtoul(argv[++i], NULL, 0);
+		}
+		else if (std::strcmp(argv[i], "-w") == 0) {
+			worst_case = true;
+		}
+		else if (std::strcmp(argv[i], "--csv") == 0 && i + 1 < argc) {
+			csv_label = argv[++i];
+		}
+		else {
+			std::fprintf(stderr, "usage: %s [-n blocks] [-b batch] [-d depth] [-s cycles] [-w] [--csv label]\n",
+					argv[0]);
+			return 2;
+		}
+	}
+	if (blocks == 0) {
+		blocks = 1;
+	}
+	if (batch == 0 || batch > DCT_MAX_BATCH_BLOCKS) {
+		batch = DCT_MAX_BATCH_BLOCKS;
+	}
+	if (depth < batch) {
+		depth = batch;
+	}
+
+	xil_printf_quiet = 1;
+	fill_image(blocks);
+	std::vector<Result> results;
+	results.push_back(bench_per_block(blocks));
+	results.push_back(bench_batched(blocks, batch, depth));
+	results.push_back(bench_async(blocks));
+	results.push_back(bench_sd_stream(blocks, sector_cycles));
+
+	DctModelTiming timing;
+	if (csv_label != NULL) {
+		for (const Result& r : results) {
+			std::printf("%s,%s,%u,%u,%u,%d,%.1f,%.1f,%.0f,%.0f,%llu,%d,%.3f,%.2f\n", csv_label,
+					r.name, r.blocks, r.batch, r.depth, worst_case ? 1 : 0,
+					(double)r.stats.reads / r.blocks, (double)r.stats.writes / r.blocks,
+					(double)r.stats.cycles / r.blocks,
+					r.stalled ? 0.0 : 1e6 * timing.axi_mhz * r.blocks / r.stats.cycles,
+					(unsigned long long)r.stats.rx_dropped, r.errors,
+					(double)r.stats.idle_cycles / r.stats.cycles,
+					(double)r.stats.irqs / r.blocks);
+		}
+	}
+	else {
+		std::printf("%u %s blocks, AXI at %u MHz, %u/%u cycles per read/write access\n",
+				blocks, worst_case ? "worst case" : "typical", timing.axi_mhz,
+				timing.axi_read_cycles, timing.axi_write_cycles);
+		std::printf("%-12s %6s %6s %10s %10s %10s %12s %10s %6s %6s\n", "per block", "batch",
+				"depth", "AXI reads", "AXI writes", "cycles", "blocks/s", "lost words", "IRQs",
+				"idle");
+		for (const Result& r : results) {
+			double cycles = (double)r.stats.cycles / r.blocks;
+			std::printf("%-12s %6u %6u %10.1f %10.1f %10.0f %12.0f %10llu %6.2f %5.0f%%%s\n",
+					r.name, r.batch, r.depth, (double)r.stats.reads / r.blocks,
+					(double)r.stats.writes / r.blocks, cycles,
+					r.stalled ? 0.0 : 1e6 * timing.axi_mhz / cycles,
+					(unsigned long long)r.stats.rx_dropped, (double)r.stats.irqs / r.blocks,
+					100.0 * r.stats.idle_cycles / r.stats.cycles, r.stalled ? "  stalled" : "");
+		}
+	}
+	if (n_errors != 0) {
+		std::fprintf(stderr, "FAILED: %d errors\n", n_errors);
+		return 1;
+	}
+	return 0;
+}
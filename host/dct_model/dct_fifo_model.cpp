@@ -0,0 +1,351 @@
+/*
+ * dct_fifo_model.cpp
+ *
+ * See dct_fifo_model.h
+ */
+
+#include "dct_fifo_model.h"
+
+#include <algorithm>
+
+#include "xllfifo.h"
+
+namespace {
+
+const uint32_t RESET_KEY = 0xA5;
+// empty RX FIFO polls with nothing coming before it counts as a stall
+const unsigned STALL_POLLS = 1000;
+
+} // namespace
+
+DctFifoModel::DctFifoModel(unsigned pixels_per_word, bool worst_case, const DctModelTiming& timing)
+	: timing_(timing), pixels_per_word_(pixels_per_word), worst_case_(worst_case), now_(0),
+	  isr_(0), ier_(0), irq_handler_(NULL), irq_ref_(NULL), irq_enabled_(false),
+	  in_irq_(false), stall_handler_(NULL), empty_polls_(0), tx_stream_t_(0),
+	  block_first_t_(0), stream_pixels_(NULL), stream_blocks_(0), stream_blocks_per_sector_(1),
+	  stream_sector_cycles_(0), stream_credit_(0), stream_next_(0), stream_t_(0), out_t_(0),
+	  rx_avail_(0), rx_words_(0), rx_pos_(0), rx_len_read_(false) {
+}
+
+unsigned DctFifoModel::compress(const uint8_t* pixels, bool worst_case, uint16_t* coeff) {
+	uint32_t sum = 0;
+	unsigned n;
+
+	for (unsigned i = 0; i < kBlockPixels; i++) {
+		sum += pixels[i];
+	}
+	// an odd number of coefficients and the EOF, 10 on average as for
+	// typical images, or the full block
+	n = worst_case ? kMaxCoeff : 2 * ((sum / kBlockPixels + pixels[0]) % 9) + 2;
+	for (unsigned i = 0; i + 1 < n; i++) {
+		coeff[i] = (uint16_t)((pixels[i % kBlockPixels] * 131 + i * 7 + sum) & 0x7FFF);
+	}
+	coeff[n - 1] = kEof;
+	return n;
+}
+
+void DctFifoModel::connect_irq(IrqHandler handler, void* ref) {
+	irq_handler_ = handler;
+	irq_ref_ = ref;
+}
+
+uint64_t DctFifoModel::next_event() const {
+	uint64_t t = kNever;
+
+	if (!tx_done_.empty()) {
+		t = tx_done_.front();
+	}
+	if (!blocks_.empty()) {
+		t = std::min(t, blocks_.front().out_end);
+	}
+	return t;
+}
+
+void DctFifoModel::advance(uint64_t t) {
+	uint64_t te;
+
+	while ((te = next_event()) <= t) {
+		if (!tx_done_.empty() && tx_done_.front() == te) {
+			tx_done_.pop_front();
+			isr_ |= XLLF_INT_TC_MASK;
+		}
+		else {
+			finish_block(te);
+		}
+	}
+	while (!tx_free_.empty() && tx_free_.front() <= t) {
+		tx_free_.pop_front();
+	}
+	now_ = t;
+	stats_.cycles = now_;
+}
+
+// The last word of the front block is in, TLAST unless another block has
+// started going into the core
+void DctFifoModel::finish_block(uint64_t t) {
+	Block b = blocks_.front();
+	bool in_flight;
+
+	blocks_.pop_front();
+	for (uint32_t word : b.words) {
+		if (rx_words_ >= timing_.rx_fifo_words) {
+			stats_.rx_dropped++;
+			continue;
+		}
+		building_.words.push_back(word);
+		rx_words_++;
+	}
+	stats_.blocks++;
+
+	in_flight = (!blocks_.empty() && blocks_.front().in_start < b.out_end) ||
+			(!pixels_.empty() && block_first_t_ < b.out_end);
+	if (!in_flight && !building_.words.empty()) {
+		building_.end = t;
+		rx_avail_ += building_.words.size();
+		rx_packets_.push_back(building_);
+		building_.words.clear();
+		stats_.rx_packets++;
+		isr_ |= XLLF_INT_RC_MASK;
+	}
+}
+
+// TLR written: the packet streams into the core a word per cycle
+void DctFifoModel::tx_commit(uint32_t bytes) {
+	uint64_t t = std::max(now_, tx_stream_t_);
+
+	if (bytes / 4 != tx_words_.size()) {
+		isr_ |= XLLF_INT_TSE_MASK;
+	}
+	for (uint32_t word : tx_words_) {
+		if (pixels_.empty()) {
+			block_first_t_ = t;
+		}
+		for (unsigned p = 0; p < pixels_per_word_; p++) {
+			pixels_.push_back((uint8_t)(word >> (8 * p)));
+		}
+		t++;
+		tx_free_.push_back(t);
+		if (pixels_.size() == kBlockPixels) {
+			add_block(pixels_.data(), block_first_t_, t);
+			pixels_.clear();
+		}
+	}
+	tx_done_.push_back(t);
+	tx_stream_t_ = t;
+	tx_words_.clear();
+}
+
+// A block went into the core between in_start and in_end
+void DctFifoModel::add_block(const uint8_t* pixels, uint64_t in_start, uint64_t in_end) {
+	Block b;
+	uint16_t coeff[kMaxCoeff];
+	unsigned n = compress(pixels, worst_case_, coeff);
+	uint64_t out_start = std::max(in_end + timing_.dct_latency, out_t_);
+
+	for (unsigned i = 0; i < n; i += 2) {
+		b.words.push_back((uint32_t)coeff[i] | (uint32_t)coeff[i + 1] << 16);
+	}
+	b.in_start = in_start;
+	b.out_end = out_start + b.words.size();
+	out_t_ = b.out_end;
+	blocks_.push_back(b);
+}
+
+void DctFifoModel::stream_sectors(const uint8_t* pixels, uint32_t blocks, unsigned blocks_per_sector,
+		uint64_t sector_cycles, uint32_t credit) {
+	stream_pixels_ = pixels;
+	stream_blocks_ = blocks;
+	stream_blocks_per_sector_ = blocks_per_sector;
+	stream_sector_cycles_ = sector_cycles;
+	stream_credit_ = credit;
+	stream_next_ = 0;
+	stream_t_ = now_;
+	stream_in_.clear();
+	stream_out_.clear();
+	stream_more();
+}
+
+void DctFifoModel::stream_credit(uint32_t credit) {
+	stats_.writes++;
+	access(timing_.axi_write_cycles);
+	stream_credit_ = credit;
+	stream_more();
+	deliver_irq();
+}
+
+// Send the blocks the credit allows from now on. The card is held while the
+// read RAM is full, a sector goes back to it once its last block is sent
+void DctFifoModel::stream_more() {
+	uint32_t b, s;
+	uint64_t t;
+
+	while (stream_next_ < stream_blocks_ && stream_next_ < stream_credit_) {
+		b = stream_next_;
+		s = b / stream_blocks_per_sector_;
+		while (stream_in_.size() <= s) {
+			size_t n = stream_in_.size();
+			t = n == 0 ? now_ : stream_in_[n - 1];
+			if (n >= timing_.stream_ram_sectors) {
+				t = std::max(t, stream_out_[n - timing_.stream_ram_sectors]);
+			}
+			stream_in_.push_back(t + stream_sector_cycles_);
+		}
+		t = std::max(std::max(stream_t_, stream_in_[s]), now_);
+		add_block(&stream_pixels_[(size_t)b * kBlockPixels], t, t + timing_.stream_block_cycles);
+		stream_t_ = t + timing_.stream_block_cycles;
+		if ((b + 1) % stream_blocks_per_sector_ == 0 || b + 1 == stream_blocks_) {
+			stream_out_.push_back(stream_t_);
+		}
+		stream_next_++;
+	}
+}
+
+void DctFifoModel::reset_tx() {
+	tx_words_.clear();
+	isr_ |= XLLF_INT_TRC_MASK;
+}
+
+void DctFifoModel::reset_rx() {
+	rx_packets_.clear();
+	building_.words.clear();
+	rx_avail_ = 0;
+	rx_words_ = 0;
+	rx_pos_ = 0;
+	rx_len_read_ = false;
+	isr_ |= XLLF_INT_RRC_MASK;
+}
+
+void DctFifoModel::access(unsigned cycles) {
+	if (in_irq_) {
+		stats_.irq_cycles += cycles;
+	}
+	advance(now_ + cycles);
+}
+
+void DctFifoModel::deliver_irq() {
+	while (irq_handler_ != NULL && irq_enabled_ && !in_irq_ && (isr_ & ier_)) {
+		in_irq_ = true;
+		stats_.irqs++;
+		access(timing_.irq_cycles);
+		irq_handler_(irq_ref_);
+		in_irq_ = false;
+	}
+}
+
+bool DctFifoModel::wait_for_irq() {
+	uint64_t te;
+
+	if (irq_handler_ == NULL || !irq_enabled_) {
+		return false;
+	}
+	while (!(isr_ & ier_)) {
+		te = next_event();
+		if (te == kNever) {
+			return false;
+		}
+		stats_.idle_cycles += te - now_;
+		advance(te);
+	}
+	deliver_irq();
+	return true;
+}
+
+uint32_t DctFifoModel::read(uint32_t offset) {
+	uint32_t value = 0;
+
+	stats_.reads++;
+	access(timing_.axi_read_cycles);
+	switch (offset) {
+	case XLLF_ISR_OFFSET:
+		value = isr_;
+		break;
+	case XLLF_IER_OFFSET:
+		value = ier_;
+		break;
+	case XLLF_TDFV_OFFSET:
+		value = timing_.tx_fifo_words - tx_words_.size() - tx_free_.size();
+		break;
+	case XLLF_RDFO_OFFSET:
+		value = rx_avail_;
+		empty_polls_ = (value == 0 && next_event() == kNever) ? empty_polls_ + 1 : 0;
+		if (empty_polls_ >= STALL_POLLS && stall_handler_ != NULL) {
+			empty_polls_ = 0;
+			stall_handler_();
+		}
+		break;
+	case XLLF_RLF_OFFSET:
+		if (rx_len_read_ || rx_packets_.empty()) {
+			isr_ |= XLLF_INT_RPUE_MASK;
+			break;
+		}
+		rx_len_read_ = true;
+		value = 4 * rx_packets_.front().words.size();
+		break;
+	case XLLF_RDFD_OFFSET:
+		if (!rx_len_read_) {
+			isr_ |= XLLF_INT_RPURE_MASK;
+			break;
+		}
+		value = rx_packets_.front().words[rx_pos_++];
+		rx_avail_--;
+		rx_words_--;
+		if (rx_pos_ == rx_packets_.front().words.size()) {
+			rx_packets_.pop_front();
+			rx_pos_ = 0;
+			rx_len_read_ = false;
+		}
+		break;
+	default:
+		break;
+	}
+	deliver_irq();
+	return value;
+}
+
+void DctFifoModel::write(uint32_t offset, uint32_t value) {
+	stats_.writes++;
+	access(timing_.axi_write_cycles);
+	switch (offset) {
+	case XLLF_ISR_OFFSET:
+		isr_ &= ~value;
+		break;
+	case XLLF_IER_OFFSET:
+		ier_ = value;
+		break;
+	case XLLF_TDFR_OFFSET:
+		if (value == RESET_KEY) {
+			reset_tx();
+		}
+		break;
+	case XLLF_TDFD_OFFSET:
+		if (tx_words_.size() + tx_free_.size() >= timing_.tx_fifo_words) {
+			isr_ |= XLLF_INT_TPOE_MASK;
+			stats_.tx_dropped++;
+			break;
+		}
+		tx_words_.push_back(value);
+		break;
+	case XLLF_TLF_OFFSET:
+		tx_commit(value);
+		break;
+	case XLLF_RDFR_OFFSET:
+		if (value == RESET_KEY) {
+			reset_rx();
+		}
+		break;
+	case XLLF_LLR_OFFSET:
+		if (value == RESET_KEY) {
+			reset_tx();
+			reset_rx();
+		}
+		break;
+	default:
+		break;
+	}
+	deliver_irq();
+}
+
+void DctFifoModel::idle_us(uint64_t us) {
+	advance(now_ + us * timing_.axi_mhz);
+	deliver_irq();
+}
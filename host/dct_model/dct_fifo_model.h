@@ -0,0 +1,176 @@
+/*
+ * dct_fifo_model.h
+ *
+ * Transaction level model of the AXI-Stream FIFO in front of the DCT core
+ * (custom_dct_axis), for running dct_fifo.c on the host. Words written to
+ * the TX FIFO go out one per cycle once their length is written, each block
+ * of 64 pixels comes back as run-length words after a fixed latency, and the
+ * core only raises TLAST when no other block has started going in, so one
+ * RX packet can hold several blocks. The RX FIFO is store-and-forward: a
+ * packet shows up in the occupancy and as receive complete once its last
+ * word is in. Words that arrive with the RX FIFO full are lost, the core
+ * doesn't wait for room.
+ *
+ * The run-length words are not a DCT, just a deterministic function of the
+ * pixels (DctFifoModel::compress) with the core's framing, so the bench can
+ * check every block.
+ *
+ * Time is counted in AXI clock cycles. Every register access costs a fixed
+ * number of cycles, as in SdControlRamModel, and so does taking the FIFO
+ * interrupt; other CPU work isn't modelled.
+ */
+
+#ifndef DCT_FIFO_MODEL_H_
+#define DCT_FIFO_MODEL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "xil_io_shim.h"
+
+// Costs, in AXI clock cycles. The access costs are the estimates
+// SdModelTiming uses, the latency is from the dct_main testbenches
+struct DctModelTiming {
+	unsigned axi_mhz = 100;
+	unsigned axi_read_cycles = 12; // one Xil_In32
+	unsigned axi_write_cycles = 8; // one Xil_Out32
+	unsigned irq_cycles = 60; // taking the interrupt and returning from it
+	unsigned dct_latency = 100; // last pixel of a block in to its first word out
+	unsigned stream_block_cycles = 32; // a block from the SD IP's m00_axis, 16 beats
+	unsigned stream_ram_sectors = 4; // sectors the SD IP's read RAM holds
+	unsigned tx_fifo_words = 128; // MAX_FIFO_LEN
+	unsigned rx_fifo_words = 128;
+};
+
+struct DctModelStats {
+	uint64_t reads = 0; // AXI reads
+	uint64_t writes = 0; // AXI writes
+	uint64_t cycles = 0; // AXI cycles since the model was made
+	uint64_t irqs = 0; // FIFO interrupts taken
+	uint64_t irq_cycles = 0; // cycles spent in the interrupt handler
+	uint64_t idle_cycles = 0; // cycles the CPU waited in wait_for_irq
+	uint64_t blocks = 0; // blocks the core finished
+	uint64_t rx_packets = 0; // packets that went into the RX FIFO
+	uint64_t rx_dropped = 0; // words lost to a full RX FIFO
+	uint64_t tx_dropped = 0; // words written to a full TX FIFO
+};
+
+class DctFifoModel : public XilIoDevice {
+public:
+	static const uintptr_t kBaseAddr = 0x44A20000; // XPAR_AXI_FIFO_0_BASEADDR
+	static const uintptr_t kSize = 0x10000;
+	static const unsigned kBlockPixels = 64;
+	static const unsigned kMaxCoeff = 66; // DCT_MAX_BLOCK_COEFF
+	static const uint16_t kEof = 0xFFFF;
+
+	typedef void (*IrqHandler)(void* ref);
+
+	// pixels_per_word is DCT_PIXELS_PER_WORD, 2 or 4 with PACKED_INPUT.
+	// With worst_case every block comes out at kMaxCoeff coefficients
+	DctFifoModel(unsigned pixels_per_word, bool worst_case,
+			const DctModelTiming& timing = DctModelTiming());
+
+	uint32_t read(uint32_t offset) override;
+	void write(uint32_t offset, uint32_t value) override;
+	void idle_us(uint64_t us) override;
+
+	// The interrupt line, delivered after any access while enabled
+	void connect_irq(IrqHandler handler, void* ref);
+	void enable_irq(bool enable) { irq_enabled_ = enable; }
+	// Let time pass until the FIFO interrupt has run, false if none can come
+	bool wait_for_irq();
+	// Called when the driver keeps polling an empty RX FIFO with nothing
+	// left in the core, it would spin forever on the board
+	void on_stall(void (*handler)()) { stall_handler_ = handler; }
+
+	// Blocks that reach the core from the SD controller instead of the TX
+	// FIFO (SD_DCT_STREAM). The card reads a sector every sector_cycles from
+	// now while the read RAM has room, and the controller sends its blocks
+	// as far as the credit, the block count last written to its reg 11
+	void stream_sectors(const uint8_t* pixels, uint32_t blocks, unsigned blocks_per_sector,
+			uint64_t sector_cycles, uint32_t credit);
+	// sd_stream_dct_credit, an AXI write to the SD controller
+	void stream_credit(uint32_t credit);
+
+	// The core's output for one block, returns the number of coefficients
+	static unsigned compress(const uint8_t* pixels, bool worst_case, uint16_t* coeff);
+
+	const DctModelStats& stats() const { return stats_; }
+	const DctModelTiming& timing() const { return timing_; }
+
+private:
+	static const uint64_t kNever = UINT64_MAX;
+
+	struct Block {
+		uint64_t in_start; // first pixel into the core
+		uint64_t out_end; // last word into the RX FIFO
+		std::vector<uint32_t> words;
+	};
+
+	struct Packet {
+		uint64_t end; // TLAST
+		std::vector<uint32_t> words;
+	};
+
+	void access(unsigned cycles);
+	void advance(uint64_t t);
+	uint64_t next_event() const;
+	void finish_block(uint64_t t);
+	void tx_commit(uint32_t bytes);
+	void add_block(const uint8_t* pixels, uint64_t in_start, uint64_t in_end);
+	void stream_more();
+	void reset_tx();
+	void reset_rx();
+	void deliver_irq();
+
+	DctModelTiming timing_;
+	DctModelStats stats_;
+	unsigned pixels_per_word_;
+	bool worst_case_;
+	uint64_t now_;
+
+	uint32_t isr_;
+	uint32_t ier_;
+	IrqHandler irq_handler_;
+	void* irq_ref_;
+	bool irq_enabled_;
+	bool in_irq_;
+	void (*stall_handler_)();
+	unsigned empty_polls_;
+
+	// TX side: words written but not committed, then packets streaming out
+	std::vector<uint32_t> tx_words_;
+	std::deque<uint64_t> tx_done_; // end of each committed packet
+	std::deque<uint64_t> tx_free_; // when each committed word leaves the FIFO
+	uint64_t tx_stream_t_; // the stream is free from here
+	std::vector<uint8_t> pixels_; // pixels of the block going into the core
+	uint64_t block_first_t_; // its first pixel
+
+	// the SD controller's stream: the image, how far it has been sent, and
+	// when each sector came into its read RAM and went out of it again
+	const uint8_t* stream_pixels_;
+	uint32_t stream_blocks_;
+	unsigned stream_blocks_per_sector_;
+	uint64_t stream_sector_cycles_;
+	uint32_t stream_credit_;
+	uint32_t stream_next_; // next block to send
+	uint64_t stream_t_; // m00_axis is free from here
+	std::vector<uint64_t> stream_in_; // sector in the read RAM
+	std::vector<uint64_t> stream_out_; // its last block sent
+
+	// the core, blocks in order of their output
+	std::deque<Block> blocks_;
+	uint64_t out_t_; // the output is free from here
+
+	// RX side
+	Packet building_; // words since the last TLAST
+	std::deque<Packet> rx_packets_; // complete, oldest first
+	uint32_t rx_avail_; // unread words of complete packets, RDFO
+	uint32_t rx_words_; // words held, complete packets and the one building
+	uint32_t rx_pos_; // next word of the front packet
+	bool rx_len_read_; // RLR was read for the front packet
+};
+
+#endif /* DCT_FIFO_MODEL_H_ */
@@ -0,0 +1,10 @@
+/*
+ * xil_cache.h
+ *
+ * Host stand-in for the Xilinx BSP header, there's no cache to manage
+ */
+
+#ifndef XIL_CACHE_H
+#define XIL_CACHE_H
+
+#endif /* XIL_CACHE_H */
@@ -0,0 +1,110 @@
+/*
+ * xllfifo.h
+ *
+ * Host stand-in for the AXI-Stream FIFO driver. The accessors are the
+ * driver's register macros, so they cost the same AXI accesses against
+ * DctFifoModel (dct_fifo_model.h) as they do on the board
+ */
+
+#ifndef XLLFIFO_H
+#define XLLFIFO_H
+
+#include "xil_types.h"
+#include "xil_io.h"
+#include "xparameters.h"
+#include "xstatus.h"
+
+/* Register offsets */
+#define XLLF_ISR_OFFSET		0x00000000 // interrupt status
+#define XLLF_IER_OFFSET		0x00000004 // interrupt enable
+#define XLLF_TDFR_OFFSET	0x00000008 // transmit reset
+#define XLLF_TDFV_OFFSET	0x0000000C // transmit vacancy
+#define XLLF_TDFD_OFFSET	0x00000010 // transmit data
+#define XLLF_TLF_OFFSET		0x00000014 // transmit length
+#define XLLF_RDFR_OFFSET	0x00000018 // receive reset
+#define XLLF_RDFO_OFFSET	0x0000001C // receive occupancy
+#define XLLF_RDFD_OFFSET	0x00000020 // receive data
+#define XLLF_RLF_OFFSET		0x00000024 // receive length
+#define XLLF_LLR_OFFSET		0x00000028 // local link reset
+
+#define XLLF_RDFR_RESET_MASK	0x000000a5
+#define XLLF_TDFR_RESET_MASK	0x000000a5
+#define XLLF_LLR_RESET_MASK		0x000000a5
+
+/* Interrupt bits */
+#define XLLF_INT_RPURE_MASK	0x80000000 // receive under-read
+#define XLLF_INT_RPORE_MASK	0x40000000 // receive over-read
+#define XLLF_INT_RPUE_MASK	0x20000000 // receive underrun (empty)
+#define XLLF_INT_TPOE_MASK	0x10000000 // transmit overrun
+#define XLLF_INT_TC_MASK	0x08000000 // transmit complete
+#define XLLF_INT_RC_MASK	0x04000000 // receive complete
+#define XLLF_INT_TSE_MASK	0x02000000 // transmit length mismatch
+#define XLLF_INT_TRC_MASK	0x01000000 // transmit reset complete
+#define XLLF_INT_RRC_MASK	0x00800000 // receive reset complete
+#define XLLF_INT_ALL_MASK	0xfff80000
+#define XLLF_INT_ERROR_MASK	(XLLF_INT_RPURE_MASK | XLLF_INT_RPORE_MASK | \
+				XLLF_INT_RPUE_MASK | XLLF_INT_TPOE_MASK | XLLF_INT_TSE_MASK)
+
+typedef struct {
+	u16 DeviceId;
+	UINTPTR BaseAddress;
+	UINTPTR Axi4BaseAddress;
+	u32 Datainterface;
+} XLlFifo_Config;
+
+typedef struct {
+	UINTPTR BaseAddress;
+	UINTPTR Axi4BaseAddress;
+	u32 IsReady;
+	u32 Datainterface;
+} XLlFifo;
+
+#define XLlFifo_ReadReg(base, offset) Xil_In32((base) + (offset))
+#define XLlFifo_WriteReg(base, offset, value) Xil_Out32((base) + (offset), (value))
+
+#define XLlFifo_Reset(inst) \
+	XLlFifo_WriteReg((inst)->BaseAddress, XLLF_LLR_OFFSET, XLLF_LLR_RESET_MASK)
+#define XLlFifo_Status(inst) XLlFifo_ReadReg((inst)->BaseAddress, XLLF_ISR_OFFSET)
+#define XLlFifo_IntClear(inst, mask) \
+	XLlFifo_WriteReg((inst)->BaseAddress, XLLF_ISR_OFFSET, (mask) & XLLF_INT_ALL_MASK)
+#define XLlFifo_IntPending(inst) \
+	(XLlFifo_ReadReg((inst)->BaseAddress, XLLF_IER_OFFSET) & \
+	 XLlFifo_ReadReg((inst)->BaseAddress, XLLF_ISR_OFFSET))
+#define XLlFifo_IntEnable(inst, mask) \
+	XLlFifo_WriteReg((inst)->BaseAddress, XLLF_IER_OFFSET, \
+		(XLlFifo_ReadReg((inst)->BaseAddress, XLLF_IER_OFFSET) | (mask)) & XLLF_INT_ALL_MASK)
+#define XLlFifo_IntDisable(inst, mask) \
+	XLlFifo_WriteReg((inst)->BaseAddress, XLLF_IER_OFFSET, \
+		XLlFifo_ReadReg((inst)->BaseAddress, XLLF_IER_OFFSET) & ~(mask))
+#define XLlFifo_iTxVacancy(inst) XLlFifo_ReadReg((inst)->BaseAddress, XLLF_TDFV_OFFSET)
+#define XLlFifo_TxPutWord(inst, word) XLlFifo_WriteReg((inst)->BaseAddress, XLLF_TDFD_OFFSET, (word))
+#define XLlFifo_iTxSetLen(inst, bytes) XLlFifo_WriteReg((inst)->BaseAddress, XLLF_TLF_OFFSET, (bytes))
+#define XLlFifo_IsTxDone(inst) \
+	((XLlFifo_ReadReg((inst)->BaseAddress, XLLF_ISR_OFFSET) & XLLF_INT_TC_MASK) ? TRUE : FALSE)
+#define XLlFifo_iRxOccupancy(inst) XLlFifo_ReadReg((inst)->BaseAddress, XLLF_RDFO_OFFSET)
+#define XLlFifo_iRxGetLen(inst) XLlFifo_ReadReg((inst)->BaseAddress, XLLF_RLF_OFFSET)
+#define XLlFifo_RxGetWord(inst) XLlFifo_ReadReg((inst)->BaseAddress, XLLF_RDFD_OFFSET)
+#define XLlFifo_IsRxDone(inst) \
+	((XLlFifo_ReadReg((inst)->BaseAddress, XLLF_ISR_OFFSET) & XLLF_INT_RC_MASK) ? TRUE : FALSE)
+
+// the one FIFO in xparameters.h, the driver really does spell it Ffio
+static inline XLlFifo_Config *XLlFfio_LookupConfig(u32 DeviceId) {
+	static XLlFifo_Config config = {XPAR_AXI_FIFO_0_DEVICE_ID, XPAR_AXI_FIFO_0_BASEADDR, 0, 0};
+
+	return DeviceId == XPAR_AXI_FIFO_0_DEVICE_ID ? &config : NULL;
+}
+
+// sets up the instance and resets the core, as the driver does
+static inline int XLlFifo_CfgInitialize(XLlFifo *InstancePtr, XLlFifo_Config *Config,
+		UINTPTR EffectiveAddress) {
+	InstancePtr->BaseAddress = EffectiveAddress;
+	InstancePtr->Axi4BaseAddress = Config->Axi4BaseAddress;
+	InstancePtr->Datainterface = Config->Datainterface;
+	InstancePtr->IsReady = 0x11111111;
+	XLlFifo_Reset(InstancePtr);
+	XLlFifo_WriteReg(InstancePtr->BaseAddress, XLLF_TDFR_OFFSET, XLLF_TDFR_RESET_MASK);
+	XLlFifo_WriteReg(InstancePtr->BaseAddress, XLLF_RDFR_OFFSET, XLLF_RDFR_RESET_MASK);
+	return XST_SUCCESS;
+}
+
+#endif /* XLLFIFO_H */
@@ -0,0 +1,16 @@
+/*
+ * xparameters.h
+ *
+ * Host stand-in for the generated BSP header, the IDs dct_fifo.h refers to.
+ * The FIFO base address only has to be clear of the other models
+ */
+
+#ifndef XPARAMETERS_H
+#define XPARAMETERS_H
+
+#define XPAR_AXI_FIFO_0_DEVICE_ID 0
+#define XPAR_AXI_FIFO_0_BASEADDR 0x44A20000
+#define XPAR_INTC_0_DEVICE_ID 0
+#define XPAR_INTC_0_LLFIFO_0_VEC_ID 0
+
+#endif /* XPARAMETERS_H */
@@ -0,0 +1,13 @@
+/*
+ * xstreamer.h
+ *
+ * Host stand-in for the Xilinx BSP header. Only brings in xil_printf, as the
+ * BSP's does through xdebug.h
+ */
+
+#ifndef XSTREAMER_H
+#define XSTREAMER_H
+
+#include "xil_printf.h"
+
+#endif /* XSTREAMER_H */
@@ -0,0 +1,229 @@
+/*
+ * sd_bench.cpp
+ *
+ * Runs the unmodified sd_card.c against SdControlRamModel and reports the
+ * modelled cost of each transfer function per sector: AXI reads and writes,
+ * AXI cycles, and the share of that time the card was clocked. Data is
+ * checked against the model's card on every run, except for sd_stream_dct
+ * where the sectors go to the DCT and only the count is checked.
+ *
+ * Usage: sd_bench [-n sectors] [--csv label]
+ *  --csv prints one line per test for sd_bench.csv instead of the table
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "sd_control_ram_model.h"
+
+extern "C" {
+#include "sd_card.h"
+}
+
+namespace {
+
+const int XFER_LEN = 511; // sd_read/sd_write limit
+
+struct Result {
+	const char* name;
+	uint32_t sectors;
+	SdModelStats stats;
+};
+
+int n_errors = 0;
+
+uint8_t pattern(uint32_t sector, uint32_t i) {
+	return (uint8_t)(sector * 31 + i * 7 + 3);
+}
+
+void fill_card(SdControlRamModel& model, uint32_t first, uint32_t count) {
+	for (uint32_t s = 0; s < count; s++) {
+		for (uint32_t i = 0; i < 512; i++) {
+			model.sector(first + s)[i] = pattern(first + s, i);
+		}
+	}
+}
+
+void check(const char* name, uint32_t sector, const uint8_t* data, int len) {
+	for (int i = 0; i < len; i++) {
+		if (data[i] != pattern(sector, i)) {
+			std::fprintf(stderr, "%s: sector %u byte %d = %02x, expected %02x\n",
+					name, sector, i, data[i], pattern(sector, i));
+			n_errors++;
+			return;
+		}
+	}
+}
+
+SdModelStats diff(const SdModelStats& after, const SdModelStats& before) {
+	SdModelStats d;
+	d.reads = after.reads - before.reads;
+	d.writes = after.writes - before.writes;
+	d.cycles = after.cycles - before.cycles;
+	d.sectors_read = after.sectors_read - before.sectors_read;
+	d.sectors_written = after.sectors_written - before.sectors_written;
+	d.card_busy_cycles = after.card_busy_cycles - before.card_busy_cycles;
+	return d;
+}
+
+// One test on a fresh model, after the card is identified
+template <typename Fn>
+Result run(const char* name, uint32_t sectors, bool fast_clock, Fn body) {
+	SdControlRamModel model(2 * sectors + 16);
+
+	xil_io_detach_all();
+	xil_io_attach(SdControlRamModel::kBaseAddr, SdControlRamModel::kSize, &model);
+	if (fast_clock) {
+		sd_card_init();
+	}
+	else {
+		while (!model.idle()) {
+			model.idle_cycles(1000);
+		}
+	}
+	SdModelStats before = model.stats();
+	body(model);
+	Result r = {name, sectors, diff(model.stats(), before)};
+	xil_io_detach_all();
+	return r;
+}
+
+Result bench_read(const char* name, uint32_t sectors, bool fast_clock) {
+	return run(name, sectors, fast_clock, [&](SdControlRamModel& model) {
+		std::vector<uint8_t> buf(SD_SECTOR_LEN);
+		fill_card(model, 0, sectors);
+		for (uint32_t s = 0; s < sectors; s++) {
+			sd_read(s, XFER_LEN, buf.data());
+			check(name, s, buf.data(), XFER_LEN);
+		}
+	});
+}
+
+Result bench_write(const char* name, uint32_t sectors) {
+	return run(name, sectors, true, [&](SdControlRamModel& model) {
+		std::vector<uint8_t> buf(SD_SECTOR_LEN);
+		for (uint32_t s = 0; s < sectors; s++) {
+			for (int i = 0; i < XFER_LEN; i++) {
+				buf[i] = pattern(s, i);
+			}
+			sd_write(s, XFER_LEN, buf.data());
+		}
+		// sd_write returns once the card has the command
+		while (sd_busy()) {
+			sd_card_poll();
+		}
+		for (uint32_t s = 0; s < sectors; s++) {
+			check(name, s, model.sector(s), XFER_LEN);
+		}
+	});
+}
+
+Result bench_read_multi(const char* name, uint32_t sectors) {
+	return run(name, sectors, true, [&](SdControlRamModel& model) {
+		std::vector<uint8_t> buf((size_t)sectors * SD_SECTOR_LEN);
+		fill_card(model, 0, sectors);
+		if (sd_read_multi(0, sectors, buf.data()) != XST_SUCCESS) {
+			std::fprintf(stderr, "%s: read failed\n", name);
+			n_errors++;
+		}
+		for (uint32_t s = 0; s < sectors; s++) {
+			check(name, s, &buf[(size_t)s * SD_SECTOR_LEN], SD_SECTOR_LEN);
+		}
+	});
+}
+
+Result bench_write_multi(const char* name, uint32_t sectors) {
+	return run(name, sectors, true, [&](SdControlRamModel& model) {
+		std::vector<uint8_t> buf(SD_SECTOR_LEN);
+		sd_write_start(0);
+		for (uint32_t s = 0; s < sectors; s++) {
+			for (int i = 0; i < SD_SECTOR_LEN; i++) {
+				buf[i] = pattern(s, i);
+			}
+			if (sd_write_append(SD_SECTOR_LEN, buf.data()) != XST_SUCCESS) {
+				std::fprintf(stderr, "%s: write failed\n", name);
+				n_errors++;
+				break;
+			}
+		}
+		sd_write_end();
+		for (uint32_t s = 0; s < sectors; s++) {
+			check(name, s, model.sector(s), SD_SECTOR_LEN);
+		}
+	});
+}
+
+Result bench_stream_dct(const char* name, uint32_t sectors) {
+	return run(name, sectors, true, [&](SdControlRamModel& model) {
+		uint64_t before = model.stats().sectors_read;
+		fill_card(model, 0, sectors);
+		// m_axis is always ready here, no DCT to hold the stream back
+		sd_stream_dct_start(0, sectors, sectors * SD_BLOCKS_PER_SECTOR);
+		if (sd_stream_dct_end() != XST_SUCCESS || model.stats().sectors_read - before != sectors) {
+			std::fprintf(stderr, "%s: stream failed\n", name);
+			n_errors++;
+		}
+	});
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+	uint32_t sectors = 64;
+	const char* csv_label = NULL;
+
+	for (int i = 1; i < argc; i++) {
+		if (std::strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+			sectors = std::strtoul(argv[++i], NULL, 0);
+		}
+		else if (std::strcmp(argv[i], "--csv") == 0 && i + 1 < argc) {
+			csv_label = argv[++i];
+		}
+		else {
+			std::fprintf(stderr, "usage: %s [-n sectors] [--csv label]\n", argv[0]);
+			return 2;
+		}
+	}
+	if (sectors == 0) {
+		sectors = 1;
+	}
+
+	xil_printf_quiet = 1;
+	std::vector<Result> results;
+	results.push_back(bench_read("sd_read", sectors, true));
+	results.push_back(bench_read("sd_read_slow_clock", sectors, false));
+	results.push_back(bench_write("sd_write", sectors));
+	results.push_back(bench_read_multi("sd_read_multi", sectors));
+	results.push_back(bench_write_multi("sd_write_append", sectors));
+	results.push_back(bench_stream_dct("sd_stream_dct", sectors));
+
+	SdModelTiming timing;
+	if (csv_label != NULL) {
+		for (const Result& r : results) {
+			std::printf("%s,%s,%u,%.1f,%.1f,%.0f,%.3f\n", csv_label, r.name, r.sectors,
+					(double)r.stats.reads / r.sectors, (double)r.stats.writes / r.sectors,
+					(double)r.stats.cycles / r.sectors,
+					(double)r.stats.card_busy_cycles / r.stats.cycles);
+		}
+	}
+	else {
+		std::printf("%u sectors, AXI at %u MHz, %u/%u cycles per read/write access\n",
+				sectors, timing.axi_mhz, timing.axi_read_cycles, timing.axi_write_cycles);
+		std::printf("%-20s %10s %10s %12s %12s %10s\n", "per sector", "AXI reads",
+				"AXI writes", "cycles", "us", "card busy");
+		for (const Result& r : results) {
+			double cycles = (double)r.stats.cycles / r.sectors;
+			std::printf("%-20s %10.1f %10.1f %12.0f %12.1f %9.0f%%\n", r.name,
+					(double)r.stats.reads / r.sectors, (double)r.stats.writes / r.sectors,
+					cycles, cycles / timing.axi_mhz,
+					100.0 * r.stats.card_busy_cycles / r.stats.cycles);
+		}
+	}
+	if (n_errors != 0) {
+		std::fprintf(stderr, "FAILED: %d mismatches\n", n_errors);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,444 @@
+/*
+ * sd_control_ram_model.cpp
+ *
+ * See sd_control_ram_model.h
+ */
+
+#include "sd_control_ram_model.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// Register numbers and command bits, as in sd_card.h
+enum {
+	REG_CMD = 0, REG_STATUS, REG_ADDR, REG_DEBUG, REG_WRITE, REG_RD_DATA,
+	REG_RAM_CMD, REG_WADDR, REG_RADDR, REG_BURST_RD, REG_BURST_WR,
+	REG_RD_ACK, REG_BLOCK_CNT, REG_RD_CNT, REG_WR_CNT, REG_WR_DONE,
+};
+const uint32_t CMD_RESET = 0x1;
+const uint32_t CMD_WRITE = 0x2;
+const uint32_t CMD_READ = 0x4;
+const uint32_t CMD_READ_MULTI = 0x8;
+const uint32_t CMD_WRITE_MULTI = 0x10;
+const uint32_t CMD_STREAM = 0x20;
+const uint32_t CMD_IRQ_EN = 0x100;
+const uint32_t CMD_RAM_WRITE = 0x2;
+const uint32_t CMD_RAM_READ = 0x4;
+
+// Bytes clocked for a data block: token, 512 bytes and the CRC
+const uint64_t BLOCK_BYTES = 515;
+
+} // namespace
+
+SdControlRamModel::SdControlRamModel(uint32_t sectors, const SdModelTiming& timing)
+	: timing_(timing), sectors_(sectors), card_((size_t)sectors * kSectorLen, 0),
+	  spi_div_(kInitDiv), phase_(Phase::Boot), now_(0), t_(0), phase_end_(0),
+	  release_t_(0), cmd_t_(0), blocks_read_(0), blocks_written_(0),
+	  block_total_(1), address_(0), multi_(false), done_(false), error_(false),
+	  strm_armed_(false), strm_sending_(false), strm_sectors_(0), strm_blocks_(0), strm_t_(0),
+	  strm_avail_t_(0), irq_handler_(NULL), irq_ref_(NULL), in_irq_(false) {
+	std::memset(rd_ram_, 0, sizeof(rd_ram_));
+	std::memset(wr_ram_, 0, sizeof(wr_ram_));
+	std::memset(reg_, 0, sizeof(reg_));
+	phase_end_ = boot_cycles();
+}
+
+// Power up wait at the full sd_clock, then identification at the divider
+uint64_t SdControlRamModel::boot_cycles() const {
+	return (uint64_t)timing_.boot_sd_clocks * timing_.sd_clock_ratio +
+			timing_.init_bytes * byte_cycles();
+}
+
+// AXI cycles for 8 SPI clocks, the controller moves once per divided sd_clock
+uint64_t SdControlRamModel::byte_cycles() const {
+	return 16ull * (spi_div_ + 1) * timing_.sd_clock_ratio;
+}
+
+uint16_t SdControlRamModel::rd_sectors_held() const {
+	bool stream_en = reg_[REG_CMD] & CMD_STREAM;
+	return blocks_read_ - (stream_en ? strm_sectors_ : (uint16_t)reg_[REG_RD_ACK]);
+}
+
+uint16_t SdControlRamModel::wr_sectors_held() const {
+	return (uint16_t)reg_[REG_WR_CNT] - blocks_written_;
+}
+
+// rd_ram[slv_reg8], rd_ram[slv_reg8+1], ... wrapping inside the sector
+uint32_t SdControlRamModel::rd_word() const {
+	uint32_t base = ((reg_[REG_RADDR] >> 9) % kRamSectors) * kSectorLen;
+	uint32_t word = 0;
+
+	for (unsigned i = 0; i < 4; i++) {
+		word |= (uint32_t)rd_ram_[base + ((reg_[REG_RADDR] + i) & (kSectorLen - 1))] << (8 * i);
+	}
+	return word;
+}
+
+// The RAM command register acts every clock while a bit is set
+void SdControlRamModel::ram_cmd() {
+	if (reg_[REG_RAM_CMD] & CMD_RAM_WRITE) {
+		wr_ram_[reg_[REG_WADDR] % sizeof(wr_ram_)] = (uint8_t)reg_[REG_WRITE];
+	}
+	if (reg_[REG_RAM_CMD] & CMD_RAM_READ) {
+		reg_[REG_RD_DATA] = rd_word() & 0xFF;
+	}
+}
+
+// sd_controller1 state number for the debug register
+unsigned SdControlRamModel::state_number() const {
+	switch (phase_) {
+	case Phase::Reset: return 0; // RST
+	case Phase::Boot: return 5; // POLL_CMD
+	case Phase::Idle: return 6; // IDLE
+	case Phase::Read: return 9; // READ_BLOCK_DATA
+	case Phase::ReadHold: return 23; // READ_MULTI_NEXT
+	case Phase::Stop: return 25; // STOP_WAIT
+	case Phase::Write: return 16; // WRITE_BLOCK_DATA
+	case Phase::WriteHold: return 26; // WRITE_MULTI_NEXT
+	case Phase::WriteStop: return 27; // WRITE_STOP_BYTE
+	default: return 11; // SEND_CMD
+	}
+}
+
+void SdControlRamModel::run(Phase phase, uint64_t t, uint64_t bytes) {
+	phase_ = phase;
+	phase_end_ = t + bytes * byte_cycles();
+	stats_.card_busy_cycles += phase_end_ - t;
+}
+
+// Back to idle with the command done
+void SdControlRamModel::finish(uint64_t t) {
+	phase_ = Phase::Idle;
+	multi_ = false;
+	done_ = true;
+	t_ = t;
+}
+
+uint64_t SdControlRamModel::next_ctrl_event() const {
+	uint32_t cmd = reg_[REG_CMD];
+
+	switch (phase_) {
+	case Phase::Reset:
+		return kNever;
+	case Phase::Idle:
+		if (cmd & (CMD_READ | CMD_READ_MULTI | CMD_WRITE | CMD_WRITE_MULTI)) {
+			return std::max(t_, cmd_t_);
+		}
+		return kNever;
+	case Phase::ReadHold:
+		if (rd_sectors_held() < kRamSectors) {
+			return std::max(t_, release_t_);
+		}
+		return kNever;
+	case Phase::WriteHold:
+		if (wr_sectors_held() != 0 || !(cmd & CMD_WRITE_MULTI)) {
+			return std::max(t_, release_t_);
+		}
+		return kNever;
+	default:
+		return phase_end_;
+	}
+}
+
+uint64_t SdControlRamModel::next_stream_event() const {
+	if (!(reg_[REG_CMD] & CMD_STREAM)) {
+		return kNever;
+	}
+	if (strm_sending_) {
+		return strm_t_;
+	}
+	// reg 11 is the number of blocks the stream may send
+	if (strm_armed_ && rd_sectors_held() != 0 && strm_blocks_ != (uint16_t)reg_[REG_RD_ACK]) {
+		return std::max(strm_t_, strm_avail_t_);
+	}
+	return kNever;
+}
+
+void SdControlRamModel::ctrl_step(uint64_t t) {
+	uint32_t cmd = reg_[REG_CMD];
+
+	t_ = t;
+	switch (phase_) {
+	case Phase::Boot:
+		finish(t);
+		break;
+	case Phase::Idle:
+		done_ = false;
+		error_ = false;
+		address_ = reg_[REG_ADDR];
+		if (cmd & CMD_STREAM) {
+			strm_armed_ = true;
+		}
+		if (cmd & (CMD_READ | CMD_READ_MULTI)) {
+			blocks_read_ = 0;
+			multi_ = cmd & CMD_READ_MULTI;
+			block_total_ = (uint16_t)reg_[REG_BLOCK_CNT] == 0 ? 1 : (uint16_t)reg_[REG_BLOCK_CNT];
+			if (address_ >= sectors_) {
+				run(Phase::Reject, t, timing_.cmd_bytes);
+			}
+			else {
+				run(Phase::Read, t, timing_.cmd_bytes + timing_.nac_bytes + BLOCK_BYTES);
+			}
+		}
+		else {
+			blocks_written_ = 0;
+			multi_ = cmd & CMD_WRITE_MULTI;
+			if (address_ >= sectors_) {
+				run(Phase::Reject, t, timing_.cmd_bytes);
+			}
+			else {
+				run(Phase::WriteCmd, t, timing_.cmd_bytes);
+			}
+		}
+		break;
+	case Phase::Reject:
+		error_ = true;
+		finish(t);
+		break;
+	case Phase::Read: {
+		// Card data lands one byte into the RAM sector, the last byte wraps to 0
+		uint8_t* ram = &rd_ram_[(blocks_read_ % kRamSectors) * kSectorLen];
+		const uint8_t* data = sector((address_ + blocks_read_) % sectors_);
+		for (unsigned i = 0; i < kSectorLen; i++) {
+			ram[(i + 1) % kSectorLen] = data[i];
+		}
+		blocks_read_++;
+		stats_.sectors_read++;
+		strm_avail_t_ = t;
+		if (!multi_) {
+			finish(t);
+		}
+		else if (blocks_read_ == block_total_) {
+			// CMD12 and the stuff byte, R1 and the card busy
+			run(Phase::Stop, t, timing_.cmd_bytes + 1 + timing_.busy_bytes);
+		}
+		else {
+			phase_ = Phase::ReadHold;
+		}
+		break;
+	}
+	case Phase::ReadHold:
+		run(Phase::Read, t, timing_.nac_bytes + BLOCK_BYTES);
+		break;
+	case Phase::Stop:
+	case Phase::WriteStop:
+		finish(t);
+		break;
+	case Phase::WriteCmd:
+		if (multi_) {
+			phase_ = Phase::WriteHold;
+		}
+		else {
+			run(Phase::Write, t, BLOCK_BYTES + 1 + timing_.busy_bytes);
+		}
+		break;
+	case Phase::Write: {
+		const uint8_t* ram = &wr_ram_[(blocks_written_ % kRamSectors) * kSectorLen];
+		std::memcpy(sector((address_ + blocks_written_) % sectors_), ram, kSectorLen);
+		blocks_written_++;
+		stats_.sectors_written++;
+		if (multi_) {
+			phase_ = Phase::WriteHold;
+		}
+		else {
+			finish(t);
+		}
+		break;
+	}
+	case Phase::WriteHold:
+		if (wr_sectors_held() != 0) {
+			run(Phase::Write, t, BLOCK_BYTES + 1 + timing_.busy_bytes);
+		}
+		else {
+			// Stop token, a byte and the card busy
+			run(Phase::WriteStop, t, 2 + timing_.busy_bytes);
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+// m_axis, always ready: a block goes out stream_block_cycles after it
+// starts, and the sector goes back to the card after its last block
+void SdControlRamModel::stream_step(uint64_t t) {
+	if (strm_sending_) {
+		strm_sending_ = false;
+		strm_blocks_++;
+		if (strm_blocks_ % kStreamBlocks == 0) {
+			strm_sectors_++;
+			release_t_ = std::max(release_t_, t);
+		}
+	}
+	else {
+		strm_sending_ = true;
+		strm_t_ = t + timing_.stream_block_cycles;
+		return;
+	}
+	strm_t_ = t;
+}
+
+void SdControlRamModel::connect_irq(IrqHandler handler, void* ref) {
+	irq_handler_ = handler;
+	irq_ref_ = ref;
+}
+
+// sd_irq is done while the command register enables it
+bool SdControlRamModel::irq() const {
+	return done_ && (reg_[REG_CMD] & CMD_IRQ_EN);
+}
+
+// The handler's own accesses don't interrupt it again
+void SdControlRamModel::deliver_irq() {
+	if (irq_handler_ != NULL && !in_irq_ && irq()) {
+		in_irq_ = true;
+		irq_handler_(irq_ref_);
+		in_irq_ = false;
+	}
+}
+
+// Run the controller and the stream up to the bus time, in time order
+void SdControlRamModel::advance() {
+	for (;;) {
+		uint64_t tc = next_ctrl_event();
+		uint64_t ts = next_stream_event();
+		if (std::min(tc, ts) > now_) {
+			break;
+		}
+		if (ts <= tc) {
+			stream_step(ts);
+		}
+		else {
+			ctrl_step(tc);
+		}
+	}
+	stats_.cycles = now_;
+}
+
+uint32_t SdControlRamModel::read(uint32_t offset) {
+	unsigned n = (offset >> 2) & 0xF;
+	uint32_t value;
+
+	now_ += timing_.axi_read_cycles;
+	stats_.reads++;
+	advance();
+	switch (n) {
+	case REG_STATUS:
+		value = (phase_ == Phase::Idle) | (phase_ != Phase::Idle) << 3 |
+				done_ << 4 | error_ << 5;
+		break;
+	case REG_DEBUG:
+		value = (uint32_t)spi_div_ << 8 | state_number();
+		break;
+	case REG_BURST_RD:
+		value = rd_word();
+		reg_[REG_RADDR] = (reg_[REG_RADDR] & ~0x1FFu) | ((reg_[REG_RADDR] + 4) & 0x1FF);
+		break;
+	case REG_RD_ACK:
+		value = (reg_[REG_CMD] & CMD_STREAM) ? strm_sectors_ : reg_[REG_RD_ACK];
+		break;
+	case REG_RD_CNT:
+		value = blocks_read_;
+		break;
+	case REG_WR_DONE:
+		value = blocks_written_;
+		break;
+	default:
+		value = reg_[n];
+		break;
+	}
+	ram_cmd();
+	deliver_irq();
+	return value;
+}
+
+void SdControlRamModel::write(uint32_t offset, uint32_t value) {
+	unsigned n = (offset >> 2) & 0xF;
+	uint32_t old_cmd = reg_[REG_CMD];
+
+	now_ += timing_.axi_write_cycles;
+	stats_.writes++;
+	advance();
+	switch (n) {
+	case REG_CMD:
+		reg_[REG_CMD] = value;
+		cmd_t_ = now_;
+		release_t_ = now_;
+		if (value & CMD_RESET) {
+			// The card is identified again at the slow clock
+			spi_div_ = kInitDiv;
+			phase_ = Phase::Reset;
+			blocks_read_ = 0;
+			blocks_written_ = 0;
+			multi_ = false;
+			error_ = false;
+			done_ = false;
+			strm_armed_ = false;
+			strm_sending_ = false;
+			strm_sectors_ = 0;
+			strm_blocks_ = 0;
+		}
+		else if (phase_ == Phase::Reset) {
+			t_ = now_;
+			phase_ = Phase::Boot;
+			phase_end_ = now_ + boot_cycles();
+		}
+		if (!(value & CMD_STREAM)) {
+			strm_armed_ = false;
+			strm_sending_ = false;
+			strm_sectors_ = 0;
+			strm_blocks_ = 0;
+		}
+		else if (!(old_cmd & CMD_STREAM)) {
+			strm_t_ = now_;
+			strm_armed_ = (phase_ != Phase::Idle);
+		}
+		break;
+	case REG_STATUS:
+	case REG_RD_DATA:
+	case REG_BURST_RD:
+	case REG_RD_CNT:
+	case REG_WR_DONE:
+		// read only
+		break;
+	case REG_DEBUG:
+		spi_div_ = (value >> 8) & 0xFF;
+		break;
+	case REG_BURST_WR: {
+		uint32_t addr = reg_[REG_WADDR] & ~3u;
+		for (unsigned i = 0; i < 4; i++) {
+			wr_ram_[(addr + i) % sizeof(wr_ram_)] = value >> (8 * i);
+		}
+		reg_[REG_BURST_WR] = value;
+		reg_[REG_WADDR] += 4;
+		break;
+	}
+	case REG_RD_ACK:
+	case REG_WR_CNT:
+		reg_[n] = value;
+		release_t_ = now_;
+		// more blocks for a stream waiting on its credit, from now on
+		if (n == REG_RD_ACK && !strm_sending_) {
+			strm_t_ = std::max(strm_t_, now_);
+		}
+		break;
+	default:
+		reg_[n] = value;
+		break;
+	}
+	ram_cmd();
+	advance();
+	deliver_irq();
+}
+
+void SdControlRamModel::idle_cycles(uint64_t cycles) {
+	now_ += cycles;
+	advance();
+	deliver_irq();
+}
+
+void SdControlRamModel::idle_us(uint64_t us) {
+	idle_cycles(us * timing_.axi_mhz);
+}
@@ -0,0 +1,154 @@
+/*
+ * sd_control_ram_model.h
+ *
+ * Transaction level model of the sd_control_ram IP (src/sd_card) and the
+ * card behind it, for running sd_card.c on the host. The 16 registers, the
+ * read and write RAMs and the burst/stream ports behave as in
+ * sd_control_ram_v1_0_S00_AXI.v. sd_controller1 is modelled by the SPI
+ * bytes each command clocks, so the modelled time follows the SPI clock
+ * divider, the sector count and how fast the driver gives RAM sectors back.
+ *
+ * Time is counted in AXI clock cycles. Every register access costs a fixed
+ * number of cycles; the CPU work between accesses isn't modelled.
+ *
+ * sd_irq goes to a handler given with connect_irq, which runs after any
+ * access or idle time that leaves the line high, as the interrupt would.
+ */
+
+#ifndef SD_CONTROL_RAM_MODEL_H_
+#define SD_CONTROL_RAM_MODEL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "xil_io_shim.h"
+
+// Costs, in AXI clock cycles unless noted. The access costs are estimates of
+// a MicroBlaze load/store through the AXI interconnect, not measurements
+struct SdModelTiming {
+	unsigned axi_mhz = 100;
+	unsigned axi_read_cycles = 12; // one Xil_In32
+	unsigned axi_write_cycles = 8; // one Xil_Out32
+	unsigned sd_clock_ratio = 2; // AXI clocks per sd_clock, 100MHz/50MHz
+	unsigned boot_sd_clocks = 100; // BOOT_CYCLES, shortened as in the testbenches
+	unsigned init_bytes = 100; // 80 dummy clocks and CMD0/8/58, 3 ACMD41s
+	unsigned cmd_bytes = 9; // a command and its R1
+	unsigned nac_bytes = 4; // 0xFF bytes before a data token
+	unsigned busy_bytes = 4; // card busy after a written block or a stop
+	unsigned stream_block_cycles = 32; // one 8x8 block out of m_axis, 64 bytes in 16 beats
+};
+
+struct SdModelStats {
+	uint64_t reads = 0; // AXI reads
+	uint64_t writes = 0; // AXI writes
+	uint64_t cycles = 0; // AXI cycles since the model was made
+	uint64_t sectors_read = 0; // blocks the card sent
+	uint64_t sectors_written = 0; // blocks the card programmed
+	uint64_t card_busy_cycles = 0; // cycles the SPI clock was running
+};
+
+class SdControlRamModel : public XilIoDevice {
+public:
+	static const uintptr_t kBaseAddr = 0x44A00000; // SPI_SD_ADDR
+	static const uintptr_t kSize = 0x10000;
+
+	typedef void (*IrqHandler)(void* ref);
+
+	explicit SdControlRamModel(uint32_t sectors, const SdModelTiming& timing = SdModelTiming());
+
+	uint32_t read(uint32_t offset) override;
+	void write(uint32_t offset, uint32_t value) override;
+	void idle_us(uint64_t us) override;
+	void idle_cycles(uint64_t cycles);
+
+	// The sd_irq line and the handler it runs, sd_card_irq_handler
+	void connect_irq(IrqHandler handler, void* ref);
+	bool irq() const;
+
+	// Card contents, 512 bytes per sector
+	uint8_t* sector(uint32_t n) { return &card_[(size_t)n * kSectorLen]; }
+	uint32_t sectors() const { return sectors_; }
+	const SdModelStats& stats() const { return stats_; }
+	const SdModelTiming& timing() const { return timing_; }
+	bool idle() const { return phase_ == Phase::Idle; }
+
+private:
+	static const unsigned kSectorLen = 512;
+	static const unsigned kRamSectors = 4; // C_RD_SECTORS, C_WR_SECTORS
+	static const uint8_t kInitDiv = 62; // C_SPI_INIT_DIV
+	static const uint64_t kNever = UINT64_MAX;
+	static const unsigned kStreamBlocks = 7; // C_STREAM_BYTES/64, blocks sent per sector
+
+	// sd_controller1, the SPI transfers between its waits
+	enum class Phase {
+		Reset, // held by CMD_RESET
+		Boot, // power up wait and card identification
+		Idle,
+		Reject, // a command the card answered with an error
+		Read, // command or next block of a read
+		ReadHold, // multi read waiting for a free RAM sector
+		Stop, // CMD12 and the card busy after it
+		WriteCmd, // CMD24/CMD25 and its R1
+		Write, // one block and the card busy after it
+		WriteHold, // multi write waiting for a sector or the end
+		WriteStop, // stop token and the card busy after it
+	};
+
+	void advance();
+	uint64_t next_ctrl_event() const;
+	uint64_t next_stream_event() const;
+	void ctrl_step(uint64_t t);
+	void stream_step(uint64_t t);
+	void finish(uint64_t t);
+	void run(Phase phase, uint64_t t, uint64_t bytes);
+	uint64_t byte_cycles() const;
+	uint64_t boot_cycles() const;
+	uint16_t rd_sectors_held() const;
+	uint16_t wr_sectors_held() const;
+	uint32_t rd_word() const;
+	void ram_cmd();
+	unsigned state_number() const;
+	void deliver_irq();
+
+	SdModelTiming timing_;
+	SdModelStats stats_;
+	uint32_t sectors_;
+	std::vector<uint8_t> card_;
+	uint8_t rd_ram_[kRamSectors * kSectorLen];
+	uint8_t wr_ram_[kRamSectors * kSectorLen];
+
+	// AXI registers, reg_[n] is slv_regn
+	uint32_t reg_[16];
+	uint8_t spi_div_;
+
+	// Controller
+	Phase phase_;
+	uint64_t now_; // bus time
+	uint64_t t_; // time of the controller's last step
+	uint64_t phase_end_; // end of a timed phase
+	uint64_t release_t_; // latest write or stream beat that can end a hold
+	uint64_t cmd_t_; // last write to the command register
+	uint16_t blocks_read_;
+	uint16_t blocks_written_;
+	uint16_t block_total_;
+	uint32_t address_;
+	bool multi_;
+	bool done_;
+	bool error_;
+
+	// m_axis
+	bool strm_armed_;
+	bool strm_sending_;
+	uint16_t strm_sectors_;
+	uint16_t strm_blocks_;
+	uint64_t strm_t_; // the stream is free from here
+	uint64_t strm_avail_t_; // the last sector came into the read RAM
+
+	// sd_irq
+	IrqHandler irq_handler_;
+	void* irq_ref_;
+	bool in_irq_;
+};
+
+#endif /* SD_CONTROL_RAM_MODEL_H_ */
@@ -0,0 +1,204 @@
+/*
+ * sd_irq_test.cpp
+ *
+ * Runs sd_card.c built with SD_INT_IRQ_ID against SdControlRamModel, with
+ * sd_irq connected to sd_card_irq_handler. The blocking calls then wait on
+ * the flag the handler clears without touching the bus, so a second thread
+ * lets the card's time pass and takes the interrupt, as the board would.
+ * Checks the data sd_read and sd_write move, that every async command is
+ * finished once with its status, and that sd_card_poll leaves them to the
+ * handler.
+ *
+ * Usage: sd_irq_test [-n sectors]
+ */
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "sd_control_ram_model.h"
+
+extern "C" {
+#include "sd_card.h"
+}
+
+#ifndef SD_INT_IRQ_ID
+#error "sd_irq_test needs sd_card.h with SD_INT_IRQ_ID, see the Makefile"
+#endif
+
+namespace {
+
+const int XFER_LEN = 511; // sd_read/sd_write limit
+const uint64_t TICK_CYCLES = 100; // card time per step of the clock thread
+
+int n_errors = 0;
+std::atomic<uint32_t> n_irqs(0);
+
+// The bus as both threads see it, one access at a time. The handler's
+// accesses come from the clock thread while it holds the lock
+class LockedBus : public XilIoDevice {
+public:
+	explicit LockedBus(SdControlRamModel& model) : model_(model) {}
+
+	uint32_t read(uint32_t offset) override {
+		std::lock_guard<std::recursive_mutex> lock(lock_);
+		return model_.read(offset);
+	}
+	void write(uint32_t offset, uint32_t value) override {
+		std::lock_guard<std::recursive_mutex> lock(lock_);
+		model_.write(offset, value);
+	}
+	void idle_us(uint64_t us) override {
+		std::lock_guard<std::recursive_mutex> lock(lock_);
+		model_.idle_us(us);
+	}
+	void tick() {
+		std::lock_guard<std::recursive_mutex> lock(lock_);
+		model_.idle_cycles(TICK_CYCLES);
+	}
+
+private:
+	SdControlRamModel& model_;
+	std::recursive_mutex lock_;
+};
+
+struct Completion {
+	uint32_t calls = 0;
+	int status = XST_FAILURE;
+};
+
+void on_irq(void* ref) {
+	n_irqs++;
+	sd_card_irq_handler(ref);
+}
+
+void on_done(void* ref, int status) {
+	Completion* c = static_cast<Completion*>(ref);
+	c->calls++;
+	c->status = status;
+}
+
+uint8_t pattern(uint32_t sector, uint32_t i) {
+	return (uint8_t)(sector * 13 + i * 5 + 1);
+}
+
+void check(const char* name, uint32_t sector, const uint8_t* data, int len) {
+	for (int i = 0; i < len; i++) {
+		if (data[i] != pattern(sector, i)) {
+			std::fprintf(stderr, "%s: sector %u byte %d = %02x, expected %02x\n",
+					name, sector, i, data[i], pattern(sector, i));
+			n_errors++;
+			return;
+		}
+	}
+}
+
+// The command has finished once, with the status it should have, and
+// polling doesn't finish it again
+void check_done(const char* name, const Completion& c, int status) {
+	for (int i = 0; i < 10; i++) {
+		sd_card_poll();
+	}
+	if (c.calls != 1 || c.status != status) {
+		std::fprintf(stderr, "%s: callback ran %u times with %d, expected once with %d\n",
+				name, c.calls, c.status, status);
+		n_errors++;
+	}
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+	uint32_t sectors = 16;
+
+	for (int i = 1; i < argc; i++) {
+		if (std::strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+			sectors = std::strtoul(argv[++i], NULL, 0);
+		}
+		else {
+			std::fprintf(stderr, "usage: %s [-n sectors]\n", argv[0]);
+			return 2;
+		}
+	}
+	if (sectors == 0) {
+		sectors = 1;
+	}
+
+	xil_printf_quiet = 1;
+	SdControlRamModel model(2 * sectors);
+	LockedBus bus(model);
+	std::vector<uint8_t> buf(SD_SECTOR_LEN);
+
+	xil_io_attach(SdControlRamModel::kBaseAddr, SdControlRamModel::kSize, &bus);
+	model.connect_irq(on_irq, NULL);
+	while (!model.idle()) {
+		bus.tick();
+	}
+	sd_card_init();
+
+	std::atomic<bool> done(false);
+	std::thread clock([&] {
+		while (!done) {
+			bus.tick();
+			std::this_thread::yield();
+		}
+	});
+
+	// sd_write returns once the card has the command, the next call waits
+	for (uint32_t s = 0; s < sectors; s++) {
+		for (int i = 0; i < XFER_LEN; i++) {
+			buf[i] = pattern(s, i);
+		}
+		sd_write(s, XFER_LEN, buf.data());
+	}
+	for (uint32_t s = 0; s < sectors; s++) {
+		std::memset(buf.data(), 0, buf.size());
+		sd_read(s, XFER_LEN, buf.data());
+		check("sd_read", s, buf.data(), XFER_LEN);
+		check("sd_write", s, model.sector(s), XFER_LEN);
+	}
+
+	Completion rd;
+	std::memset(buf.data(), 0, buf.size());
+	if (sd_read_async(0, XFER_LEN, buf.data(), on_done, &rd) != XST_SUCCESS) {
+		std::fprintf(stderr, "sd_read_async: refused\n");
+		n_errors++;
+	}
+	// only the handler may finish it, the interrupt count tells
+	while (sd_busy()) {
+		sd_card_poll();
+	}
+	check_done("sd_read_async", rd, XST_SUCCESS);
+	check("sd_read_async", 0, buf.data(), XFER_LEN);
+
+	// past the end of the card, rejected
+	Completion bad;
+	if (sd_read_async(model.sectors(), XFER_LEN, buf.data(), on_done, &bad) != XST_SUCCESS) {
+		std::fprintf(stderr, "sd_read_async: refused\n");
+		n_errors++;
+	}
+	// only the handler may finish it, the interrupt count tells
+	while (sd_busy()) {
+		sd_card_poll();
+	}
+	check_done("sd_read_async rejected", bad, XST_FAILURE);
+
+	done = true;
+	clock.join();
+	xil_io_detach_all();
+
+	std::printf("%u sectors written and read back, %u interrupts\n", sectors, (unsigned)n_irqs);
+	if (n_irqs != 2 * sectors + 2) {
+		std::fprintf(stderr, "expected an interrupt per command, %u\n", 2 * sectors + 2);
+		n_errors++;
+	}
+	if (n_errors != 0) {
+		std::fprintf(stderr, "FAILED: %d errors\n", n_errors);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,26 @@
+/*
+ * sleep.h
+ *
+ * Host stand-in for the Xilinx BSP header. Sleeping advances the attached
+ * device models instead of the host clock
+ */
+
+#ifndef SLEEP_H
+#define SLEEP_H
+
+#include "xil_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void xil_sleep_us(u64 us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define sleep(seconds)	xil_sleep_us((u64)(seconds) * 1000000)
+#define usleep(useconds)	xil_sleep_us((u64)(useconds))
+
+#endif /* SLEEP_H */
@@ -0,0 +1,25 @@
+/*
+ * xil_io.h
+ *
+ * Host stand-in for the Xilinx BSP header. Xil_In32/Xil_Out32 go to the
+ * device models attached with xil_io_attach (xil_io_shim.cpp), an access
+ * outside all of them aborts
+ */
+
+#ifndef XIL_IO_H
+#define XIL_IO_H
+
+#include "xil_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+u32 Xil_In32(UINTPTR Addr);
+void Xil_Out32(UINTPTR Addr, u32 Value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* XIL_IO_H */
@@ -0,0 +1,25 @@
+/*
+ * xil_printf.h
+ *
+ * Host stand-in for the Xilinx BSP header. Output goes to stdout unless
+ * xil_printf_quiet is set, so benchmarks aren't timing the terminal
+ */
+
+#ifndef XIL_PRINTF_H
+#define XIL_PRINTF_H
+
+#include "xil_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern int xil_printf_quiet;
+void xil_printf(const char *fmt, ...);
+void print(const char *str);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* XIL_PRINTF_H */
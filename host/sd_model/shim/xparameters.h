@@ -0,0 +1,11 @@
+/*
+ * xparameters.h
+ *
+ * Host stand-in for the generated BSP header. The drivers built against the
+ * model only use their own base addresses
+ */
+
+#ifndef XPARAMETERS_H
+#define XPARAMETERS_H
+
+#endif /* XPARAMETERS_H */
@@ -0,0 +1,16 @@
+/*
+ * xstatus.h
+ *
+ * Host stand-in for the Xilinx BSP header, same values as the BSP
+ */
+
+#ifndef XSTATUS_H
+#define XSTATUS_H
+
+#include "xil_types.h"
+
+#define XST_SUCCESS		0L
+#define XST_FAILURE		1L
+#define XST_DEVICE_BUSY	21L
+
+#endif /* XSTATUS_H */
@@ -0,0 +1,95 @@
+/*
+ * xil_io_shim.cpp
+ *
+ * Host side of the BSP calls the drivers make: register accesses go to the
+ * attached device models, sleeps advance them and platform set up is empty
+ */
+
+#include "xil_io_shim.h"
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+extern "C" {
+#include "xil_io.h"
+#include "xil_printf.h"
+#include "sleep.h"
+}
+
+namespace {
+
+struct Mapping {
+	uintptr_t base;
+	uintptr_t size;
+	XilIoDevice* device;
+};
+
+std::vector<Mapping>& mappings() {
+	static std::vector<Mapping> map;
+	return map;
+}
+
+Mapping& lookup(uintptr_t addr) {
+	for (Mapping& m : mappings()) {
+		if (addr >= m.base && addr - m.base < m.size) {
+			return m;
+		}
+	}
+	std::fprintf(stderr, "xil_io: no device at 0x%08lx\n", (unsigned long)addr);
+	std::abort();
+}
+
+} // namespace
+
+void xil_io_attach(uintptr_t base, uintptr_t size, XilIoDevice* device) {
+	mappings().push_back({base, size, device});
+}
+
+void xil_io_detach_all() {
+	mappings().clear();
+}
+
+extern "C" {
+
+int xil_printf_quiet = 0;
+
+u32 Xil_In32(UINTPTR Addr) {
+	Mapping& m = lookup(Addr);
+	return m.device->read(Addr - m.base);
+}
+
+void Xil_Out32(UINTPTR Addr, u32 Value) {
+	Mapping& m = lookup(Addr);
+	m.device->write(Addr - m.base, Value);
+}
+
+void xil_printf(const char* fmt, ...) {
+	va_list args;
+
+	if (xil_printf_quiet) {
+		return;
+	}
+	va_start(args, fmt);
+	std::vprintf(fmt, args);
+	va_end(args);
+}
+
+void print(const char* str) {
+	if (!xil_printf_quiet) {
+		std::fputs(str, stdout);
+	}
+}
+
+void xil_sleep_us(u64 us) {
+	for (Mapping& m : mappings()) {
+		m.device->idle_us(us);
+	}
+}
+
+// platform.h, nothing to set up on the host
+void init_platform() {}
+void cleanup_platform() {}
+
+}
@@ -0,0 +1,25 @@
+/*
+ * xil_io_shim.h
+ *
+ * Memory map behind the host Xil_In32/Xil_Out32. A device model is attached
+ * at a base address and sees offsets from it
+ */
+
+#ifndef XIL_IO_SHIM_H_
+#define XIL_IO_SHIM_H_
+
+#include <cstdint>
+
+class XilIoDevice {
+public:
+	virtual ~XilIoDevice() {}
+	virtual uint32_t read(uint32_t offset) = 0;
+	virtual void write(uint32_t offset, uint32_t value) = 0;
+	// Time passing without bus traffic, sleep()/usleep() in the driver
+	virtual void idle_us(uint64_t us) = 0;
+};
+
+void xil_io_attach(uintptr_t base, uintptr_t size, XilIoDevice* device);
+void xil_io_detach_all();
+
+#endif /* XIL_IO_SHIM_H_ */
@@ -0,0 +1,10 @@
+/*
+ * xenv.h
+ *
+ * Host stand-in for the Xilinx BSP header, nothing in it is used
+ */
+
+#ifndef XENV_H
+#define XENV_H
+
+#endif /* XENV_H */
@@ -0,0 +1,21 @@
+/*
+ * xil_exception.h
+ *
+ * Host stand-in for the Xilinx BSP header. Nothing to register, the
+ * xuartlite shim calls the UartLite interrupt handler itself
+ */
+
+#ifndef XIL_EXCEPTION_H
+#define XIL_EXCEPTION_H
+
+#include "xil_types.h"
+
+#define XIL_EXCEPTION_ID_INT 0
+
+typedef void (*Xil_ExceptionHandler)(void *data);
+
+#define Xil_ExceptionInit()
+#define Xil_ExceptionRegisterHandler(id, handler, data)
+#define Xil_ExceptionEnable()
+
+#endif /* XIL_EXCEPTION_H */
@@ -0,0 +1,14 @@
+/*
+ * xparameters.h
+ *
+ * Host stand-in for the generated BSP header, the IDs uart.h refers to
+ */
+
+#ifndef XPARAMETERS_H
+#define XPARAMETERS_H
+
+#define XPAR_UARTLITE_0_DEVICE_ID 0
+#define XPAR_INTC_0_DEVICE_ID 0
+#define XPAR_INTC_0_UARTLITE_0_VEC_ID 0
+
+#endif /* XPARAMETERS_H */
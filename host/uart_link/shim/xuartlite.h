@@ -0,0 +1,66 @@
+/*
+ * xuartlite.h
+ *
+ * Host stand-in for the UartLite driver. The instance and buffer fields
+ * uart.c looks at are the driver's, the calls are implemented in
+ * xuartlite_shim.cpp on top of a file descriptor, see xuartlite_shim.h
+ */
+
+#ifndef XUARTLITE_H
+#define XUARTLITE_H
+
+#include "xil_types.h"
+#include "xstatus.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void (*XUartLite_Handler)(void *CallBackRef, unsigned int ByteCount);
+
+typedef struct {
+	u16 DeviceId;
+	UINTPTR RegBaseAddr;
+	u32 BaudRate;
+	u8 UseParity;
+	u8 ParityOdd;
+	u8 DataBits;
+} XUartLite_Config;
+
+typedef struct {
+	u8 *NextBytePtr;
+	unsigned int RequestedBytes;
+	unsigned int RemainingBytes;
+} XUartLite_Buffer;
+
+typedef struct {
+	UINTPTR RegBaseAddress;
+	u32 IsReady;
+	XUartLite_Buffer SendBuffer;
+	XUartLite_Buffer ReceiveBuffer;
+	XUartLite_Handler RecvHandler;
+	void *RecvCallBackRef;
+	XUartLite_Handler SendHandler;
+	void *SendCallBackRef;
+} XUartLite;
+
+int XUartLite_Initialize(XUartLite *InstancePtr, u16 DeviceId);
+int XUartLite_SelfTest(XUartLite *InstancePtr);
+XUartLite_Config *XUartLite_LookupConfig(u16 DeviceId);
+void XUartLite_SetSendHandler(XUartLite *InstancePtr, XUartLite_Handler FuncPtr, void *CallBackRef);
+void XUartLite_SetRecvHandler(XUartLite *InstancePtr, XUartLite_Handler FuncPtr, void *CallBackRef);
+void XUartLite_EnableInterrupt(XUartLite *InstancePtr);
+void XUartLite_DisableInterrupt(XUartLite *InstancePtr);
+unsigned int XUartLite_Send(XUartLite *InstancePtr, u8 *DataBufferPtr, unsigned int NumBytes);
+unsigned int XUartLite_Recv(XUartLite *InstancePtr, u8 *DataBufferPtr, unsigned int NumBytes);
+void XUartLite_InterruptHandler(XUartLite *InstancePtr);
+
+/* xuartlite_l.h */
+int XUartLite_IsReceiveEmpty(UINTPTR BaseAddress);
+u8 XUartLite_RecvByte(UINTPTR BaseAddress);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* XUARTLITE_H */
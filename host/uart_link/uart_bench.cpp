@@ -0,0 +1,276 @@
+/*
+ * uart_bench.cpp
+ *
+ * Sends an image's worth of sectors to the unmodified uart.c over a
+ * pseudo-terminal and reports the effective payload rate. The board side is
+ * uart.c on the xuartlite shim: one thread plays the UART interrupt and the
+ * main thread runs compression-main's loop, handing each sector to a
+ * stand-in sd_write_append that checks it and takes as long as a card write.
+ *
+ * Built with UART_FRAMED the host side is UartFrameSender. Without it, it
+ * is host-pc-uart.py's loop: the header, then each sector after a '!', one
+ * byte per write, with the port reopened for every sector.
+ *
+ * Usage: uart_bench [-n sectors] [-b baud] [-w window] [-s sd_us]
+ *                   [-e error_rate] [-x] [--csv label]
+ *  -b 0 doesn't pace the line, only the host and board code count then
+ *  -e flips a bit in that share of received bytes, the '!' protocol can't
+ *     recover from it
+ *  -x the board rejects the header with uart_rx_abort, the sender has to
+ *     stop without anything going to the card
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "uart_frame_sender.h"
+#include "xuartlite_shim.h"
+
+extern "C" {
+#include "uart.h"
+}
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+std::vector<std::vector<uint8_t>> sectors;
+unsigned sd_us = 200;
+uint32_t sectors_checked = 0;
+int n_errors = 0;
+std::atomic<bool> host_aborted(false); // the sender heard the board give up
+
+uint8_t pattern(uint32_t sector, uint32_t i) {
+	return (uint8_t)(sector * 31 + i * 7 + 3);
+}
+
+#if !UART_FRAMED
+// host-pc-uart.py, the header goes out at once and every sector waits for
+// a '!' and is written a byte at a time
+bool send_legacy(const char* path, unsigned baud) {
+	for (size_t s = 0; s < sectors.size(); s++) {
+		int fd = uart_open(path, baud);
+		if (fd < 0) {
+			return false;
+		}
+		if (s == 0) {
+			if (write(fd, sectors[0].data(), sectors[0].size()) != (ssize_t)sectors[0].size()) {
+				close(fd);
+				return false;
+			}
+			close(fd);
+			continue;
+		}
+		uint8_t c = 0;
+		while (c != '!') {
+			struct pollfd pfd = {fd, POLLIN, 0};
+			if (poll(&pfd, 1, 5000) <= 0 || read(fd, &c, 1) < 0) {
+				std::fprintf(stderr, "legacy: no '!' for sector %zu\n", s);
+				close(fd);
+				return false;
+			}
+			if (c == UART_RX_ABORT) {
+				host_aborted = true;
+				close(fd);
+				return false;
+			}
+		}
+		for (uint8_t byte : sectors[s]) {
+			while (write(fd, &byte, 1) != 1) {
+			}
+		}
+		close(fd);
+	}
+	return true;
+}
+#endif
+
+} // namespace
+
+// compression-main writes each sector to the card, here it's checked and
+// takes sd_us
+extern "C" int sd_write_append(int len, u8* data_arr) {
+	uint32_t s = sectors_checked++;
+
+	if (s >= sectors.size() || std::memcmp(data_arr, sectors[s].data(), len) != 0) {
+		std::fprintf(stderr, "sector %u doesn't match\n", s);
+		n_errors++;
+	}
+	std::this_thread::sleep_for(std::chrono::microseconds(sd_us));
+	return XST_SUCCESS;
+}
+
+int main(int argc, char** argv) {
+	uint32_t n_sectors = 32;
+	unsigned baud = 115200;
+	unsigned window = UART_RING_SECTORS;
+	double error_rate = 0;
+	bool reject_header = false;
+	const char* csv_label = NULL;
+
+	for (int i = 1; i < argc; i++) {
+		if (std::strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+			n_sectors = std::strtoul(argv[++i], NULL, 0);
+		}
+		else if (std::strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+			baud = std::strtoul(argv[++i], NULL, 0);
+		}
+		else if (std::strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+			window = std::strtoul(argv[++i], NULL, 0);
+		}
+		else if (std::strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+			sd_us = std::strtoul(argv[++i], NULL, 0);
+		}
+		else if (std::strcmp(argv[i], "-e") == 0 && i + 1 < argc) {
+			error_rate = std::strtod(argv[++i], NULL);
+		}
+		else if (std::strcmp(argv[i], "-x") == 0) {
+			reject_header = true;
+		}
+		else if (std::strcmp(argv[i], "--csv") == 0 && i + 1 < argc) {
+			csv_label = argv[++i];
+		}
+		else {
+			std::fprintf(stderr, "usage: %s [-n sectors] [-b baud] [-w window] [-s sd_us] "
+					"[-e error_rate] [-x] [--csv label]\n", argv[0]);
+			return 2;
+		}
+	}
+	if (n_sectors < 2) {
+		n_sectors = 2;
+	}
+	if (window > UART_RING_SECTORS) {
+		std::fprintf(stderr, "window %u is more than the %d sector ring\n", window, UART_RING_SECTORS);
+		return 2;
+	}
+
+	// the board's end is the master, the sender opens the slave like a port
+	int master = posix_openpt(O_RDWR | O_NOCTTY);
+	if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+		std::perror("pty");
+		return 1;
+	}
+	const char* slave_path = ptsname(master);
+	// held open for the whole run, the legacy sender closes its own
+	int slave = uart_open(slave_path, 115200);
+	if (slave < 0) {
+		return 1;
+	}
+
+	for (uint32_t s = 0; s < n_sectors; s++) {
+		std::vector<uint8_t> sector(UART_BUFFER_SIZE);
+		for (uint32_t i = 0; i < UART_BUFFER_SIZE; i++) {
+			sector[i] = pattern(s, i);
+		}
+		sectors.push_back(sector);
+	}
+
+	XUartLiteLine line;
+	line.fd = master;
+	line.baud = baud;
+	line.error_rate = error_rate;
+	xuartlite_connect(line);
+	SetupUartLiteNoInterrupt(UARTLITE_DEVICE_ID);
+	{
+		std::lock_guard<std::mutex> lock(xuartlite_irq_lock());
+		uart_rx_start();
+	}
+
+	std::atomic<bool> done(false);
+	std::thread irq([&] {
+		while (!done) {
+			xuartlite_service(1000);
+		}
+	});
+
+	Clock::time_point start = Clock::now();
+	bool sent = false;
+	UartSendStats stats;
+	std::thread host([&] {
+#if UART_FRAMED
+		int fd = uart_open(slave_path, 115200);
+		UartFrameSender sender(fd, window, 1000);
+		sent = sender.send(sectors);
+		stats = sender.stats();
+		host_aborted = sender.aborted();
+		close(fd);
+#else
+		sent = send_legacy(slave_path, 115200);
+#endif
+	});
+
+	// compression-main's receive loop
+	if (reject_header) {
+		// a bad header, nothing goes to the card
+		uart_rx_sector();
+		std::lock_guard<std::mutex> lock(xuartlite_irq_lock());
+		uart_rx_abort();
+	}
+	for (uint32_t s = 0; s < n_sectors && !reject_header; s++) {
+		uart_sd(uart_rx_sector());
+		std::lock_guard<std::mutex> lock(xuartlite_irq_lock());
+		uart_rx_release();
+	}
+	double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+	host.join();
+	done = true;
+	irq.join();
+	close(slave);
+	close(master);
+
+	if (reject_header) {
+		// until the sender gave up
+		seconds = std::chrono::duration<double>(Clock::now() - start).count();
+		std::printf("%s, header rejected, the sender %s after %.3f s\n", UART_FRAMED ? "framed" : "legacy",
+				host_aborted ? "stopped" : "didn't stop", seconds);
+		if (!host_aborted || sent || sectors_checked != 0) {
+			std::fprintf(stderr, "FAILED: the sender didn't hear the board give up\n");
+			return 1;
+		}
+		return 0;
+	}
+
+	double payload = (double)n_sectors * UART_BUFFER_SIZE;
+	double rate = payload / seconds;
+	const char* mode = UART_FRAMED ? "framed" : "legacy";
+	if (csv_label != NULL) {
+		std::printf("%s,%s,%u,%u,%u,%.0f,%.3f,%llu,%llu\n", csv_label, mode, baud, window,
+				n_sectors, rate, baud ? rate * 10 / baud : 0.0,
+				(unsigned long long)stats.repeats, (unsigned long long)xuartlite_bytes_corrupted());
+	}
+	else {
+		std::printf("%s, %u sectors of %d bytes, %s, %u us per SD write\n", mode, n_sectors,
+				UART_BUFFER_SIZE, baud ? (std::to_string(baud) + " baud").c_str() : "unpaced", sd_us);
+		std::printf("  %.3f s, %.0f payload bytes/s", seconds, rate);
+		if (baud) {
+			std::printf(", %.1f%% of the line", 100.0 * rate * 10 / baud);
+		}
+		std::printf("\n");
+		if (UART_FRAMED) {
+			std::printf("  window %u, %llu frames, %llu repeats, %llu naks, %llu timeouts, "
+					"%llu bytes corrupted\n", window,
+					(unsigned long long)stats.frames, (unsigned long long)stats.repeats,
+					(unsigned long long)stats.naks, (unsigned long long)stats.timeouts,
+					(unsigned long long)xuartlite_bytes_corrupted());
+		}
+	}
+
+	if (!sent || n_errors != 0 || sectors_checked != n_sectors) {
+		std::fprintf(stderr, "FAILED: %d sectors wrong\n", n_errors);
+		return 1;
+	}
+	return 0;
+}
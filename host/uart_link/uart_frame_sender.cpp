@@ -0,0 +1,183 @@
+/*
+ * uart_frame_sender.cpp
+ *
+ * Framed UART sender, see uart_frame_sender.h. The frames are built by the
+ * firmware's uart_frame.c
+ */
+
+#include "uart_frame_sender.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+extern "C" {
+#include "uart_frame.h"
+}
+
+namespace {
+
+speed_t baud_constant(unsigned baud) {
+	switch (baud) {
+	case 9600: return B9600;
+	case 19200: return B19200;
+	case 38400: return B38400;
+	case 57600: return B57600;
+	case 115200: return B115200;
+	case 230400: return B230400;
+	case 460800: return B460800;
+	case 921600: return B921600;
+	default: return B0;
+	}
+}
+
+bool write_all(int fd, const uint8_t* data, size_t len) {
+	while (len > 0) {
+		ssize_t n = write(fd, data, len);
+		if (n < 0) {
+			if (errno == EINTR || errno == EAGAIN) {
+				continue;
+			}
+			std::perror("uart: write");
+			return false;
+		}
+		data += n;
+		len -= n;
+	}
+	return true;
+}
+
+} // namespace
+
+int uart_open(const char* path, unsigned baud) {
+	struct termios tio;
+	speed_t speed = baud_constant(baud);
+	int fd = open(path, O_RDWR | O_NOCTTY);
+
+	if (fd < 0) {
+		std::perror(path);
+		return -1;
+	}
+	if (speed == B0) {
+		std::fprintf(stderr, "%s: unsupported baud rate %u\n", path, baud);
+		close(fd);
+		return -1;
+	}
+	if (tcgetattr(fd, &tio) == 0) {
+		cfmakeraw(&tio);
+		cfsetispeed(&tio, speed);
+		cfsetospeed(&tio, speed);
+		tio.c_cflag |= CLOCAL | CREAD | CRTSCTS;
+		tio.c_cc[VMIN] = 0;
+		tio.c_cc[VTIME] = 0;
+		tcsetattr(fd, TCSANOW, &tio);
+	}
+	return fd;
+}
+
+UartFrameSender::UartFrameSender(int fd, unsigned window, unsigned timeout_ms)
+	: fd_(fd), window_(window ? window : 1), timeout_ms_(timeout_ms),
+	  base_(0), next_(0), sent_(0), aborted_(false) {}
+
+void UartFrameSender::write_frame(const std::vector<uint8_t>& sector, uint32_t n) {
+	frame_.resize(sector.size() + UART_FRAME_HDR_LEN + UART_FRAME_CRC_LEN);
+	u32 len = uart_frame_build(frame_.data(), (u8)n, sector.data(), (u16)sector.size());
+
+	write_all(fd_, frame_.data(), len);
+	stats_.frames++;
+	stats_.bytes += len;
+	if (n < sent_) {
+		stats_.repeats++;
+	}
+	else {
+		sent_ = n + 1;
+	}
+}
+
+// Read acks and naks for up to timeout_ms, true if the window moved or a nak
+// sent it back
+bool UartFrameSender::wait_reply(unsigned timeout_ms) {
+	struct pollfd pfd = {fd_, POLLIN, 0};
+	uint8_t buf[64];
+	bool got = false;
+
+	if (poll(&pfd, 1, (int)timeout_ms) <= 0) {
+		return false;
+	}
+	ssize_t n = read(fd_, buf, sizeof(buf));
+	for (ssize_t i = 0; i < n; i++) {
+		reply_.push_back(buf[i]);
+		if (reply_.size() < 2) {
+			continue;
+		}
+		// sequence numbers are 8 bits, place them in the window
+		uint32_t n_seq = base_ + (uint8_t)(reply_[1] - (uint8_t)base_);
+		if (reply_[0] == UART_FRAME_ACK && n_seq <= sent_) {
+			if (n_seq > base_) {
+				base_ = n_seq;
+				got = true;
+			}
+			if (next_ < base_) {
+				next_ = base_;
+			}
+		}
+		else if (reply_[0] == UART_FRAME_NAK && n_seq < next_) {
+			stats_.naks++;
+			next_ = n_seq;
+			got = true;
+		}
+		else if (reply_[0] == UART_FRAME_ERR) {
+			// the board gave up, a bad header
+			aborted_ = true;
+		}
+		else if (reply_[0] != UART_FRAME_ACK && reply_[0] != UART_FRAME_NAK) {
+			// out of step, drop a byte
+			reply_.erase(reply_.begin());
+			continue;
+		}
+		reply_.clear();
+	}
+	return got;
+}
+
+bool UartFrameSender::send(const std::vector<std::vector<uint8_t>>& sectors, unsigned max_timeouts) {
+	typedef std::chrono::steady_clock Clock;
+	uint32_t total = (uint32_t)sectors.size();
+	unsigned timeouts = 0;
+	Clock::time_point progress = Clock::now();
+
+	base_ = 0;
+	next_ = 0;
+	sent_ = 0;
+	aborted_ = false;
+	reply_.clear();
+
+	while (base_ < total && !aborted_) {
+		while (next_ < total && next_ - base_ < window_) {
+			write_frame(sectors[next_], next_);
+			next_++;
+			// pick up acks between frames so the window keeps moving
+			wait_reply(0);
+		}
+		if (wait_reply(1)) {
+			timeouts = 0;
+			progress = Clock::now();
+		}
+		else if (base_ < total && Clock::now() - progress > std::chrono::milliseconds(timeout_ms_)) {
+			// nothing back, the board lost the frame at the window base
+			// or the ack for it
+			stats_.timeouts++;
+			if (++timeouts > max_timeouts) {
+				return false;
+			}
+			next_ = base_;
+			progress = Clock::now();
+		}
+	}
+	return !aborted_;
+}
@@ -0,0 +1,59 @@
+/*
+ * uart_frame_sender.h
+ *
+ * Host side of the framed UART ingestion protocol (uart_frame.h in the
+ * firmware). Frames are sent go-back-N: up to a window of them outstanding,
+ * a cumulative ack slides the window, a nak or a timeout sends again from
+ * the frame the board is missing.
+ */
+
+#ifndef UART_FRAME_SENDER_H_
+#define UART_FRAME_SENDER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct UartSendStats {
+	uint64_t frames = 0; // frames written, repeats included
+	uint64_t repeats = 0; // frames written again
+	uint64_t naks = 0;
+	uint64_t timeouts = 0;
+	uint64_t bytes = 0; // bytes written
+};
+
+// Open a serial port raw at the baud rate, with RTS/CTS as host-pc-uart.py.
+// Returns -1 on failure
+int uart_open(const char* path, unsigned baud);
+
+class UartFrameSender {
+public:
+	// window must not be more than the board's UART_RING_SECTORS
+	UartFrameSender(int fd, unsigned window = 4, unsigned timeout_ms = 1000);
+
+	// Send every sector and wait until the board has acked them all, false
+	// once max_timeouts timeouts in a row went by without an ack or the board
+	// gave up on the transfer
+	bool send(const std::vector<std::vector<uint8_t>>& sectors, unsigned max_timeouts = 10);
+
+	const UartSendStats& stats() const { return stats_; }
+	// the board sent UART_FRAME_ERR, it didn't take the header
+	bool aborted() const { return aborted_; }
+
+private:
+	void write_frame(const std::vector<uint8_t>& sector, uint32_t n);
+	bool wait_reply(unsigned timeout_ms);
+
+	int fd_;
+	unsigned window_;
+	unsigned timeout_ms_;
+	UartSendStats stats_;
+	uint32_t base_; // frames acked
+	uint32_t next_; // next frame to write
+	uint32_t sent_; // frames written at least once
+	bool aborted_; // UART_FRAME_ERR came back
+	std::vector<uint8_t> reply_; // partial ack or nak
+	std::vector<uint8_t> frame_;
+};
+
+#endif /* UART_FRAME_SENDER_H_ */
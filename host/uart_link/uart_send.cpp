@@ -0,0 +1,144 @@
+/*
+ * uart_send.cpp
+ *
+ * Sends a raw 8-bit grayscale image to compression-main built with
+ * UART_FRAMED, in the sectors host-pc-uart.py sends: the image header, then
+ * the pixels as 8x8 blocks in row order, 7 blocks per sector, zero padded.
+ *
+ * Usage: uart_send [-b baud] [-w window] [-t timeout_ms] -W width -H height
+ *                  image.raw port
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <unistd.h>
+
+#include "uart_frame_sender.h"
+
+namespace {
+
+// sd_card.h
+const uint32_t kImgMagic = 0x31474D49; // "IMG1"
+const uint32_t kPixFmtGray8 = 0;
+const unsigned kBlocksPerSector = 7;
+const unsigned kSectorLen = kBlocksPerSector * 64; // UART_BUFFER_SIZE
+
+void put_u32(std::vector<uint8_t>& buf, size_t off, uint32_t v) {
+	for (int i = 0; i < 4; i++) {
+		buf[off + i] = (uint8_t)(v >> (8 * i));
+	}
+}
+
+// make_header() in host-pc-uart.py
+std::vector<uint8_t> make_header(uint32_t width, uint32_t height) {
+	std::vector<uint8_t> header(kSectorLen, 0);
+
+	put_u32(header, 0, kImgMagic);
+	put_u32(header, 4, width);
+	put_u32(header, 8, height);
+	put_u32(header, 12, ((width + 7) / 8) * ((height + 7) / 8));
+	put_u32(header, 16, kPixFmtGray8);
+	return header;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+	unsigned baud = 115200;
+	unsigned window = 4;
+	unsigned timeout_ms = 1000;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	const char* image_path = NULL;
+	const char* port = NULL;
+
+	for (int i = 1; i < argc; i++) {
+		if (std::strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+			baud = std::strtoul(argv[++i], NULL, 0);
+		}
+		else if (std::strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+			window = std::strtoul(argv[++i], NULL, 0);
+		}
+		else if (std::strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+			timeout_ms = std::strtoul(argv[++i], NULL, 0);
+		}
+		else if (std::strcmp(argv[i], "-W") == 0 && i + 1 < argc) {
+			width = std::strtoul(argv[++i], NULL, 0);
+		}
+		else if (std::strcmp(argv[i], "-H") == 0 && i + 1 < argc) {
+			height = std::strtoul(argv[++i], NULL, 0);
+		}
+		else if (image_path == NULL) {
+			image_path = argv[i];
+		}
+		else if (port == NULL) {
+			port = argv[i];
+		}
+		else {
+			image_path = NULL;
+			break;
+		}
+	}
+	if (image_path == NULL || port == NULL || width == 0 || height == 0) {
+		std::fprintf(stderr, "usage: %s [-b baud] [-w window] [-t timeout_ms] "
+				"-W width -H height image.raw port\n", argv[0]);
+		return 2;
+	}
+
+	std::vector<uint8_t> pixels((size_t)width * height);
+	FILE* f = std::fopen(image_path, "rb");
+	if (f == NULL || std::fread(pixels.data(), 1, pixels.size(), f) != pixels.size()) {
+		std::fprintf(stderr, "%s: expected %ux%u bytes\n", image_path, width, height);
+		return 1;
+	}
+	std::fclose(f);
+
+	// pad_img(), split_img() and add_padding() in host-pc-uart.py
+	uint32_t bw = (width + 7) / 8;
+	uint32_t bh = (height + 7) / 8;
+	uint32_t n_blocks = bw * bh;
+	std::vector<std::vector<uint8_t>> sectors;
+	sectors.push_back(make_header(width, height));
+	for (uint32_t b = 0; b < n_blocks; b += kBlocksPerSector) {
+		std::vector<uint8_t> sector(kSectorLen, 0);
+		for (uint32_t k = 0; k < kBlocksPerSector && b + k < n_blocks; k++) {
+			uint32_t bx = (b + k) % bw;
+			uint32_t by = (b + k) / bw;
+			for (uint32_t y = 0; y < 8; y++) {
+				for (uint32_t x = 0; x < 8; x++) {
+					uint32_t px = bx * 8 + x;
+					uint32_t py = by * 8 + y;
+					if (px < width && py < height) {
+						sector[k * 64 + y * 8 + x] = pixels[(size_t)py * width + px];
+					}
+				}
+			}
+		}
+		sectors.push_back(sector);
+	}
+
+	int fd = uart_open(port, baud);
+	if (fd < 0) {
+		return 1;
+	}
+	std::printf("Sending %ux%u image, %u blocks in %zu sectors\n", width, height, n_blocks,
+			sectors.size() - 1);
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	UartFrameSender sender(fd, window, timeout_ms);
+	bool ok = sender.send(sectors);
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	close(fd);
+
+	const UartSendStats& stats = sender.stats();
+	std::printf("%s after %.2f s, %.0f payload bytes/s, %llu frames, %llu repeats, %llu naks, "
+			"%llu timeouts\n", ok ? "Done" : sender.aborted() ? "Board rejected the header" : "Gave up", seconds,
+			sectors.size() * kSectorLen / seconds,
+			(unsigned long long)stats.frames, (unsigned long long)stats.repeats,
+			(unsigned long long)stats.naks, (unsigned long long)stats.timeouts);
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,217 @@
+/*
+ * xuartlite_shim.cpp
+ *
+ * The UartLite calls uart.c makes, over a file descriptor, see
+ * xuartlite_shim.h. The receive path follows xuartlite.c and
+ * xuartlite_intr.c: a posted buffer is filled from the FIFO, and the
+ * receive handler is called whenever nothing is left to fill.
+ */
+
+#include "xuartlite_shim.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+
+#include <poll.h>
+#include <unistd.h>
+
+#include "xuartlite.h"
+
+namespace {
+
+const unsigned kFifoLen = 16;
+
+typedef std::chrono::steady_clock Clock;
+
+XUartLiteLine line;
+XUartLite* instance = NULL;
+XUartLite_Config config;
+std::mutex irq_lock;
+std::mt19937 rng;
+
+uint8_t fifo[kFifoLen];
+unsigned fifo_head = 0; // next byte out
+unsigned fifo_count = 0;
+
+Clock::time_point line_start;
+uint64_t bytes_received = 0;
+uint64_t bytes_corrupted = 0;
+
+uint8_t fifo_pop() {
+	uint8_t byte = fifo[fifo_head];
+	fifo_head = (fifo_head + 1) % kFifoLen;
+	fifo_count--;
+	return byte;
+}
+
+void fifo_push(uint8_t byte) {
+	fifo[(fifo_head + fifo_count) % kFifoLen] = byte;
+	fifo_count++;
+}
+
+// XUartLite_ReceiveBuffer, FIFO into the posted buffer
+unsigned receive_buffer(XUartLite* inst) {
+	unsigned n = 0;
+
+	while (inst->ReceiveBuffer.RemainingBytes > 0 && fifo_count > 0) {
+		*inst->ReceiveBuffer.NextBytePtr++ = fifo_pop();
+		inst->ReceiveBuffer.RemainingBytes--;
+		n++;
+	}
+	return n;
+}
+
+// Bytes the line has carried by now at the baud rate
+uint64_t line_budget() {
+	if (line.baud == 0) {
+		return UINT64_MAX;
+	}
+	double s = std::chrono::duration<double>(Clock::now() - line_start).count();
+	return (uint64_t)(s * line.baud / 10);
+}
+
+} // namespace
+
+void xuartlite_connect(const XUartLiteLine& l) {
+	line = l;
+	rng.seed(l.seed);
+	fifo_head = 0;
+	fifo_count = 0;
+	bytes_received = 0;
+	bytes_corrupted = 0;
+	line_start = Clock::now();
+}
+
+void xuartlite_service(unsigned timeout_us) {
+	uint8_t buf[kFifoLen];
+	unsigned room = kFifoLen - fifo_count;
+	uint64_t budget = line_budget() - bytes_received;
+	ssize_t n = 0;
+
+	if (room > budget) {
+		room = (unsigned)budget;
+	}
+	if (room == 0) {
+		// FIFO full or the line hasn't carried the next byte yet
+		std::this_thread::sleep_for(std::chrono::microseconds(line.baud ? 10000000 / line.baud : 10));
+	}
+	else {
+		struct pollfd pfd = {line.fd, POLLIN, 0};
+		if (poll(&pfd, 1, (int)(timeout_us / 1000)) > 0) {
+			n = read(line.fd, buf, room);
+			if (n < 0 && errno != EAGAIN && errno != EIO) {
+				std::perror("xuartlite: read");
+				std::exit(1);
+			}
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(irq_lock);
+	for (ssize_t i = 0; i < n; i++) {
+		if (line.error_rate > 0 && std::uniform_real_distribution<double>(0, 1)(rng) < line.error_rate) {
+			buf[i] ^= (uint8_t)(1 << (rng() % 8));
+			bytes_corrupted++;
+		}
+		fifo_push(buf[i]);
+	}
+	bytes_received += n > 0 ? n : 0;
+
+	// the RX interrupt fires when bytes arrive
+	if (n > 0 && instance != NULL) {
+		XUartLite_InterruptHandler(instance);
+	}
+}
+
+std::mutex& xuartlite_irq_lock() {
+	return irq_lock;
+}
+
+uint64_t xuartlite_bytes_received() {
+	return bytes_received;
+}
+
+uint64_t xuartlite_bytes_corrupted() {
+	return bytes_corrupted;
+}
+
+extern "C" {
+
+int XUartLite_Initialize(XUartLite* InstancePtr, u16 DeviceId) {
+	*InstancePtr = XUartLite();
+	InstancePtr->IsReady = 1;
+	instance = InstancePtr;
+	return XST_SUCCESS;
+}
+
+int XUartLite_SelfTest(XUartLite* InstancePtr) {
+	return XST_SUCCESS;
+}
+
+XUartLite_Config* XUartLite_LookupConfig(u16 DeviceId) {
+	config.DeviceId = DeviceId;
+	config.BaudRate = line.baud;
+	config.DataBits = 8;
+	return &config;
+}
+
+void XUartLite_SetSendHandler(XUartLite* InstancePtr, XUartLite_Handler FuncPtr, void* CallBackRef) {
+	InstancePtr->SendHandler = FuncPtr;
+	InstancePtr->SendCallBackRef = CallBackRef;
+}
+
+void XUartLite_SetRecvHandler(XUartLite* InstancePtr, XUartLite_Handler FuncPtr, void* CallBackRef) {
+	InstancePtr->RecvHandler = FuncPtr;
+	InstancePtr->RecvCallBackRef = CallBackRef;
+}
+
+void XUartLite_EnableInterrupt(XUartLite* InstancePtr) {}
+void XUartLite_DisableInterrupt(XUartLite* InstancePtr) {}
+
+// The TX FIFO is never full here, every byte goes out at once
+unsigned int XUartLite_Send(XUartLite* InstancePtr, u8* DataBufferPtr, unsigned int NumBytes) {
+	unsigned int sent = 0;
+
+	while (sent < NumBytes) {
+		ssize_t n = write(line.fd, DataBufferPtr + sent, NumBytes - sent);
+		if (n < 0) {
+			if (errno == EAGAIN || errno == EINTR) {
+				continue;
+			}
+			std::perror("xuartlite: write");
+			std::exit(1);
+		}
+		sent += n;
+	}
+	return sent;
+}
+
+unsigned int XUartLite_Recv(XUartLite* InstancePtr, u8* DataBufferPtr, unsigned int NumBytes) {
+	InstancePtr->ReceiveBuffer.RequestedBytes = NumBytes;
+	InstancePtr->ReceiveBuffer.RemainingBytes = NumBytes;
+	InstancePtr->ReceiveBuffer.NextBytePtr = DataBufferPtr;
+	return receive_buffer(InstancePtr);
+}
+
+void XUartLite_InterruptHandler(XUartLite* InstancePtr) {
+	if (InstancePtr->ReceiveBuffer.RemainingBytes != 0) {
+		receive_buffer(InstancePtr);
+	}
+	if (InstancePtr->ReceiveBuffer.RemainingBytes == 0 && InstancePtr->RecvHandler != NULL) {
+		InstancePtr->RecvHandler(InstancePtr->RecvCallBackRef,
+				InstancePtr->ReceiveBuffer.RequestedBytes - InstancePtr->ReceiveBuffer.RemainingBytes);
+	}
+}
+
+int XUartLite_IsReceiveEmpty(UINTPTR BaseAddress) {
+	return fifo_count == 0;
+}
+
+u8 XUartLite_RecvByte(UINTPTR BaseAddress) {
+	return fifo_pop();
+}
+
+}
@@ -0,0 +1,35 @@
+/*
+ * xuartlite_shim.h
+ *
+ * Host UartLite behind a file descriptor, for running uart.c against a
+ * pseudo-terminal. Bytes read from the descriptor go through a 16 byte RX
+ * FIFO, paced at the line rate, and xuartlite_service() plays the interrupt:
+ * it fills the FIFO and calls XUartLite_InterruptHandler, which follows the
+ * driver's receive path. Sends are written to the descriptor.
+ *
+ * The handler runs with xuartlite_irq_lock() held. On the board it can't run
+ * in the middle of main loop code it races with, so the bench holds the lock
+ * around those calls instead.
+ */
+
+#ifndef XUARTLITE_SHIM_H_
+#define XUARTLITE_SHIM_H_
+
+#include <cstdint>
+#include <mutex>
+
+struct XUartLiteLine {
+	int fd = -1;
+	unsigned baud = 115200; // 10 bits per byte, 0 for no pacing
+	double error_rate = 0; // chance of a bit flip in each received byte
+	uint32_t seed = 1;
+};
+
+void xuartlite_connect(const XUartLiteLine& line);
+// Wait up to timeout_us for bytes and run the interrupt for them
+void xuartlite_service(unsigned timeout_us);
+std::mutex& xuartlite_irq_lock();
+uint64_t xuartlite_bytes_received();
+uint64_t xuartlite_bytes_corrupted();
+
+#endif /* XUARTLITE_SHIM_H_ */
@@ -96,7 +96,9 @@
 // 8x8x7 block numbers sent over UART
 // 146 8x8x7 blocks + 2 left over with zero padding
 #define IMG_BLOCK_NUM 1024
-#define UART_BLOCK_NUM 147
+// the image header goes in the first sector, the geometry and the number of
+// sectors to receive after it come from there
+#define SD_IMG_ADDR 0x00000000
 
 #define TCP_SEND_BUFSIZE 134
 #define BYPASS_DCT 0
@@ -195,6 +197,9 @@ int main()
 
 	platform_enable_interrupts();
 
+	// card identified, SPI clock up to full speed
+	sd_card_init();
+
 	//Get a reference pointer to the Uart Configuration
 	UartLite_Cfg = XUartLite_LookupConfig(UARTLITE_DEVICE_ID);
 
@@ -208,16 +213,41 @@ int main()
 	xil_printf("\n\r");
 
 	// UART OPERATION
-	for(u32 i=0; i<UART_BLOCK_NUM; i++){
-		xil_printf("Waiting to receive UART packets\n");
-		uart_sd((u32)(0x00000000 + i));
-		xil_printf("\nimage block %d wrote to SD card\n\n", i);
-
-		sleep(1);
-		SendBuffer[0] = 33; // ASCII !
-		XUartLite_Send(&UartLite, &SendBuffer[0],1);
-		resetBuffer();
+	sd_img_header img_hdr;
+	u32 uart_block_num;
+
+	// header sector, checked before anything goes to the card
+	uart_rx_start();
+	xil_printf("Waiting to receive UART packets\n");
+	u8* sector = uart_rx_sector();
+	if (sd_parse_header(sector, &img_hdr) != XST_SUCCESS){
+		xil_printf("Invalid image header, stopping\n");
+		// the host stops sending rather than wait for the next '!'
+		uart_rx_abort();
+		cleanup_platform();
+		return -1;
+	}
+	// the pixels follow one sector per 7 blocks
+	uart_block_num = 1 + (img_hdr.block_num + SD_BLOCKS_PER_SECTOR - 1)/SD_BLOCKS_PER_SECTOR;
+	xil_printf("Receiving %dx%d image, %d blocks in %d sectors\n",
+			img_hdr.width, img_hdr.height, img_hdr.block_num, uart_block_num - 1);
+
+	// the header and pixel sectors go to the card as one multiple block write,
+	// the UART ring keeps receiving while each sector is written
+	sd_write_start((u32)SD_IMG_ADDR);
+	for(u32 i=0; i<uart_block_num; i++){
+		if (i > 0){
+			xil_printf("Waiting to receive UART packets\n");
+			sector = uart_rx_sector();
+		}
+		uart_sd(sector);
+		xil_printf("\nimage block %d queued for SD card\n\n", i);
+
+		// RecvHandler already asked the host for the next sector if the ring
+		// had room, otherwise this does
+		uart_rx_release();
 	}
+	sd_write_end();
 
     cleanup_platform();
 
@@ -42,6 +42,7 @@
 
 #include "lwip/tcp.h"
 #include "uart.h"
+#include "sd_card.h"
 
 //UART parameters
 #define UARTLITE_DEVICE_ID XPAR_UARTLITE_0_DEVICE_ID
@@ -118,6 +119,13 @@ void platform_setup_interrupts()
 				(XInterruptHandler)XUartLite_InterruptHandler,
 				(void *)&UartLite);
 
+#ifdef SD_INT_IRQ_ID
+	// for SD card command interrupts
+	XIntc_Connect(intcp, SD_INT_IRQ_ID,
+				(XInterruptHandler)sd_card_irq_handler,
+				NULL);
+#endif
+
 	/* Start the interrupt controller */
 	XIntc_MasterEnable(XPAR_INTC_0_BASEADDR);
 
@@ -165,6 +173,11 @@ void platform_setup_interrupts()
 
 	//UART interrupt enable
 	XIntc_Enable(intcp, XPAR_INTC_0_UARTLITE_0_VEC_ID);
+
+#ifdef SD_INT_IRQ_ID
+	//SD card interrupt enable
+	XIntc_Enable(intcp, SD_INT_IRQ_ID);
+#endif
 }
 
 void
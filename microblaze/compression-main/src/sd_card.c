@@ -1,4 +1,151 @@
 #include "sd_card.h"
+// Command in flight, see sd_read_async/sd_write_async
+static struct {
+	u8* buf;
+	int len;
+	sd_callback callback;
+	void* ref;
+} sd_op;
+static volatile u8 sd_op_pending = 0;
+
+// Wait until the controller is idle
+static void sd_wait_idle() {
+	while(XSPI_AXI_READ(SD_STATUS_REG) & SD_STAT_BUSY);
+}
+
+// Start a command at an SD card address, it is dropped again once the
+// controller has taken it so that it only runs once
+static void sd_start(u32 cmd, u32 addr) {
+	// Stop any repeating command and wait for it to finish
+	XSPI_AXI_WRITE(SD_CMD_REG, 0x0);
+	sd_wait_idle();
+	XSPI_AXI_WRITE(SD_ADDR_REG, addr);
+	XSPI_AXI_WRITE(SD_CMD_REG, cmd);
+	while(!(XSPI_AXI_READ(SD_STATUS_REG) & SD_STAT_BUSY));
+	XSPI_AXI_WRITE(SD_CMD_REG, 0x0);
+}
+
+// Copy the sector read by the card out of the read RAM. The card data
+// starts at RAM address 1 and the address steps by 4 with every burst read
+static void sd_copy_sector(u32 ram_addr, int len, u8* ret_data_arr) {
+	XSPI_AXI_WRITE(SD_RADDR_REG, ram_addr + 1);
+	for (u16 i=0; i<len; i+=4) {
+		u32 word = XSPI_AXI_READ(SD_BURST_RD_REG);
+		for (u16 j=0; j<4 && i+j<len; j++) {
+			ret_data_arr[i+j] = word >> (8*j);
+		}
+	}
+}
+
+// Finish the command in flight if the controller is done with it
+static void sd_complete() {
+	u32 status;
+
+	if (!sd_op_pending) {
+		return;
+	}
+	status = XSPI_AXI_READ(SD_STATUS_REG);
+	if (!(status & SD_STAT_DONE)) {
+		return;
+	}
+	// Disabling the interrupt also drops it
+	XSPI_AXI_WRITE(SD_CMD_REG, 0x0);
+	if (sd_op.buf != NULL && !(status & SD_STAT_ERROR)) {
+		sd_copy_sector(0, sd_op.len, sd_op.buf);
+	}
+	sd_op_pending = 0;
+	if (sd_op.callback != NULL) {
+		sd_op.callback(sd_op.ref, (status & SD_STAT_ERROR) ? XST_FAILURE : XST_SUCCESS);
+	}
+}
+
+// Interrupt handler for the controller's sd_irq, platform.c connects it
+// when the interrupt controller has SD_INT_IRQ_ID
+void sd_card_irq_handler(void* ref) {
+	sd_complete();
+}
+
+// Finish a command without the interrupt, call from the main loop on
+// systems where sd_irq isn't connected. With SD_INT_IRQ_ID only the handler
+// finishes commands, so this does nothing
+void sd_card_poll() {
+#ifndef SD_INT_IRQ_ID
+	sd_complete();
+#endif
+}
+
+// Wait for the command in flight to finish, on the flag the interrupt
+// handler clears or, without the interrupt, polling the controller
+static void sd_wait_op() {
+	while (sd_op_pending) {
+#ifndef SD_INT_IRQ_ID
+		sd_complete();
+#endif
+	}
+}
+
+// Returns 1 while a command started by sd_read_async/sd_write_async is in flight
+int sd_busy() {
+	return sd_op_pending;
+}
+
+// Write to SD card without waiting for it
+// addr: SD card address to write to
+// len: length of array to write
+// data_arr: data to write as an array, copied before this returns
+// callback: called with XST_SUCCESS or XST_FAILURE once the card is done
+// ref: passed to callback
+// returns XST_DEVICE_BUSY if another command is in flight
+// Restrictions:
+// 1. maximum write amount is 511
+int sd_write_async(u32 addr, int len, u8* data_arr, sd_callback callback, void* ref) {
+	if (sd_op_pending) {
+		return XST_DEVICE_BUSY;
+	}
+	sd_wait_idle();
+	// Write to RAM, the address steps by 4 with every burst write
+	XSPI_AXI_WRITE(SD_WADDR_REG, 0);
+	for (u16 i=0; i<len; i+=4) {
+		u32 word = 0;
+		for (u16 j=0; j<4 && i+j<len; j++) {
+			word |= (u32)data_arr[i+j] << (8*j);
+		}
+		XSPI_AXI_WRITE(SD_BURST_WR_REG, word);
+	}
+	XSPI_AXI_WRITE(SD_WRITE_REG, 0xaa);
+
+	sd_op.buf = NULL;
+	sd_op.len = 0;
+	sd_op.callback = callback;
+	sd_op.ref = ref;
+	sd_op_pending = 1;
+	sd_start(CMD_WRITE, addr);
+	XSPI_AXI_WRITE(SD_CMD_REG, CMD_IRQ_EN);
+	return XST_SUCCESS;
+}
+
+// Read from SD card without waiting for it
+// addr: SD card address to read from
+// len: length of read
+// ret_data_arr: filled with sd card returned data before callback is called
+// callback: called with XST_SUCCESS or XST_FAILURE once the data is in
+//  ret_data_arr, from the interrupt handler or sd_card_poll
+// ref: passed to callback
+// returns XST_DEVICE_BUSY if another command is in flight
+int sd_read_async(u32 addr, int len, u8* ret_data_arr, sd_callback callback, void* ref) {
+	if (sd_op_pending) {
+		return XST_DEVICE_BUSY;
+	}
+	sd_op.buf = ret_data_arr;
+	sd_op.len = len;
+	sd_op.callback = callback;
+	sd_op.ref = ref;
+	sd_op_pending = 1;
+	sd_start(CMD_READ, addr);
+	XSPI_AXI_WRITE(SD_CMD_REG, CMD_IRQ_EN);
+	return XST_SUCCESS;
+}
+
 // Write to SD card
 // addr: SD card address to write to
 // len: length of array to write
@@ -8,31 +155,71 @@
 // 2. maximum write amount is 511
 void sd_write(u32 addr, int len, u8* data_arr) {
 	print("Write to SD card \n");
-	// Write to RAM
-	for (u16 i=0; i<len; i++) {
-		if (i < 10){
-			xil_printf("SD write data %d\n", data_arr[i]);
-		}
-		//RAM address location
-		XSPI_AXI_WRITE(SD_WADDR_REG, i);
-		//Data to write
-		XSPI_AXI_WRITE(SD_WRITE_REG, data_arr[i]);
-		//Write to RAM
-		XSPI_AXI_WRITE(SD_RAM_CMD_REG, CMD_RAM_WRITE);
-		//Stop writing
-		XSPI_AXI_WRITE(SD_RAM_CMD_REG, 0);
+	for (u16 i=0; i<len && i<10; i++) {
+		xil_printf("SD write data %d\n", data_arr[i]);
 	}
-	XSPI_AXI_WRITE(SD_WRITE_REG, 0xaa);
-	// Write to SD card
-	// Don't do anything until idle
-	while(XSPI_AXI_READ(SD_DEBUG_REG) != 6);
-	// Set up write conditions - address
+	sd_wait_op();
+	sd_write_async(addr, len, data_arr, NULL, NULL);
+}
+
+// Sectors appended since sd_write_start
+static u32 sd_wr_queued = 0;
+
+// Start writing consecutive sectors with a single multiple block write,
+// the sectors are given to sd_write_append
+// addr: SD card address of the first sector
+void sd_write_start(u32 addr) {
+	print("Start SD card write \n");
+	sd_wait_op();
+	XSPI_AXI_WRITE(SD_CMD_REG, 0x0);
+	sd_wait_idle();
+	sd_wr_queued = 0;
+	XSPI_AXI_WRITE(SD_WR_CNT_REG, 0);
 	XSPI_AXI_WRITE(SD_ADDR_REG, addr);
-	// Start write process
-	XSPI_AXI_WRITE(SD_CMD_REG, CMD_WRITE);
-	// Stop sending write signal
-	while(XSPI_AXI_READ(SD_DEBUG_REG) == 6);
+	// The command stays set until sd_write_end
+	XSPI_AXI_WRITE(SD_CMD_REG, CMD_WRITE_MULTI);
+	while(!(XSPI_AXI_READ(SD_STATUS_REG) & SD_STAT_BUSY));
+}
+
+// Append the next sector to the write started by sd_write_start, returns
+// as soon as the sector is in the write RAM
+// len: length of array to write, the rest of the sector is zeroed
+// data_arr: data to write as an array
+// returns XST_FAILURE if the card rejected the write
+// Restrictions:
+// 1. maximum write amount is SD_SECTOR_LEN
+int sd_write_append(int len, u8* data_arr) {
+	// Wait for the card to free a RAM sector
+	while(sd_wr_queued - XSPI_AXI_READ(SD_WR_DONE_REG) >= SD_WR_SECTORS) {
+		if (XSPI_AXI_READ(SD_STATUS_REG) & SD_STAT_ERROR) {
+			print("SD card rejected the write \n");
+			return XST_FAILURE;
+		}
+	}
+	XSPI_AXI_WRITE(SD_WADDR_REG, (sd_wr_queued % SD_WR_SECTORS)*SD_SECTOR_LEN);
+	for (u16 i=0; i<SD_SECTOR_LEN; i+=4) {
+		u32 word = 0;
+		for (u16 j=0; j<4 && i+j<len; j++) {
+			word |= (u32)data_arr[i+j] << (8*j);
+		}
+		XSPI_AXI_WRITE(SD_BURST_WR_REG, word);
+	}
+	sd_wr_queued++;
+	XSPI_AXI_WRITE(SD_WR_CNT_REG, sd_wr_queued);
+	return XST_SUCCESS;
+}
+
+// Wait for the appended sectors to be written and end the write
+void sd_write_end() {
+	while(XSPI_AXI_READ(SD_WR_DONE_REG) != sd_wr_queued) {
+		if (XSPI_AXI_READ(SD_STATUS_REG) & SD_STAT_ERROR) {
+			break;
+		}
+	}
 	XSPI_AXI_WRITE(SD_CMD_REG, 0x0);
+	// Wait for the stop token
+	sd_wait_idle();
+	xil_printf("Wrote %d sectors to SD card\n", XSPI_AXI_READ(SD_WR_DONE_REG));
 }
 
 // Read from SD card
@@ -41,39 +228,221 @@ void sd_write(u32 addr, int len, u8* data_arr) {
 // ret_data_arr: empty array that will be filled with sd card returned data
 void sd_read(u32 addr, int len, u8* ret_data_arr) {
 	print("Read from SD card \n");
-	len = len + 1;
-	// Command SD card to read
+	sd_wait_op();
+	sd_read_async(addr, len, ret_data_arr, NULL, NULL);
+	sd_wait_op();
+	for (u16 i=0; i<len && i<10; i++) {
+		xil_printf("SD read data %d\n", ret_data_arr[i]);
+	}
+}
+
+// Sectors of the read started by sd_stream_start
+static u32 sd_rd_count = 0;
+// Sectors taken by sd_stream_next
+static u32 sd_rd_taken = 0;
+
+// Start reading consecutive sectors with a single multiple block read and
+// return, the controller reads ahead into the free read RAM sectors while
+// the caller works on the ones it has taken with sd_stream_next
+// addr: SD card address of the first sector
+// count: number of sectors to read
+void sd_stream_start(u32 addr, u32 count) {
+	sd_wait_op();
+	// Stop any repeating read and wait for it to finish
+	XSPI_AXI_WRITE(SD_CMD_REG, 0x0);
+	sd_wait_idle();
+	sd_rd_count = count;
+	sd_rd_taken = 0;
+	XSPI_AXI_WRITE(SD_BLOCK_CNT_REG, count);
+	XSPI_AXI_WRITE(SD_RD_ACK_REG, 0);
+	// The sector count is cleared once the read has started
+	sd_start(CMD_READ_MULTI, addr);
+}
+
+// Returns 1 if the next sector of the stream is in the read RAM, so
+// sd_stream_next won't wait for the card
+int sd_stream_ready() {
+	return sd_rd_taken < sd_rd_count && XSPI_AXI_READ(SD_RD_CNT_REG) > sd_rd_taken;
+}
+
+// Take the next sector of the read started by sd_stream_start, waiting
+// for the card if it isn't in yet. Its RAM sector is given back to the
+// card before this returns
+// len: bytes of the sector to copy
+// ret_data_arr: filled with len bytes
+// returns XST_FAILURE if the card rejected the read or the stream is over
+int sd_stream_next(int len, u8* ret_data_arr) {
+	if (sd_rd_taken >= sd_rd_count) {
+		return XST_FAILURE;
+	}
+	// Wait for the card, it is held once SD_RD_SECTORS are unread
+	while(XSPI_AXI_READ(SD_RD_CNT_REG) <= sd_rd_taken) {
+		if (XSPI_AXI_READ(SD_STATUS_REG) & SD_STAT_ERROR) {
+			print("SD card rejected the read \n");
+			return XST_FAILURE;
+		}
+	}
+	sd_copy_sector((sd_rd_taken % SD_RD_SECTORS)*SD_SECTOR_LEN, len, ret_data_arr);
+	sd_rd_taken++;
+	// Free the RAM sector for the card
+	XSPI_AXI_WRITE(SD_RD_ACK_REG, sd_rd_taken);
+	return XST_SUCCESS;
+}
+
+// Drop the sectors of the stream that haven't been taken and wait for
+// STOP_TRANSMISSION
+void sd_stream_end() {
+	while (sd_rd_taken < sd_rd_count) {
+		if (XSPI_AXI_READ(SD_STATUS_REG) & SD_STAT_ERROR) {
+			break;
+		}
+		// Give back each sector as it comes in, the count runs out
+		if (XSPI_AXI_READ(SD_RD_CNT_REG) > sd_rd_taken) {
+			sd_rd_taken++;
+			XSPI_AXI_WRITE(SD_RD_ACK_REG, sd_rd_taken);
+		}
+	}
+	sd_wait_idle();
+}
+
+// Read consecutive sectors with a single multiple block read
+// addr: SD card address of the first sector
+// count: number of sectors to read
+// ret_data_arr: filled with count*SD_SECTOR_LEN bytes
+// returns XST_FAILURE if the card rejected the read
+int sd_read_multi(u32 addr, u32 count, u8* ret_data_arr) {
+	xil_printf("Read %d sectors from SD card \n", count);
+	sd_stream_start(addr, count);
+	for (u32 n=0; n<count; n++) {
+		if (sd_stream_next(SD_SECTOR_LEN, ret_data_arr + n*SD_SECTOR_LEN) != XST_SUCCESS) {
+			return XST_FAILURE;
+		}
+	}
+	sd_stream_end();
+	return XST_SUCCESS;
+}
+
+// Sectors of the read started by sd_stream_dct_start
+static u32 sd_dct_count = 0;
+// 8x8 blocks the stream may send, last written to SD_RD_ACK_REG
+static u32 sd_dct_credit = 0;
+
+// Stream consecutive sectors straight into the DCT through the controller's
+// AXI-Stream port and return, the pixels never pass through the CPU. The
+// first SD_BLOCKS_PER_SECTOR*64 bytes of each sector are sent, the
+// coefficients come out of the DCT as usual
+// addr: SD card address of the first sector
+// count: number of sectors to send
+// blocks: 8x8 blocks the stream may send before sd_stream_dct_credit
+//  allows more
+void sd_stream_dct_start(u32 addr, u32 count, u32 blocks) {
+	sd_wait_op();
+	XSPI_AXI_WRITE(SD_CMD_REG, 0x0);
+	sd_wait_idle();
+	sd_dct_count = count;
+	sd_dct_credit = blocks;
+	XSPI_AXI_WRITE(SD_BLOCK_CNT_REG, count);
+	XSPI_AXI_WRITE(SD_RD_ACK_REG, blocks);
 	XSPI_AXI_WRITE(SD_ADDR_REG, addr);
-	// Don't do anything until SD card done
-	while(XSPI_AXI_READ(SD_DEBUG_REG) != 6);
-	XSPI_AXI_WRITE(SD_CMD_REG, CMD_READ);
-	usleep(500);
-	// Wait until read done
-	while(XSPI_AXI_READ(SD_DEBUG_REG) != 6);
-	// From RAM
-	for (u16 i=1; i<len; i++) {
-		//RAM address location
-		XSPI_AXI_WRITE(SD_RADDR_REG, i);
-		//Tell to read
-		XSPI_AXI_WRITE(SD_RAM_CMD_REG, CMD_RAM_READ);
-		//Read data
-		ret_data_arr[i-1] = XSPI_AXI_READ(SD_RD_DATA_REG);
-		if ((i-1) < 10){
-			xil_printf("SD read data %d\n", ret_data_arr[i-1]);
+	XSPI_AXI_WRITE(SD_CMD_REG, CMD_READ_MULTI | CMD_STREAM);
+	while(!(XSPI_AXI_READ(SD_STATUS_REG) & SD_STAT_BUSY));
+	// The stream stays on until sd_stream_dct_end, only the read is dropped
+	XSPI_AXI_WRITE(SD_CMD_REG, CMD_STREAM);
+}
+
+// Let the stream send 8x8 blocks up to this count since sd_stream_dct_start.
+// The DCT only gives its coefficients back once it's empty, so this should
+// run no further ahead of the blocks taken out of its RX FIFO than the RX
+// FIFO holds
+// blocks: total blocks the stream may send, never less than before
+void sd_stream_dct_credit(u32 blocks) {
+	if (blocks != sd_dct_credit) {
+		sd_dct_credit = blocks;
+		XSPI_AXI_WRITE(SD_RD_ACK_REG, blocks);
+	}
+}
+
+// Returns the number of sectors sent to the DCT so far
+u32 sd_stream_dct_sent() {
+	return XSPI_AXI_READ(SD_RD_ACK_REG);
+}
+
+// Wait for the last sector to go out and turn the stream off
+// returns XST_FAILURE if the card rejected the read
+int sd_stream_dct_end() {
+	int status = XST_SUCCESS;
+
+	while (XSPI_AXI_READ(SD_RD_ACK_REG) < sd_dct_count) {
+		if (XSPI_AXI_READ(SD_STATUS_REG) & SD_STAT_ERROR) {
+			print("SD card rejected the read \n");
+			status = XST_FAILURE;
+			break;
 		}
-		//Stop reading
-		XSPI_AXI_WRITE(SD_RAM_CMD_REG, 0);
 	}
-	// End read
-	XSPI_AXI_WRITE(SD_RAM_CMD_REG, 0x0);
+	XSPI_AXI_WRITE(SD_CMD_REG, 0x0);
+	sd_wait_idle();
+	return status;
+}
+
+// Little endian u32 out of a byte array
+static u32 sd_get_u32(u8* data_arr) {
+	return (u32)data_arr[0] | ((u32)data_arr[1] << 8) |
+			((u32)data_arr[2] << 16) | ((u32)data_arr[3] << 24);
+}
+
+// Parse an image header
+// data_arr: header sector as read from the card
+// hdr: filled with the image geometry
+// returns XST_FAILURE if the sector isn't a valid header
+int sd_parse_header(u8* data_arr, sd_img_header* hdr) {
+	if (sd_get_u32(data_arr) != SD_IMG_MAGIC) {
+		return XST_FAILURE;
+	}
+	hdr->width = sd_get_u32(data_arr + 4);
+	hdr->height = sd_get_u32(data_arr + 8);
+	hdr->block_num = sd_get_u32(data_arr + 12);
+	hdr->pixel_format = sd_get_u32(data_arr + 16);
+
+	if (hdr->pixel_format != SD_PIX_FMT_GRAY8) {
+		xil_printf("Unsupported pixel format %d\n", hdr->pixel_format);
+		return XST_FAILURE;
+	}
+	if (hdr->block_num == 0 || hdr->block_num != ((hdr->width + 7)/8) * ((hdr->height + 7)/8)) {
+		xil_printf("Image header block count %d doesn't match %dx%d\n",
+				hdr->block_num, hdr->width, hdr->height);
+		return XST_FAILURE;
+	}
+	return XST_SUCCESS;
+}
+
+// Read the image header
+// addr: SD card address of the header sector
+// hdr: filled with the image geometry
+// returns XST_FAILURE if the sector isn't a valid header
+int sd_read_header(u32 addr, sd_img_header* hdr) {
+	u8 data_arr[SD_IMG_HDR_LEN];
+
+	sd_read(addr, SD_IMG_HDR_LEN, data_arr);
+	return sd_parse_header(data_arr, hdr);
+}
+
+// Wait for the controller to identify the card at the slow SPI clock, then
+// switch to SD_CLK_DIV_FAST for the transfers. Call once before using the
+// card, sd_card_reset calls it again. The divider is only written while the
+// controller is idle, and it reads back once the controller has taken it
+void sd_card_init(){
+	sd_wait_idle();
+	XSPI_AXI_WRITE(SD_DEBUG_REG, SD_CLK_DIV_FAST << SD_CLK_DIV_SHIFT);
+	while(((XSPI_AXI_READ(SD_DEBUG_REG) >> SD_CLK_DIV_SHIFT) & 0xFF) != SD_CLK_DIV_FAST);
 }
 
 void sd_card_reset(){
-    // Reset SD card - set bit 0 of reg 0 high
+    // Reset SD card - set bit 0 of reg 0 high, this also slows the SPI clock down
     XSPI_AXI_WRITE(SD_CMD_REG, CMD_RESET);
     sleep(1);
     //Set reset back low
     XSPI_AXI_WRITE(SD_CMD_REG, 0x00);
+    sd_card_init();
 }
 
 void sd_card_test()
@@ -87,11 +456,12 @@ void sd_card_test()
 	xil_printf("Status reg set to: %d\n", reg);
 	sleep(1);
 	print("Sent reset signal\n");
-	xil_printf("Debug state: %d\n", XSPI_AXI_READ(SD_DEBUG_REG));
+	xil_printf("Debug state: %d\n", XSPI_AXI_READ(SD_DEBUG_REG) & SD_STATE_MASK);
 	//Set reset back low
 	XSPI_AXI_WRITE(SD_CMD_REG, 0x00);
 	reg = XSPI_AXI_READ(SD_CMD_REG);
 	xil_printf("Status reg set to: %d\n", reg);
+	sd_card_init();
 
     xil_printf("Initialize testing array:");
     u8 data_arr[15];
@@ -41,12 +41,41 @@ static volatile int TotalReceivedCount;
 static volatile int TotalSentCount;
 
 /*
-* The following buffers are used in this example to send and receive data
-* with the UartLite.
+* Received sectors go into a ring of UART_RING_SECTORS buffers. RecvHandler
+* is the only writer of the head and fills the ring from the interrupt, the
+* main loop is the only writer of the tail and hands each full sector to the
+* SD card by pointer. Must be a power of 2.
+*/
+#define UART_RING_SECTORS 4
+
+/*
+* With UART_FRAMED the host sends each sector as a CRC checked frame and keeps
+* up to UART_RING_SECTORS of them in flight, see uart_frame.h, instead of
+* waiting for a '!' per sector. host/uart_link has a sender for it,
+* host-pc-uart.py only speaks the '!' protocol. host/uart_link builds uart.c
+* both ways, so it can be set from the command line.
+*/
+#ifndef UART_FRAMED
+#define UART_FRAMED 0
+#endif
+
+/*
+* With UART_FRAMED, sectors given back are acked every UART_ACK_EVERY sectors
+* and whenever the ring runs empty.
+*/
+#define UART_ACK_EVERY 2
+
+/*
+* Sent in place of the next '!' when the board gives up on the image, see
+* uart_rx_abort. With UART_FRAMED it goes out as a UART_FRAME_ERR reply.
+*/
+#define UART_RX_ABORT 'E'
+
+/*
+* The following buffer is used to send the '!' asking the host for the next
+* sector.
 */
 u8 SendBuffer[1];
-u8 ReceiveBuffer[UART_BUFFER_SIZE];
-u8 BufferCopy[UART_BUFFER_SIZE];
 
 
 /************************** Function Prototypes ******************************/
@@ -61,8 +90,16 @@ void SendHandler(void *CallBackRef, unsigned int EventData);
 
 void RecvHandler(void *CallBackRef, unsigned int EventData);
 
-void uart_sd(u32 sd_addr);
+void uart_rx_start();
+
+u8* uart_rx_sector();
+
+u8* uart_rx_peek(u32 n, u32* len);
+
+void uart_rx_release();
+
+void uart_rx_abort();
 
-void resetBuffer();
+void uart_sd(u8* sector);
 
 
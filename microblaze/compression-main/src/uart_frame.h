@@ -0,0 +1,56 @@
+/* Header file for uart_frame.c, the framing of the UART ingestion protocol.
+ *
+ * The host sends each sector as a frame:
+ *   0xA5 0x5A, sequence number, payload length (u16, little endian),
+ *   payload, CRC-16/CCITT-FALSE of the sequence number, length and payload
+ *   (u16, little endian)
+ * and may have up to a window of frames unacknowledged. The board answers
+ *   'A' n : cumulative ack, frames before sequence number n have been used
+ *   'N' n : frame n was lost or corrupted, send again from n
+ *
+ * Only depends on xil_types.h, host/uart_link builds it for the sender.
+ */
+
+#ifndef UART_FRAME_H_
+#define UART_FRAME_H_
+
+#include "xil_types.h"
+
+/* DEFINES */
+
+#define UART_FRAME_SYNC0        0xA5
+#define UART_FRAME_SYNC1        0x5A
+#define UART_FRAME_HDR_LEN      5 // sync, sync, sequence number, length
+#define UART_FRAME_CRC_LEN      2
+#define UART_FRAME_ACK          'A'
+#define UART_FRAME_NAK          'N'
+#define UART_FRAME_ERR          'E' // the board gave up on the transfer, see uart_rx_abort
+
+// results of uart_frame_rx_byte
+#define UART_FRAME_MORE         0 // frame not complete yet
+#define UART_FRAME_OK           1 // frame complete, CRC good
+#define UART_FRAME_BAD          2 // frame complete, CRC wrong or too long
+
+// what to do with a good frame, from uart_frame_check_seq
+#define UART_FRAME_NEXT         0 // the one expected
+#define UART_FRAME_DUP          1 // already had it, its ack was lost
+#define UART_FRAME_GAP          2 // frames before it went missing
+
+typedef struct {
+    u8 state;
+    u8 seq;
+    u16 len;
+    u16 pos; // payload bytes so far
+    u16 crc; // over the frame so far
+    u16 crc_rx; // the frame's CRC
+    u8 *dst; // where the payload went, NULL if it wasn't kept
+} uart_frame_rx_t;
+
+/* Function Definitions */
+u16 uart_crc16(u16 crc, const u8 *data, u32 len);
+void uart_frame_rx_init(uart_frame_rx_t *rx);
+int uart_frame_rx_byte(uart_frame_rx_t *rx, u8 byte, u8 *payload, u16 max_len);
+int uart_frame_check_seq(u8 seq, u32 expected);
+u32 uart_frame_build(u8 *frame, u8 seq, const u8 *payload, u16 len);
+
+#endif // UART_FRAME_H_
@@ -12,10 +12,37 @@
 #include "dct_fifo.h"
 
 
+/* TYPES */
+typedef struct {
+    dct_callback_t callback;
+    void *ref;
+    u32 rx_len;
+    u16 coeff[DCT_MAX_BLOCK_COEFF];
+} dct_request_t;
+
 /* GLOBALS */
 XLlFifo_Config *dct_fifo_cfg;
 XLlFifo  dct_fifo;
 
+// words left over in the RX packet we're currently draining
+static u32 rx_words_left = 0;
+
+// submission queue for dct_submit, the counters only ever increase:
+//  [cb_count, done_count) are compressed and waiting for their callback
+//  [done_count, submit_count) are still in the DCT core
+static dct_request_t dct_queue[DCT_QUEUE_LEN];
+static volatile u32 submit_count = 0;
+static volatile u32 done_count = 0;
+static volatile u32 cb_count = 0;
+// TX packets written to the FIFO but not yet streamed out
+static volatile u32 tx_pending = 0;
+// errors seen by the interrupt, which leaves the logging to dct_process_completions()
+static volatile u32 rx_sync_errors = 0; // blocks that ran out of room before their EOF
+static volatile u32 fifo_int_errors = 0;
+static volatile u32 fifo_int_status = 0; // error bits of the last one
+static u32 rx_sync_logged = 0;
+static u32 fifo_int_logged = 0;
+
 /* FUNCTIONS */
 
 /** 
@@ -71,14 +98,26 @@ int dct_init(void){
 int dct_transmit(u8 *base_addr, u32 len){
     int status = XST_SUCCESS;
     u32 write_val = 0;
+    u32 tx_bytes = len*4/DCT_PIXELS_PER_WORD;
 
-    if (len > MAX_FIFO_LEN){
+    // each pixel pair (or quad, when packed) takes up a full 32-bit word in the FIFO
+    if (tx_bytes > MAX_FIFO_LEN){
         xil_printf("ERROR: attempting to write more bytes to the AXIS FIFO then there is space for ...");
     }
 
-    for (int i=0 ; i < len ; i=i+2){
+    for (int i=0 ; i < len ; i=i+DCT_PIXELS_PER_WORD){
         // construct the word to write
+#if DCT_PACKED_INPUT
+        if (((UINTPTR)base_addr & 0x3) == 0){
+            // little-endian, so the first pixel lands in the lowest byte
+            write_val = *(u32*)(base_addr + i);
+        } else {
+            write_val = (u32)(base_addr[3 + i] << 24 | base_addr[2 + i] << 16 |
+                    base_addr[1 + i] << 8 | base_addr[0 + i]);
+        }
+#else
         write_val =  (u32)(0x0000FFFF & (base_addr[1 + i] << 8 | base_addr[0 + i]));
+#endif
 
         //xil_printf("writing to DCT %d\n", write_val);
         // check for vacancy in the fifo tx buffer
@@ -92,11 +131,35 @@ int dct_transmit(u8 *base_addr, u32 len){
     }
 
     // write the length that we just wrote
-    XLlFifo_iTxSetLen(&dct_fifo, len*2);
+    XLlFifo_iTxSetLen(&dct_fifo, tx_bytes);
 
     return status;
 }
 
+/**
+ * Write several 8x8 blocks of pixels to the AXI Stream FIFO as one packet
+ *
+ * The blocks must be stored back to back, DCT_BLOCK_PIXELS bytes each. Saves
+ * the per-packet length write and completion poll of one dct_transmit() call
+ * per block.
+ *
+ * @param base_addr (u8*) pointer to the first block
+ * @param n_blocks (u32) number of blocks, at most DCT_MAX_BATCH_BLOCKS
+ *
+ * @return
+ *  -XST_SUCCESS to indicate success
+ *  -XST_FAILURE to indicate FAILURE
+ */
+int dct_transmit_blocks(u8 *base_addr, u32 n_blocks){
+
+    if (n_blocks == 0 || n_blocks > DCT_MAX_BATCH_BLOCKS){
+        xil_printf("ERROR: can't send %d blocks in one AXIS FIFO packet\n", n_blocks);
+        return XST_FAILURE;
+    }
+
+    return dct_transmit(base_addr, n_blocks*DCT_BLOCK_PIXELS);
+}
+
 /**
  * Check if the AXIS FIFO is done transmitting data
  * 
@@ -156,3 +219,312 @@ u32 dct_receive(u16 *dest_addr){
 }
 
 
+/**
+ * Read the DCT coefficients of exactly one block from the AXI Stream FIFO
+ *
+ * The DCT core only raises TLAST once it has no other block in flight, so when
+ * blocks are pipelined a single RX packet can hold several of them. This
+ * splits the stream on the EOF marker and keeps the rest of the packet in the
+ * FIFO for the next call.
+ *
+ * @param dest_addr (u16*) pointer to the destination address to write to,
+ *      must hold DCT_MAX_BLOCK_COEFF coefficients
+ *
+ * @return
+ *  -number of coefficients read, including the EOF
+ */
+u32 dct_receive_block(u16 *dest_addr){
+
+    u32 rx_word;
+    u16 lower, upper;
+    u32 rx_len = 0;
+
+    while (rx_len < DCT_MAX_BLOCK_COEFF){
+        if (rx_words_left == 0){
+            // wait for the next packet from the DCT core
+            while(!XLlFifo_iRxOccupancy(&dct_fifo)){};
+            rx_words_left = XLlFifo_iRxGetLen(&dct_fifo)/4; // length is in bytes
+        }
+
+        rx_word = XLlFifo_RxGetWord(&dct_fifo);
+        rx_words_left--;
+
+        lower = (u16)(rx_word & 0x0000FFFF); // lower coefficient
+        upper = (u16)((rx_word >> 16) & 0x0000FFFF); // upper coefficient
+        dest_addr[rx_len] = lower;
+        dest_addr[rx_len+1] = upper;
+        rx_len = rx_len + 2;
+
+        // the run-length stage always ends a block on a word boundary
+        if (lower == DCT_EOF || upper == DCT_EOF){
+            return rx_len;
+        }
+    }
+
+    xil_printf("ERROR: no EOF found in DCT block, stream is out of sync\n");
+    return rx_len;
+}
+
+/**
+ * Read the DCT coefficients of several blocks from the AXI Stream FIFO
+ *
+ * @param dest_addr (u16*) pointer to n_blocks arrays of DCT_MAX_BLOCK_COEFF
+ *      coefficients, one per block
+ * @param n_blocks (u32) number of blocks to read
+ * @param rx_lens (u32*) filled with the number of coefficients of each block
+ *
+ * @return
+ *  -total number of coefficients read
+ */
+u32 dct_receive_blocks(u16 *dest_addr, u32 n_blocks, u32 *rx_lens){
+    u32 total_len = 0;
+
+    for (u32 i=0; i < n_blocks; i++){
+        rx_lens[i] = dct_receive_block(dest_addr + i*DCT_MAX_BLOCK_COEFF);
+        total_len = total_len + rx_lens[i];
+    }
+
+    return total_len;
+}
+
+/**
+ * Move the coefficients already in the RX FIFO into the submission queue
+ *
+ * Never waits for the DCT, so it's safe to call from the interrupt: only the
+ * words the FIFO reports are read, and a block that isn't all there yet is
+ * picked up where it left off on the next call.
+ */
+static void dct_drain_rx(void){
+    dct_request_t *req;
+    u32 occupancy;
+    u32 rx_word;
+    u16 lower, upper;
+
+    occupancy = XLlFifo_iRxOccupancy(&dct_fifo);
+    while (done_count != submit_count && occupancy){
+        if (rx_words_left == 0){
+            rx_words_left = XLlFifo_iRxGetLen(&dct_fifo)/4; // length is in bytes
+        }
+
+        req = &dct_queue[done_count % DCT_QUEUE_LEN];
+        rx_word = XLlFifo_RxGetWord(&dct_fifo);
+        rx_words_left--;
+        occupancy--;
+
+        lower = (u16)(rx_word & 0x0000FFFF); // lower coefficient
+        upper = (u16)((rx_word >> 16) & 0x0000FFFF); // upper coefficient
+        req->coeff[req->rx_len] = lower;
+        req->coeff[req->rx_len+1] = upper;
+        req->rx_len = req->rx_len + 2;
+
+        // the run-length stage always ends a block on a word boundary
+        if (lower == DCT_EOF || upper == DCT_EOF){
+            done_count++;
+        } else if (req->rx_len >= DCT_MAX_BLOCK_COEFF){
+            rx_sync_errors++;
+            done_count++;
+        }
+
+        if (occupancy == 0){
+            occupancy = XLlFifo_iRxOccupancy(&dct_fifo);
+        }
+    }
+}
+
+/**
+ * Set up interrupt-driven operation of the AXIS FIFO, call after dct_init()
+ *
+ * The handler must already be connected to the interrupt controller, which
+ * platform_setup_interrupts() does when the FIFO interrupt is wired up.
+ *
+ * @return
+ *  -XST_SUCCESS to indicate success
+ */
+int dct_async_init(void){
+    submit_count = 0;
+    done_count = 0;
+    cb_count = 0;
+    tx_pending = 0;
+    rx_words_left = 0;
+    rx_sync_errors = 0;
+    fifo_int_errors = 0;
+    rx_sync_logged = 0;
+    fifo_int_logged = 0;
+
+    XLlFifo_IntClear(&dct_fifo, XLLF_INT_ALL_MASK);
+    XLlFifo_IntEnable(&dct_fifo, XLLF_INT_RC_MASK | XLLF_INT_TC_MASK | XLLF_INT_ERROR_MASK);
+
+    return XST_SUCCESS;
+}
+
+/**
+ * Queue one 8x8 block for compression without waiting for it
+ *
+ * The callback runs from dct_process_completions(), never from the interrupt,
+ * so it's free to call into lwIP or the SD card.
+ *
+ * @param base_addr (u8*) pointer to the DCT_BLOCK_PIXELS pixels of the block
+ * @param callback (dct_callback_t) function to hand the coefficients to
+ * @param ref (void*) passed through to the callback
+ *
+ * @return
+ *  -XST_SUCCESS if the block was queued
+ *  -XST_FAILURE if the queue, the TX FIFO or the DCT is full, try again later
+ */
+int dct_submit(u8 *base_addr, dct_callback_t callback, void *ref){
+    dct_request_t *req;
+
+    if (submit_count - cb_count >= DCT_QUEUE_LEN){
+        return XST_FAILURE;
+    }
+    // make sure the whole packet fits, dct_transmit would drop pixels otherwise
+    if ((tx_pending + 1)*DCT_BLOCK_TX_BYTES > MAX_FIFO_LEN){
+        return XST_FAILURE;
+    }
+    // and that the coefficients of every block in the core fit in the RX FIFO
+    if (submit_count - done_count >= DCT_MAX_PIPELINE_BLOCKS){
+        return XST_FAILURE;
+    }
+
+    req = &dct_queue[submit_count % DCT_QUEUE_LEN];
+    req->callback = callback;
+    req->ref = ref;
+    req->rx_len = 0;
+
+    // bump the counters before sending, the interrupt can fire right away
+    tx_pending++;
+    submit_count++;
+
+    return dct_transmit(base_addr, DCT_BLOCK_PIXELS);
+}
+
+/**
+ * Queue the callback of a block that reaches the DCT some other way
+ *
+ * For blocks the SD controller streams into the DCT core directly: nothing
+ * is written to the TX FIFO, the coefficients are collected like those of
+ * dct_submit(). Blocks come out in order, so call this once per block in the
+ * order they're streamed.
+ *
+ * @param callback (dct_callback_t) function to hand the coefficients to, or NULL to drop them
+ * @param ref (void*) passed through to the callback
+ *
+ * @return
+ *  -XST_SUCCESS if the block was queued
+ *  -XST_FAILURE if the queue is full, try again later
+ */
+int dct_expect(dct_callback_t callback, void *ref){
+    dct_request_t *req;
+
+    if (submit_count - cb_count >= DCT_QUEUE_LEN){
+        return XST_FAILURE;
+    }
+
+    req = &dct_queue[submit_count % DCT_QUEUE_LEN];
+    req->callback = callback;
+    req->ref = ref;
+    req->rx_len = 0;
+    submit_count++;
+
+    // the block may have come out already, the RX interrupt only takes
+    // what's been queued
+    XLlFifo_IntDisable(&dct_fifo, XLLF_INT_RC_MASK);
+    dct_drain_rx();
+    XLlFifo_IntEnable(&dct_fifo, XLLF_INT_RC_MASK);
+
+    return XST_SUCCESS;
+}
+
+/**
+ * Run the callbacks of all blocks that finished since the last call, and log
+ * the errors the interrupt ran into
+ *
+ * @return
+ *  -number of callbacks run
+ */
+u32 dct_process_completions(void){
+    dct_request_t *req;
+    u32 n_done = 0;
+    u32 errors;
+
+    errors = rx_sync_errors;
+    if (errors != rx_sync_logged){
+        xil_printf("ERROR: %d DCT blocks without an EOF, stream is out of sync\n", errors - rx_sync_logged);
+        rx_sync_logged = errors;
+    }
+    errors = fifo_int_errors;
+    if (errors != fifo_int_logged){
+        xil_printf("ERROR: AXIS FIFO interrupt 0x%x, %d times\n", fifo_int_status, errors - fifo_int_logged);
+        fifo_int_logged = errors;
+    }
+
+    while (cb_count != done_count){
+        req = &dct_queue[cb_count % DCT_QUEUE_LEN];
+        if (req->callback){
+            req->callback(req->ref, req->coeff, req->rx_len);
+        }
+        cb_count++;
+        n_done++;
+    }
+
+    return n_done;
+}
+
+/**
+ * Number of submitted blocks whose callback hasn't run yet
+ *
+ * @return
+ *  -number of blocks in the queue
+ */
+u32 dct_pending(void){
+    return submit_count - cb_count;
+}
+
+/**
+ * Number of blocks whose callback has run since dct_async_init()
+ *
+ * @return
+ *  -number of blocks completed
+ */
+u32 dct_completed(void){
+    return cb_count;
+}
+
+/**
+ * Interrupt handler for the AXIS FIFO
+ *
+ * Receive complete moves the coefficients in the RX FIFO into the submission
+ * queue, transmit complete frees up room in the TX FIFO for dct_submit().
+ * Errors are only counted here, dct_process_completions() logs them.
+ *
+ * @param ref (void*) unused, the FIFO instance is global
+ */
+void dct_fifo_intr_handler(void *ref){
+    u32 pending;
+
+    pending = XLlFifo_IntPending(&dct_fifo);
+
+    while (pending){
+        if (pending & XLLF_INT_RC_MASK){
+            XLlFifo_IntClear(&dct_fifo, XLLF_INT_RC_MASK);
+
+            dct_drain_rx();
+        }
+        else if (pending & XLLF_INT_TC_MASK){
+            XLlFifo_IntClear(&dct_fifo, XLLF_INT_TC_MASK);
+            if (tx_pending > 0){
+                tx_pending--;
+            }
+        }
+        else if (pending & XLLF_INT_ERROR_MASK){
+            fifo_int_status = pending & XLLF_INT_ERROR_MASK;
+            fifo_int_errors++;
+            XLlFifo_IntClear(&dct_fifo, XLLF_INT_ERROR_MASK);
+        }
+        else {
+            XLlFifo_IntClear(&dct_fifo, pending);
+        }
+
+        pending = XLlFifo_IntPending(&dct_fifo);
+    }
+}
@@ -15,19 +15,54 @@
 #include "xllfifo.h"
 #include "xstatus.h"
 #include "xparameters.h"
+#include "xintc.h"
 //#include "xil_printf.h"
 
 /* DEFINES */
 
 #define FIFO_DEV_ID             XPAR_AXI_FIFO_0_DEVICE_ID
 #define MAX_FIFO_LEN            512 // bytes, set in block diagram
+#define DCT_EOF                 0xFFFF // run-length end of block marker
+#define DCT_MAX_BLOCK_COEFF     66 // 64 coefficients + EOF, padded to a full word
+#define DCT_PACKED_INPUT        0 // match PACKED_INPUT of custom_dct_axis
+#define DCT_BLOCK_PIXELS        64 // one 8x8 block
+#if DCT_PACKED_INPUT
+#define DCT_PIXELS_PER_WORD     4
+#else
+#define DCT_PIXELS_PER_WORD     2
+#endif
+#define DCT_BLOCK_TX_BYTES      (DCT_BLOCK_PIXELS*4/DCT_PIXELS_PER_WORD) // bytes of TX FIFO per block
+#define DCT_MAX_BATCH_BLOCKS    (MAX_FIFO_LEN/DCT_BLOCK_TX_BYTES) // blocks per TX packet
+#define DCT_RX_FIFO_LEN         MAX_FIFO_LEN // bytes, RX side of the FIFO, set in block diagram
+#define DCT_MAX_PIPELINE_BLOCKS (DCT_RX_FIFO_LEN/(DCT_MAX_BLOCK_COEFF*2)) // blocks in the DCT at once, the core only raises TLAST when it's empty
+#define DCT_QUEUE_LEN           8 // blocks tracked by dct_submit, power of 2
+#define DCT_FIFO_INT_IRQ_ID     XPAR_INTC_0_LLFIFO_0_VEC_ID
 // #define FIFO_BASE_ADDR          XPAR_AXI
 
+/* TYPES */
+
+// called from dct_process_completions() once a submitted block is compressed
+typedef void (*dct_callback_t)(void *ref, u16 *coeff, u32 rx_len);
+
+/* GLOBALS */
+extern XLlFifo dct_fifo;
+
 
 /* Function Definitions */
 int dct_init(void);
 int dct_transmit(u8 *base_addr, u32 len);
+int dct_transmit_blocks(u8 *base_addr, u32 n_blocks);
 int dct_transmit_done(void);
 u32 dct_receive(u16 *dest_addr);
+u32 dct_receive_block(u16 *dest_addr);
+u32 dct_receive_blocks(u16 *dest_addr, u32 n_blocks, u32 *rx_lens);
+
+int dct_async_init(void);
+int dct_submit(u8 *base_addr, dct_callback_t callback, void *ref);
+int dct_expect(dct_callback_t callback, void *ref);
+u32 dct_process_completions(void);
+u32 dct_pending(void);
+u32 dct_completed(void);
+void dct_fifo_intr_handler(void *ref);
 
 #endif // DCT_FIFO_H_
@@ -0,0 +1,107 @@
+/* Runtime quantization table of the DCT, see dct_quant.h.
+ *
+ * The quality factor scales the standard JPEG luminance table the way
+ * libjpeg does, 50 is the table itself, lower is coarser (fewer run-length
+ * words per block) and higher is finer. The DCT can only divide by powers of
+ * two, so each entry then becomes its nearest shift in log scale, the same as
+ * python/quantization_gen.py.
+ */
+
+/* INCLUDES */
+#include "dct_quant.h"
+
+
+/* GLOBALS */
+
+// the JPEG luminance quantization table, row by row
+static const u8 jpeg_luma[64] = {
+    16, 11, 10, 16, 24,  40,  51,  61,
+    12, 12, 14, 19, 26,  58,  60,  55,
+    14, 13, 16, 24, 40,  57,  69,  56,
+    14, 17, 22, 29, 51,  87,  80,  62,
+    18, 22, 37, 56, 68,  109, 103, 77,
+    24, 36, 55, 64, 81,  104, 113, 92,
+    49, 64, 78, 87, 103, 121, 120, 101,
+    72, 92, 95, 98, 112, 100, 103, 99
+};
+
+/* FUNCTIONS */
+
+/**
+ * Work out the quantizer shifts for a quality factor
+ *
+ * @param quality (int) 1 (smallest output) to 100 (best image), clamped
+ * @param shifts (u8*) 64 shifts, in the order the DCT wants them
+ *
+ * @return
+ *  - void
+ */
+void dct_quality_table(int quality, u8 *shifts){
+    u32 scale, q, s;
+
+    if (quality < 1) quality = 1;
+    if (quality > 100) quality = 100;
+    scale = (quality < 50) ? 5000/quality : 200 - 2*quality;
+
+    for (int i = 0; i < 64; i++){
+        // the DCT gives its coefficients transposed
+        q = (jpeg_luma[8*(i%8) + i/8]*scale + 50)/100;
+        if (q < 1) q = 1;
+        if (q > 255) q = 255;
+
+        // round(log2(q)), q is at least 2**(s+0.5) while q*q >= 2**(2s+1)
+        s = 0;
+        while (q*q >= (1u << (2*s + 1))) s++;
+
+        if (s < DCT_QUANT_MIN_SHIFT) s = DCT_QUANT_MIN_SHIFT;
+        if (s > DCT_QUANT_MAX_SHIFT) s = DCT_QUANT_MAX_SHIFT;
+        shifts[i] = (u8)s;
+    }
+}
+
+/**
+ * Write a new quantization table and wait for the DCT to take it. The DCT
+ * should be idle, a block already inside it gets the new table
+ *
+ * @param shifts (const u8*) 64 shifts, in the order the DCT wants them
+ *
+ * @return
+ *  - XST_SUCCESS if the DCT took the table, XST_FAILURE if it never did
+ */
+int dct_set_quant_table(const u8 *shifts){
+    u32 timeout = DCT_QUANT_TIMEOUT;
+
+    // the table is read only while a load is pending
+    while (Xil_In32(DCT_QUANT_ADDR + DCT_QUANT_CTRL_REG) & DCT_QUANT_CTRL_PENDING){
+        if (--timeout == 0) return XST_FAILURE;
+    }
+
+    for (int n = 0; n < 16; n++){
+        Xil_Out32(DCT_QUANT_ADDR + DCT_QUANT_TABLE_REG + 4*n,
+                (u32)shifts[4*n] | ((u32)shifts[4*n + 1] << 8) |
+                ((u32)shifts[4*n + 2] << 16) | ((u32)shifts[4*n + 3] << 24));
+    }
+    Xil_Out32(DCT_QUANT_ADDR + DCT_QUANT_CTRL_REG, DCT_QUANT_CTRL_LOAD);
+
+    // every core takes it at the start of its next block, straight away if idle
+    timeout = DCT_QUANT_TIMEOUT;
+    while (Xil_In32(DCT_QUANT_ADDR + DCT_QUANT_CTRL_REG) & DCT_QUANT_CTRL_PENDING){
+        if (--timeout == 0) return XST_FAILURE;
+    }
+    return XST_SUCCESS;
+}
+
+/**
+ * Set the DCT's quantization from a quality factor, between images
+ *
+ * @param quality (int) 1 (smallest output) to 100 (best image)
+ *
+ * @return
+ *  - XST_SUCCESS if the DCT took the table, XST_FAILURE if it never did
+ */
+int dct_set_quality(int quality){
+    u8 shifts[64];
+
+    dct_quality_table(quality, shifts);
+    return dct_set_quant_table(shifts);
+}
@@ -0,0 +1,36 @@
+/* Header file for dct_quant.c, loading the DCT's quantization table at runtime.
+ *
+ * The table is 64 right shifts, one per coefficient, the same as
+ * quant_coeff.mem. It sits in the quant_regs AXI-Lite registers of
+ * custom_dct_axis and the DCT takes a new one between blocks, so load it
+ * before sending an image.
+ */
+
+#ifndef DCT_QUANT_H_
+#define DCT_QUANT_H_
+
+#include "xil_types.h"
+#include "xil_io.h"
+#include "xstatus.h"
+
+/* DEFINES */
+
+#define DCT_QUANT_ADDR          0x44A10000 // set in block diagram, see DCT_QUANT_REGS in main.c
+#define DCT_QUANT_CTRL_REG      0x00 // write to load the table, reads pending
+#define DCT_QUANT_TABLE_REG     0x40 // 16 words, entry 4n + b in byte b of word n
+#define DCT_QUANT_CTRL_LOAD     0x1
+#define DCT_QUANT_CTRL_PENDING  0x1
+
+#define DCT_QUANT_MIN_SHIFT     3 // smaller shifts overflow the quantizer output
+#define DCT_QUANT_MAX_SHIFT     8 // a JPEG quantizer of 255
+#define DCT_QUANT_TIMEOUT       100000 // polls of DCT_QUANT_CTRL_REG
+
+#define DCT_QUALITY_DEFAULT     50 // the table in quant_coeff.mem
+
+
+/* Function Definitions */
+void dct_quality_table(int quality, u8 *shifts);
+int dct_set_quant_table(const u8 *shifts);
+int dct_set_quality(int quality);
+
+#endif // DCT_QUANT_H_
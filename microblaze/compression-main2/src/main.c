@@ -54,6 +54,7 @@
 #include "sleep.h"
 //#include "dct_dma.h"
 #include "dct_fifo.h"
+#include "dct_quant.h"
 #include "sd_card.h"
 
 // need to get platform.h, platform_config.h from the example project to include
@@ -93,16 +94,116 @@
 #define DEST_IP6_ADDR "fe80::6600:6aff:fe71:fde3"
 #define DEST_PORT 7
 
-// 8x8x7 block numbers sent over UART
-// 146 8x8x7 blocks + 2 left over with zero padding
-#define IMG_BLOCK_NUM 1024
-#define UART_BLOCK_NUM 147
-
-//#define IMG_BLOCK_NUM 70
-//#define UART_BLOCK_NUM 10
+// image header sector written by compression-main, the pixels start in the
+// next sector. Cards written before the header hold a 256x256 image from here
+#define SD_IMG_ADDR 0x00000000
+#define IMG_DEFAULT_WIDTH 256
+#define IMG_DEFAULT_HEIGHT 256
+#define BLOCKS_PER_SECTOR SD_BLOCKS_PER_SECTOR
+#define SD_SECTOR_BYTES (BLOCKS_PER_SECTOR*64)
 
 #define TCP_SEND_BUFSIZE 134
 
+// packets written to lwIP but not yet acked by the server, refilled from tcp_client_sent.
+// 8 packets are 1072 bytes, inside the 2048 byte receive window of the mirror server
+#define TCP_WINDOW_PKTS 8
+// also wait for a RDY per packet, the server gives TCP_WINDOW_PKTS credits up front.
+// With TCP_WINDOW_PKTS 1 this is the old stop-and-wait protocol
+#define TCP_RDY_CREDIT 0
+// hand lwIP pointers into the coefficient arena instead of copying every packet,
+// the arena space is only released once the server acks it
+#define TCP_ZERO_COPY 1
+
+// packets compressed and waiting for room in lwIP or an ack, one per index
+// slot, the geometry and the telemetry
+#define TX_QUEUE_LEN (COEFF_INDEX_LEN+2)
+#define TX_TELEMETRY 0xFFFF // tx_queue entry of the compression ratio packet
+#define TX_GEOMETRY 0xFFFE // tx_queue entry of the image geometry packet
+
+// number of 8x8 blocks queued in the DCT at once. The core only raises TLAST
+// once it's empty, so the worst case coefficients of all of them have to fit
+// in the RX FIFO: 3 blocks of 132 bytes in 512
+#define DCT_PIPELINE_DEPTH DCT_MAX_PIPELINE_BLOCKS
+// number of 8x8 blocks sent to the DCT in one AXIS FIFO packet, at most
+// DCT_MAX_BATCH_BLOCKS. With a pipeline this short single blocks keep the DCT
+// busier than batches do: 136k blocks/s against 127k for batches of 3 in
+// host/dct_model
+#define DCT_BATCH_BLOCKS 1
+
+// hand blocks to the DCT with dct_submit() and collect them from the FIFO
+// interrupt, needs the AXI FIFO interrupt wired up to the INTC
+#define DCT_ASYNC 0
+
+// the DCT was built with the quant_regs AXI-Lite port, at DCT_QUANT_ADDR in the
+// block diagram. Without it the DCT keeps quant_coeff.mem, and the geometry
+// leaves the quality out so the client uses that table
+#define DCT_QUANT_REGS 0
+// quality of the DCT's quantization table, 1 (smallest output) to 100 (best
+// image). With DCT_QUANT_REGS, loaded before the image goes in and sent to the
+// client with the geometry so it dequantizes with the same table
+#define DCT_QUALITY DCT_QUALITY_DEFAULT
+
+// the SD controller streams the sectors straight into the DCT, the CPU only
+// collects the coefficients. Needs the DCT's s_axis wired to the SD IP's
+// m00_axis instead of the AXI FIFO, with PACKED_INPUT set
+#define SD_DCT_STREAM 0
+
+// compress the image as host-pc-uart.py sends it instead of reading it back
+// from the SD card, every 8x8 block goes to the DCT as soon as its 64 bytes are
+// in the UART ring. The header comes over UART first, as for compression-main
+#define UART_DCT_STREAM 0
+// with UART_DCT_STREAM, also write the header and pixel sectors to the card
+// the way compression-main does, to keep a copy of the raw image
+#define UART_SD_ARCHIVE 1
+
+// print every block the DCT gives back and every TCP packet sent or received,
+// slows the DCT down to the UART's pace
+#define DCT_VERBOSE 0
+
+#if DCT_PIPELINE_DEPTH < DCT_BATCH_BLOCKS
+#error "DCT_PIPELINE_DEPTH must hold at least one batch"
+#endif
+#if DCT_BATCH_BLOCKS > DCT_MAX_BATCH_BLOCKS
+#error "DCT_BATCH_BLOCKS doesn't fit in the TX FIFO"
+#endif
+#if DCT_PIPELINE_DEPTH*DCT_MAX_BLOCK_COEFF*2 > DCT_RX_FIFO_LEN
+#error "the coefficients of DCT_PIPELINE_DEPTH blocks don't fit in the RX FIFO"
+#endif
+
+#if SD_DCT_STREAM && !(DCT_ASYNC && DCT_PACKED_INPUT)
+#error "SD_DCT_STREAM collects the coefficients with DCT_ASYNC and needs DCT_PACKED_INPUT"
+#endif
+
+#if UART_DCT_STREAM && SD_DCT_STREAM
+#error "UART_DCT_STREAM and SD_DCT_STREAM can't both feed the DCT"
+#endif
+
+// compress from the event loop while the packets go out over TCP, only
+// COEFF_INDEX_LEN blocks are held in memory instead of the whole image.
+// With 0, as much of the image as fits in the arena is compressed before
+// connecting and the rest is compressed as it's sent. With DCT_ASYNC that
+// happens alongside the lwIP start up rather than before it
+#define STREAM_COMPRESSION 1
+
+#if STREAM_COMPRESSION
+// compressed blocks not yet handed to lwIP, needs to cover one DCT batch
+#define COEFF_INDEX_LEN 16
+// run-length words of those blocks
+#define COEFF_ARENA_WORDS 2048
+#else
+// a whole 256x256 image, larger ones stream the rest
+#define COEFF_INDEX_LEN 1024
+// 32 KB, typical images come out at around 10 words per block
+#define COEFF_ARENA_WORDS 16384
+#endif
+
+#if COEFF_INDEX_LEN < DCT_BATCH_BLOCKS
+#error "COEFF_INDEX_LEN must hold at least one batch"
+#endif
+#if COEFF_ARENA_WORDS < (DCT_PIPELINE_DEPTH+1)*DCT_MAX_BLOCK_COEFF
+#error "COEFF_ARENA_WORDS must hold the worst case of every block queued in the DCT"
+#endif
+
 //Interrupt handlers
 #define INTC_DEVICE_ID XPAR_INTC_0_DEVICE_ID
 #define UARTLITE_INT_IRQ_ID XPAR_INTC_0_UARTLITE_0_VEC_ID
@@ -145,8 +246,20 @@ static err_t tcp_client_recv(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, er
 static err_t tcp_client_sent(void *arg, struct tcp_pcb *tpcb, u16_t len);
 static void tcp_client_err(void *arg, err_t err);
 static void tcp_client_close(struct tcp_pcb *pcb);
+static err_t tcp_tx_service(struct tcp_pcb *tpcb);
+void tx_enqueue(u16 entry);
+static err_t tcp_client_write_coeff(struct tcp_pcb *tpcb, u32 slot);
 
 void assemble_packets(u8* packet_ptr, u8* coeff_ptr, u32 len, u8 type);
+void assemble_header(u8* packet_ptr, u32 len, u8 type);
+void assemble_telemetry(void);
+void assemble_geometry(void);
+void dct_block_done(void *ref, u16 *coeff, u32 rx_len);
+u32 coeff_tx_limit(void);
+u8* dct_source_block(u32 img_block);
+u32 dct_source_ready(u32 img_block);
+void dct_source_release(void);
+u32 dct_compress_step(u32 tx_limit);
 
 
 /* =============================================================================
@@ -173,18 +286,68 @@ struct netif *echo_netif;
 //Packet input global variables for TCP
 u8 packetinput[TCP_SEND_BUFSIZE] = {0};
 
-// array to store the coefficients to be written out over TCP
-u8 coeff_arr[IMG_BLOCK_NUM][134] = {0};
-
-volatile int packet_sent = 0;
+// run-length words of the compressed blocks, back to back in image order.
+// Blocks are released in the same order once acked, so the arena wraps around
+// like a ring, a block that doesn't fit before the end starts at word 0
+u16 coeff_arena[COEFF_ARENA_WORDS] = {0};
+u32 coeff_arena_head = 0; // words allocated, including the padding skipped at the end
+u32 coeff_arena_tail = 0; // words released
+
+// per-block index into the arena, image block n goes in slot n % COEFF_INDEX_LEN
+u16 coeff_off[COEFF_INDEX_LEN] = {0}; // first word of the block in coeff_arena
+u16 coeff_len[COEFF_INDEX_LEN] = {0}; // number of run-length words
+u32 coeff_end[COEFF_INDEX_LEN] = {0}; // coeff_arena_head after the block, released up to here
+u8 coeff_hdr[COEFF_INDEX_LEN][4] = {0}; // packet header of the block, lwIP points here until acked
+
+// zeros after the coefficients of a short packet
+const u8 pkt_pad[TCP_SEND_BUFSIZE-4] = {0};
+
+// transmit queue, written to lwIP in order by tcp_tx_service
+u16 tx_queue[TX_QUEUE_LEN] = {0}; // index slot of each coefficient packet, or TX_GEOMETRY/TX_TELEMETRY
+u32 tx_queue_head = 0; // packets queued
+u32 tx_queue_tail = 0; // packets written to lwIP
+u32 tx_part_sent = 0; // bytes of the packet at tx_queue_tail already written to lwIP
+u32 tx_queue_max_depth = 0; // most packets ever waiting in the queue
+u32 tx_stall_count = 0; // times the queue had packets but lwIP had no room
+u32 tx_stall_us = 0; // total time spent stalled
+u32 tx_stall_start = 0; // platform_time_us() when the current stall started
+u8 tx_stalled = 0;
+
+u32 send_credit = 0; // packets the server is ready for (one per RDY)
+u32 tcp_unacked = 0; // bytes written to lwIP and not acked yet
+u32 packet_acked = 0; // packets acked by the server, counts through tx_queue
+u32 coeff_blocks_acked = 0; // coefficient packets acked by the server
+u32 tcp_acked_bytes = 0; // acked bytes of the packet after packet_acked
+u32 tcp_bytes_copied = 0; // coefficient bytes copied by the CPU for this image
 
 // dct global arrays
-u16 dct_rx_ptr[65] = {0}; // array for storing the DCT output
+u16 dct_rx_ptr[DCT_BATCH_BLOCKS][DCT_MAX_BLOCK_COEFF] = {0}; // array for storing the DCT output
+u32 dct_rx_len[DCT_BATCH_BLOCKS] = {0}; // coefficients per block in dct_rx_ptr
+u32 dct_blocks_done = 0; // blocks stored by dct_block_done
+u32 dct_bytes_done = 0; // coefficient bytes stored by dct_block_done
+u32 dct_tx_block = 0; // next image block to hand to the DCT
+u32 dct_pad_blocks = 0; // zero blocks after the image in its last sector, SD_DCT_STREAM
+
+// sector read from the SD card, word aligned so that packed DCT transmits can use word loads.
+// The controller reads the following sectors ahead into its own RAM
+u8 sd_read_arr[SD_SECTOR_LEN] __attribute__((aligned(4))) = {0};
+u32 sd_read_block = 0xFFFFFFFF; // sector held in sd_read_arr
+
+u32 uart_src_sector = 0; // pixel sector at the tail of the UART ring, UART_DCT_STREAM
+u8 uart_src_done = 0; // every sector handed back to the ring
 
 u32 telem_num = 0;
 
 u8 telem_ratio[134] = {0};
 u8 telem_bw[134] = {0};
+u8 telem_geometry[134] = {0};
+
+// image geometry, read from the header sector at boot
+sd_img_header img_hdr;
+u32 img_block_num = 0;
+// quality of the table the DCT took, 0 while it has quant_coeff.mem
+u8 dct_quality = 0;
+u32 sd_data_addr = SD_IMG_ADDR + 1; // first pixel sector
 
 // dct_tx_ptr is the same as &dct_tx_ptr[0], reminder to myself
 
@@ -211,143 +374,93 @@ int main()
 
     init_platform();
 
-	platform_enable_interrupts();
-
-    // /* DCT OPERATION GOES HERE*/
-
-
-	// initialize the DCT AXIS FIFO
-	dct_init();
-
-
-    // declare the array storing what's read from the SD card
-	u8 sd_read_arr[UART_BUFFER_SIZE] = {0};
-    u32 rx_len = 0;
-    u32 total_len = 0;
-    // u32 bw = 0;
-
-	// we're using DCT
-
-	for(u32 sd_block=0; sd_block<UART_BLOCK_NUM; sd_block++){
-		// iterate over the SD card blocks
-
-		// read data from the sd card
-		sd_read((u32)(0x00000000 + sd_block), UART_BUFFER_SIZE, (u8*)sd_read_arr);
-		xil_printf("\nReading Data from SD card, block %d\n\n", sd_block);
-
-		//xil_printf("random data checking %d\n", sd_read_arr[33]);
-
-		if (sd_block == UART_BLOCK_NUM - 1){
-			// last iteration of UART block doesn't contain all 7 blocks
-			int residual = IMG_BLOCK_NUM % 7;
-
-			xil_printf("residual is %d\n", residual);
-
-			if(residual > 0){
-				for (u32 i=0; i<residual; i++){
-					// double start = clock();
-					dct_transmit((u8*)(sd_read_arr + (i*64)), 64);
-					xil_printf("waiting for DCT...\n");
-					while (!dct_transmit_done()){};
-
-					// double end = clock();
-					// returns the # of received coefficients, each coeff is 2 bytes
-					rx_len = dct_receive((u16*)dct_rx_ptr);
-					xil_printf("Got coefficient length of: %d\n", rx_len);
-
-					 for (u32 k=0; k < 134; k++){
-						// zero the coeff array, if desired
-						coeff_arr[sd_block*7+i][k] = 0;
-					 }
-
-					// cast dct_rx_ptr into 8-bit, use rx_len*2 to copy the bytes
-					assemble_packets((u8*)(coeff_arr[sd_block*7+i]), (u8*)dct_rx_ptr, rx_len*2, 0);
-
-					xil_printf("Assembled packet %d, server type %c, msg type %d, length %d\n",
-							sd_block*7+i, coeff_arr[sd_block*7+i][0], coeff_arr[sd_block*7+i][1], rx_len*2);
-					total_len = total_len + rx_len*2;
-					// bw = bw + (int) rx_len*2 / (end - start);
-
-				}
-				break;
-			}
-		}else{
-		for(u32 i=0; i<7; i++){
-
-			// iterate over the number of image blocks in each SD card block
-
-			// double start = clock();
-			//dct_transmit((u8*)(sd_read_arr + (i*64)), 64); // just transmit directly from SD card read block
-			xil_printf("waiting for DCT...\n");
-			dct_init();
-			dct_transmit((u8*)(sd_read_arr + i*64), 64);
-			while (!dct_transmit_done()){};
-
-
-			// double end = clock();
-			rx_len = dct_receive((u16*)dct_rx_ptr); // returns the # of received coefficients, each coeff is 2 bytes
-			xil_printf("Got coefficient length of: %d\n", rx_len);
-
-			 for (u32 k; k < 134; k++){
-				// zero the coeff array, if desired
-				coeff_arr[sd_block*7+i][k] = 0;
-			 }
-
-			 //xil_printf("random data checking %d\n", dct_rx_ptr[0]);
-
-			// cast dct_rx_ptr into 8-bit, use rx_len*2 to copy the bytes
-			assemble_packets((u8*)(coeff_arr[sd_block*7+i]), (u8*)dct_rx_ptr, rx_len*2, 0);
+#if UART_DCT_STREAM
+	//Set up the UART, RecvHandler fills the ring from its interrupt
+	SetupUartLiteNoInterrupt(UARTLITE_DEVICE_ID);
+#endif
 
+	platform_enable_interrupts();
 
-			xil_printf("Assembled packet %d, server type %c, msg type %d, length %d\n",
-					sd_block*7+i, coeff_arr[sd_block*7+i][0], coeff_arr[sd_block*7+i][1], rx_len*2);
+	// card identified, SPI clock up to full speed
+	sd_card_init();
 
+    // /* DCT OPERATION GOES HERE*/
 
-			total_len = total_len + rx_len*2;
-			// bw = bw + (int) rx_len*2 / (end - start);
-			}
-		}
 
+#if UART_DCT_STREAM
+	// size the pipeline from the header, the first UART packet
+	uart_rx_start();
+	u8* hdr_sector = uart_rx_sector();
+	if (sd_parse_header(hdr_sector, &img_hdr) != XST_SUCCESS){
+		xil_printf("Invalid image header, stopping\n");
+		// the host stops sending rather than wait for the next '!'
+		uart_rx_abort();
+		return -1;
 	}
+#if UART_SD_ARCHIVE
+	sd_write_start((u32)SD_IMG_ADDR);
+	sd_write_append(SD_SECTOR_BYTES, hdr_sector);
+#endif
+	uart_rx_release();
+#else
+	// size the pipeline from the image header
+	if (sd_read_header(SD_IMG_ADDR, &img_hdr) == XST_SUCCESS){
+		sd_data_addr = SD_IMG_ADDR + 1;
+	}else{
+		xil_printf("No image header, assuming %dx%d\n", IMG_DEFAULT_WIDTH, IMG_DEFAULT_HEIGHT);
+		img_hdr.width = IMG_DEFAULT_WIDTH;
+		img_hdr.height = IMG_DEFAULT_HEIGHT;
+		img_hdr.block_num = (IMG_DEFAULT_WIDTH/8) * (IMG_DEFAULT_HEIGHT/8);
+		img_hdr.pixel_format = SD_PIX_FMT_GRAY8;
+		sd_data_addr = SD_IMG_ADDR;
+	}
+#endif
+	img_block_num = img_hdr.block_num;
+	xil_printf("Compressing %dx%d image, %d blocks\n", img_hdr.width, img_hdr.height, img_block_num);
 
+	// initialize the DCT AXIS FIFO, once for the whole image
+	dct_init();
 
-	u8 compressed_ratio[134] = {0};
-
-	int ratio = (int) IMG_BLOCK_NUM * 64 / total_len;
-	xil_printf("Compression ratio is %d\n", ratio);
-	// bw = (int) bw / IMG_BLOCK_NUM;
-
-	int shift = 1;
-	while ((ratio >> 8*shift) > 0){
-		compressed_ratio[shift-1] = (u8) (ratio >> 8*shift) && 0xff;
-		shift++;
-		if (shift >= 130){
-			xil_printf("compression ratio too big, number invalid\n!!");
-			break;
-		}
+#if DCT_QUANT_REGS
+	// the quantization table for this image, before any block goes in
+	if (dct_set_quality(DCT_QUALITY) == XST_SUCCESS){
+		dct_quality = DCT_QUALITY;
+	}else{
+		xil_printf("DCT didn't take the quantization table\n");
 	}
+#endif
 
-	assemble_packets(telem_ratio, compressed_ratio, shift, 2);
-	telem_num = 1;
+	// the client needs the geometry, and the table the DCT took, before the
+	// first coefficient packet
+	assemble_geometry();
 
-	xil_printf("Assembled packet %d, server type %c, msg type %d, length %d\n", telem_num, telem_ratio[0], telem_ratio[1], shift);
-	/*
-	u8 arr[130] = {0};
-	shift = 1;
-	while ((bw >> 8*shift) > 0){
-		arr[shift-1] = (u8) (bw >> 8*shift) && 0xff;
-		shift++;
-		if (shift >= 130){
-			xil_printf("compression ratio too big, number invalid\n!!");
-			break;
-		}
-	}
+#if DCT_ASYNC
+	dct_async_init();
+#endif
 
-	assemble_packets(telem_bw, arr, shift, 1);
-	telem_num ++;
+	// one multiple block read for the whole image, the controller keeps a few
+	// sectors ahead of the DCT, or with SD_DCT_STREAM feeds them to it
+#if SD_DCT_STREAM
+	dct_pad_blocks = (BLOCKS_PER_SECTOR - img_block_num % BLOCKS_PER_SECTOR) % BLOCKS_PER_SECTOR;
+	sd_stream_dct_start(sd_data_addr, (img_block_num + BLOCKS_PER_SECTOR - 1) / BLOCKS_PER_SECTOR,
+			DCT_PIPELINE_DEPTH);
+#elif !UART_DCT_STREAM
+	sd_stream_start(sd_data_addr, (img_block_num + BLOCKS_PER_SECTOR - 1) / BLOCKS_PER_SECTOR);
+#endif
 
-	xil_printf("Assembled packet %d, server type %c, msg type %d, length %d\n", telem_num, telem_bw[0], telem_bw[1], shift);
-	*/
+#if !STREAM_COMPRESSION && DCT_ASYNC
+	// get the first blocks into the DCT and let the interrupt collect them
+	// while lwIP comes up, the event loop hands it the rest
+	dct_compress_step(coeff_tx_limit());
+#elif !STREAM_COMPRESSION
+	// compress up front whatever fits in the arena, the event loop does the rest
+	while (dct_blocks_done < img_block_num && (dct_tx_block < coeff_tx_limit() || dct_blocks_done < dct_tx_block)){
+		dct_compress_step(coeff_tx_limit());
+	}
+	xil_printf("%d blocks compressed before connecting, %d arena words\n", dct_blocks_done, coeff_arena_head);
+	if (dct_blocks_done == img_block_num)
+		assemble_telemetry();
+#endif
 
 	/*
 	 * TCP TRANSFER BEGINS HERE
@@ -457,6 +570,17 @@ int main()
         //Process data queued after interrupt
         xemacif_input(app_netif);
 
+        // compress the next blocks while there is room in the arena
+        if (dct_blocks_done < img_block_num && (dct_tx_block < coeff_tx_limit() || dct_blocks_done < dct_tx_block)){
+        	dct_compress_step(coeff_tx_limit());
+        	if (dct_blocks_done == img_block_num)
+        		assemble_telemetry();
+        }
+
+        // send whatever was queued since the last sent callback
+        if (is_connected)
+        	tcp_tx_service(c_pcb);
+
         //ADD CODE HERE to be repeated constantly
         // Note - should be non-blocking
         // Note - can check is_connected global var to see if connection open
@@ -575,9 +699,6 @@ static void tcp_client_close(struct tcp_pcb *pcb)
 
 static err_t tcp_client_connected(void *arg, struct tcp_pcb *tpcb, err_t err)
 {
-
-	u8_t apiflags = TCP_WRITE_FLAG_COPY;
-
     if (err != ERR_OK) {
         tcp_client_close(tpcb);
         xil_printf("Connection error\n");
@@ -590,44 +711,18 @@ static err_t tcp_client_connected(void *arg, struct tcp_pcb *tpcb, err_t err)
     c_pcb = tpcb;
     is_connected = 1;
 
-    u8 packetinput[TCP_SEND_BUFSIZE] = {0};
-
-    if(telem_num > 0){
-		xil_printf("sending %d telemetry data\n", telem_num);
-
-		memcpy((u8*)packetinput, (u8*)telem_ratio, TCP_SEND_BUFSIZE);
-
-		telem_num = 0;
-
-	}
-
-	//Loop until enough room in buffer (should be right away)
-	while (tcp_sndbuf(c_pcb) < TCP_SEND_BUFSIZE);
-
-	//Enqueue some data to send
-	err = tcp_write(c_pcb, /*changed here*/packetinput, TCP_SEND_BUFSIZE, apiflags);
-
-	if (err != ERR_OK) {
-		xil_printf("TCP client: Error on tcp_write: %d\n", err);
-		return err;
-	}
-
-	err = tcp_output(c_pcb);
-	// no hankshaking for now, tcp_output should do what we expect
-	if (err != ERR_OK) {
-		xil_printf("TCP client: Error on tcp_output: %d\n",err);
-		return err;
-	}
-
-	//Print message
-	xil_printf("sent packet\n");
-
     //Set callback values & functions
     tcp_arg(c_pcb, NULL);
 	tcp_recv(c_pcb, tcp_client_recv);
 	tcp_sent(c_pcb, tcp_client_sent);
+	tcp_err(c_pcb, tcp_client_err);
+
+	// the first window goes out without a RDY. An error here is already
+	// printed, whatever didn't go out is sent from tcp_client_sent or the main
+	// loop, and returning it would have lwIP abort the connection
+	send_credit = TCP_WINDOW_PKTS;
+	tcp_tx_service(c_pcb);
 
-    tcp_err(c_pcb, tcp_client_err);
     return ERR_OK;
 }
 
@@ -637,86 +732,256 @@ static err_t tcp_client_recv(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, er
     if (!p) {
         xil_printf("No data received\n");
         tcp_client_close(tpcb);
+        c_pcb = NULL;
+        is_connected = 0;
         return ERR_OK;
     }
 
     //ADD CODE HERE to do on packet reception
 
+#if DCT_VERBOSE
     //Print message
     xil_printf("Packet received, %d bytes\n", p->tot_len);
+#endif
 
     //Print packet contents to terminal
-    char* packet_data = (char*) malloc(p->tot_len);
-    pbuf_copy_partial(p, packet_data, p->tot_len, 0); //Note - inefficient way to access packet data
+    char packet_data[3] = {0};
+    pbuf_copy_partial(p, packet_data, 3, 0);
 
     // RDY, 3 bytes
-    if(packet_data[0] == 82 && packet_data[1] == 68 && packet_data[2] == 89 && packet_sent >= 0){
+    if(packet_data[0] == 82 && packet_data[1] == 68 && packet_data[2] == 89){
 
+#if DCT_VERBOSE
     	xil_printf("received packet %c%c%c\n", packet_data[0], packet_data[1], packet_data[2]);
-    	u8_t apiflags = TCP_WRITE_FLAG_COPY;
+#endif
 
-		// CLIENT TODO HERE
+#if TCP_RDY_CREDIT
+    	// several RDYs can arrive in one segment now that a window is in flight
+    	send_credit = send_credit + p->tot_len/3;
+    	if(tx_queue_tail < img_block_num + 2){
+    		// the packet may not be compressed yet, the main loop sends it then
+    		err = tcp_tx_service(tpcb);
+    	}else{
+    		xil_printf("Very harmful\n");
+    	}
+#endif
+    }else{
+#if DCT_VERBOSE
+    	xil_printf("received packet %c%c%c\n", packet_data[0], packet_data[1], packet_data[2]);
+#endif
+    }
 
-		u8 packetinput[TCP_SEND_BUFSIZE] = {0};
+    //END OF ADDED CODE
 
-		// send telemetry data first
-		if(packet_sent < IMG_BLOCK_NUM){
-			xil_printf("packet sent is %d\n", packet_sent);
-			// send all coefficient data
+    //Indicate done processing
+    tcp_recved(tpcb, p->tot_len);
 
-			xil_printf("coefficient packet number to sent is %d\n", packet_sent);
+    //Free the received pbuf
+    pbuf_free(p);
 
-			memcpy((u8*)packetinput, (u8*)(coeff_arr[packet_sent]), TCP_SEND_BUFSIZE);
+    return 0;
+}
 
-			packet_sent++;
+static err_t tcp_client_sent(void *arg, struct tcp_pcb *tpcb, u16_t len)
+{
+	// acked data leaves the window, refill it
+	tcp_unacked = tcp_unacked - len;
+
+	// every packet is TCP_SEND_BUFSIZE on the wire, lwIP is done with a
+	// packet's arena space once all of it is acked
+	tcp_acked_bytes = tcp_acked_bytes + len;
+	while (tcp_acked_bytes >= TCP_SEND_BUFSIZE){
+		u16 entry = tx_queue[packet_acked % TX_QUEUE_LEN];
+
+		if (entry != TX_TELEMETRY && entry != TX_GEOMETRY){
+			coeff_arena_tail = coeff_end[entry];
+			coeff_blocks_acked++;
+		}
+		tcp_acked_bytes = tcp_acked_bytes - TCP_SEND_BUFSIZE;
+		packet_acked++;
 
+		if (entry == TX_TELEMETRY){
+			xil_printf("Image acked, %d coefficient bytes copied\n", tcp_bytes_copied);
+			xil_printf("TX queue max depth %d, stalled %d times for %d us\n",
+					tx_queue_max_depth, tx_stall_count, tx_stall_us);
+		}
+	}
 
-			//Loop until enough room in buffer (should be right away)
-			while (tcp_sndbuf(c_pcb) < TCP_SEND_BUFSIZE);
+    return tcp_tx_service(tpcb);
+}
 
-			//Enqueue some data to send
-			err = tcp_write(c_pcb, /*changed here*/packetinput, TCP_SEND_BUFSIZE, apiflags);
+/**
+ * Write queued packets to lwIP while the send window and lwIP have room,
+ * called from the main loop and tcp_client_sent. Never waits, a full window
+ * is counted as a stall and picked up again once data is acked
+ *
+ * @param tpcb (struct tcp_pcb*) connection to the mirror server, NULL once
+ *  it's closed
+ *
+ * @return
+ *  - ERR_OK if the packets were sent, there is nothing to send yet or the
+ *    connection is gone
+ */
+static err_t tcp_tx_service(struct tcp_pcb *tpcb)
+{
+	err_t err = ERR_OK;
+#if DCT_VERBOSE
+	u32 n_written = 0;
+#endif
+	u32 n_bytes = 0;
+	u32 part;
+	u16 entry;
+
+	// the connection was closed or aborted, the packets stay queued
+	if (tpcb == NULL)
+		return ERR_OK;
+
+	while (tx_queue_tail != tx_queue_head){
+		// a zero copy packet takes up to 3 pbufs of the send queue
+		if (tcp_unacked + TCP_SEND_BUFSIZE - tx_part_sent > TCP_WINDOW_PKTS*TCP_SEND_BUFSIZE ||
+				tcp_sndbuf(tpcb) < TCP_SEND_BUFSIZE - tx_part_sent || tcp_sndqueuelen(tpcb) + 3 > TCP_SND_QUEUELEN)
+			break;
+#if TCP_RDY_CREDIT
+		if (send_credit == 0)
+			break;
+#endif
 
-			if (err != ERR_OK) {
-				xil_printf("TCP client: Error on tcp_write: %d\n", err);
-				return err;
-			}
+		entry = tx_queue[tx_queue_tail % TX_QUEUE_LEN];
+		part = tx_part_sent;
+		if (entry == TX_TELEMETRY || entry == TX_GEOMETRY){
+#if DCT_VERBOSE
+			xil_printf("sending telemetry data\n");
+#endif
+			// telemetry packets are never rewritten, no need to copy them either
+			err = tcp_write(tpcb, entry == TX_TELEMETRY ? telem_ratio : telem_geometry,
+					TCP_SEND_BUFSIZE, TCP_ZERO_COPY ? 0 : TCP_WRITE_FLAG_COPY);
+			if (err == ERR_OK)
+				tx_part_sent = TCP_SEND_BUFSIZE;
+		}else{
+#if DCT_VERBOSE
+			xil_printf("coefficient packet number to sent is %d\n", tx_queue_tail);
+#endif
+			err = tcp_client_write_coeff(tpcb, entry);
+		}
 
-			err = tcp_output(c_pcb);
-			// no hankshaking for now, tcp_output should do what we expect
-			if (err != ERR_OK) {
-				xil_printf("TCP client: Error on tcp_output: %d\n",err);
-				return err;
-			}
+		// the bytes that went to lwIP, part of the packet if it ran out of memory
+		tcp_unacked = tcp_unacked + tx_part_sent - part;
+		n_bytes = n_bytes + tx_part_sent - part;
 
-			//Print message
-			xil_printf("sent packet\n");
+		if (err != ERR_OK) {
+			xil_printf("TCP client: Error on tcp_write: %d\n", err);
+			break;
+		}
 
-			//END OF ADDED CODE
-    	    }else{
-    	    	xil_printf("Very harmful\n");
-    	    }
-    	}else{
-    		xil_printf("received packet %c%c%c\n", packet_data[0], packet_data[1], packet_data[2]);
-    	}
+		tx_part_sent = 0;
+		tx_queue_tail++;
+#if TCP_RDY_CREDIT
+		send_credit--;
+#endif
+#if DCT_VERBOSE
+		n_written++;
+#endif
+	}
 
-    //END OF ADDED CODE
+	// packets left over means lwIP or the server is holding us back
+	if (tx_queue_tail != tx_queue_head && !tx_stalled){
+		tx_stalled = 1;
+		tx_stall_start = platform_time_us();
+		tx_stall_count++;
+	}else if (tx_queue_tail == tx_queue_head && tx_stalled){
+		tx_stalled = 0;
+		tx_stall_us = tx_stall_us + (platform_time_us() - tx_stall_start);
+	}
 
-    //Indicate done processing
-    tcp_recved(tpcb, p->tot_len);
+	if (n_bytes == 0)
+		return err;
 
-    //Free the received pbuf
-    pbuf_free(p);
+	// one output for the whole window, lwIP packs the packets into segments
+	err = tcp_output(tpcb);
+	if (err != ERR_OK) {
+		xil_printf("TCP client: Error on tcp_output: %d\n",err);
+		return err;
+	}
 
-    return 0;
+#if DCT_VERBOSE
+	//Print message
+	xil_printf("sent %d packets\n", n_written);
+#endif
+
+	return ERR_OK;
 }
 
-static err_t tcp_client_sent(void *arg, struct tcp_pcb *tpcb, u16_t len)
-{
+/**
+ * Queue a packet for tcp_tx_service, in the order it goes on the wire
+ *
+ * @param entry (u16) index slot of a coefficient packet, TX_GEOMETRY or TX_TELEMETRY
+ *
+ * @return
+ *  - void
+ */
+void tx_enqueue(u16 entry){
+	// coeff_tx_limit() keeps at most COEFF_INDEX_LEN blocks unacked, so this never
+	// overwrites an entry tcp_client_sent still needs
+	tx_queue[tx_queue_head % TX_QUEUE_LEN] = entry;
+	tx_queue_head++;
+
+	if (tx_queue_head - tx_queue_tail > tx_queue_max_depth)
+		tx_queue_max_depth = tx_queue_head - tx_queue_tail;
+}
 
-	xil_printf("mostly harmless\n");
+/**
+ * Write one coefficient packet to lwIP, straight out of the arena with TCP_ZERO_COPY.
+ * The header, coefficients and padding are written separately, if lwIP runs out of
+ * memory part way the packet carries on from tx_part_sent on the next call, so the
+ * server never sees a header twice
+ *
+ * @param tpcb (struct tcp_pcb*) connection to the mirror server
+ * @param slot (u32) index slot of the block
+ *
+ * @return
+ *  - return value of the tcp_write that failed, or ERR_OK once the whole packet is in
+ */
+static err_t tcp_client_write_coeff(struct tcp_pcb *tpcb, u32 slot)
+{
+	err_t err = ERR_OK;
+	u8 *coeff = (u8*)(coeff_arena + coeff_off[slot]);
+	u32 len = coeff_len[slot]*2;
+
+	// 64 nonzero coefficients come back as 64 words, EOF and a padding EOF,
+	// only the first EOF fits in the packet
+	if (len > TCP_SEND_BUFSIZE-4)
+		len = TCP_SEND_BUFSIZE-4;
+
+#if TCP_ZERO_COPY
+	// header, coefficients and padding stay where they are until acked
+	u8 *part[3] = {coeff_hdr[slot], coeff, (u8*)pkt_pad};
+	u32 part_len[3] = {4, len, TCP_SEND_BUFSIZE-4-len};
+	u32 start = 0;
+	u32 off, n;
+
+	if (tx_part_sent == 0)
+		assemble_header(coeff_hdr[slot], len, 0);
+	for (u32 i=0; i<3 && err == ERR_OK; i++){
+		// skip what went in last time, and the padding of a full packet
+		if (tx_part_sent < start + part_len[i]){
+			off = tx_part_sent - start;
+			n = part_len[i] - off;
+			err = tcp_write(tpcb, part[i] + off, n, tx_part_sent + n < TCP_SEND_BUFSIZE ? TCP_WRITE_FLAG_MORE : 0);
+			if (err == ERR_OK)
+				tx_part_sent = tx_part_sent + n;
+		}
+		start = start + part_len[i];
+	}
+#else
+	memset(packetinput, 0, TCP_SEND_BUFSIZE);
+	assemble_packets(packetinput, coeff, len, 0);
+	err = tcp_write(tpcb, packetinput, TCP_SEND_BUFSIZE, TCP_WRITE_FLAG_COPY);
+	if (err == ERR_OK)
+		tx_part_sent = TCP_SEND_BUFSIZE;
+	tcp_bytes_copied = tcp_bytes_copied + len + TCP_SEND_BUFSIZE;
+#endif
 
-    return 0;
+	return err;
 }
 
 static void tcp_client_err(void *arg, err_t err)
@@ -724,6 +989,7 @@ static void tcp_client_err(void *arg, err_t err)
     LWIP_UNUSED_ARG(err);
     tcp_client_close(c_pcb);
     c_pcb = NULL;
+    is_connected = 0;
     xil_printf("TCP connection aborted\n");
 }
 
@@ -741,12 +1007,370 @@ static void tcp_client_err(void *arg, err_t err)
  */
 void assemble_packets(u8* packet_ptr, u8* coeff_ptr, u32 len, u8 type){
 
+	assemble_header(packet_ptr, len, type);
+
+	memcpy((u8*)(packet_ptr + 4), (u8*)coeff_ptr, len);
+}
+
+/**
+ * Write the 4 byte header of a TCP packet, the data follows it on the wire
+ *
+ * @param packet_ptr (u8*) pointer to the write address
+ * @param len (u32) length of the data in bytes
+ * @param type (u8) type of packet, user-defined
+ *
+ * @return
+ *  - void
+ */
+void assemble_header(u8* packet_ptr, u32 len, u8 type){
+
 	packet_ptr[0] = 82;
 	packet_ptr[1] = type;
 	packet_ptr[2] = (u8) ((len>>8) & 0xff);
 	packet_ptr[3] = (u8) (len & 0xff);
+}
 
-	memcpy((u8*)(packet_ptr + 4), (u8*)coeff_ptr, len);
+/**
+ * Index of the first image block that can't be handed to the DCT yet, every
+ * block before it is guaranteed a slot in the index and room in the arena
+ *
+ * @return
+ *  - block index, compared against dct_tx_block
+ */
+u32 coeff_tx_limit(void){
+	u32 free_words = COEFF_ARENA_WORDS - (coeff_arena_head - coeff_arena_tail);
+	u32 limit = coeff_blocks_acked + COEFF_INDEX_LEN;
+
+	// worst case for every block, and one more for the padding when the arena wraps
+	if (free_words < DCT_MAX_BLOCK_COEFF)
+		return dct_blocks_done;
+	if (limit > dct_blocks_done + free_words/DCT_MAX_BLOCK_COEFF - 1)
+		limit = dct_blocks_done + free_words/DCT_MAX_BLOCK_COEFF - 1;
+
+	return limit;
 }
 
+/**
+ * Store the coefficients of one compressed block, callback for dct_submit()
+ *
+ * @param ref (void*) index of the image block
+ * @param coeff (u16*) run-length coefficients of the block
+ * @param rx_len (u32) number of coefficients, each coeff is 2 bytes
+ *
+ * @return
+ *  - void
+ */
+void dct_block_done(void *ref, u16 *coeff, u32 rx_len){
+	u32 img_block = (u32)ref;
+	u32 slot = img_block % COEFF_INDEX_LEN;
+	u32 pos = coeff_arena_head % COEFF_ARENA_WORDS;
+
+	if (pos + rx_len > COEFF_ARENA_WORDS){
+		// doesn't fit before the end, skip to the start of the arena
+		coeff_arena_head = coeff_arena_head + COEFF_ARENA_WORDS - pos;
+		pos = 0;
+	}
+
+	// coeff_tx_limit() reserved the space before the block went to the DCT
+	memcpy((u16*)(coeff_arena + pos), coeff, rx_len*2);
+	tcp_bytes_copied = tcp_bytes_copied + rx_len*2;
+	coeff_arena_head = coeff_arena_head + rx_len;
+
+	coeff_off[slot] = (u16)pos;
+	coeff_len[slot] = (u16)rx_len;
+	coeff_end[slot] = coeff_arena_head;
+	tx_enqueue((u16)slot);
+
+#if DCT_VERBOSE
+	xil_printf("Stored block %d, arena word %d, length %d\n", img_block, pos, rx_len*2);
+#endif
+
+	dct_bytes_done = dct_bytes_done + rx_len*2;
+	dct_blocks_done++;
+}
+
+/**
+ * Assemble the compression ratio telemetry packet, once the whole image is compressed
+ *
+ * @return
+ *  - void
+ */
+void assemble_telemetry(void){
+	u8 compressed_ratio[134] = {0};
+
+	int ratio = (int) img_block_num * 64 / dct_bytes_done;
+	xil_printf("Compression ratio is %d\n", ratio);
+	// bw = (int) bw / img_block_num;
+
+	int shift = 1;
+	while ((ratio >> 8*shift) > 0){
+		compressed_ratio[shift-1] = (u8) (ratio >> 8*shift) && 0xff;
+		shift++;
+		if (shift >= 130){
+			xil_printf("compression ratio too big, number invalid\n!!");
+			break;
+		}
+	}
 
+	assemble_packets(telem_ratio, compressed_ratio, shift, 2);
+	telem_num = 1;
+	tx_enqueue(TX_TELEMETRY);
+
+	xil_printf("Assembled packet %d, server type %c, msg type %d, length %d\n", telem_num, telem_ratio[0], telem_ratio[1], shift);
+	/*
+	u8 arr[130] = {0};
+	shift = 1;
+	while ((bw >> 8*shift) > 0){
+		arr[shift-1] = (u8) (bw >> 8*shift) && 0xff;
+		shift++;
+		if (shift >= 130){
+			xil_printf("compression ratio too big, number invalid\n!!");
+			break;
+		}
+	}
+
+	assemble_packets(telem_bw, arr, shift, 1);
+	telem_num ++;
+
+	xil_printf("Assembled packet %d, server type %c, msg type %d, length %d\n", telem_num, telem_bw[0], telem_bw[1], shift);
+	*/
+}
+
+/**
+ * Assemble the image geometry packet, width and height as big endian u16s
+ * followed by the DCT quality if a table was loaded
+ *
+ * @return
+ *  - void
+ */
+void assemble_geometry(void){
+	u8 geometry[5] = {0};
+
+	geometry[0] = (u8) ((img_hdr.width>>8) & 0xff);
+	geometry[1] = (u8) (img_hdr.width & 0xff);
+	geometry[2] = (u8) ((img_hdr.height>>8) & 0xff);
+	geometry[3] = (u8) (img_hdr.height & 0xff);
+	geometry[4] = dct_quality;
+
+	assemble_packets(telem_geometry, geometry, dct_quality ? 5 : 4, 3);
+	tx_enqueue(TX_GEOMETRY);
+}
+
+/**
+ * Get an image block out of the SD card, taking its sector from the read-ahead
+ * stream if it isn't loaded. With UART_DCT_STREAM the block is used in place in
+ * the UART ring, waiting for the host if it isn't all in yet
+ *
+ * @param img_block (u32) index of the image block
+ *
+ * @return
+ *  - pointer to the 64 pixels of the block in sd_read_arr or the UART ring
+ */
+u8* dct_source_block(u32 img_block){
+	u32 sd_block = img_block / BLOCKS_PER_SECTOR;
+	u32 sd_offset = img_block % BLOCKS_PER_SECTOR;
+
+#if UART_DCT_STREAM
+	u32 len = 0;
+	u8* sector;
+
+	if (sd_block != uart_src_sector){
+		// blocks are compressed in order, every block of the sector at the
+		// tail is in the FIFO and the next sector comes after it
+		dct_source_release();
+		uart_src_sector = sd_block;
+	}
+	do {
+		sector = uart_rx_peek(0, &len);
+	} while (len < (sd_offset+1)*64);
+
+	return sector + sd_offset*64;
+#else
+	if (sd_block != sd_read_block){
+		// every block of the previous sector has been copied into the FIFO,
+		// blocks are compressed in order so the stream has the next one
+		if (sd_block != sd_read_block + 1 || sd_stream_next(SD_SECTOR_BYTES, sd_read_arr) != XST_SUCCESS){
+			xil_printf("\nReading Data from SD card, block %d\n\n", sd_block);
+			sd_stream_end();
+			sd_read((u32)(sd_data_addr + sd_block), SD_SECTOR_BYTES, sd_read_arr);
+		}
+		sd_read_block = sd_block;
+	}
+
+	return (u8*)(sd_read_arr + sd_offset*64);
+#endif
+}
+
+/**
+ * Check if an image block can be had without waiting for the SD card, or for
+ * the host with UART_DCT_STREAM
+ *
+ * @param img_block (u32) index of the image block
+ *
+ * @return
+ *  - number of blocks from img_block to the end of its sector that are ready,
+ *    all of them once its sector is loaded or already read ahead by the controller
+ */
+u32 dct_source_ready(u32 img_block){
+	u32 sd_block = img_block / BLOCKS_PER_SECTOR;
+	u32 sd_offset = img_block % BLOCKS_PER_SECTOR;
+
+#if UART_DCT_STREAM
+	u32 len = 0;
+
+	// the sector after the tail one is the next in the ring
+	uart_rx_peek(sd_block == uart_src_sector ? 0 : 1, &len);
+	if (len < (sd_offset+1)*64)
+		return 0;
+	return len/64 - sd_offset;
+#else
+	if (sd_block == sd_read_block || (sd_block == sd_read_block + 1 && sd_stream_ready()))
+		return BLOCKS_PER_SECTOR - sd_offset;
+	return 0;
+#endif
+}
+
+/**
+ * Hand the sector at the tail of the UART ring back once all of its blocks
+ * are in the DCT, writing it to the card first with UART_SD_ARCHIVE
+ *
+ * @return
+ *  - void
+ */
+void dct_source_release(void){
+#if UART_DCT_STREAM
+#if UART_SD_ARCHIVE
+	u32 len = 0;
+
+	// copied into the SD write RAM, waits only if the card is 4 sectors behind
+	sd_write_append(SD_SECTOR_BYTES, uart_rx_peek(0, &len));
+#endif
+	uart_rx_release();
+#endif
+}
+
+/**
+ * Compress the next few image blocks, stored through dct_block_done
+ *
+ * @param tx_limit (u32) don't hand image blocks at or past this index to the DCT
+ *
+ * @return
+ *  - number of blocks stored
+ */
+u32 dct_compress_step(u32 tx_limit){
+	u32 blocks_done = dct_blocks_done;
+
+	if (tx_limit > img_block_num)
+		tx_limit = img_block_num;
+
+#if SD_DCT_STREAM
+	// the pixels are already on their way, just line up the callbacks
+	while (dct_tx_block < tx_limit){
+		if (dct_expect(dct_block_done, (void*)dct_tx_block) != XST_SUCCESS)
+			break;
+		dct_tx_block++;
+	}
+	// the zero padding of the last sector comes out after the image
+	while (dct_tx_block == img_block_num && dct_pad_blocks > 0){
+		if (dct_expect(NULL, NULL) != XST_SUCCESS)
+			break;
+		dct_pad_blocks--;
+	}
+
+	dct_process_completions();
+	// no more blocks in the DCT than the RX FIFO holds the coefficients of,
+	// the controller would otherwise send a sector's 7 back to back
+	sd_stream_dct_credit(dct_completed() + DCT_PIPELINE_DEPTH);
+	if (dct_blocks_done == img_block_num){
+		// the padding has to come out of the DCT too before the stream ends
+		while (dct_pad_blocks > 0 || dct_pending() > 0){
+			if (dct_pad_blocks > 0 && dct_expect(NULL, NULL) == XST_SUCCESS)
+				dct_pad_blocks--;
+			dct_process_completions();
+			sd_stream_dct_credit(dct_completed() + DCT_PIPELINE_DEPTH);
+		}
+		sd_stream_dct_end();
+	}
+#elif DCT_ASYNC
+	while (dct_tx_block < tx_limit){
+		// don't wait on the card while there are coefficients to store
+		if (!dct_source_ready(dct_tx_block) && dct_pending() > 0)
+			break;
+#if UART_DCT_STREAM
+		// or on the host at all, the event loop keeps TCP going meanwhile
+		if (!dct_source_ready(dct_tx_block))
+			break;
+#endif
+		// stop when the queue is full, the callbacks below make room
+		if (dct_submit(dct_source_block(dct_tx_block), dct_block_done, (void*)dct_tx_block) != XST_SUCCESS)
+			break;
+		dct_tx_block++;
+	}
+
+	// CPU is free between calls, the FIFO interrupt does the receiving
+	dct_process_completions();
+#else
+	u32 n_tx = 0;
+	u32 n_rx = 0;
+	u32 n_ready = 0;
+
+	// keep the DCT fed so that the next batch sits in the TX FIFO while
+	// we drain the coefficients of this one
+	while (dct_tx_block < tx_limit && dct_tx_block + DCT_BATCH_BLOCKS <= dct_blocks_done + DCT_PIPELINE_DEPTH){
+		// batches never straddle a sector, the next one isn't read yet
+		// drain the DCT while the card reads the next sector in
+		n_ready = dct_source_ready(dct_tx_block);
+		if (n_ready == 0 && dct_blocks_done < dct_tx_block)
+			break;
+#if UART_DCT_STREAM
+		// or on the host at all, the event loop keeps TCP going meanwhile
+		if (n_ready == 0)
+			break;
+#endif
+
+		n_tx = BLOCKS_PER_SECTOR - dct_tx_block % BLOCKS_PER_SECTOR;
+		// only the blocks of a UART sector that are in so far
+		if (n_ready > 0 && n_tx > n_ready)
+			n_tx = n_ready;
+		if (n_tx > DCT_BATCH_BLOCKS)
+			n_tx = DCT_BATCH_BLOCKS;
+		if (n_tx > tx_limit - dct_tx_block)
+			n_tx = tx_limit - dct_tx_block;
+
+		dct_transmit_blocks(dct_source_block(dct_tx_block), n_tx);
+		dct_tx_block = dct_tx_block + n_tx;
+	}
+
+	n_rx = dct_tx_block - dct_blocks_done;
+	if (n_rx > DCT_BATCH_BLOCKS)
+		n_rx = DCT_BATCH_BLOCKS;
+	if (n_rx == 0)
+		return 0;
+
+#if DCT_VERBOSE
+	xil_printf("waiting for DCT...\n");
+#endif
+	// splits the coefficient stream back into blocks, each coeff is 2 bytes
+	dct_receive_blocks((u16*)dct_rx_ptr, n_rx, dct_rx_len);
+
+	for (u32 i=0; i<n_rx; i++){
+#if DCT_VERBOSE
+		xil_printf("Got coefficient length of: %d\n", dct_rx_len[i]);
+#endif
+		dct_block_done((void*)(dct_blocks_done), dct_rx_ptr[i], dct_rx_len[i]);
+	}
+#endif
+
+#if UART_DCT_STREAM
+	// the last sector is done with once its blocks are in the DCT
+	if (dct_tx_block == img_block_num && !uart_src_done){
+		dct_source_release();
+		uart_src_done = 1;
+#if UART_SD_ARCHIVE
+		sd_write_end();
+#endif
+	}
+#endif
+
+	return dct_blocks_done - blocks_done;
+}
@@ -42,6 +42,8 @@
 
 #include "lwip/tcp.h"
 #include "uart.h"
+#include "dct_fifo.h"
+#include "sd_card.h"
 
 //UART parameters
 #define UARTLITE_DEVICE_ID XPAR_UARTLITE_0_DEVICE_ID
@@ -118,6 +120,20 @@ void platform_setup_interrupts()
 				(XInterruptHandler)XUartLite_InterruptHandler,
 				(void *)&UartLite);
 
+#ifdef XPAR_INTC_0_LLFIFO_0_VEC_ID
+	// for DCT AXIS FIFO interrupts
+	XIntc_Connect(intcp, DCT_FIFO_INT_IRQ_ID,
+				(XInterruptHandler)dct_fifo_intr_handler,
+				(void *)&dct_fifo);
+#endif
+
+#ifdef SD_INT_IRQ_ID
+	// for SD card command interrupts
+	XIntc_Connect(intcp, SD_INT_IRQ_ID,
+				(XInterruptHandler)sd_card_irq_handler,
+				NULL);
+#endif
+
 	/* Start the interrupt controller */
 	XIntc_MasterEnable(XPAR_INTC_0_BASEADDR);
 
@@ -165,6 +181,16 @@ void platform_setup_interrupts()
 
 	//UART interrupt enable
 	XIntc_Enable(intcp, XPAR_INTC_0_UARTLITE_0_VEC_ID);
+
+#ifdef XPAR_INTC_0_LLFIFO_0_VEC_ID
+	//DCT FIFO interrupt enable
+	XIntc_Enable(intcp, DCT_FIFO_INT_IRQ_ID);
+#endif
+
+#ifdef SD_INT_IRQ_ID
+	//SD card interrupt enable
+	XIntc_Enable(intcp, SD_INT_IRQ_ID);
+#endif
 }
 
 void
@@ -29,6 +29,8 @@
 #ifndef __PLATFORM_H_
 #define __PLATFORM_H_
 
+#include "xil_types.h"
+
 /* Platform timer is calibrated for 250 ms, so kept interval value 4 to call
  * eth_link_detect() at every one second
  */
@@ -45,5 +47,6 @@ void timer_callback();
 void platform_setup_timer();
 void platform_enable_interrupts();
 void platform_disable_interrupts();
+u32 platform_time_us();
 #endif
 
@@ -42,10 +42,13 @@
 #include "xintc.h"
 #include "xtmrctr_l.h"
 
+static volatile u32 timer_periods = 0; /* timer periods since platform_setup_timer */
+
 void
 xadapter_timer_handler(void *p)
 {
 	timer_callback();
+	timer_periods++;
 
 	/* Load timer, clear interrupt bit */
 	XTmrCtr_SetControlStatusReg(PLATFORM_TIMER_BASEADDR, 0,
@@ -86,6 +89,24 @@ platform_setup_timer()
 			0);
 }
 
+/* microseconds since the timer started, from the lwIP timer so no extra
+ * timer is needed. Wraps around after about 71 minutes
+ */
+u32
+platform_time_us()
+{
+	u32 periods, count;
+
+	/* the period count can change between the two reads */
+	do {
+		periods = timer_periods;
+		count = XTmrCtr_GetTimerCounterReg(PLATFORM_TIMER_BASEADDR, 0);
+	} while (periods != timer_periods);
+
+	/* the timer counts down from TIMER_TLR */
+	return periods*(u32)(TIMER_TLR/MHZ) + ((u32)TIMER_TLR - count)/MHZ;
+}
+
 void platform_enable_interrupts()
 {
 #ifdef MICROBLAZE_EXCEPTIONS_ENABLED
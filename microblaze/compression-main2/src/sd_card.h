@@ -12,27 +12,85 @@
 #include "xparameters.h"
 #include "xil_printf.h"
 #include "xil_io.h"
+#include "xstatus.h"
 #include "sleep.h"
 
 #define SPI_SD_ADDR		0x44A00000
 #define SD_CMD_REG		0
-#define SD_STATUS_REG	4
+#define SD_STATUS_REG	4 //SD_STAT_* flags
 #define SD_ADDR_REG		8 //SD card write/read address
-#define SD_DEBUG_REG	12 //SD card state
+#define SD_DEBUG_REG	12 //SD card state [4:0], SPI clock divider [15:8]
 #define SD_WRITE_REG	16 //Data to write to SD card
 #define SD_RD_DATA_REG	20 //Data read from SD card
 #define SD_RAM_CMD_REG	24 //Temp RAM storage commands
 #define SD_WADDR_REG	28 //Write RAM Address
 #define SD_RADDR_REG	32 //Read RAM Address
+#define SD_BURST_RD_REG	36 //Read RAM, 4 bytes per read from SD_RADDR_REG on
+#define SD_BURST_WR_REG	40 //Write RAM, 4 bytes per write from SD_WADDR_REG on
+#define SD_RD_ACK_REG	44 //Sectors of a multi read the firmware is done with,
+							//or sent out of the stream port with CMD_STREAM.
+							//Written with CMD_STREAM, 8x8 blocks it may send
+#define SD_BLOCK_CNT_REG	48 //Sectors to read with CMD_READ_MULTI
+#define SD_RD_CNT_REG	52 //Sectors read so far
+#define SD_WR_CNT_REG	56 //Sectors of a multi write put in the write RAM
+#define SD_WR_DONE_REG	60 //Sectors written so far
 
 // CMD register macros
 #define CMD_RESET		0b1
 #define CMD_WRITE		0b10
 #define CMD_READ		0b100
+#define CMD_READ_MULTI	0b1000
+#define CMD_WRITE_MULTI	0b10000
+#define CMD_STREAM		0b100000 //multi read sectors go out of the stream port
+#define CMD_IRQ_EN		0x100 //sd_irq while SD_STAT_DONE
+// Status register flags
+#define SD_STAT_BUSY	0b1000 //a command is running
+#define SD_STAT_DONE	0b10000 //the last command finished
+#define SD_STAT_ERROR	0b100000 //the card rejected the last command
+// sd_irq on the interrupt controller. When it's there sd_card_irq_handler
+// finishes the commands and sd_card_poll does nothing
+#ifdef XPAR_INTC_0_SD_CONTROL_RAM_0_VEC_ID
+#define SD_INT_IRQ_ID	XPAR_INTC_0_SD_CONTROL_RAM_0_VEC_ID
+#endif
+// Debug register fields
+#define SD_STATE_MASK	0x1F
+#define SD_CLK_DIV_SHIFT	8
+// SPI clock dividers, the clock is sd_clock/(2*(divider+1)) from the 50MHz
+// sd_clock. The IP resets to SD_CLK_DIV_INIT and goes back to it with
+// CMD_RESET, the card must be identified at 400kHz or less
+#define SD_CLK_DIV_INIT	62 //397kHz
+#define SD_CLK_DIV_FAST	0 //25MHz
 // RAM CMD register macros
 #define CMD_RAM_WRITE	0b10
 #define CMD_RAM_READ	0b100
 
+// The read RAM holds SD_RD_SECTORS sectors, sector n of a multi read is at
+// RAM address (n % SD_RD_SECTORS)*SD_SECTOR_LEN. Its data starts one byte in
+#define SD_SECTOR_LEN	512
+#define SD_RD_SECTORS	4
+// Likewise the write RAM holds SD_WR_SECTORS sectors for a multi write,
+// starting at RAM address 0
+#define SD_WR_SECTORS	4
+
+// Image header, the first sector of an image on the card. The pixels follow
+// from the next sector, SD_BLOCKS_PER_SECTOR 8x8 blocks per sector.
+// Fields are little endian u32s
+#define SD_IMG_MAGIC		0x31474D49 //"IMG1"
+#define SD_IMG_HDR_LEN		20
+#define SD_PIX_FMT_GRAY8	0 //one 8-bit grayscale pixel per byte
+#define SD_BLOCKS_PER_SECTOR	7
+
+typedef struct {
+	u32 width; //pixels
+	u32 height; //pixels
+	u32 block_num; //8x8 blocks, row by row, partial blocks zero padded
+	u32 pixel_format;
+} sd_img_header;
+
+// Called when a command started by sd_read_async/sd_write_async is done,
+// status is XST_SUCCESS or XST_FAILURE
+typedef void (*sd_callback)(void* ref, int status);
+
 //Writes to AXI register
 #define XSPI_AXI_WRITE(address, data) \
 	Xil_Out32((SPI_SD_ADDR) + (address), (data))
@@ -42,6 +100,26 @@
 
 void sd_write(u32 addr, int len, u8* data_arr);
 void sd_read(u32 addr, int len, u8* ret_data_arr);
+int sd_write_async(u32 addr, int len, u8* data_arr, sd_callback callback, void* ref);
+int sd_read_async(u32 addr, int len, u8* ret_data_arr, sd_callback callback, void* ref);
+int sd_busy();
+void sd_card_irq_handler(void* ref);
+void sd_card_poll();
+int sd_read_multi(u32 addr, u32 count, u8* ret_data_arr);
+void sd_stream_start(u32 addr, u32 count);
+int sd_stream_ready();
+int sd_stream_next(int len, u8* ret_data_arr);
+void sd_stream_end();
+void sd_stream_dct_start(u32 addr, u32 count, u32 blocks);
+void sd_stream_dct_credit(u32 blocks);
+u32 sd_stream_dct_sent();
+int sd_stream_dct_end();
+void sd_write_start(u32 addr);
+int sd_write_append(int len, u8* data_arr);
+void sd_write_end();
 void sd_card_test();
+void sd_card_init();
 void sd_card_reset();
+int sd_parse_header(u8* data_arr, sd_img_header* hdr);
+int sd_read_header(u32 addr, sd_img_header* hdr);
 #endif /* SRC_SD_CARD_H_ */
@@ -1,9 +1,26 @@
 #include "uart.h"
+#include "uart_frame.h"
 #include "sd_card.h"
 
-/* Here are the pointers to the buffer */
-u8* ReceiveBufferPtr = &ReceiveBuffer[0];
-u8* SendBufferPtr = &SendBuffer[0];
+/* Sector ring, RxHead and RxTail count sectors and only ever go up */
+static u8 RxRing[UART_RING_SECTORS][UART_BUFFER_SIZE] __attribute__((aligned(4)));
+static volatile u32 RxHead = 0; /* sectors received, RecvHandler only */
+static volatile u32 RxTail = 0; /* sectors given back, main loop only */
+static volatile u8 RxStalled = 0; /* ring was full, no sector posted */
+static volatile u8 RxPosted = 0; /* the head sector is posted to the driver */
+static volatile u8 RxAborted = 0; /* uart_rx_abort, anything still coming is dropped */
+
+#if UART_FRAMED
+static uart_frame_rx_t RxFrame; /* frame being received, RecvHandler only */
+static u8 RxNaked = 0; /* the frame at the head has been asked for again */
+static u8 AckMsg[2]; /* sent from uart_rx_release */
+static u8 RxMsg[2]; /* sent from RecvHandler */
+
+static void uart_frame_rx(u8 byte);
+static void uart_frame_send(u8* msg, u8 type, u8 seq);
+#else
+static void uart_rx_post(u8 ack);
+#endif
 
 /****************************************************************************/
 /**
@@ -202,53 +219,204 @@ void SendHandler(void *CallBackRef, unsigned int EventData)
 
 void RecvHandler(void *CallBackRef, unsigned int EventData)
 {
-	XUartLite_Recv(&UartLite, ReceiveBufferPtr, 2);
-	ReceiveBufferPtr += 2;
-	TotalReceivedCount += 2;
+#if UART_FRAMED
+	// nothing is posted to the driver, frames are read here as they come
+	while (!XUartLite_IsReceiveEmpty(UartLite.RegBaseAddress)){
+		u8 byte = XUartLite_RecvByte(UartLite.RegBaseAddress);
+		if (!RxAborted){
+			uart_frame_rx(byte);
+		}
+	}
+#else
+	// The driver calls this once the posted sector is full, and again with
+	// a stale count for bytes that arrive while nothing is posted. Those
+	// stay in the RX FIFO, the host only sends after a '!'
+	if (!RxPosted){
+		return;
+	}
+	RxPosted = 0;
+	TotalReceivedCount += EventData;
+	RxHead++;
+
+	if (RxHead - RxTail < UART_RING_SECTORS){
+		uart_rx_post(1);
+	}
+	else {
+		RxStalled = 1;
+	}
+#endif
+}
+
+#if UART_FRAMED
+// One byte of a frame, the payload goes straight into the sector at the ring
+// head while there's one free. A frame is taken if it's the next one and
+// whole, anything else gets the host to send again from the head
+static void uart_frame_rx(u8 byte)
+{
+	u8* sector = NULL;
+	int seq;
+
+	if (RxHead - RxTail < UART_RING_SECTORS){
+		sector = RxRing[RxHead & (UART_RING_SECTORS - 1)];
+	}
+
+	switch (uart_frame_rx_byte(&RxFrame, byte, sector, UART_BUFFER_SIZE)){
+	case UART_FRAME_OK:
+		seq = uart_frame_check_seq(RxFrame.seq, RxHead);
+		if (seq == UART_FRAME_NEXT && RxFrame.dst != NULL && RxFrame.len == UART_BUFFER_SIZE){
+			TotalReceivedCount += RxFrame.len;
+			RxHead++;
+			RxNaked = 0;
+		}
+		else if (seq == UART_FRAME_DUP){
+			// the host timed out waiting, repeat the last ack
+			uart_frame_send(RxMsg, UART_FRAME_ACK, (u8)RxTail);
+		}
+		else if (!RxNaked){
+			RxNaked = 1;
+			uart_frame_send(RxMsg, UART_FRAME_NAK, (u8)RxHead);
+		}
+		break;
+	case UART_FRAME_BAD:
+		// once per missing frame, the frames after it are dropped until
+		// the host goes back to it
+		if (!RxNaked){
+			RxNaked = 1;
+			uart_frame_send(RxMsg, UART_FRAME_NAK, (u8)RxHead);
+		}
+		break;
+	}
+}
+
+// Send an ack or a nak, the driver disables the UART interrupt while it
+// loads the TX FIFO so RecvHandler can't cut into uart_rx_release's
+static void uart_frame_send(u8* msg, u8 type, u8 seq)
+{
+	msg[0] = type;
+	msg[1] = seq;
+	XUartLite_Send(&UartLite, msg, 2);
 }
 
-void uart_sd(u32 sd_addr){
+#else
+// Post the sector at the ring head to the driver, which fills it from the RX
+// FIFO on each interrupt, and ask the host for it with a '!'
+static void uart_rx_post(u8 ack)
+{
+	RxPosted = 1;
+	XUartLite_Recv(&UartLite, RxRing[RxHead & (UART_RING_SECTORS - 1)], UART_BUFFER_SIZE);
 
-    while (1){
-    	//If we've reached the end of the buffer, write to memory
+	if (ack){
+		SendBuffer[0] = 33; // ASCII !
+		XUartLite_Send(&UartLite, &SendBuffer[0], 1);
+	}
+}
+#endif
 
-		if (ReceiveBufferPtr >= (&ReceiveBuffer[0] + UART_BUFFER_SIZE)){
+// Empty the ring and post its first sector. The host sends the header
+// without waiting for a '!', so this has to run before it starts. With
+// UART_FRAMED the host starts on its own, RecvHandler takes the frames
+void uart_rx_start()
+{
+	RxHead = 0;
+	RxTail = 0;
+	RxStalled = 0;
+	RxAborted = 0;
+	TotalReceivedCount = 0;
+#if UART_FRAMED
+	uart_frame_rx_init(&RxFrame);
+	RxNaked = 0;
+#else
+	uart_rx_post(0);
+#endif
+}
 
-			// copy the buffer over
-			for(int i=0; i<UART_BUFFER_SIZE; i++){
-				BufferCopy[i] = ReceiveBuffer[i];
-				// xil_printf("%d\n", BufferCopy[i]);
-			}
+// Wait for the oldest received sector and return it in place. It stays valid
+// until uart_rx_release, the sectors after it keep coming in meanwhile
+u8* uart_rx_sector()
+{
+	u32 len = 0;
+	u8* sector;
 
-			// xil_printf("Resetting Receive Buffer\n");
-			resetBuffer();
+	do {
+		sector = uart_rx_peek(0, &len);
+	} while (len < UART_BUFFER_SIZE);
 
-			ReceiveBufferPtr = &ReceiveBuffer[0];
-			TotalReceivedCount = 0;
+	return sector;
+}
 
-			xil_printf("done one UART buffer cycle\n");
+// Look at the n-th sector after the oldest one not released, n below
+// UART_RING_SECTORS, without waiting. len is set to the number of its bytes
+// already in, the start of the sector being filled can be used while the
+// rest is still coming. A frame only counts once its CRC has been checked
+u8* uart_rx_peek(u32 n, u32* len)
+{
+	u32 head = RxHead;
+	u32 sector = RxTail + n;
 
-		break;
+	if ((s32)(sector - head) < 0){
+		*len = UART_BUFFER_SIZE;
+	}
+	else if (sector != head || RxStalled){
+		*len = 0;
+	}
+	else {
+#if UART_FRAMED
+		*len = 0;
+#else
+		// the sector posted to the driver, unless RecvHandler finished it
+		// and posted the next one since the head was read
+		*len = UartLite.ReceiveBuffer.RequestedBytes - UartLite.ReceiveBuffer.RemainingBytes;
+#endif
+		if (RxHead != head){
+			*len = UART_BUFFER_SIZE;
 		}
-    }
+	}
 
-    // SD card write
-	sd_write(sd_addr, UART_BUFFER_SIZE, &BufferCopy[0]);
-	xil_printf("done writing to SD card\n");
+	return RxRing[sector & (UART_RING_SECTORS - 1)];
+}
 
-	// SD card read, just checking
-	// can also expand this to a true or false check to see if we get what we wrote
+// Give the sector from uart_rx_sector back to the ring. RecvHandler can't
+// run in the middle of this on the one core, so it either saw the new tail
+// or stalled before it and the sector is posted here. With UART_FRAMED the
+// host hears about it in a cumulative ack, every UART_ACK_EVERY sectors or
+// once the ring is empty
+void uart_rx_release()
+{
+	RxTail++;
 
-	// int* read_arr[UART_BUFFER_SIZE];
-	// sd_read(sd_addr, UART_BUFFER_SIZE, read_arr);
+#if UART_FRAMED
+	if (RxTail % UART_ACK_EVERY == 0 || RxTail == RxHead){
+		uart_frame_send(AckMsg, UART_FRAME_ACK, (u8)RxTail);
+	}
+#else
+	if (RxStalled){
+		RxStalled = 0;
+		uart_rx_post(1);
+	}
+#endif
 }
 
-void resetBuffer()
+// Give up on the image, after a bad header. The host is told with a
+// UART_RX_ABORT in place of the next '!', or a UART_FRAME_ERR reply with
+// UART_FRAMED, and stops sending. A sector the driver is still filling is
+// left to it, RecvHandler ignores it once it's in
+void uart_rx_abort()
 {
-    for(int i=0;i<UART_BUFFER_SIZE;i++){
-    	ReceiveBuffer[i]=0;
-    }
+	RxAborted = 1;
+#if UART_FRAMED
+	uart_frame_send(AckMsg, UART_FRAME_ERR, (u8)RxTail);
+#else
+	RxPosted = 0;
+	RxStalled = 0;
+	SendBuffer[0] = UART_RX_ABORT;
+	XUartLite_Send(&UartLite, &SendBuffer[0], 1);
+#endif
+}
 
-    SendBuffer[0] = 0;
-    TotalSentCount = 0;
+// Append a sector from uart_rx_sector to the SD card write started by
+// sd_write_start. The driver copies it into the SD write RAM, the ring
+// sector can be released once this returns
+void uart_sd(u8* sector)
+{
+	sd_write_append(UART_BUFFER_SIZE, sector);
 }
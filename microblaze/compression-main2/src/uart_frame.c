@@ -0,0 +1,178 @@
+/* Framing of the UART ingestion protocol, see uart_frame.h.
+ *
+ * The receive side is a byte at a time state machine that RecvHandler feeds
+ * straight from the RX FIFO, the payload goes where the caller says so a
+ * frame lands in its ring sector without a copy.
+ */
+
+#include <stddef.h>
+
+#include "uart_frame.h"
+
+// receive states
+#define RX_SYNC0    0
+#define RX_SYNC1    1
+#define RX_SEQ      2
+#define RX_LEN0     3
+#define RX_LEN1     4
+#define RX_PAYLOAD  5
+#define RX_CRC0     6
+#define RX_CRC1     7
+
+/**
+ * Update a CRC-16/CCITT-FALSE (polynomial 0x1021, starts at 0xFFFF)
+ *
+ * @param crc (u16) CRC so far, 0xFFFF for a new one
+ * @param data (const u8*) bytes to add
+ * @param len (u32) number of bytes
+ *
+ * @return
+ *  - the updated CRC
+ */
+u16 uart_crc16(u16 crc, const u8 *data, u32 len){
+    for (u32 i = 0; i < len; i++){
+        crc ^= (u16)data[i] << 8;
+        for (int b = 0; b < 8; b++){
+            crc = (crc & 0x8000) ? (u16)((crc << 1) ^ 0x1021) : (u16)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+/**
+ * Start looking for the next frame
+ *
+ * @param rx (uart_frame_rx_t*) receive state
+ *
+ * @return
+ *  - void
+ */
+void uart_frame_rx_init(uart_frame_rx_t *rx){
+    rx->state = RX_SYNC0;
+    rx->seq = 0;
+    rx->len = 0;
+    rx->pos = 0;
+    rx->crc = 0xFFFF;
+    rx->crc_rx = 0;
+    rx->dst = NULL;
+}
+
+/**
+ * Feed one received byte to the frame parser
+ *
+ * A frame longer than max_len is still read to its end so that the parser
+ * stays in step, then reported as bad. Lost bytes make the CRC fail, and the
+ * parser looks for the sync bytes again after every frame.
+ *
+ * @param rx (uart_frame_rx_t*) receive state
+ * @param byte (u8) the byte
+ * @param payload (u8*) where the payload of the frame goes, NULL to check the
+ *  frame without keeping it. Taken at the last length byte and kept in
+ *  rx->dst for the rest of the frame
+ * @param max_len (u16) room at payload
+ *
+ * @return
+ *  -UART_FRAME_MORE until the end of a frame
+ *  -UART_FRAME_OK at the end of a good frame, rx->seq, rx->len and rx->dst are valid
+ *  -UART_FRAME_BAD at the end of a frame that failed its CRC or didn't fit
+ */
+int uart_frame_rx_byte(uart_frame_rx_t *rx, u8 byte, u8 *payload, u16 max_len){
+    switch (rx->state){
+    case RX_SYNC0:
+        if (byte == UART_FRAME_SYNC0)
+            rx->state = RX_SYNC1;
+        break;
+    case RX_SYNC1:
+        if (byte == UART_FRAME_SYNC1)
+            rx->state = RX_SEQ;
+        else if (byte != UART_FRAME_SYNC0)
+            rx->state = RX_SYNC0;
+        break;
+    case RX_SEQ:
+        rx->seq = byte;
+        rx->crc = uart_crc16(0xFFFF, &byte, 1);
+        rx->state = RX_LEN0;
+        break;
+    case RX_LEN0:
+        rx->len = byte;
+        rx->crc = uart_crc16(rx->crc, &byte, 1);
+        rx->state = RX_LEN1;
+        break;
+    case RX_LEN1:
+        rx->len |= (u16)byte << 8;
+        rx->crc = uart_crc16(rx->crc, &byte, 1);
+        rx->pos = 0;
+        rx->dst = payload;
+        rx->state = rx->len > 0 ? RX_PAYLOAD : RX_CRC0;
+        break;
+    case RX_PAYLOAD:
+        if (rx->dst != NULL && rx->pos < max_len)
+            rx->dst[rx->pos] = byte;
+        rx->crc = uart_crc16(rx->crc, &byte, 1);
+        rx->pos++;
+        if (rx->pos == rx->len)
+            rx->state = RX_CRC0;
+        break;
+    case RX_CRC0:
+        rx->crc_rx = byte;
+        rx->state = RX_CRC1;
+        break;
+    case RX_CRC1:
+        rx->crc_rx |= (u16)byte << 8;
+        rx->state = RX_SYNC0;
+        if (rx->crc_rx != rx->crc || rx->len > max_len)
+            return UART_FRAME_BAD;
+        return UART_FRAME_OK;
+    }
+
+    return UART_FRAME_MORE;
+}
+
+/**
+ * Place a good frame against the sequence number expected next. Sequence
+ * numbers are 8 bits and wrap, anything up to 128 behind is a repeat
+ *
+ * @param seq (u8) sequence number of the frame
+ * @param expected (u32) frames taken so far
+ *
+ * @return
+ *  -UART_FRAME_NEXT, UART_FRAME_DUP or UART_FRAME_GAP
+ */
+int uart_frame_check_seq(u8 seq, u32 expected){
+    u8 behind = (u8)((u8)expected - seq);
+
+    if (behind == 0)
+        return UART_FRAME_NEXT;
+    if (behind <= 128)
+        return UART_FRAME_DUP;
+    return UART_FRAME_GAP;
+}
+
+/**
+ * Build a frame, for the host side and the tests
+ *
+ * @param frame (u8*) output, len + UART_FRAME_HDR_LEN + UART_FRAME_CRC_LEN bytes
+ * @param seq (u8) sequence number
+ * @param payload (const u8*) payload
+ * @param len (u16) payload length
+ *
+ * @return
+ *  - number of bytes written to frame
+ */
+u32 uart_frame_build(u8 *frame, u8 seq, const u8 *payload, u16 len){
+    u16 crc;
+
+    frame[0] = UART_FRAME_SYNC0;
+    frame[1] = UART_FRAME_SYNC1;
+    frame[2] = seq;
+    frame[3] = (u8)(len & 0xff);
+    frame[4] = (u8)(len >> 8);
+    for (u32 i = 0; i < len; i++)
+        frame[UART_FRAME_HDR_LEN + i] = payload[i];
+
+    crc = uart_crc16(0xFFFF, &frame[2], 3 + (u32)len);
+    frame[UART_FRAME_HDR_LEN + len] = (u8)(crc & 0xff);
+    frame[UART_FRAME_HDR_LEN + len + 1] = (u8)(crc >> 8);
+
+    return UART_FRAME_HDR_LEN + len + UART_FRAME_CRC_LEN;
+}
@@ -52,6 +52,8 @@ void dump_payload(char *p, int len);
 int generate_response(struct tcp_pcb *pcb, struct pbuf *p, char *payload, int len);
 err_t recv_callback(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err);
 err_t accept_callback(void *arg, struct tcp_pcb *newpcb, err_t err);
+void err_callback(void *arg, err_t err);
+void close_connection(struct tcp_pcb *pcb);
 int start_application();
 
 // message type definition
@@ -62,13 +64,27 @@ enum req_type {RECV, SEND, UNKNOWN};
 unsigned ipv4_port = 7;
 
 #define MAX_PKT_NUM 2048 // expected block coefficients + 1
+#define MAX_PKT_LEN 134 // 'R', type, 2 bytes of length, 130 bytes of data
 // based on our own packet definition
 int curr_coeff_packet = 0;
 
 // place to store the packets
-u8 packet_buffer[MAX_PKT_NUM][134];
+u8 packet_buffer[MAX_PKT_NUM][MAX_PKT_LEN];
 int packet_len_buffer[MAX_PKT_NUM];
 
+#define MAX_CONNECTIONS 4 // the compression board and the client, with room to spare
+
+// R packet being put back together, one per connection. The client keeps
+// several packets in flight so one segment can hold more than one packet or
+// end in the middle of one. Passed to the callbacks with tcp_arg
+struct rx_state {
+	int in_use;
+	int connection;
+	u8 packet[MAX_PKT_LEN];
+	int packet_len;
+};
+struct rx_state rx_states[MAX_CONNECTIONS];
+
 volatile u16 curr_pkt_num = 0;
 volatile u16 last_pkt_num = 0;
 volatile u16 size_pkt_buf = 0;
@@ -107,7 +123,7 @@ enum req_type decode_request(char *req, int l){
 int do_404(struct tcp_pcb *pcb, struct pbuf *p, char *req, int rlen){
 	xil_printf("Invalid message type! Closing connection\n");
 
-	tcp_close(pcb);
+	close_connection(pcb);
 
 	return 0;
 }
@@ -177,7 +193,7 @@ int ack_send(struct tcp_pcb *pcb, struct pbuf *p, char *req, int rlen){
 	err = tcp_write(pcb, packet, strlen(packet), 1);
 	if(err != ERR_OK){
 		xil_printf("error (%d) sending ack signal\r\n", err);
-		tcp_close(pcb);
+		close_connection(pcb);
 	}
 
 	xil_printf("send ack\n");
@@ -214,18 +230,37 @@ int generate_response(struct tcp_pcb *pcb, struct pbuf *p, char *payload, int le
 }
 
 
+/* free the connection's rx_state and close it, the callbacks won't be
+   called for it again */
+void close_connection(struct tcp_pcb *pcb)
+{
+	struct rx_state *rx = (struct rx_state *)pcb->callback_arg;
+
+	if (rx != NULL)
+		rx->in_use = 0;
+	tcp_arg(pcb, NULL);
+	tcp_recv(pcb, NULL);
+	tcp_err(pcb, NULL);
+	tcp_close(pcb);
+}
+
 err_t recv_callback(void *arg, struct tcp_pcb *tpcb,
                                struct pbuf *p, err_t err)
 {
+	struct rx_state *rx = (struct rx_state *)arg;
+
 	/* do not read the packet if we are not in ESTABLISHED state */
 	if (!p) {
-		tcp_close(tpcb);
-		tcp_recv(tpcb, NULL);
+		close_connection(tpcb);
+		return ERR_OK;
+	}
+	if (rx == NULL) {
+		pbuf_free(p);
 		return ERR_OK;
 	}
 
 	/* indicate that the packet has been received */
-	tcp_recved(tpcb, p->len);
+	tcp_recved(tpcb, p->tot_len);
 
 	/* echo back the payload */
 	/* in this case, we assume that the payload is < TCP_SND_BUF */
@@ -234,7 +269,43 @@ err_t recv_callback(void *arg, struct tcp_pcb *tpcb,
 	} else
 		xil_printf("no space in tcp_sndbuf\n\r");
 	*/
-	generate_response(tpcb, p, p->payload, p->len);
+	/* walk the whole chain, R packets are cut back out of the byte stream */
+	for (struct pbuf *q = p; q != NULL; q = q->next) {
+		char *payload = (char *)q->payload;
+		int i = 0;
+
+		while (i < q->len) {
+			if (rx->packet_len == 0 && payload[i] != 'R') {
+				/* one byte requests */
+				if (decode_request(payload + i, 1) == UNKNOWN) {
+					generate_response(tpcb, p, payload + i, q->len - i);
+					pbuf_free(p);
+					return ERR_OK;
+				}
+				generate_response(tpcb, p, payload + i, 1);
+				i++;
+			}
+			else {
+				int n = MAX_PKT_LEN - rx->packet_len;
+				if (n > q->len - i)
+					n = q->len - i;
+				memcpy(rx->packet + rx->packet_len, payload + i, n);
+				rx->packet_len += n;
+				i += n;
+
+				if (rx->packet_len == MAX_PKT_LEN) {
+					generate_response(tpcb, p, (char *)rx->packet, MAX_PKT_LEN);
+					rx->packet_len = 0;
+				}
+			}
+
+			/* a failed ack closes the connection */
+			if (!rx->in_use) {
+				pbuf_free(p);
+				return ERR_OK;
+			}
+		}
+	}
 
 	/* free the received pbuf */
 	pbuf_free(p);
@@ -242,16 +313,43 @@ err_t recv_callback(void *arg, struct tcp_pcb *tpcb,
 	return ERR_OK;
 }
 
+/* the connection is gone, lwIP has already freed the pcb */
+void err_callback(void *arg, err_t err)
+{
+	struct rx_state *rx = (struct rx_state *)arg;
+
+	xil_printf("Connection error (%d)\n", err);
+	if (rx != NULL)
+		rx->in_use = 0;
+}
+
 err_t accept_callback(void *arg, struct tcp_pcb *newpcb, err_t err)
 {
 	static int connection = 1;
+	struct rx_state *rx = NULL;
+
+	for (int i = 0; i < MAX_CONNECTIONS; i++) {
+		if (!rx_states[i].in_use) {
+			rx = &rx_states[i];
+			break;
+		}
+	}
+	if (rx == NULL) {
+		xil_printf("Too many connections, refusing connection %d\n", connection);
+		tcp_abort(newpcb);
+		return ERR_ABRT;
+	}
+
 	xil_printf("Connection number is %d\n", connection);
-	/* just use an integer number indicating the connection id as the
-	   callback argument */
-	tcp_arg(newpcb, (void*)(UINTPTR)connection);
+	/* every connection starts without a partial R packet */
+	rx->in_use = 1;
+	rx->connection = connection;
+	rx->packet_len = 0;
+	tcp_arg(newpcb, rx);
 
-	/* set the receive callback for this connection */
+	/* set the receive and error callbacks for this connection */
 	tcp_recv(newpcb, recv_callback);
+	tcp_err(newpcb, err_callback);
 
 	/* increment for subsequent accepted connections */
 	connection++;
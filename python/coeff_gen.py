@@ -7,6 +7,8 @@ from os import write
 
 FILENAME = 'ram_coeff.mem'
 BIT_DEPTH = 9
+FAST_FILENAME = 'fast_coeff.mem'
+FAST_BIT_DEPTH = BIT_DEPTH + 1 # the biggest one is 1.85, needs the extra bit
 
 def write_coeffs():
     coeff_arr = [0] * 7
@@ -81,7 +83,41 @@ def comp(num_str):
 
     return "{0:#0{1}x}".format(num_comp, hex_places)
 
+def get_fast_coeffs():
+    ''' the constants for the fast (Loeffler) kernel in dct_stage, scaled by
+    2**(BIT_DEPTH-1). Each rotation by C, S takes three of them so that it only
+    needs three multiplies, o1 = K0*(u+v) + K1*v and o2 = K0*(u+v) - K2*u with
+    K0 = C, K1 = S-C, K2 = C+S. The rotations are, in order, the odd part by
+    3pi/16, the odd part by pi/16, the even part by 2pi/16 scaled by sqrt(2),
+    and the last one is just the two sqrt(2) multiplies
+    '''
+    scale = 2**(BIT_DEPTH-1)
+    rotations = [
+        (m.cos(3*m.pi/16), m.sin(3*m.pi/16)),
+        (m.cos(m.pi/16), m.sin(m.pi/16)),
+        (m.sqrt(2)*m.cos(2*m.pi/16), m.sqrt(2)*m.sin(2*m.pi/16))]
+
+    coeffs = []
+    for (c, s) in rotations:
+        coeffs += [round(c*scale), round((s-c)*scale), round((c+s)*scale)]
+    coeffs += [0, round(m.sqrt(2)*scale), -round(m.sqrt(2)*scale)]
+
+    return coeffs
+
+
+def write_fast_coeffs():
+    hex_places = m.ceil(FAST_BIT_DEPTH/4) + 2
+    mask = (2**FAST_BIT_DEPTH) - 1
+
+    with open(FAST_FILENAME, 'wb') as file:
+        for coeff in get_fast_coeffs():
+            # negative values as FAST_BIT_DEPTH two's complement
+            val = "{0:#0{1}x}".format(coeff & mask, hex_places)
+            file.write((val + '\n').encode('ascii'))
+
+
 if __name__ == "__main__":
     write_coeffs()
+    write_fast_coeffs()
     # comp(hex(12))
 
@@ -130,7 +130,7 @@ Returns:
     np.array: 8x8 numpy array of the decompressed image coefficients
 
 '''
-def get_decompressed_block(coeff_arr):
+def get_decompressed_block(coeff_arr, dct_quality=DCT_QUALITY):
 
     decode_arr = []
 
@@ -157,7 +157,7 @@ def get_decompressed_block(coeff_arr):
         decode_arr = decode_arr.extend([0 for _ in range(64-len(decode_arr))])
 
     # get myself an instance of the class for decompression
-    dct = dct_compressor(DCT_BLOCK_SIZE, DCT_QUALITY, pow2=True)
+    dct = dct_compressor(DCT_BLOCK_SIZE, dct_quality, pow2=True)
 
     decode_arr = dct.get_un_zigzag(decode_arr)
 
@@ -210,7 +210,10 @@ class dct_compressor:
 
         # return quantization matrix to a power of 2
         if (pow2):
-            quantization_matrix = np.power(2, np.round(np.log2(self.QUANTIZATION_MATRIX)))
+            # the same shifts as dct_quant.c loads into the DCT, 50 is quant_coeff.mem
+            scale = 5000//dct_quality if dct_quality < 50 else 200 - 2*dct_quality
+            quantization_matrix = np.clip((self.QUANTIZATION_MATRIX*scale + 50)//100, 1, 255)
+            quantization_matrix = np.power(2, np.clip(np.round(np.log2(quantization_matrix)), 3, 8))
             # adjust quantization to user-specified quality
         else:
             if (dct_quality >= 50):
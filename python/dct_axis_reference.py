@@ -0,0 +1,119 @@
+'''
+Expected m_axis output of custom_dct_axis for the test image
+
+Runs dct_test_block.mem through the bit-exact dct_main model of
+dct_kernel_compare.py, then does what zig_zag_stage and run_length_stage do
+with the quantized coefficients, and writes the 32-bit m_axis words to
+dct_axis_expected.mem for tb_custom_dct_axis.v. The first word of a beat is
+in the low 16 bits and a block that ends on the low half is padded with an
+extra EOF, so every block ends in the one word holding its EOF.
+
+A block ending in a value and a single zero, with a value before them, comes
+out the way run_length_stage writes it: the zero flag on the value's word and
+the run word with whatever top bit its buffer page last had. Such a block
+doesn't decode back, so it is only reported.
+
+The float model in dct_alg_util.py is not bit for bit, this one is. The words
+are decoded again and checked against the quantized coefficients before the
+file is written.
+
+    python dct_axis_reference.py [kernel]
+
+Only needs the standard library, run it from this directory.
+'''
+
+import os
+import sys
+
+from dct_kernel_compare import MEM_PATH, DATA_WIDTH, QUANT_STAGE_WIDTH, NUM_IMG_PIXELS, read_mem, dct_model
+
+RUNL_STAGE_WIDTH = 16
+EOF = 2**RUNL_STAGE_WIDTH - 1
+ZERO_FLAG = 2**(RUNL_STAGE_WIDTH - 1)
+RUN_SHIFT = 9 # a zero run is {1'b1, run[5:0], 9'b0}
+OUT_FILE = 'dct_axis_expected.mem'
+
+
+def zig_zag(quantized, lut):
+    ''' zig_zag_stage: the coefficients go in transposed, so zig-zag address
+    zz reads the one that came out at 8*(zz % 8) + zz // 8 '''
+    return [quantized[8*(zz % 8) + zz // 8] for zz in lut]
+
+
+def is_zero(val):
+    return val == 0 or val == -1
+
+
+def ends_in_one_zero(values):
+    ''' the last pair is a value and a zero, with no run before them '''
+    return not is_zero(values[-3]) and not is_zero(values[-2]) and is_zero(values[-1])
+
+
+def run_length(values, page):
+    ''' run_length_stage: a zero run before every non-zero value and at the end,
+    then EOF. -1 counts as zero, a run of 64 wraps to a count of 0. page is the
+    stage's buffer page the block goes to, it keeps what was last written '''
+    last = len(values)
+    if ends_in_one_zero(values):
+        last -= 2
+    words = []
+    run = 0
+    for val in values[:last]:
+        if is_zero(val):
+            run += 1
+            continue
+        if run:
+            words.append(ZERO_FLAG | (run % 64) << RUN_SHIFT)
+        words.append(val % 2**QUANT_STAGE_WIDTH)
+        run = 0
+    if last < len(values):
+        words.append(ZERO_FLAG | values[-2] % 2**QUANT_STAGE_WIDTH)
+        words.append(page[len(words)] & ZERO_FLAG | 1 << RUN_SHIFT)
+    elif run:
+        words.append(ZERO_FLAG | (run % 64) << RUN_SHIFT)
+    words.append(EOF)
+    page[:len(words)] = words
+    return words
+
+
+def decode(words):
+    ''' back to zig-zag ordered values, -1 comes back as 0 '''
+    values = []
+    for word in words:
+        if word == EOF:
+            break
+        if word & ZERO_FLAG:
+            values += [0] * ((word >> RUN_SHIFT) % 64 or 64)
+        else:
+            values.append(word - 2**QUANT_STAGE_WIDTH if word >= 2**(QUANT_STAGE_WIDTH-1) else word)
+    return values
+
+
+def main():
+    kernel = int(sys.argv[1]) if len(sys.argv) > 1 else 0
+    pixels = read_mem('dct_test_block.mem', DATA_WIDTH + 1)
+    with open(os.path.join(MEM_PATH, 'zigzag_lookup.mem')) as file:
+        lut = [int(line, 16) for line in file if line.strip()][:64]
+    model = dct_model(kernel)
+
+    beats = []
+    pages = [[0] * 65, [0] * 65]
+    for b in range(NUM_IMG_PIXELS // 64):
+        _, quantized = model.run(pixels[64*b : 64*b + 64])
+        zz = zig_zag(quantized, lut)
+        words = run_length(zz, pages[b % 2])
+        if ends_in_one_zero(zz):
+            print(f"block {b} ends in a value and one zero, its value word has the zero flag")
+        elif decode(words) != [0 if v == -1 else v for v in zz]:
+            sys.exit(f"block {b} doesn't decode back to its coefficients")
+        if len(words) % 2:
+            words.append(EOF)
+        beats += [words[i] | words[i+1] << RUNL_STAGE_WIDTH for i in range(0, len(words), 2)]
+
+    with open(os.path.join(MEM_PATH, OUT_FILE), 'w') as file:
+        file.writelines(f"{beat:08x}\n" for beat in beats)
+    print(f"{NUM_IMG_PIXELS // 64} blocks, {len(beats)} words, kernel {kernel}, written to {OUT_FILE}")
+
+
+if __name__ == "__main__":
+    main()
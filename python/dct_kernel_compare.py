@@ -0,0 +1,223 @@
+'''
+Compare the two 1D kernels dct_stage can be built with, bit for bit
+
+Runs the test image (dct_test_block.mem, the upper-right corner of
+flowers_ms_31.png) through integer models of dct_main: the row stage, the
+column stage and the quantizer, with the same widths, shifts and rounding as
+the verilog. Both kernels are compared against the exact DCT and against each
+other, before quantization in output LSBs and after it in quantized
+coefficients, and the decoded image is compared against the original.
+Coefficients whose exact value sits right on a quantizer step (mostly the
+zeros of flat blocks) are left out of the comparison with the exact DCT, the
+quantizer floors so either neighbour is as good.
+
+    KERNEL = 0: the 8x4 coefficient matrix, ram_coeff.mem
+    KERNEL = 1: Loeffler's flow graph as four rotations of three multiplies,
+                fast_coeff.mem
+
+The row stage takes the pixels as signed DATA_WIDTH-bit values before it
+subtracts 2**(DATA_WIDTH-1), so pixels from 128 up go in 256 lower. The
+models do the same, and the exact DCT and the decoded image are of what the
+row stage takes in.
+
+Only needs the standard library, run it from this directory.
+'''
+
+import math as m
+import os
+
+MEM_PATH = os.path.join('..', 'src', 'axis_custom_dct', 'mem_files')
+
+DATA_WIDTH = 8
+COEFF_WIDTH = 9
+FIRST_STAGE_WIDTH = 21
+SECOND_STAGE_WIDTH = 25
+QUANT_STAGE_WIDTH = 14
+EXTRA_QUANT = 15
+
+NUM_IMG_PIXELS = 65536
+FRAC = COEFF_WIDTH - 1 # fraction bits of the fast kernel constants
+
+
+def read_mem(filename, bits):
+    ''' read a $readmemh file into a list of signed integers '''
+    with open(os.path.join(MEM_PATH, filename)) as file:
+        vals = [int(line, 16) for line in file if line.strip()]
+    return [v - 2**bits if v >= 2**(bits-1) else v for v in vals]
+
+
+def wrap(val, bits):
+    ''' what's left of val in a signed register of bits bits '''
+    val &= (2**bits) - 1
+    return val - 2**bits if val >= 2**(bits-1) else val
+
+
+def get_addsub(row):
+    return [row[i] + row[7-i] for i in range(4)] + [row[i] - row[7-i] for i in range(4)]
+
+
+def matrix_1d(row, coeffs):
+    ''' KERNEL = 0, returns the accumulators in coefficient order '''
+    addsub = get_addsub(row)
+    acc = [sum(coeffs[4*k + t] * addsub[4*(k//4) + t] for t in range(4)) for k in range(8)]
+    return [acc[0], acc[4], acc[1], acc[5], acc[2], acc[6], acc[3], acc[7]]
+
+
+def rotate(u, v, k):
+    ''' a rotation in three multiplies, the products share K0*(u+v) '''
+    p = k[0] * (u + v)
+    return p + k[1]*v, p - k[2]*u
+
+
+def fast_1d(row, coeffs):
+    ''' KERNEL = 1, returns the accumulators in coefficient order, all of them
+    at 2**FRAC times sqrt(8) times the orthonormal DCT '''
+    s = get_addsub(row)
+    d = s[4:]
+    e0, e1, e2, e3 = s[0] + s[3], s[1] + s[2], s[1] - s[2], s[0] - s[3]
+
+    a4, a7 = rotate(d[3], d[0], coeffs[0:3])
+    a5, a6 = rotate(d[2], d[1], coeffs[3:6])
+    y2, y6 = rotate(e3, e2, coeffs[6:9])
+    b4, b5, b6, b7 = a4 + a6, a7 - a5, a4 - a6, a7 + a5
+    y3, y5 = rotate(b6, b5, coeffs[9:12])
+
+    return [(e0 + e1) << FRAC, b7 + b4, y2, y3 >> FRAC,
+            (e0 - e1) << FRAC, y5 >> FRAC, -y6, b7 - b4]
+
+
+class stage_model:
+    ''' one dct_stage, acc holds DATA_WIDTH+COEFF_WIDTH+4 bits and the output
+    is its top OUTPUT_WIDTH bits '''
+
+    def __init__(self, data_width, output_width, kernel, coeffs):
+        self.acc_width = data_width + COEFF_WIDTH + 4
+        self.output_width = output_width
+        self.kernel = kernel
+        self.coeffs = coeffs
+        self.max_acc = 0
+
+    def run(self, row):
+        if self.kernel == 0:
+            acc = matrix_1d(row, self.coeffs)
+        else:
+            acc = fast_1d(row, self.coeffs)
+        self.max_acc = max([self.max_acc] + [abs(a) for a in acc])
+        shift = self.acc_width - self.output_width
+        return [wrap(a, self.acc_width) >> shift for a in acc]
+
+
+class dct_model:
+    ''' dct_main up to the quantizer '''
+
+    def __init__(self, kernel):
+        if kernel == 0:
+            coeffs = read_mem('ram_coeff.mem', COEFF_WIDTH)
+        else:
+            coeffs = read_mem('fast_coeff.mem', COEFF_WIDTH + 1)
+        self.rows = stage_model(DATA_WIDTH, FIRST_STAGE_WIDTH, kernel, coeffs)
+        self.cols = stage_model(FIRST_STAGE_WIDTH, SECOND_STAGE_WIDTH, kernel, coeffs)
+        # the extra factor of 2 of the fast kernel comes off in the quantizer
+        self.corr_shift = SECOND_STAGE_WIDTH - 3 - 1 - EXTRA_QUANT - (QUANT_STAGE_WIDTH - 1) + kernel
+        self.quant = read_mem('quant_coeff.mem', 8)
+        # column stage LSBs per orthonormal DCT unit
+        self.scale = 2**(2*COEFF_WIDTH) * (2 if kernel else 1) / 2**(self.cols.acc_width - SECOND_STAGE_WIDTH)
+
+    def run(self, block):
+        ''' block is 64 pixels, row by row. Returns the column stage output
+        and the quantized coefficients, both in the order they come out, by
+        column of the row stage output '''
+        rows = [self.rows.run([input_shift(p) for p in block[8*r : 8*r + 8]]) for r in range(8)]
+        coeffs = []
+        for c in range(8):
+            coeffs += self.cols.run([wrap(rows[r][c], FIRST_STAGE_WIDTH) for r in range(8)])
+        coeffs = [wrap(c, SECOND_STAGE_WIDTH) for c in coeffs]
+        quantized = [wrap(coeffs[n] >> (self.quant[n] + EXTRA_QUANT + self.corr_shift), QUANT_STAGE_WIDTH) for n in range(64)]
+        return coeffs, quantized
+
+    def dequantize(self, quantized):
+        ''' back to orthonormal DCT units, like dct_compressor.get_unquantized '''
+        return [quantized[n] * 2**(self.quant[n] + EXTRA_QUANT + self.corr_shift) / self.scale for n in range(64)]
+
+
+# the orthonormal DCT matrix, T[k][x]
+T = [[(m.sqrt(1/8) if k == 0 else 0.5) * m.cos((2*x + 1) * k * m.pi / 16) for x in range(8)] for k in range(8)]
+
+
+def input_shift(p):
+    ''' what the row stage latches for pixel p, the pixel is signed '''
+    return wrap(wrap(p, DATA_WIDTH) - 2**(DATA_WIDTH-1), DATA_WIDTH + 1)
+
+
+def exact_dct(block):
+    ''' orthonormal 2D DCT of the shifted block, in the order dct_main gives it,
+    out[8*u + v] with u the horizontal frequency '''
+    x = [[input_shift(p) for p in block[8*r : 8*r + 8]] for r in range(8)]
+    rows = [[sum(T[u][c] * x[r][c] for c in range(8)) for u in range(8)] for r in range(8)]
+    return [sum(T[v][r] * rows[r][u] for r in range(8)) for u in range(8) for v in range(8)]
+
+
+def inverse_dct(coeffs):
+    ''' inverse of exact_dct, back to pixels '''
+    cols = [[sum(T[v][r] * coeffs[8*u + v] for v in range(8)) for r in range(8)] for u in range(8)]
+    return [sum(T[u][c] * cols[u][r] for u in range(8)) + 2**(DATA_WIDTH-1) for r in range(8) for c in range(8)]
+
+
+def compare():
+    pixels = read_mem('dct_test_block.mem', DATA_WIDTH + 1)
+    models = [dct_model(0), dct_model(1)]
+    names = ['matrix', 'fast']
+
+    n_coeffs = 0
+    err_sum = [0.0, 0.0]
+    err_max = [0.0, 0.0]
+    q_diff_exact = [0, 0]
+    q_ties = 0
+    q_diff_kernels = 0
+    q_diff_max = 0
+    nonzeros = [0, 0]
+    sq_err = [0.0, 0.0]
+
+    for b in range(NUM_IMG_PIXELS // 64):
+        block = pixels[64*b : 64*b + 64]
+        taken_in = [input_shift(p) + 2**(DATA_WIDTH-1) for p in block]
+        exact = exact_dct(block)
+        quantized = []
+        for k, model in enumerate(models):
+            coeffs, q = model.run(block)
+            quantized.append(q)
+            for n in range(64):
+                # in LSBs of the matrix kernel, the fast one has one more
+                err = abs(coeffs[n] / model.scale - exact[n]) * models[0].scale
+                err_sum[k] += err
+                err_max[k] = max(err_max[k], err)
+                q_exact = exact[n] * model.scale / 2**(model.quant[n] + EXTRA_QUANT + model.corr_shift)
+                if abs(q_exact - round(q_exact)) < 1e-9:
+                    q_ties += (k == 0)
+                else:
+                    q_diff_exact[k] += (q[n] != m.floor(q_exact))
+                nonzeros[k] += (q[n] != 0)
+            decoded = inverse_dct(model.dequantize(q))
+            sq_err[k] += sum((decoded[p] - taken_in[p])**2 for p in range(64))
+
+        n_coeffs += 64
+        for n in range(64):
+            q_diff_kernels += (quantized[0][n] != quantized[1][n])
+            q_diff_max = max(q_diff_max, abs(quantized[0][n] - quantized[1][n]))
+
+    print(f"{NUM_IMG_PIXELS // 64} blocks, {n_coeffs} coefficients, {q_ties} on a quantizer step")
+    print("kernel  error (LSB) mean   max  quantized != exact  nonzero  PSNR (dB)")
+    for k in range(2):
+        psnr = 10 * m.log10((2**DATA_WIDTH - 1)**2 / (sq_err[k] / NUM_IMG_PIXELS))
+        print(f"{names[k]:6}  {err_sum[k] / n_coeffs:16.3f}  {err_max[k]:4.1f}  "
+              f"{q_diff_exact[k]:9d} ({100 * q_diff_exact[k] / (n_coeffs - q_ties):5.3f}%)  "
+              f"{nonzeros[k]:7d}  {psnr:9.2f}")
+    print(f"quantized coefficients that differ between the kernels: {q_diff_kernels} "
+          f"({100 * q_diff_kernels / n_coeffs:.3f}%), by at most {q_diff_max}")
+    for k in range(2):
+        for stage in [models[k].rows, models[k].cols]:
+            print(f"{names[k]:6} largest accumulator {stage.max_acc} of {2**(stage.acc_width-1) - 1}")
+
+
+if __name__ == "__main__":
+    compare()
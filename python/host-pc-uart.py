@@ -20,6 +20,11 @@ ComPort = "COM6"
 UART_BUFFER_SIZE = 64
 FULL_TEST = True
 
+# image header, the first UART packet of an image, see sd_card.h
+SD_IMG_MAGIC = 0x31474D49  # "IMG1"
+SD_PIX_FMT_GRAY8 = 0
+UART_PACKET_SIZE = 7 * 64  # 7 8x8 blocks, one SD sector
+
 
 def read_img(num):
     # read each image as one band
@@ -48,7 +53,7 @@ def split_img(img, row_size, col_size):
     # split the image based on row and colume size of the required image
     # img is a numpy array of pixel values
     row_split_num = int(img.shape[0] / row_size)
-    col_split_num = int(img.shape[1] / row_size)
+    col_split_num = int(img.shape[1] / col_size)
     img_list = []
 
     imgx = np.split(img, row_split_num)
@@ -75,7 +80,27 @@ def add_padding(img_list):
     return new_img_list
 
 
-def uart_op(img_list):
+# pad the image with 0 up to a whole number of 8x8 blocks
+def pad_img(img):
+    rows = -(-img.shape[0] // 8) * 8
+    cols = -(-img.shape[1] // 8) * 8
+    new_img = np.zeros((rows, cols), dtype=img.dtype)
+    new_img[: img.shape[0], : img.shape[1]] = img
+
+    return new_img
+
+
+# header packet telling the FPGA the geometry of the image that follows
+def make_header(width, height):
+    block_num = (-(-width // 8)) * (-(-height // 8))
+    header = struct.pack(
+        "<IIIII", SD_IMG_MAGIC, width, height, block_num, SD_PIX_FMT_GRAY8
+    )
+
+    return header + bytes(UART_PACKET_SIZE - len(header))
+
+
+def uart_op(img_list, header):
     packet_num = int((img_list.shape[0] / 7))
 
     print("Initializing serial port...")
@@ -100,16 +125,24 @@ def uart_op(img_list):
     while 1:
         # sending one full image for FULL_TEST
         if FULL_TEST:
-            for i in range(packet_num):
-                if i > 0:
-                    ser.open()
-                    # time.sleep(3)
-                    # can't sleep, has time drift
+            # header goes first, the FPGA sizes the rest of the transfer from it
+            ser.write(header)
+            ser.close()
+            print("Sent image header")
 
-                    # use uart handshake
+            for i in range(packet_num):
+                ser.open()
+                # time.sleep(3)
+                # can't sleep, has time drift
+
+                # use uart handshake, the header gets one too
+                # an E instead means the FPGA didn't take the header
+                rec = ser.read().decode("ASCII")
+                while rec != "!" and rec != "E":
                     rec = ser.read().decode("ASCII")
-                    while rec != "!":
-                        rec = ser.read().decode("ASCII")
+                if rec == "E":
+                    print("FPGA rejected the image header, stopping")
+                    break
 
                 for k in range(7):
                     img_payload = img_list[i * 7 + k].flatten()
@@ -140,12 +173,13 @@ if __name__ == "__main__":
     img = read_img(31)
     # split image into 8x8 blocks
     img_smol = split_img(img, 256, 256)
-    img_list = split_img(img_smol[1], 8, 8)
+    header = make_header(img_smol[1].shape[1], img_smol[1].shape[0])
+    img_list = split_img(pad_img(img_smol[1]), 8, 8)
     # cv.imshow("small img", img_list[9])
     # cv.waitKey()
     img_list_pad = add_padding(img_list)
 
     # UART operation
-    uart_op(img_list_pad)
+    uart_op(img_list_pad, header)
     cv.imshow("original small img", img_smol[1])
     cv.waitKey()
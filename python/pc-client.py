@@ -38,9 +38,10 @@ lock = threading.Lock()
 logging.basicConfig(level=logging.INFO)
 logger = logging.getLogger(__name__)
 
-# Image size requirements
-img_size = 256
-img = np.zeros((img_size,img_size))
+# Image size and DCT quality, sent by the FPGA in a geometry message (type 3) before the coefficients
+img_width = 256
+img_height = 256
+img_quality = 50
 
 # ============================================================================
 # SOCKET AND MESSAGE CLASSES
@@ -117,7 +118,7 @@ def main_rx(rx_port):
             logger.info("Received message type "+str(msg_type)+"\r")
             # collect the entire message
             recv_msg = b''
-            if (msg_type == 0) or (msg_type == 1) or (msg_type == 2):
+            if (msg_type == 0) or (msg_type == 1) or (msg_type == 2) or (msg_type == 3):
                 # second 2 bytes are message length
                 [msg_len,] = struct.unpack('>H', s.recv(2))
                 logger.info("Received message length "+str(msg_len)+"\r")
@@ -140,10 +141,13 @@ def main_rx(rx_port):
                         logger.info("Data message: "+str(recv_msg)+"\r")
                         break
 
-                # Add data into queue for processing
+                # Add data into queue for processing, geometry comes first so the image can be sized
                 if (msg_type == 0):
                     data_msg = rx_data_msg(msg_type, msg_len, recv_msg[0:int(msg_len/2)])
                     rx_q.put(data_msg, block=True, timeout=5)
+                if (msg_type == 3):
+                    data_msg = rx_data_msg(msg_type, msg_len, recv_msg[0:msg_len])
+                    rx_q.put(data_msg, block=True, timeout=5)
                 # Add telemetry data into queue
                 if (msg_type == 1) or (msg_type == 2):
                     # Concatenate telemetry byte data into one integer
@@ -202,20 +206,35 @@ def main():
     # disp_t.start()
 
     # Show coefficient visuals - matplotlib doesn't work inside threads
+    global img_width, img_height, img_quality
     i = 0
     block_size = 8
-    total_rows = int(img_size/block_size)
+    img = None
     while True:
         rx_msg = rx_q.get()
+        if (rx_msg.msg_type == 3):
+            # width and height as big endian 16-bit numbers
+            img_width = (rx_msg.data[0] << 8) | rx_msg.data[1]
+            img_height = (rx_msg.data[2] << 8) | rx_msg.data[3]
+            if rx_msg.msg_length > 4:
+                img_quality = rx_msg.data[4]
+            logger.info("Image size "+str(img_width)+"x"+str(img_height)+", quality "+str(img_quality)+"\r")
+            continue
+        if img is None:
+            # images that don't divide into blocks are padded up to the next block
+            total_cols = int((img_width + block_size - 1)/block_size)
+            total_rows = int((img_height + block_size - 1)/block_size)
+            img = np.zeros((total_rows*block_size, total_cols*block_size))
         # process the coefficient into decompressed image data
-        decomp_img_data = get_decompressed_block(rx_msg.data)
-        # reconstruct image from decompressed data
-        y = int((i%total_rows)*block_size)
-        x = int(int(i/total_rows)*block_size)
+        decomp_img_data = get_decompressed_block(rx_msg.data, img_quality)
+        # reconstruct image from decompressed data, blocks arrive row by row
+        y = int(int(i/total_cols)*block_size)
+        x = int((i%total_cols)*block_size)
         img[y:(y+block_size), x:(x+block_size)] = decomp_img_data
         i += 1
-        if (i == total_rows*total_rows):
+        if (i == total_rows*total_cols):
             break
+    img = img[0:img_height, 0:img_width]
     # Show decompressed image
     plt.title("Decompressed image")
     plt.imshow(img)
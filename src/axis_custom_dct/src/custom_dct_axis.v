@@ -6,8 +6,13 @@
 // Module Name: custom_dct_axis
 // Description:
 //  interfaces the custom DCT block to axistream
+//  With N_CORES above 1 the blocks go round-robin to a dct_array instead of
+//  a single dct_main, each beat goes straight in and s_axis_tready only
+//  drops when the core taking the block is behind
+//  The quantization table is written over the s_axi AXI-Lite port, see
+//  quant_regs, which has to run off the stream clock
 //
-// Last Modified: 2021-03-23
+// Last Modified: 2026-10-17
 //
 //////////////////////////////////////////////////////////////////////////////////
 
@@ -15,6 +20,12 @@
 module custom_dct_axis #(
     // AXI STREAM PARAMETERS
     parameter C_AXIS_TDATA_WIDTH = 32, // another illusion of choice
+    parameter PACKED_INPUT = 0, // 0: two pixels in the lower 16 bits, 1: four pixels per beat
+    parameter N_CORES = 1, // number of DCT cores, see dct_array
+
+    // AXI LITE PARAMETERS
+    parameter C_S_AXI_DATA_WIDTH = 32,
+    parameter C_S_AXI_ADDR_WIDTH = 7, // 0x00 to 0x7F, see quant_regs
 
     // DCT PARAMETERS
     parameter DATA_WIDTH = 8,
@@ -22,7 +33,8 @@ module custom_dct_axis #(
     parameter FIRST_STAGE_WIDTH = 21,
     parameter SECOND_STAGE_WIDTH = 25,
     parameter QUANT_STAGE_WIDTH = 14,
-    parameter RUNL_STAGE_WIDTH = 16 // an illusion of choice
+    parameter RUNL_STAGE_WIDTH = 16, // an illusion of choice
+    parameter KERNEL = 0 // 0: coefficient matrix, 1: fast (Loeffler), see dct_stage
 )(
     // common signals 
     input  wire                                 aclk,
@@ -40,23 +52,52 @@ module custom_dct_axis #(
     output wire [(RUNL_STAGE_WIDTH/4)-1 : 0]  m_axis_tstrb, // normall /8 but *2
     output wire                                 m_axis_tvalid,
     input  wire                                 m_axis_tready,
-    output wire                                 m_axis_tlast
+    output wire                                 m_axis_tlast,
+
+    // Slave interface for the quantization table
+    input  wire [C_S_AXI_ADDR_WIDTH-1 : 0]      s_axi_awaddr,
+    input  wire [2 : 0]                         s_axi_awprot,
+    input  wire                                 s_axi_awvalid,
+    output wire                                 s_axi_awready,
+    input  wire [C_S_AXI_DATA_WIDTH-1 : 0]      s_axi_wdata,
+    input  wire [(C_S_AXI_DATA_WIDTH/8)-1 : 0]  s_axi_wstrb,
+    input  wire                                 s_axi_wvalid,
+    output wire                                 s_axi_wready,
+    output wire [1 : 0]                         s_axi_bresp,
+    output wire                                 s_axi_bvalid,
+    input  wire                                 s_axi_bready,
+    input  wire [C_S_AXI_ADDR_WIDTH-1 : 0]      s_axi_araddr,
+    input  wire [2 : 0]                         s_axi_arprot,
+    input  wire                                 s_axi_arvalid,
+    output wire                                 s_axi_arready,
+    output wire [C_S_AXI_DATA_WIDTH-1 : 0]      s_axi_rdata,
+    output wire [1 : 0]                         s_axi_rresp,
+    output wire                                 s_axi_rvalid,
+    input  wire                                 s_axi_rready
     
     );
     localparam ADDR_WIDTH = 6;
+    localparam IN_LANES = PACKED_INPUT ? 4 : 2; // pixels per beat
     
     // put data in, get data out
     reg [DATA_WIDTH - 1 : 0] i_data0, i_data1;
+    reg [DATA_WIDTH*2 - 1 : 0] i_data_hi; // upper pixel pair of a packed beat
+    reg i_vld; // packed mode: i_data0/1 hold a valid pixel pair for the DCT
+    reg i_hi_vld; // i_data_hi still has to go to the DCT
     wire [RUNL_STAGE_WIDTH - 1 : 0] o_data0, o_data1;
     wire [RUNL_STAGE_WIDTH*2 - 1 : 0] o_dbl; // for storing both outputs to fifo
     wire [RUNL_STAGE_WIDTH*2 - 1 : 0] o_fifo; // for output of the fifo, can be transmit over stream
     reg [RUNL_STAGE_WIDTH*2 - 1 : 0] m_axis_tdata_reg; // for buffering the output
 
-    wire i_sync; // used to synchronize when the DCT block reads the input
+    wire i_sync; // used to synchronize when a beat is accepted from the slave interface
+    wire i_wen; // used to synchronize when the DCT block reads the input
     wire o_sync; // used to synchronize when the output should be written out
     wire fifo_rden; // used to enable reads from the fifo
     wire fifo_empty, fifo_full, fifo_rst; // fifo signals
+    wire array_ready; // the dct_array can take the beat
     reg m_axis_tvalid_reg, m_axis_tvalid_rdy;
+    wire [64*8 - 1 : 0] q_table; // quantization table from quant_regs
+    wire q_load, q_pending;
     
     // used to count how many packets we should handle    
     reg [31 : 0] n_pixel_in;
@@ -78,7 +119,10 @@ module custom_dct_axis #(
             n_pixel_in <= 0;
         end
         else begin
-            if (i_sync)
+            if (N_CORES > 1 && i_sync)
+                // the dct_array takes the whole beat
+                n_pixel_in <= n_pixel_in + IN_LANES;
+            else if (N_CORES == 1 && i_wen)
                 // we input two 
                 n_pixel_in <= n_pixel_in + 2;
         end
@@ -121,10 +165,15 @@ module custom_dct_axis #(
     // assume that we reset from the slave I guess
 
 
-    // we are always ready to accept input
-    assign s_axis_tready = 1;
+    // in the two pixel mode we are always ready to accept input
+    // in the packed mode we have to hold off while the upper pixel pair goes in
+    // with more than one core the dct_array says when it can take a beat
+    assign s_axis_tready = (N_CORES > 1) ? array_ready : (PACKED_INPUT ? !i_hi_vld : 1);
     // if there is valid data then we write to the DCT block
     assign i_sync = s_axis_tready && s_axis_tvalid;
+    // the two pixel mode writes on the beat itself, as it always has, the
+    // packed mode writes each pair once it is registered
+    assign i_wen = PACKED_INPUT ? i_vld : i_sync;
 
     // handle writing to inbufs
     always @(posedge aclk) begin
@@ -132,48 +181,125 @@ module custom_dct_axis #(
             // reset the inputs
             i_data0 <= 0;
             i_data1 <= 0;
+            i_data_hi <= 0;
+            i_vld <= 0;
+            i_hi_vld <= 0;
         end
         else begin
             // TODO: figure out if this is correct **************
             // might be the other way around for byte ordering
-            // WE DISCARD THE UPPER 16 BITS
-            i_data0 <= s_axis_tdata[7 : 0];
-            i_data1 <= s_axis_tdata[15: 8];
+            if (!PACKED_INPUT) begin
+                // WE DISCARD THE UPPER 16 BITS
+                i_data0 <= s_axis_tdata[7 : 0];
+                i_data1 <= s_axis_tdata[15: 8];
+            end
+            else if (i_sync) begin
+                // latch the lower pixel pair together with its valid flag
+                i_data0 <= s_axis_tdata[7 : 0];
+                i_data1 <= s_axis_tdata[15: 8];
+                i_vld <= 1;
+                // the upper pair goes in on the next cycle
+                i_data_hi <= s_axis_tdata[31 : 16];
+                i_hi_vld <= 1;
+            end
+            else if (i_hi_vld) begin
+                {i_data1, i_data0} <= i_data_hi;
+                i_vld <= 1;
+                i_hi_vld <= 0;
+            end
+            else begin
+                i_vld <= 0;
+            end
         end
     end
 
 
-    // instantantiate the dct main block
-    dct_main #(DATA_WIDTH, COEFF_WIDTH, FIRST_STAGE_WIDTH, SECOND_STAGE_WIDTH)
-        dct_main(
+    // fifo reset is not aresetn
+    assign fifo_rst = !aresetn;
+
+    /* QUANTIZATION TABLE */
+    // the firmware writes a new table and loads it, the DCT takes it between blocks
+    quant_regs #(C_S_AXI_DATA_WIDTH, C_S_AXI_ADDR_WIDTH)
+        quant_regs(
             .i_clk(aclk),
             .i_resetn(aresetn),
-            .wdata0(i_data0),
-            .wdata1(i_data1),
-            .wen(i_sync),
-            .rdata0(o_data0),
-            .rdata1(o_data1),
-            .rsync(o_sync)
+            .o_table(q_table),
+            .o_load(q_load),
+            .i_pending(q_pending),
+            .s_axi_awaddr(s_axi_awaddr),
+            .s_axi_awprot(s_axi_awprot),
+            .s_axi_awvalid(s_axi_awvalid),
+            .s_axi_awready(s_axi_awready),
+            .s_axi_wdata(s_axi_wdata),
+            .s_axi_wstrb(s_axi_wstrb),
+            .s_axi_wvalid(s_axi_wvalid),
+            .s_axi_wready(s_axi_wready),
+            .s_axi_bresp(s_axi_bresp),
+            .s_axi_bvalid(s_axi_bvalid),
+            .s_axi_bready(s_axi_bready),
+            .s_axi_araddr(s_axi_araddr),
+            .s_axi_arprot(s_axi_arprot),
+            .s_axi_arvalid(s_axi_arvalid),
+            .s_axi_arready(s_axi_arready),
+            .s_axi_rdata(s_axi_rdata),
+            .s_axi_rresp(s_axi_rresp),
+            .s_axi_rvalid(s_axi_rvalid),
+            .s_axi_rready(s_axi_rready)
             );
 
-    
-    assign o_dbl = {o_data1, o_data0}; // for input to the fifo
+    generate
+        if (N_CORES == 1) begin : single
+            // instantantiate the dct main block
+            dct_main #(DATA_WIDTH, COEFF_WIDTH, FIRST_STAGE_WIDTH, SECOND_STAGE_WIDTH, QUANT_STAGE_WIDTH, RUNL_STAGE_WIDTH, 2, KERNEL)
+                dct_main(
+                    .i_clk(aclk),
+                    .i_resetn(aresetn),
+                    .wdata({i_data1, i_data0}),
+                    .wen(i_wen),
+                    .rdata({o_data1, o_data0}),
+                    .rsync(o_sync),
+                    .i_qtable(q_table),
+                    .i_qload(q_load),
+                    .o_qpending(q_pending)
+                    );
 
-    // fifo reset is not aresetn
-    assign fifo_rst = !aresetn;
+            assign o_dbl = {o_data1, o_data0}; // for input to the fifo
+            assign array_ready = 0;
 
-    // instantantiate the outptut fifo
-    // also needs to be 32-bit wide now
-    fifo_generator_1 axis_fifo(
-        .clk(aclk),
-        .rst(fifo_rst),
-        .din(o_dbl),
-        .wr_en(o_sync),
-        .rd_en(fifo_rden),
-        .dout(o_fifo),
-        .full(fifo_full),
-        .empty(fifo_empty)
-    );
+            // instantantiate the outptut fifo
+            // also needs to be 32-bit wide now
+            fifo_generator_1 axis_fifo(
+                .clk(aclk),
+                .rst(fifo_rst),
+                .din(o_dbl),
+                .wr_en(o_sync),
+                .rd_en(fifo_rden),
+                .dout(o_fifo),
+                .full(fifo_full),
+                .empty(fifo_empty)
+            );
+        end
+        else begin : multi
+            // the beat goes straight in, the array puts the blocks back in
+            // order and reads like the fifo
+            dct_array #(DATA_WIDTH, COEFF_WIDTH, FIRST_STAGE_WIDTH, SECOND_STAGE_WIDTH, QUANT_STAGE_WIDTH, RUNL_STAGE_WIDTH, N_CORES, IN_LANES, KERNEL)
+                dct_array(
+                    .i_clk(aclk),
+                    .i_resetn(aresetn),
+                    .wdata(s_axis_tdata[IN_LANES*DATA_WIDTH-1 : 0]),
+                    .wen(i_sync),
+                    .o_ready(array_ready),
+                    .rd_en(fifo_rden),
+                    .dout(o_fifo),
+                    .empty(fifo_empty),
+                    .i_qtable(q_table),
+                    .i_qload(q_load),
+                    .o_qpending(q_pending)
+                    );
+
+            assign fifo_full = 0;
+        end
+    endgenerate
 
     /* MASTER INTERFACE */
 
@@ -0,0 +1,271 @@
+`timescale 1ns / 1ps
+//////////////////////////////////////////////////////////////////////////////////
+// Team: HEALTH
+//
+// Module Name: dct_array
+// Description:
+//  N_CORES copies of dct_main behind one input and one output. Blocks of 64
+//  pixels are handed out round-robin, block n going to core n % N_CORES, and
+//  the run-length words are read back from the cores in the same order so
+//  they come out in the order the blocks went in.
+//
+//  Each core has a one block input buffer that takes IN_LANES pixels a cycle
+//  and gives the core two, so N_CORES cores keep up with IN_LANES/2 times
+//  the input of one. On the way out each core writes into its own
+//  fifo_generator_1 and the length of every block it finishes, in beats,
+//  into a small length fifo. The read port works like the fifo, dout is
+//  valid the cycle after rd_en, and only whole blocks are read.
+//
+//  A new quantization table goes to every core, each takes it at the start
+//  of its next block and o_qpending is set until they all have.
+//
+// Last Modified: 2026-10-17
+//
+//////////////////////////////////////////////////////////////////////////////////
+
+module dct_array #(
+    parameter DATA_WIDTH = 8,
+    parameter COEFF_WIDTH = 9,
+    parameter FIRST_STAGE_WIDTH = 21,
+    parameter SECOND_STAGE_WIDTH = 25,
+    parameter QUANT_STAGE_WIDTH = 14,
+    parameter RUNL_STAGE_WIDTH = 16,
+    parameter N_CORES = 2,  // number of dct_main cores
+    parameter IN_LANES = 4, // pixels per input cycle, 2, 4 or 8
+    parameter KERNEL = 0    // DCT kernel of the cores, see dct_stage
+)(
+    input i_clk,
+    input i_resetn,                      // active-low reset
+
+    // writing to this block
+    input [IN_LANES*DATA_WIDTH-1 : 0] wdata, // first pixel in the low bits
+    input wen,  // write enable, only when o_ready
+    output o_ready, // the core taking the current block has room
+
+    // reading from this block, like the output fifo of custom_dct_axis
+    input rd_en,
+    output [RUNL_STAGE_WIDTH*2-1 : 0] dout, // first word in the low bits
+    output empty,
+
+    // loading a new quantization table, see quant_regs
+    input [64*8-1 : 0] i_qtable,
+    input i_qload,
+    output o_qpending
+);
+
+    localparam CORE_WIDTH = N_CORES > 1 ? $clog2(N_CORES) : 1;
+    localparam IN_PAIRS = IN_LANES / 2; // pixel pairs per input cycle
+    localparam IN_DEPTH = 32; // pixel pairs per input buffer, one block
+    localparam LEN_DEPTH = 32; // blocks per length fifo
+    localparam EOF = {RUNL_STAGE_WIDTH{1'b1}};
+
+    /* DISPATCHER */
+    reg [CORE_WIDTH-1 : 0] i_core; // core taking the current block
+    reg [5 : 0] n_pixel_in; // pixels of the current block so far
+    wire [N_CORES-1 : 0] core_room; // the core's input buffer can take an input
+
+    /* COLLECTOR */
+    reg [CORE_WIDTH-1 : 0] o_core; // core whose block is being read
+    reg [CORE_WIDTH-1 : 0] rd_core; // core read on the last rd_en, for dout
+    reg [5 : 0] o_left; // beats of the current block still to read, 0 between blocks
+
+    wire [RUNL_STAGE_WIDTH*2-1 : 0] core_dout [0 : N_CORES-1];
+    wire [5 : 0] core_len [0 : N_CORES-1]; // length of the core's next block
+    wire [N_CORES-1 : 0] core_empty, core_len_empty;
+    wire [N_CORES-1 : 0] core_qpending;
+
+    // the dispatcher waits while the core's buffer can't take a full input
+    assign o_ready = core_room[i_core];
+
+    assign empty = (o_left == 0) ? (core_len_empty[o_core] || core_empty[o_core]) : core_empty[o_core];
+    assign dout = core_dout[rd_core];
+    assign o_qpending = |core_qpending;
+
+    // handle i_core and n_pixel_in
+    // move on to the next core once a block has gone in
+    initial begin
+        i_core = 0;
+        n_pixel_in = 0;
+    end
+    always @(posedge i_clk) begin
+        if (!i_resetn) begin
+            i_core <= 0;
+            n_pixel_in <= 0;
+        end
+        else begin
+            if (wen) begin
+                n_pixel_in <= n_pixel_in + IN_LANES;
+                if (n_pixel_in == 64 - IN_LANES)
+                    i_core <= (i_core == N_CORES-1) ? 0 : i_core + 1;
+            end
+        end
+    end
+
+    genvar g;
+    generate
+        for (g = 0; g < N_CORES; g = g + 1) begin : core
+
+            /* INPUT BUFFER */
+            // written IN_PAIRS pixel pairs at a time by the dispatcher and
+            // read a pair at a time by the core
+            reg [DATA_WIDTH*2-1 : 0] in_buf [0 : IN_DEPTH-1];
+            reg [4 : 0] in_wptr, in_rptr;
+            reg [5 : 0] in_count;
+            reg [DATA_WIDTH*2-1 : 0] core_wdata;
+            reg core_wen;
+            wire buf_wen, buf_ren;
+
+            assign buf_wen = wen && i_core == g;
+            assign buf_ren = (in_count != 0);
+            assign core_room[g] = (in_count <= IN_DEPTH - IN_PAIRS);
+
+            integer p;
+            initial begin
+                in_wptr = 0;
+                in_rptr = 0;
+                in_count = 0;
+                core_wen = 0;
+                core_wdata = 0;
+            end
+            always @(posedge i_clk) begin
+                if (!i_resetn) begin
+                    in_wptr <= 0;
+                    in_rptr <= 0;
+                    in_count <= 0;
+                    core_wen <= 0;
+                end
+                else begin
+                    if (buf_wen) begin
+                        // in_wptr stays a multiple of IN_PAIRS, so this doesn't wrap
+                        for (p = 0; p < IN_PAIRS; p = p + 1) begin
+                            in_buf[in_wptr + p] <= wdata[p*DATA_WIDTH*2 +: DATA_WIDTH*2];
+                        end
+                        in_wptr <= in_wptr + IN_PAIRS;
+                    end
+
+                    // the core takes a pair whenever there is one
+                    core_wen <= buf_ren;
+                    if (buf_ren) begin
+                        core_wdata <= in_buf[in_rptr];
+                        in_rptr <= in_rptr + 1;
+                    end
+
+                    in_count <= in_count + (buf_wen ? IN_PAIRS : 0) - (buf_ren ? 1 : 0);
+                end
+            end
+
+            /* CORE */
+            wire [RUNL_STAGE_WIDTH*2-1 : 0] core_rdata;
+            wire core_rsync, core_eof, core_rden, core_full;
+
+            dct_main #(DATA_WIDTH, COEFF_WIDTH, FIRST_STAGE_WIDTH, SECOND_STAGE_WIDTH, QUANT_STAGE_WIDTH, RUNL_STAGE_WIDTH, 2, KERNEL)
+                dct_main(
+                    .i_clk(i_clk),
+                    .i_resetn(i_resetn),
+                    .wdata(core_wdata),
+                    .wen(core_wen),
+                    .rdata(core_rdata),
+                    .rsync(core_rsync),
+                    .i_qtable(i_qtable),
+                    .i_qload(i_qload),
+                    .o_qpending(core_qpending[g])
+                    );
+
+            /* OUTPUT FIFO */
+            assign core_rden = rd_en && o_core == g;
+            // either word can be the EOF, anything after it is padding
+            assign core_eof = (core_rdata[RUNL_STAGE_WIDTH-1 : 0] == EOF || core_rdata[RUNL_STAGE_WIDTH*2-1 : RUNL_STAGE_WIDTH] == EOF);
+
+            // needs to be 32-bit wide, same as the one in custom_dct_axis
+            fifo_generator_1 axis_fifo(
+                .clk(i_clk),
+                .rst(!i_resetn),
+                .din(core_rdata),
+                .wr_en(core_rsync),
+                .rd_en(core_rden),
+                .dout(core_dout[g]),
+                .full(core_full),
+                .empty(core_empty[g])
+            );
+
+            /* BLOCK LENGTHS */
+            reg [5 : 0] blk_len [0 : LEN_DEPTH-1];
+            reg [4 : 0] len_wptr, len_rptr;
+            reg [5 : 0] n_beats; // beats of the block being written
+
+            assign core_len[g] = blk_len[len_rptr];
+            assign core_len_empty[g] = (len_wptr == len_rptr);
+
+            // handle the block lengths
+            // count the beats written and push the count at the EOF
+            initial begin
+                len_wptr = 0;
+                n_beats = 0;
+            end
+            always @(posedge i_clk) begin
+                if (!i_resetn) begin
+                    len_wptr <= 0;
+                    n_beats <= 0;
+                end
+                else begin
+                    if (core_rsync && core_eof) begin
+                        blk_len[len_wptr] <= n_beats + 1;
+                        len_wptr <= len_wptr + 1;
+                        n_beats <= 0;
+                    end
+                    else if (core_rsync) begin
+                        n_beats <= n_beats + 1;
+                    end
+                end
+            end
+
+            // handle len_rptr
+            // a length is used up when the first beat of its block is read
+            initial len_rptr = 0;
+            always @(posedge i_clk) begin
+                if (!i_resetn) begin
+                    len_rptr <= 0;
+                end
+                else begin
+                    if (core_rden && o_left == 0)
+                        len_rptr <= len_rptr + 1;
+                end
+            end
+        end
+    endgenerate
+
+    /* COLLECTOR */
+
+    // handle o_left and o_core
+    // start a block on its first read, move to the next core after its last
+    initial begin
+        o_core = 0;
+        rd_core = 0;
+        o_left = 0;
+    end
+    always @(posedge i_clk) begin
+        if (!i_resetn) begin
+            o_core <= 0;
+            rd_core <= 0;
+            o_left <= 0;
+        end
+        else begin
+            if (rd_en) begin
+                rd_core <= o_core;
+                if ((o_left == 0 && core_len[o_core] == 1) || o_left == 1) begin
+                    // last beat of the block, the next block is on the next core
+                    o_left <= 0;
+                    o_core <= (o_core == N_CORES-1) ? 0 : o_core + 1;
+                end
+                else if (o_left == 0) begin
+                    // first beat of the block
+                    o_left <= core_len[o_core] - 1;
+                end
+                else begin
+                    o_left <= o_left - 1;
+                end
+            end
+        end
+    end
+
+endmodule
@@ -6,8 +6,12 @@
 // Module Name: dct_main
 // Description:
 //  Coordinates the two 1D DCT stages and the transpose buffer
+//  LANES sets how many pixels go in and words come out per cycle, 2, 4 or 8.
+//  A block takes 64/LANES cycles at every stage
+//  KERNEL picks the 1D DCT of both stages, see dct_stage
+//  The quantization table can be swapped between blocks, see quant_stage
 //
-// Last Modified: 2021-03-22
+// Last Modified: 2026-10-17
 //
 //////////////////////////////////////////////////////////////////////////////////
 
@@ -18,18 +22,25 @@ module dct_main #(
     parameter FIRST_STAGE_WIDTH = 21,
     parameter SECOND_STAGE_WIDTH = 25,
     parameter QUANT_STAGE_WIDTH = 14,
-    parameter RUNL_STAGE_WIDTH = 16
+    parameter RUNL_STAGE_WIDTH = 16,
+    parameter LANES = 2, // pixels per cycle, 2, 4 or 8
+    parameter KERNEL = 0 // 0: coefficient matrix, 1: fast (Loeffler)
 )(
     input i_clk,
     input i_resetn,                      // active-low reset
 
     // writing to this block
-    input [DATA_WIDTH-1 : 0] wdata0, wdata1,
+    input [LANES*DATA_WIDTH-1 : 0] wdata, // first pixel in the low bits
     input wen,  // write enable
 
     // reading from this block
-    output [RUNL_STAGE_WIDTH-1 : 0] rdata0, rdata1,
-    output rsync // tell the output that we're 
+    output [LANES*RUNL_STAGE_WIDTH-1 : 0] rdata, // first word in the low bits
+    output rsync, // tell the output that we're 
+
+    // loading a new quantization table, see quant_regs
+    input [64*8-1 : 0] i_qtable,
+    input i_qload,
+    output o_qpending
 );
     
     localparam ADDR_WIDTH = 6; // this is fixed
@@ -41,110 +52,98 @@ module dct_main #(
     wire q_stage_osync, zz_stage_osync, rl_stage_osync;
 
     // inputs to first stage
-    wire [DATA_WIDTH-1 : 0] f_stage_p0, f_stage_p1;
+    wire [LANES*DATA_WIDTH-1 : 0] f_stage_p;
     // outputs from first stage
-    wire [FIRST_STAGE_WIDTH-1 : 0] f_stage_c0, f_stage_c1;
+    wire [LANES*FIRST_STAGE_WIDTH-1 : 0] f_stage_c;
     // inputs to second stage
-    wire [FIRST_STAGE_WIDTH-1 : 0] s_stage_p0, s_stage_p1;
+    wire [LANES*FIRST_STAGE_WIDTH-1 : 0] s_stage_p;
     // outputs from second stage
-    wire [SECOND_STAGE_WIDTH-1 : 0] s_stage_c0, s_stage_c1;
+    wire [LANES*SECOND_STAGE_WIDTH-1 : 0] s_stage_c;
     // outpus from the quantization stage
-    wire [QUANT_STAGE_WIDTH-1 : 0] q_stage_q0, q_stage_q1;
+    wire [LANES*QUANT_STAGE_WIDTH-1 : 0] q_stage_q;
     // outputs from the zig-zag stage
-    wire [QUANT_STAGE_WIDTH-1 : 0] zz_stage_c0, zz_stage_c1;
+    wire [LANES*QUANT_STAGE_WIDTH-1 : 0] zz_stage_c;
     // outputs from the run-length encoder
-    wire [RUNL_STAGE_WIDTH-1 : 0] rl_stage_c0, rl_stage_c1;
+    wire [LANES*RUNL_STAGE_WIDTH-1 : 0] rl_stage_c;
     
     // assign the outputs
     // eventually will be the output of the run-length stage
-//    assign rdata0 = q_stage_q0;
-//    assign rdata1 = q_stage_q1;
+//    assign rdata = q_stage_q;
 //    assign rsync = q_stage_osync;
-    assign rdata0 = rl_stage_c0;
-    assign rdata1 = rl_stage_c1;
+    assign rdata = rl_stage_c;
     assign rsync = rl_stage_osync;
     
     // assign the inputs
-    assign f_stage_p0 = wdata0;
-    assign f_stage_p1 = wdata1;
+    assign f_stage_p = wdata;
     assign f_stage_ivld = wen;
 
     // init the first stage, performing DCT row operations  
-    dct_stage #(DATA_WIDTH, FIRST_STAGE_WIDTH, COEFF_WIDTH, 1) 
+    dct_stage #(DATA_WIDTH, FIRST_STAGE_WIDTH, COEFF_WIDTH, 1, LANES, KERNEL) 
         dct_row(  
             // inputs
-            .i_p0(f_stage_p0),
-            .i_p1(f_stage_p1),
+            .i_p(f_stage_p),
             .i_clk(i_clk), 
             .i_resetn(i_resetn), 
             .i_vld(f_stage_ivld), 
             // outputs
-            .o_c0(f_stage_c0),
-            .o_c1(f_stage_c1),
+            .o_c(f_stage_c),
             .o_sync(f_stage_osync));
 
     // instantantiate the transpose buffer
     // TODO: check this
-	two_wide_transpose_buf #(FIRST_STAGE_WIDTH, ADDR_WIDTH)
+	two_wide_transpose_buf #(FIRST_STAGE_WIDTH, ADDR_WIDTH, LANES)
         transpose_buf(
             .i_clk(i_clk),
             .i_resetn(i_resetn),
-            .wdata0(f_stage_c0),
-            .wdata1(f_stage_c1),
+            .wdata(f_stage_c),
             .wen(f_stage_osync),
-            .rdata0(s_stage_p0),
-            .rdata1(s_stage_p1),
+            .rdata(s_stage_p),
             .rsync(s_stage_ivld)
             );
 
     // init the second stage, performing DCT column operations
-    dct_stage #(FIRST_STAGE_WIDTH, SECOND_STAGE_WIDTH, COEFF_WIDTH, 0) 
+    dct_stage #(FIRST_STAGE_WIDTH, SECOND_STAGE_WIDTH, COEFF_WIDTH, 0, LANES, KERNEL) 
         dct_col(  
             // inputs
-            .i_p0(s_stage_p0),
-            .i_p1(s_stage_p1),
+            .i_p(s_stage_p),
             .i_clk(i_clk), 
             .i_resetn(i_resetn), 
             .i_vld(s_stage_ivld), 
             // outputs
-            .o_c0(s_stage_c0),
-            .o_c1(s_stage_c1),
+            .o_c(s_stage_c),
             .o_sync(s_stage_osync));
 
     // init the output quantization stage
-    quant_stage #(SECOND_STAGE_WIDTH, QUANT_STAGE_WIDTH)
+    quant_stage #(SECOND_STAGE_WIDTH, QUANT_STAGE_WIDTH, LANES, KERNEL)
         quant(
             // inputs
-            .i_c0(s_stage_c0),
-            .i_c1(s_stage_c1),
+            .i_c(s_stage_c),
             .i_clk(i_clk),
             .i_resetn(i_resetn),
             .i_vld(s_stage_osync),
+            .i_qtable(i_qtable),
+            .i_qload(i_qload),
             //outputs
-            .o_q0(q_stage_q0),
-            .o_q1(q_stage_q1),
+            .o_q(q_stage_q),
+            .o_qpending(o_qpending),
             .o_sync(q_stage_osync));
 
-    zig_zag_stage #(QUANT_STAGE_WIDTH, 6)
+    zig_zag_stage #(QUANT_STAGE_WIDTH, 6, LANES)
         zz_stage(
             .i_clk(i_clk),
             .i_resetn(i_resetn),
-            .wdata0(q_stage_q0), 
-            .wdata1(q_stage_q1),
+            .wdata(q_stage_q), 
             .wen(q_stage_osync),
-            .rdata0(zz_stage_c0),
-            .rdata1(zz_stage_c1),
+            .rdata(zz_stage_c),
             .rsync(zz_stage_osync));
 
-    run_length_stage #(QUANT_STAGE_WIDTH, RUNL_STAGE_WIDTH)
+    run_length_stage #(QUANT_STAGE_WIDTH, RUNL_STAGE_WIDTH, LANES)
         rl_stage(
             .i_clk(i_clk),
             .i_resetn(i_resetn),
-            .i_data0(zz_stage_c0),
-            .i_data1(zz_stage_c1),
+            .i_data(zz_stage_c),
             .wen(zz_stage_osync),
-            .o_data0(rl_stage_c0),
-            .o_data1(rl_stage_c1),
+            .o_data(rl_stage_c),
             .rsync(rl_stage_osync)
         );
     
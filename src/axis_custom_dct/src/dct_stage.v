@@ -6,8 +6,21 @@
 // Module Name: dct_stage
 // Description:
 //  Single 1-D DCT stage. Feed it some pixels and get coeffs out (hopefully)
+//  A row of 8 goes in and comes out LANES values per cycle (2, 4 or 8), so
+//  a row takes 8/LANES cycles. The multipliers scale with it, each output
+//  coefficient adds up LANES/2 products per cycle
 //
-// Last Modified: 2021-03-16
+//  KERNEL = 1 swaps the coefficient matrix for Loeffler's flow graph, done
+//  as four rotations of three multiplies each, with the 12 constants of
+//  fast_coeff.mem: the odd part by 3pi/16 and pi/16, the even part by 2pi/16
+//  and sqrt(2) times two odd butterflies. The rotations share multipliers
+//  across the cycles of a row the same way the matrix products do, 3 or 6
+//  multipliers for 2 or 4 lanes. With 8 lanes the sqrt(2) one is two
+//  multiplies on the way out, 11 in all. The matrix needs 8, 16 or 32. The
+//  coefficients come out sqrt(2) bigger than with the matrix, see
+//  python/dct_kernel_compare.py
+//
+// Last Modified: 2026-10-17
 //
 //////////////////////////////////////////////////////////////////////////////////
 
@@ -15,11 +28,13 @@ module dct_stage #(
     parameter DATA_WIDTH = 8,       // pixel bit depth
     parameter OUTPUT_WIDTH = 12,    // output coefficient width
     parameter COEFF_WIDTH = 9,      // coefficient bit width
-    parameter INPUT_SHIFT = 0       // whether to shift the input
+    parameter INPUT_SHIFT = 0,      // whether to shift the input
+    parameter LANES = 2,            // values per cycle, 2, 4 or 8
+    parameter KERNEL = 0            // 0 for the coefficient matrix, 1 for the fast (Loeffler) kernel
 ) (
 //    old 
 //    input [DATA_WIDTH-1 : 0] i_p0, i_p1, i_p2, i_p3, i_p4, i_p5, i_p6, i_p7,    // input pixel stream
-    input signed [DATA_WIDTH-1 : 0] i_p0, i_p1, // input pixel stream
+    input [LANES*DATA_WIDTH-1 : 0] i_p, // input pixel stream, first pixel in the low bits
 
     input i_clk,                   // input clock
     input i_vld,                   // signal indicating that the input is valid
@@ -27,30 +42,44 @@ module dct_stage #(
 //    old
 //    output signed [OUTPUT_WIDTH-1 : 0] o_c0, o_c1, o_c2, o_c3, o_c4, o_c5, o_c6, o_c7,
 
-    output signed [OUTPUT_WIDTH-1 : 0] o_c0, o_c1,
+    output [LANES*OUTPUT_WIDTH-1 : 0] o_c, // output coefficients, same order as i_p
     
     output o_sync                 // sync signal indicating that new data can be input
 //    old
 //    output o_vld                   // signal indicating that the output is valid
 );
 
+    localparam ROW_CYCLES = 8 / LANES; // cycles to take in or put out a row
+    localparam MULT_TERMS = LANES / 2; // products added per output per cycle
+    localparam N_ROT = (ROW_CYCLES == 1) ? 3 : 4 / ROW_CYCLES; // rotations per cycle of the fast kernel
+    localparam FRAC = COEFF_WIDTH - 1; // fraction bits of the fast kernel constants
+
     // register definitions
 
     reg [2 : 0] n_in, n_out, n_mult;            // indicate the number of inputs, outputs, and mults
-    reg addsum_vld, olatch_vld, olatch_rdy, r_o_sync;       // indicate whether we've latched addsum
+    reg addsum_vld, mult_vld, acc_done, r_o_sync;       // indicate whether we've latched addsum, mults, a row's sums
 
     reg signed [DATA_WIDTH : 0] i_latch [0:7];                // shifted input latch
     reg signed [DATA_WIDTH : 0] addsub [0:7];                   // additions and subtractions
     reg signed [DATA_WIDTH+COEFF_WIDTH+3 : 0] mult [0:7];    // multiplies
     reg signed [DATA_WIDTH+COEFF_WIDTH+3 : 0] acc [0:7];     // accumulates
     reg signed [DATA_WIDTH+COEFF_WIDTH+3 : 0] o_latch [0:7];    // output latches
-    reg signed [DATA_WIDTH+COEFF_WIDTH+3 : 0] r_oc0, r_oc1;     // output buffers 
+    reg signed [DATA_WIDTH+COEFF_WIDTH+3 : 0] r_oc [0:LANES-1];  // output buffers
+    wire signed [DATA_WIDTH+COEFF_WIDTH+3 : 0] mult_sum [0:7];   // products for this cycle
+    wire signed [DATA_WIDTH+COEFF_WIDTH+3 : 0] acc_out [0:7];    // accumulators on their way to the output latches
+    wire signed [DATA_WIDTH+COEFF_WIDTH+3 : 0] bfly [4:7];       // butterflies of the fast kernel's odd rotations
+    wire [2 : 0] m_group;   // which products of the row n_mult is on
+    wire [2 : 0] in_lane0;  // where the first input lane latches
+    wire [2 : 0] out_lane0; // which output latch goes out of the first output lane
 
     reg signed [COEFF_WIDTH-1 : 0] ram_coeff [0 : 31];   // 16 matrix coefficients
     initial begin
         $readmemh("ram_coeff.mem", ram_coeff, 0, 31);
     end
 
+    // the biggest fast kernel constant is 1.85, it needs the extra bit
+    reg signed [COEFF_WIDTH : 0] fast_coeff [0 : 11];   // 3 per rotation, see python/coeff_gen.py
+
     // assign the output signals
     assign o_sync = r_o_sync;
 
@@ -65,8 +94,18 @@ module dct_stage #(
 //    assign i_pshift[7] = i_p7 - 127;
 
     // output latches, plus bus width shifting
-    assign o_c0 = r_oc0[DATA_WIDTH + COEFF_WIDTH + 3  :  DATA_WIDTH + COEFF_WIDTH + 3 - (OUTPUT_WIDTH - 1)];
-    assign o_c1 = r_oc1[DATA_WIDTH + COEFF_WIDTH + 3  :  DATA_WIDTH + COEFF_WIDTH + 3 - (OUTPUT_WIDTH - 1)];
+    genvar g;
+    generate
+        for (g = 0; g < LANES; g = g + 1) begin : out_lane
+            assign o_c[g*OUTPUT_WIDTH +: OUTPUT_WIDTH] = r_oc[g][DATA_WIDTH + COEFF_WIDTH + 3  :  DATA_WIDTH + COEFF_WIDTH + 3 - (OUTPUT_WIDTH - 1)];
+        end
+    endgenerate
+
+    // the counters run 1 to ROW_CYCLES while busy, ROW_CYCLES being the first
+    // cycle of a row as well as the last
+    assign m_group = (n_mult == ROW_CYCLES) ? 0 : n_mult;
+    assign in_lane0 = (n_in == ROW_CYCLES) ? 0 : LANES * n_in;
+    assign out_lane0 = (n_out == 0) ? 0 : LANES * (n_out - 1);
     
 //    assign o_c2 = r_out[2][DATA_WIDTH + COEFF_WIDTH + 3  :  DATA_WIDTH + COEFF_WIDTH + 3 - (OUTPUT_WIDTH - 1)];
 //    assign o_c3 = r_out[3][DATA_WIDTH + COEFF_WIDTH + 3  :  DATA_WIDTH + COEFF_WIDTH + 3 - (OUTPUT_WIDTH - 1)];
@@ -85,15 +124,15 @@ module dct_stage #(
             n_in <= 0;
         end
         else begin
-            if (i_vld && n_in < 4) begin
+            if (i_vld && n_in < ROW_CYCLES) begin
                 // if we're not done latching keep counting
                 n_in <= n_in + 1;
             end
-            else if (i_vld && n_in == 4) begin
+            else if (i_vld && n_in == ROW_CYCLES) begin
                 // if we're done latching, get ready to loop
                 n_in <= 1;
             end
-            else if (~i_vld && n_in == 4) begin
+            else if (~i_vld && n_in == ROW_CYCLES) begin
                 // go back to zero if the input isn't currently valid
                 n_in <= 0;
             end
@@ -106,7 +145,7 @@ module dct_stage #(
     
     
     // handle the input latches i_latch
-    // i_latch should take every two inputs and latch them for use later
+    // i_latch should take every LANES inputs and latch them for use later
     integer a;
     initial begin
         for (a=0; a < 8; a=a+1) i_latch[a] = 0;
@@ -118,26 +157,14 @@ module dct_stage #(
             end
         end
         else begin
-            if (i_vld && n_in != 4) begin
-                // if the input is valid, latch the input depending on the state of n_mult
-                if (INPUT_SHIFT) begin
-                    i_latch[2*n_in + 0] <= i_p0 - 2**(DATA_WIDTH-1);
-                    i_latch[2*n_in + 1] <= i_p1 - 2**(DATA_WIDTH-1);
-                end
-                else begin
-                    i_latch[2*n_in + 0] <= i_p0;
-                    i_latch[2*n_in + 1] <= i_p1;
-                end                  
-            end
-            else if (i_vld && n_in == 4) begin
-                // done latching, go back to the first two
-                if (INPUT_SHIFT) begin
-                    i_latch[0] <= i_p0 - 2**(DATA_WIDTH-1);
-                    i_latch[1] <= i_p1 - 2**(DATA_WIDTH-1);
-                end
-                else begin
-                    i_latch[0] <= i_p0;
-                    i_latch[1] <= i_p1;
+            if (i_vld) begin
+                // if the input is valid, latch the input depending on the state of n_in
+                // once we're done latching in_lane0 goes back to the first ones
+                for (a=0; a < LANES; a=a+1) begin
+                    if (INPUT_SHIFT)
+                        i_latch[in_lane0 + a] <= $signed(i_p[a*DATA_WIDTH +: DATA_WIDTH]) - 2**(DATA_WIDTH-1);
+                    else
+                        i_latch[in_lane0 + a] <= $signed(i_p[a*DATA_WIDTH +: DATA_WIDTH]);
                 end
             end
         end
@@ -155,11 +182,11 @@ module dct_stage #(
             addsum_vld <= 0;
         end
         else begin
-            if (~addsum_vld && n_in == 4) begin
+            if (~addsum_vld && n_in == ROW_CYCLES) begin
                 // if we're not already valid and n_in is done, we're valid
                 addsum_vld <= 1; 
             end
-            else if(addsum_vld && n_mult == 3 && n_in != 4) begin
+            else if(addsum_vld && m_group == ROW_CYCLES-1 && n_in != ROW_CYCLES) begin
                 // if we're done multiplying but an input is not ready to add/subtract, clear addsum
                 addsum_vld <= 0;
             end
@@ -185,7 +212,7 @@ module dct_stage #(
             end
         end
         else begin
-            if (n_in == 4) begin
+            if (n_in == ROW_CYCLES) begin
                 // if we're done latching input, add and subtract
                 for (i=0; i < 4; i=i+1) begin
                     addsub[i] <= i_latch[i] + i_latch[7-i];
@@ -211,25 +238,122 @@ module dct_stage #(
             n_mult <= 0;
         end
         else begin
-            if (addsum_vld && n_mult < 4) begin
+            if (addsum_vld && n_mult < ROW_CYCLES) begin
                 // adds and subtracts are valid, increment
                 n_mult <= n_mult + 1;
             end
-            else if (addsum_vld && n_mult == 4) begin
+            else if (addsum_vld && n_mult == ROW_CYCLES) begin
                 // done multiplying, still valid, go back to 1
                 n_mult <= 1;
             end
             else begin
-                // adds and subtracts not valid, or became valid and somehow n_mult > 4
+                // adds and subtracts not valid, or became valid and somehow n_mult > ROW_CYCLES
                 n_mult <= 0;
             end            
         end
     end
 
 
+    // the products for this cycle, group m_group of the MULT_TERMS wide
+    // groups of addsub terms. n_mult == 0 or n_mult == ROW_CYCLES is group 0
+    genvar m, t, r;
+    generate
+        if (KERNEL == 0) begin : matrix
+            for (m = 0; m < 8; m = m + 1) begin : mac
+                // the lower half takes the sums, the upper half the differences
+                wire signed [DATA_WIDTH+COEFF_WIDTH+3 : 0] part [0 : MULT_TERMS];
+                assign part[0] = 0;
+                for (t = 0; t < MULT_TERMS; t = t + 1) begin : term
+                    assign part[t+1] = part[t] + ram_coeff[4*m + MULT_TERMS*m_group + t] * addsub[4*(m/4) + MULT_TERMS*m_group + t];
+                end
+                assign mult_sum[m] = part[MULT_TERMS];
+                assign acc_out[m] = acc[m];
+            end
+        end
+        else begin : fast
+            // the four rotations, or slots, of a row are handed out N_ROT to a
+            // cycle: the odd part by 3pi/16 and pi/16, the even part by 2pi/16,
+            // then sqrt(2) times the odd butterflies, which needs the first two
+            // done. Each gives two values, at 2**FRAC scale
+            wire signed [DATA_WIDTH+COEFF_WIDTH+3 : 0] even [0:3];
+            wire signed [DATA_WIDTH+COEFF_WIDTH+3 : 0] rot_u [0:3];
+            wire signed [DATA_WIDTH+COEFF_WIDTH+3 : 0] rot_v [0:3];
+
+            initial begin
+                $readmemh("fast_coeff.mem", fast_coeff, 0, 11);
+            end
+
+            assign even[0] = addsub[0] + addsub[3];
+            assign even[1] = addsub[1] + addsub[2];
+            assign even[2] = addsub[1] - addsub[2];
+            assign even[3] = addsub[0] - addsub[3];
+
+            assign bfly[4] = acc[4] + acc[6];
+            assign bfly[5] = acc[7] - acc[5];
+            assign bfly[6] = acc[4] - acc[6];
+            assign bfly[7] = acc[7] + acc[5];
+
+            assign rot_u[0] = addsub[7];
+            assign rot_v[0] = addsub[4];
+            assign rot_u[1] = addsub[6];
+            assign rot_v[1] = addsub[5];
+            assign rot_u[2] = even[3];
+            assign rot_v[2] = even[2];
+            if (ROW_CYCLES == 2) begin : sqrt2_mult
+                // the odd rotations only reach acc at the end of this cycle,
+                // take them from the mults
+                assign rot_u[3] = mult[0] - mult[3];
+                assign rot_v[3] = mult[1] - mult[2];
+            end
+            else begin : sqrt2_acc
+                assign rot_u[3] = bfly[6];
+                assign rot_v[3] = bfly[5];
+            end
+
+            for (r = 0; r < N_ROT; r = r + 1) begin : rot
+                // three multiplies, o1 = u*C + v*S and o2 = v*C - u*S
+                wire [2 : 0] slot;
+                wire signed [DATA_WIDTH+2*COEFF_WIDTH+4 : 0] p, o1, o2;
+                assign slot = N_ROT*m_group + r;
+                assign p = fast_coeff[3*slot] * (rot_u[slot] + rot_v[slot]);
+                assign o1 = p + fast_coeff[3*slot + 1] * rot_v[slot];
+                assign o2 = p - fast_coeff[3*slot + 2] * rot_u[slot];
+                // the sqrt(2) slot multiplies values that are already scaled
+                assign mult_sum[2*r] = (slot == 3) ? o1 >>> FRAC : o1;
+                assign mult_sum[2*r + 1] = (slot == 3) ? o2 >>> FRAC : o2;
+            end
+            for (r = 2*N_ROT; r < 6; r = r + 1) begin : unused
+                assign mult_sum[r] = 0;
+            end
+            // the even outputs that don't need a multiply
+            assign mult_sum[6] = (even[0] + even[1]) <<< FRAC;
+            assign mult_sum[7] = (even[0] - even[1]) <<< FRAC;
+
+            for (m = 0; m < 4; m = m + 1) begin : even_out
+                assign acc_out[m] = acc[m];
+            end
+            if (ROW_CYCLES == 1) begin : last_slot
+                // a row every cycle leaves no cycle for the sqrt(2) slot, it's
+                // done on the way to the output latches instead
+                wire signed [DATA_WIDTH+2*COEFF_WIDTH+4 : 0] p5, p6;
+                assign p5 = fast_coeff[10] * bfly[5];
+                assign p6 = fast_coeff[10] * bfly[6];
+                assign acc_out[4] = bfly[7] + bfly[4];
+                assign acc_out[5] = p5 >>> FRAC;
+                assign acc_out[6] = p6 >>> FRAC;
+                assign acc_out[7] = bfly[7] - bfly[4];
+            end
+            else begin : odd_out
+                for (m = 4; m < 8; m = m + 1) begin : acc_odd
+                    assign acc_out[m] = acc[m];
+                end
+            end
+        end
+    endgenerate
+
     // handle the mults
     // if addsum is valid we should multiply and accumulate
-    // if n_mult == 0 or n_mult == 4 we should reset the accumulator
+    // if n_mult == 0 or n_mult == ROW_CYCLES we should reset the accumulator
     integer j;
     initial begin
         for(j=0; j<8; j=j+1) begin
@@ -244,25 +368,26 @@ module dct_stage #(
             end
         end
         else begin
-            if (addsum_vld && (n_mult == 0 || n_mult == 4)) begin
-                // reset the accumulators and calc the new value
-                for (j=0; j < 4; j=j+1) begin
-                    // lower half
-                    mult[j] <= ram_coeff[4*j] * addsub[0];
-                    // upper half
-                    mult[j+4] <= ram_coeff[4*(j+4)] * addsub[4];
-                end
-            end
-            else if (addsum_vld && ~(n_mult == 0 || n_mult == 4)) begin
-                // normal cycle, multiply and accumulate
-                for (j=0; j < 4; j=j+1) begin
-                    mult[j] <= ram_coeff[4*j + n_mult] * addsub[n_mult];
-                    mult[j+4] <= ram_coeff[4*(j+4) + n_mult] * addsub[n_mult + 4];
+            if (addsum_vld) begin
+                // multiply, mult_sum picks the terms for this cycle
+                for (j=0; j < 8; j=j+1) begin
+                    mult[j] <= mult_sum[j];
                 end
             end
         end
     end
     
+    // handle mult_vld
+    // the mults hold products the cycle after addsum_vld, this lets the last
+    // products of a row go into the accumulators when no row follows it
+    initial mult_vld = 0;
+    always @(posedge i_clk) begin
+        if (~i_resetn)
+            mult_vld <= 0;
+        else
+            mult_vld <= addsum_vld;
+    end
+
     integer b;
     initial begin
         for(b=0; b<8; b=b+1) begin
@@ -277,54 +402,61 @@ module dct_stage #(
             end
         end
         else begin
-            if (addsum_vld && n_mult == 1) begin
+            if (KERNEL == 0 && mult_vld && n_mult == 1) begin
                 // reset the accumulators and calc the new value
                 for (j=0; j < 8; j=j+1) begin
                     acc[j] <= mult[j];
                 end
             end
-            else if (addsum_vld && !(n_mult == 1)) begin
+            else if (KERNEL == 0 && mult_vld && !(n_mult == 1)) begin
                 // normal cycle, multiply and accumulate
                 for (j=0; j < 8; j=j+1) begin
                     acc[j] <= acc[j] + mult[j];
                 end
             end
+            else if (KERNEL == 1 && mult_vld) begin
+                // fast kernel, each slot writes its own two accumulators
+                // acc[4..7] hold the odd rotations until the sqrt(2) slot
+                if (n_mult == 1) begin
+                    acc[0] <= mult[6];
+                    acc[2] <= mult[7];
+                end
+                for (j=0; j < N_ROT; j=j+1) begin
+                    case (N_ROT*(n_mult - 1) + j)
+                        0: begin
+                            acc[4] <= mult[2*j];
+                            acc[7] <= mult[2*j + 1];
+                        end
+                        1: begin
+                            acc[5] <= mult[2*j];
+                            acc[6] <= mult[2*j + 1];
+                        end
+                        2: begin
+                            acc[1] <= mult[2*j];
+                            acc[3] <= -mult[2*j + 1];
+                        end
+                        3: begin
+                            acc[4] <= bfly[7] + bfly[4];
+                            acc[5] <= mult[2*j];
+                            acc[6] <= mult[2*j + 1];
+                            acc[7] <= bfly[7] - bfly[4];
+                        end
+                    endcase
+                end
+            end
         end
     end
         
-    // handle olatch_rdy
-    // olatch_rdy should go high when there is a valid multiply
-    initial olatch_rdy = 0;
+    // handle acc_done
+    // acc_done goes high for a cycle once the accumulators hold a whole row
+    initial acc_done = 0;
     always @(posedge i_clk) begin
-        if (!i_resetn) begin
-            // reset the output latch
-            olatch_rdy <= 0;
-        end
-        else begin
-            if (~olatch_rdy && n_mult == 4) begin
-                // we're latching the output
-                olatch_rdy <= 1;
-            end
-            else if (olatch_rdy && n_out == 2 && n_mult != 4) begin
-                // if we're done latching but not ready to re-latch, reset
-                olatch_rdy <= 0;
-            end
-            else begin
-                olatch_rdy <= olatch_rdy;
-            end
-        end
+        if (!i_resetn)
+            acc_done <= 0;
+        else
+            acc_done <= mult_vld && n_mult == ROW_CYCLES;
     end
-    
-    // handle olatch_vld
-    // should go high when there is a valid accumulate
-    initial olatch_vld = 0;
-    always @(posedge i_clk) begin
-        if (!i_resetn) 
-            olatch_vld <= 0;
-        else 
-            olatch_vld <= olatch_rdy;
-     end
-     
+
     // handle the output latching
     integer k;
     initial begin
@@ -338,12 +470,12 @@ module dct_stage #(
            end 
         end
         else begin
-            if (n_mult == 1) begin
+            if (acc_done) begin
                 // done the required number of multiplies and accumulates, latch the output
                 for (k=0; k < 4; k=k+1) begin
                     // need to alternate even and odd coefficients
-                    o_latch[2*k]     <= acc[k];
-                    o_latch[2*k + 1] <= acc[4 + k];
+                    o_latch[2*k]     <= acc_out[k];
+                    o_latch[2*k + 1] <= acc_out[4 + k];
                 end
             end
             else begin
@@ -358,22 +490,22 @@ module dct_stage #(
     
     
     // handle n_out
-    // n_out should increment as long as we have some valid output latched
-    // n_out should wrap if we get new output ready
+    // n_out counts the cycles a latched row goes out on, 1 to ROW_CYCLES
+    // a new row can only be latched after the last one is out
     initial n_out = 0;
     always @(posedge i_clk) begin
         if (~i_resetn) begin
             n_out <= 0;
         end 
         else begin
-            if (olatch_vld && n_out < 4) begin
+            if (acc_done) begin
+                // new output latched, start from the first ones
+                n_out <= 1;
+            end
+            else if (n_out != 0 && n_out < ROW_CYCLES) begin
                 // latched output valid, keep counting
                 n_out <= n_out + 1;
             end
-            else if (olatch_vld && n_out == 4) begin
-                // if we're done latching, get ready to loop
-                n_out <= 1;
-            end
             else begin
                 // in any other case just reset
                 n_out <= 0;
@@ -382,25 +514,23 @@ module dct_stage #(
     end
     
     
-    // handle r_oc0 and r_oc1
+    // handle r_oc
     // the absolute accuracy of these don't matter since we have o_sync to indicate output is ready
-    initial r_oc0 = 0;
-    initial r_oc1 = 0;
+    integer c;
+    initial begin
+        for (c=0; c < LANES; c=c+1) r_oc[c] = 0;
+    end
     always @(posedge i_clk) begin
         if (~i_resetn) begin
-            r_oc0 <= 0;
-            r_oc1 <= 0;
+            for (c=0; c < LANES; c=c+1) begin
+                r_oc[c] <= 0;
+            end
         end
         else begin
-            if (n_out != 4) begin
-                // always latch the output depending on the state of n_out
-                r_oc0 <= o_latch[2*n_out + 0];
-                r_oc1 <= o_latch[2*n_out + 1];
-            end
-            else if (n_out == 4) begin
-                // done shifting, go back to the first two
-                r_oc0 <= o_latch[0];
-                r_oc1 <= o_latch[1];
+            // always latch the output depending on the state of n_out
+            // once we're done shifting out_lane0 goes back to the first ones
+            for (c=0; c < LANES; c=c+1) begin
+                r_oc[c] <= o_latch[out_lane0 + c];
             end
         end
     end
@@ -416,8 +546,8 @@ module dct_stage #(
             r_o_sync <= 0;
         end
         else begin
-            if (olatch_vld) begin
-                // if olatch_vld is high (on this cycle) set o_sync high
+            if (n_out != 0) begin
+                // if a row is going out (on this cycle) set o_sync high
                 r_o_sync <= 1;
             end
             else begin
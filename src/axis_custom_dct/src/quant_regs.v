@@ -0,0 +1,216 @@
+`timescale 1ns / 1ps
+//////////////////////////////////////////////////////////////////////////////////
+// Team: HEALTH
+//
+// Module Name: quant_regs
+// Description:
+//  AXI-Lite registers for loading a new quantization table at runtime.
+//  The table is 64 right shifts, the same as quant_coeff.mem, and starts out
+//  as quant_coeff.mem. The firmware writes the shifts four to a word and
+//  then sets QUANT_CTRL_LOAD, every quant_stage takes the table at the start
+//  of its next block and QUANT_CTRL_PENDING stays set until they all have.
+//  Table writes are dropped while a load is pending so a block never sees
+//  half a table. Shifts below 3 overflow the quantizer output, the firmware
+//  (dct_quant.c) keeps them in range.
+//
+//  Register map, byte addresses:
+//   0x00 QUANT_CTRL   write bit 0 to load the table, bit 0 reads as pending
+//   0x40 QUANT_TABLE  16 words, entry 4*n + b in byte b of word n
+//
+//  The AXI handshake is the one from the Vivado AXI-Lite slave template, it
+//  runs on the stream clock
+//
+// Last Modified: 2026-10-17
+//
+//////////////////////////////////////////////////////////////////////////////////
+
+module quant_regs #(
+    parameter integer C_S_AXI_DATA_WIDTH = 32,
+    parameter integer C_S_AXI_ADDR_WIDTH = 7
+) (
+    input i_clk,
+    input i_resetn,
+
+    // to the quant_stages
+    output [64*8-1 : 0] o_table, // entry n in bits [8n+7 : 8n]
+    output o_load,               // pulse, load o_table at the next block
+    input i_pending,             // a quant_stage hasn't loaded it yet
+
+    // AXI-Lite slave
+    input [C_S_AXI_ADDR_WIDTH-1 : 0] s_axi_awaddr,
+    input [2 : 0] s_axi_awprot,
+    input s_axi_awvalid,
+    output s_axi_awready,
+    input [C_S_AXI_DATA_WIDTH-1 : 0] s_axi_wdata,
+    input [(C_S_AXI_DATA_WIDTH/8)-1 : 0] s_axi_wstrb,
+    input s_axi_wvalid,
+    output s_axi_wready,
+    output [1 : 0] s_axi_bresp,
+    output s_axi_bvalid,
+    input s_axi_bready,
+    input [C_S_AXI_ADDR_WIDTH-1 : 0] s_axi_araddr,
+    input [2 : 0] s_axi_arprot,
+    input s_axi_arvalid,
+    output s_axi_arready,
+    output [C_S_AXI_DATA_WIDTH-1 : 0] s_axi_rdata,
+    output [1 : 0] s_axi_rresp,
+    output s_axi_rvalid,
+    input s_axi_rready
+);
+
+    localparam integer ADDR_LSB = (C_S_AXI_DATA_WIDTH/32) + 1;
+    localparam integer OPT_MEM_ADDR_BITS = 4; // 32 words
+    localparam QUANT_CTRL = 5'h00;
+    localparam QUANT_TABLE = 5'h10; // first word of the table
+
+    reg [C_S_AXI_ADDR_WIDTH-1 : 0] axi_awaddr, axi_araddr;
+    reg axi_awready, axi_wready, axi_bvalid, axi_arready, axi_rvalid;
+    reg [C_S_AXI_DATA_WIDTH-1 : 0] axi_rdata;
+    reg aw_en;
+    wire slv_reg_wren, slv_reg_rden;
+    wire [OPT_MEM_ADDR_BITS : 0] wr_word, rd_word;
+
+    reg [7 : 0] quant_table [0 : 63];
+    reg r_load;
+
+    initial begin
+        $readmemh("quant_coeff.mem", quant_table, 0, 63);
+    end
+
+    assign s_axi_awready = axi_awready;
+    assign s_axi_wready = axi_wready;
+    assign s_axi_bresp = 2'b00; // always OKAY
+    assign s_axi_bvalid = axi_bvalid;
+    assign s_axi_arready = axi_arready;
+    assign s_axi_rdata = axi_rdata;
+    assign s_axi_rresp = 2'b00;
+    assign s_axi_rvalid = axi_rvalid;
+
+    assign slv_reg_wren = axi_wready && s_axi_wvalid && axi_awready && s_axi_awvalid;
+    assign slv_reg_rden = axi_arready && s_axi_arvalid && ~axi_rvalid;
+    assign wr_word = axi_awaddr[ADDR_LSB+OPT_MEM_ADDR_BITS : ADDR_LSB];
+    assign rd_word = axi_araddr[ADDR_LSB+OPT_MEM_ADDR_BITS : ADDR_LSB];
+
+    assign o_load = r_load;
+
+    genvar g;
+    generate
+        for (g = 0; g < 64; g = g + 1) begin : entry
+            assign o_table[g*8 +: 8] = quant_table[g];
+        end
+    endgenerate
+
+    // handle axi_awready, axi_wready and axi_awaddr
+    // take the address and data together, one write at a time
+    initial begin
+        axi_awready = 0;
+        axi_wready = 0;
+        axi_awaddr = 0;
+        aw_en = 1;
+    end
+    always @(posedge i_clk) begin
+        if (!i_resetn) begin
+            axi_awready <= 0;
+            axi_wready <= 0;
+            axi_awaddr <= 0;
+            aw_en <= 1;
+        end
+        else begin
+            if (~axi_awready && s_axi_awvalid && s_axi_wvalid && aw_en) begin
+                axi_awready <= 1;
+                axi_wready <= 1;
+                axi_awaddr <= s_axi_awaddr;
+                aw_en <= 0;
+            end
+            else begin
+                axi_awready <= 0;
+                axi_wready <= 0;
+                if (s_axi_bready && axi_bvalid)
+                    aw_en <= 1;
+            end
+        end
+    end
+
+    // handle axi_bvalid
+    initial axi_bvalid = 0;
+    always @(posedge i_clk) begin
+        if (!i_resetn) begin
+            axi_bvalid <= 0;
+        end
+        else begin
+            if (slv_reg_wren && ~axi_bvalid)
+                axi_bvalid <= 1;
+            else if (s_axi_bready && axi_bvalid)
+                axi_bvalid <= 0;
+        end
+    end
+
+    // handle the table writes and r_load
+    // the table is only written while no load is pending, it isn't reset
+    integer b;
+    initial r_load = 0;
+    always @(posedge i_clk) begin
+        if (!i_resetn) begin
+            r_load <= 0;
+        end
+        else begin
+            r_load <= slv_reg_wren && wr_word == QUANT_CTRL && s_axi_wstrb[0] && s_axi_wdata[0] && !i_pending;
+            if (slv_reg_wren && wr_word >= QUANT_TABLE && !i_pending && !r_load) begin
+                for (b = 0; b < 4; b = b + 1) begin
+                    if (s_axi_wstrb[b])
+                        quant_table[4*(wr_word - QUANT_TABLE) + b] <= s_axi_wdata[b*8 +: 8];
+                end
+            end
+        end
+    end
+
+    // handle axi_arready and axi_araddr
+    initial begin
+        axi_arready = 0;
+        axi_araddr = 0;
+    end
+    always @(posedge i_clk) begin
+        if (!i_resetn) begin
+            axi_arready <= 0;
+            axi_araddr <= 0;
+        end
+        else begin
+            if (~axi_arready && s_axi_arvalid) begin
+                axi_arready <= 1;
+                axi_araddr <= s_axi_araddr;
+            end
+            else begin
+                axi_arready <= 0;
+            end
+        end
+    end
+
+    // handle axi_rvalid and axi_rdata
+    // a load counts as pending from the cycle it's written
+    initial begin
+        axi_rvalid = 0;
+        axi_rdata = 0;
+    end
+    always @(posedge i_clk) begin
+        if (!i_resetn) begin
+            axi_rvalid <= 0;
+            axi_rdata <= 0;
+        end
+        else begin
+            if (slv_reg_rden) begin
+                axi_rvalid <= 1;
+                if (rd_word == QUANT_CTRL)
+                    axi_rdata <= {{(C_S_AXI_DATA_WIDTH-1){1'b0}}, i_pending || r_load};
+                else if (rd_word >= QUANT_TABLE)
+                    axi_rdata <= {quant_table[4*(rd_word - QUANT_TABLE) + 3], quant_table[4*(rd_word - QUANT_TABLE) + 2],
+                                  quant_table[4*(rd_word - QUANT_TABLE) + 1], quant_table[4*(rd_word - QUANT_TABLE)]};
+                else
+                    axi_rdata <= 0;
+            end
+            else if (axi_rvalid && s_axi_rready) begin
+                axi_rvalid <= 0;
+            end
+        end
+    end
+
+endmodule
@@ -7,22 +7,33 @@
 // Description:
 //  Quantization Stage
 //  Assumes you're feeding in transposed DCT coefficients and performs quantization
+//  Takes LANES coefficients per cycle (2, 4 or 8)
+//  KERNEL matches the DCT stages, the fast kernel's coefficients are twice
+//  as big so they get shifted one more
+//  The shifts start out as quant_coeff.mem, i_qload swaps in i_qtable at the
+//  start of the next block, see quant_regs
 //
-// Last Modified: 2021-03-16
+// Last Modified: 2026-10-17
 //
 //////////////////////////////////////////////////////////////////////////////////
 
 module quant_stage #(
     parameter DATA_WIDTH = 25,       // pixel bit depth
-    parameter OUTPUT_WIDTH = 12       // output coefficient width
+    parameter OUTPUT_WIDTH = 12,      // output coefficient width
+    parameter LANES = 2,              // coefficients per cycle, 2, 4 or 8
+    parameter KERNEL = 0              // DCT kernel of the stages before, see dct_stage
 ) (
-    input signed [DATA_WIDTH-1 : 0] i_c0, i_c1, // input coefficient stream
+    input [LANES*DATA_WIDTH-1 : 0] i_c, // input coefficient stream, first in the low bits
 
     input i_clk,                   // input clock
     input i_vld,                   // signal indicating that the input is valid
     input i_resetn,                // reset signal
 
-    output signed [OUTPUT_WIDTH-1 : 0] o_q0, o_q1,
+    output [LANES*OUTPUT_WIDTH-1 : 0] o_q,
+
+    input [64*8-1 : 0] i_qtable,   // new quantization shifts, entry n in bits [8n+7 : 8n]
+    input i_qload,                 // take i_qtable at the start of the next block
+    output o_qpending,             // i_qload hasn't been taken yet
 
     output o_sync                 // sync signal indicating that new data can be input
 );
@@ -33,10 +44,11 @@ module quant_stage #(
 
     reg [8 : 0] n_in;                           // indicate the number of inputs, outputs, and mults
     reg addsum_vld, olatch_vld, r_o_sync;       // indicate whether we've latched addsum
+    reg q_pending;                              // a new table is waiting for the next block
+    wire blk_start;                             // the next coefficient in is the first of a block
 
     // three is the minimum quantization value
-    reg signed [DATA_WIDTH-3-1-EXTRA_QUANT-CORR_SHIFT : 0] r_oq0;
-    reg signed [DATA_WIDTH-3-1-EXTRA_QUANT-CORR_SHIFT : 0] r_oq1;     // output buffers
+    reg signed [DATA_WIDTH-3-1-EXTRA_QUANT-CORR_SHIFT : 0] r_oq [0 : LANES-1];     // output buffers
 
     reg signed [7 : 0] quant_coeff [0 : 63];   // 16 matrix coefficients
     initial begin
@@ -45,10 +57,17 @@ module quant_stage #(
 
     // assign the output signals
     assign o_sync = r_o_sync;
+    assign o_qpending = q_pending;
+
+    assign blk_start = i_vld ? (n_in == 64 - LANES) : (n_in == 0);
 
     // assign the output to be the 8 upper bits of the quantized values
-    assign o_q0 = r_oq0;
-    assign o_q1 = r_oq1;
+    genvar g;
+    generate
+        for (g = 0; g < LANES; g = g + 1) begin : out_lane
+            assign o_q[g*OUTPUT_WIDTH +: OUTPUT_WIDTH] = r_oq[g];
+        end
+    endgenerate
 //    assign o_q0 = r_oq0[DATA_WIDTH-3-1-EXTRA_QUANT  : DATA_WIDTH-3-1-EXTRA_QUANT-(OUTPUT_WIDTH-1)];
 //    assign o_q1 = r_oq1[DATA_WIDTH-3-1-EXTRA_QUANT  : DATA_WIDTH-3-1-EXTRA_QUANT-(OUTPUT_WIDTH-1)];
 
@@ -64,7 +83,7 @@ module quant_stage #(
         else begin
             if (i_vld) begin
                 // count n_in up and wrap at 64
-                n_in <= (n_in + 2) % 64;
+                n_in <= (n_in + LANES) % 64;
             end
             else begin
                 // otherwise hold steady
@@ -73,19 +92,45 @@ module quant_stage #(
         end
     end
 
-    // handle r_oq0 and r_oq1
+    // handle q_pending and the table load
+    // a new table only goes in between blocks so a block is quantized by one table
+    integer q;
+    initial q_pending = 0;
+    always @(posedge i_clk) begin
+        if (~i_resetn) begin
+            q_pending <= 0;
+        end
+        else begin
+            if (q_pending && blk_start) begin
+                // the table isn't reset, it keeps the last one loaded
+                q_pending <= 0;
+                for (q = 0; q < 64; q = q + 1) begin
+                    quant_coeff[q] <= i_qtable[q*8 +: 8];
+                end
+            end
+            else if (i_qload) begin
+                q_pending <= 1;
+            end
+        end
+    end
+
+    // handle r_oq
     // the absolute accuracy of these don't matter since we have o_sync to indicate output is ready
-    initial r_oq0 = 0;
-    initial r_oq1 = 0;
+    integer l;
+    initial begin
+        for (l = 0; l < LANES; l=l+1) r_oq[l] = 0;
+    end
     always @(posedge i_clk) begin
         if (~i_resetn) begin
-            r_oq0 <= 0;
-            r_oq1 <= 0;
+            for (l = 0; l < LANES; l=l+1) begin
+                r_oq[l] <= 0;
+            end
         end
         else begin
             // o_sync handles whether the output is "valid"
-            r_oq0 <= i_c0 >>> (quant_coeff[n_in] + EXTRA_QUANT + CORR_SHIFT);
-            r_oq1 <= i_c1 >>> (quant_coeff[n_in + 1] + EXTRA_QUANT + CORR_SHIFT);
+            for (l = 0; l < LANES; l=l+1) begin
+                r_oq[l] <= $signed(i_c[l*DATA_WIDTH +: DATA_WIDTH]) >>> (quant_coeff[n_in + l] + EXTRA_QUANT + CORR_SHIFT + KERNEL);
+            end
         end
     end
 
@@ -6,6 +6,12 @@
 // Module Name: run_length_stage.v
 // Description:
 //  performs run length encoding and de-transposes the DCT coefficients
+//  Takes and puts out LANES values per cycle (2, 4 or 8). A cycle's
+//  coefficients give at most LANES+2 words: a zero run before each non-zero
+//  one, and at the end of a block the trailing zero run and EOF. With 2
+//  lanes the words are the ones the 2-value encoder always wrote, including
+//  a block ending in a value and a single zero: there the zero flag goes on
+//  the value's word and the run word keeps its old top bit
 //
 // Last Modified: 2021-03-28
 //
@@ -14,18 +20,17 @@
 
 module run_length_stage #(
     DATA_WIDTH = 14, // an illusion of choice, they need to be 15-bit for the fifo
-    OUTPUT_WIDTH = 16
+    OUTPUT_WIDTH = 16,
+    LANES = 2 // values per cycle, 2, 4 or 8
 )(
     input i_clk,
     input i_resetn,
-    // to avoid conflicts we write two values at once at sequential addresses
-    input [DATA_WIDTH-1 : 0] i_data0,
-    input [DATA_WIDTH-1 : 0] i_data1, // 16-bit wide
+    // to avoid conflicts we write LANES values at once at sequential addresses
+    input [LANES*DATA_WIDTH-1 : 0] i_data, // first value in the low bits
     input wen,
 
     // reading
-    output [OUTPUT_WIDTH-1 : 0] o_data0, // 16-bit wide
-    output [OUTPUT_WIDTH-1 : 0] o_data1, // 16-bit wide
+    output [LANES*OUTPUT_WIDTH-1 : 0] o_data, // 16-bit wide each
     output reg rsync // sync the reader reads
 
     );
@@ -56,25 +61,26 @@ module run_length_stage #(
     reg [ADDR_WIDTH : 0] n_data_processed; // keep track of how many bytes we've processed
 
     /* OUTPUT AND INPUT DATA VARIABLES */
-    // input
-    wire [(DATA_WIDTH*2)-1 : 0] i_data_dbl; // store the 2-wide input as ... two-wide
-    assign i_data_dbl = {i_data1, i_data0};
-
     // fifo output
-    wire [(DATA_WIDTH*2)-1 : 0] curr_data_dbl;
-    wire [DATA_WIDTH-1 : 0] curr_data0, curr_data1;
-    
-    assign {curr_data1, curr_data0} = curr_data_dbl; // unstack the fifo output data into two variables
-    
+    wire [(DATA_WIDTH*LANES)-1 : 0] curr_data;
+    wire [LANES-1 : 0] curr_zero; // which of the current datas count as zero
+
     wire fifo_rden_rdy, fifo_full, fifo_empty, fifo_rst; // fifo signals
+    wire [LANES/2-1 : 0] pair_full, pair_empty; // one fifo per two lanes
     reg fifo_rden; // signal that the fifo_rden signal is ready
 
     // output
-    reg [OUTPUT_WIDTH-1 : 0] o_data0_reg;
-    reg [OUTPUT_WIDTH-1 : 0] o_data1_reg;
+    reg [OUTPUT_WIDTH-1 : 0] o_data_reg [0 : LANES-1];
     reg rsync_ready;
-    assign o_data0 = o_data0_reg; // output assignments
-    assign o_data1 = o_data1_reg;
+
+    genvar g;
+    generate
+        for (g = 0; g < LANES; g = g + 1) begin : lane
+            assign o_data[g*OUTPUT_WIDTH +: OUTPUT_WIDTH] = o_data_reg[g]; // output assignments
+            // -1 is what a small negative number quantizes to, call it zero
+            assign curr_zero[g] = (curr_data[g*DATA_WIDTH +: DATA_WIDTH] == 0 || curr_data[g*DATA_WIDTH +: DATA_WIDTH] == {DATA_WIDTH{1'b1}});
+        end
+    endgenerate
 
     assign fifo_rst = ~i_resetn;
 
@@ -85,21 +91,28 @@ module run_length_stage #(
     //      current read_ptr will read the last data in the buffer OR
     //      we haven't yet processed a full buffer's worth of data
     wire data_processed_flag;
-    assign data_processed_flag = ((read_ptr+1) >= last_ptr || !(n_data_processed==MAX_COUNT) || (n_data_processed==MAX_COUNT && rsync_ready));
+    assign data_processed_flag = ((read_ptr+LANES-1) >= last_ptr || !(n_data_processed==MAX_COUNT) || (n_data_processed==MAX_COUNT && rsync_ready));
     assign fifo_rden_rdy = !fifo_empty && data_processed_flag;
 
     // instantantiate the outptut fifo
-    // needs to be 32 (30?) bit wide
-    fifo_generator_1 axis_fifo(
-        .clk(i_clk),
-        .rst(fifo_rst),
-        .din(i_data_dbl),
-        .wr_en(wen),
-        .rd_en(fifo_rden_rdy),
-        .dout(curr_data_dbl),
-        .full(fifo_full),
-        .empty(fifo_empty)
-    );
+    // needs to be 32 (30?) bit wide, so wider lanes get one per lane pair
+    // they're written and read together so the first one's flags do for all
+    assign fifo_full = pair_full[0];
+    assign fifo_empty = pair_empty[0];
+    generate
+        for (g = 0; g < LANES/2; g = g + 1) begin : pair
+            fifo_generator_1 axis_fifo(
+                .clk(i_clk),
+                .rst(fifo_rst),
+                .din(i_data[g*DATA_WIDTH*2 +: DATA_WIDTH*2]),
+                .wr_en(wen),
+                .rd_en(fifo_rden_rdy),
+                .dout(curr_data[g*DATA_WIDTH*2 +: DATA_WIDTH*2]),
+                .full(pair_full[g]),
+                .empty(pair_empty[g])
+            );
+        end
+    endgenerate
 
 
     initial fifo_rden = 0;
@@ -123,12 +136,12 @@ module run_length_stage #(
         else begin
             if (fifo_rden && !(n_data_processed==MAX_COUNT)) begin
                 // it means that we are reading, and it's likely because n_data_processed is not max
-                n_data_processed <= n_data_processed + 2; // once we've latched the data, update how many we've processed
+                n_data_processed <= n_data_processed + LANES; // once we've latched the data, update how many we've processed
             end
             else if (fifo_rden && (n_data_processed==MAX_COUNT)) begin
                 // we're reading, and yet n_data_processed is equal to max_count. This means that we must be about
                 // to finish reading from the read buffer, and can process more data
-                n_data_processed <= 2; // we'll process two bytes this cycle
+                n_data_processed <= LANES; // we'll process LANES values this cycle
             end
         end
     end
@@ -142,7 +155,7 @@ module run_length_stage #(
             w_done <= 0;
         end
         else begin
-            if (n_data_processed==MAX_COUNT-2 && fifo_rden)
+            if (n_data_processed==MAX_COUNT-LANES && fifo_rden)
                 // we're finishing a write cycle
                 w_done <= 1;
             else if (n_data_processed==MAX_COUNT)
@@ -159,11 +172,11 @@ module run_length_stage #(
             rsync_ready <= 0;
         end
         else begin
-            if (n_data_processed==(MAX_COUNT-2) && fifo_rden && !rsync_ready) begin
+            if (n_data_processed==(MAX_COUNT-LANES) && fifo_rden && !rsync_ready) begin
                 // if rsync is low and we finished writing a block, set high
                 rsync_ready <= 1;
             end
-            else if (rsync_ready && (read_ptr+1)>=last_ptr && !w_done && !(n_data_processed==(MAX_COUNT-2) && fifo_rden)) begin
+            else if (rsync_ready && (read_ptr+LANES-1)>=last_ptr && !w_done && !(n_data_processed==(MAX_COUNT-LANES) && fifo_rden)) begin
                 // if rsync_ready is already high AND
                 //  the current read_ptr will read the last data in the read buffer AND
                 //  we haven't finished a transfer previously AND
@@ -198,49 +211,84 @@ module run_length_stage #(
     end
 
     // handle reading data from run_length_buf
+    integer r;
     initial begin
         read_ptr = 0;
-        o_data0_reg = 0;
-        o_data1_reg = 0;
+        for (r = 0; r < LANES; r=r+1) o_data_reg[r] = 0;
     end
     always @(posedge i_clk) begin
         if (!i_resetn) begin
             read_ptr <= 0;
-            o_data0_reg <= 0;
-            o_data1_reg <= 0;
+            for (r = 0; r < LANES; r=r+1) begin
+                o_data_reg[r] <= 0;
+            end
         end
         else begin
-            if (rsync_ready && (read_ptr + 2) <= last_ptr) begin
-                // next +2 will either be lower or equal to last ptr
-                o_data0_reg <= run_length_buf[rpage][read_ptr];
-                o_data1_reg <= run_length_buf[rpage][read_ptr + 1];
-                read_ptr <= read_ptr + 2;
-            end
-            else if (rsync_ready && (read_ptr + 1) == last_ptr) begin
-                // if last one didn't get called, it means that read_ptr + 1 is likely equal to last_ptr, hence we have to stop here
-                o_data0_reg <= run_length_buf[rpage][read_ptr];
-                o_data1_reg <= run_length_buf[rpage][read_ptr + 1];
-//                read_ptr <= read_ptr + 2;
-                // set back to zero, rsync_ready will handle disabling the read
-                read_ptr <= 0;
-    
+            if (rsync_ready && (read_ptr + LANES) <= last_ptr) begin
+                // next +LANES will either be lower or equal to last ptr
+                for (r = 0; r < LANES; r=r+1) begin
+                    o_data_reg[r] <= run_length_buf[rpage][read_ptr + r];
+                end
+                read_ptr <= read_ptr + LANES;
             end
-            else if (rsync_ready && read_ptr == last_ptr) begin
-                // exactly one more data left
-                o_data0_reg <= run_length_buf[rpage][read_ptr]; // output last data, which should be EOF
-                o_data1_reg <= EOF; // output an extra EOF, just to pad
-//                read_ptr <= read_ptr + 1;
+            else if (rsync_ready && read_ptr <= last_ptr) begin
+                // the rest of the block fits in this read, the last data should be EOF
+                // output an extra EOF after it in any lanes left, just to pad
+                for (r = 0; r < LANES; r=r+1) begin
+                    if (read_ptr + r <= last_ptr)
+                        o_data_reg[r] <= run_length_buf[rpage][read_ptr + r];
+                    else
+                        o_data_reg[r] <= EOF;
+                end
                 // set back to zero, rsync_ready will handle disabling the read
                 read_ptr <= 0;
             end
         end
     end
 
-    // some flags for figuring out how to write
-    wire [3 : 0] flags;
-    assign flags = {(zero_count != 0), (curr_data0 == 0 || curr_data0 == {DATA_WIDTH{1'b1}}), (curr_data1==0 || curr_data1=={DATA_WIDTH{1'b1}}), ((n_data_processed+2)==MAX_COUNT)};
+    // work out what to write for the datas read from the fifo
+    // a zero run is written when a non-zero data ends it, or at the end of
+    // the block, where EOF follows
+    wire last_data; // these are the last datas of the block
+    reg [OUTPUT_WIDTH-1 : 0] rl_word [0 : LANES+1]; // the words to write
+    reg [3 : 0] n_words; // how many of them there are
+    reg [ADDR_WIDTH : 0] run; // zero count including these datas
+    assign last_data = ((n_data_processed+LANES)==MAX_COUNT);
+
+    integer w;
+    always @(*) begin
+        n_words = 0;
+        run = zero_count;
+        for (w = 0; w < LANES+2; w=w+1) begin
+            rl_word[w] = EOF;
+        end
+        for (w = 0; w < LANES; w=w+1) begin
+            if (curr_zero[w]) begin
+                run = run + 1;
+            end
+            else begin
+                if (run != 0) begin
+                    // top bit one for zero, bottom bits zero
+                    rl_word[n_words] = {1'b1, run[5:0], 9'b0};
+                    n_words = n_words + 1;
+                end
+                rl_word[n_words] = {{PAD_WIDTH{1'b0}}, curr_data[w*DATA_WIDTH +: DATA_WIDTH]};
+                n_words = n_words + 1;
+                run = 0;
+            end
+        end
+        if (last_data) begin
+            if (run != 0) begin
+                // a run of 64 wraps to a zero count, which means 64
+                rl_word[n_words] = {1'b1, run[5:0], 9'b0};
+                n_words = n_words + 1;
+            end
+            // rl_word is already EOF here
+            n_words = n_words + 1;
+        end
+    end
 
-    integer i;
+    integer i, k;
     initial begin
         // reset all the signals
         curr_ptr <= 0;
@@ -266,162 +314,36 @@ module run_length_stage #(
         end
         else begin
             if (fifo_rden) begin
-                casez (flags)
-                    // is end of packet
-                    4'b0001: begin
-                        // last data not zero, none of these datas zero, max count
-                        run_length_buf[wpage][curr_ptr] <= {{PAD_WIDTH{1'b0}}, curr_data0};
-                        run_length_buf[wpage][curr_ptr+1] <= {{PAD_WIDTH{1'b0}}, curr_data1};
-                        run_length_buf[wpage][curr_ptr+2] <= EOF;
-                        // increment the pointers
-                        curr_ptr <= 0;
-                        last_ptr <= curr_ptr + 2;
-                        // update wpage and zero count
-                        wpage = ~wpage;
-                        zero_count <= 0;
-                    end
-                    4'b0011: begin
-                        // last data not zero, current data0 is non-zero, current data1 is zero, at max count
-                        run_length_buf[wpage][curr_ptr] <= {{PAD_WIDTH{1'b0}}, curr_data0};
-                        run_length_buf[wpage][curr_ptr + 1][14:0] <= {6'b1, 9'b0}; // indicate the zero
-                        run_length_buf[wpage][curr_ptr][15] <= 1'b1;
-                        run_length_buf[wpage][curr_ptr + 2] <= EOF;
-                        // increment the pointers
-                        curr_ptr <= 0;
-                        last_ptr <= curr_ptr + 2;
-                        // update wpage and zero count
-                        wpage = ~wpage;
-                        zero_count <= 0;
-                    end
-                    4'b0101: begin
-                        // last data not zero, current data0 is zero, current data1 is not zero, not at max count
-                        run_length_buf[wpage][curr_ptr][14:0] <= {6'b1, 9'b0}; // top bit one for zero, bottom bits zero
-                        run_length_buf[wpage][curr_ptr][15] <= 1'b1;
-                        run_length_buf[wpage][curr_ptr + 1] <= {{PAD_WIDTH{1'b0}}, curr_data1};
-                        run_length_buf[wpage][curr_ptr + 2] <= EOF;
-                        // increment the pointers
-                        curr_ptr <= 0;
-                        last_ptr <= curr_ptr + 2;
-                        // update wpage and zero count
-                        wpage = ~wpage;
-                        zero_count <= 0;
-                    end
-                    4'b?111: begin
-                        // doesn't matter what zero count is, end of packet
-                        run_length_buf[wpage][curr_ptr][14:0] <= {zero_count+2, 9'b0};
-                        run_length_buf[wpage][curr_ptr][15] <= 1'b1;
-                        run_length_buf[wpage][curr_ptr + 1] <= EOF;
-                        // increment the pointers
-                        curr_ptr <= 0;
-                        last_ptr <= curr_ptr + 1;
-                        // update wpage and zero count
-                        wpage = ~wpage;
-                        zero_count <= 0;
-                    end
-                    4'b1001: begin
-                        // last data zero, both current datas not zero, at max count
-                        run_length_buf[wpage][curr_ptr][14:0] <= {zero_count, 9'b0}; // last count is correct, store
-                        run_length_buf[wpage][curr_ptr][15] <= 1'b1;
-                        run_length_buf[wpage][curr_ptr + 1] <= {{PAD_WIDTH{1'b0}}, curr_data0}; // store the current data
-                        run_length_buf[wpage][curr_ptr + 2] <= {{PAD_WIDTH{1'b0}}, curr_data1};
-                        run_length_buf[wpage][curr_ptr + 3] <= EOF;
-                        // increment the pointers
-                        curr_ptr <= 0;
-                        last_ptr <= curr_ptr + 3;
-                        // update wpage and zero count
-                        wpage = ~wpage;
-                        zero_count <= 0;
-                    end
-                    4'b1101: begin
-                        // last data zero, next data zero, data1 not zero, at max count
-                        run_length_buf[wpage][curr_ptr][14:0] <= {zero_count+1, 9'b0}; // write current value + 1
-                        run_length_buf[wpage][curr_ptr][15] <= 1'b1;
-                        run_length_buf[wpage][curr_ptr + 1] <= {{PAD_WIDTH{1'b0}}, curr_data1};
-                        run_length_buf[wpage][curr_ptr + 2] <= EOF;
-                        // increment the pointers
-                        curr_ptr <= 0;
-                        last_ptr <= curr_ptr + 2;
-                        // update wpage and zero count
-                        wpage = ~wpage;
-                        zero_count <= 0;
-                    end
-                    4'b1011: begin
-                        // last data zero, next data not zero, data1 zero, at max count
-                        run_length_buf[wpage][curr_ptr][14:0] <= {zero_count, 9'b0};
-                        run_length_buf[wpage][curr_ptr][15] <= 1'b1;
-                        run_length_buf[wpage][curr_ptr + 1] <= {{PAD_WIDTH{1'b0}}, curr_data0};
-                        run_length_buf[wpage][curr_ptr + 2] <= {1'b1, 6'b1, 9'b0}; // encode data 1
-                        run_length_buf[wpage][curr_ptr + 3] <= EOF;
-                        // increment the pointers
-                        curr_ptr <= 0;
-                        last_ptr <= curr_ptr + 3;
-                        // update wpage and zero count
-                        wpage = ~wpage;
-                        zero_count <= 0;
-                    end
-                    // not end of packet
-                    4'b0000: begin
-                        // last data not zero, none of these datas zero
-                        run_length_buf[wpage][curr_ptr] <= {{PAD_WIDTH{1'b0}}, curr_data0};
-                        run_length_buf[wpage][curr_ptr+1] <= {{PAD_WIDTH{1'b0}}, curr_data1};
-                        // increment the current pointer
-                        curr_ptr <= (curr_ptr + 2) % 2**ADDR_WIDTH;
-                    end
-                    4'b0010: begin
-                        // last data not zero, current data0 is non-zero, current data1 is zero, not at max count
-                        run_length_buf[wpage][curr_ptr] <= {{PAD_WIDTH{1'b0}}, curr_data0};
-                        // increment the current pointer
-                        curr_ptr <= (curr_ptr + 1) % 2**ADDR_WIDTH;
-                        zero_count <= 1; // reset the count
-                    end
-                    4'b0100: begin
-                        // last data not zero, current data0 is zero, current data1 is not zero, not at max count
-                        run_length_buf[wpage][curr_ptr][14:0] <= {6'b1, 9'b0}; // top bit one for zero, bottom bits zero
-                        run_length_buf[wpage][curr_ptr][15] <= 1'b1;
-                        run_length_buf[wpage][curr_ptr + 1] <= {{PAD_WIDTH{1'b0}}, curr_data1};
-                        // increment the current pointer
-                        curr_ptr <= (curr_ptr + 2) % 2**ADDR_WIDTH;
-                        zero_count <= 0; // reset the count
-                    end
-                    4'b?110: begin
-                        // don't care what zero count is, increment it
-                        zero_count <= zero_count + 2; // just increment zero count
-                    end
-                    4'b1000: begin
-                        // last data zero, both current datas not zero, not at max count
-                        run_length_buf[wpage][curr_ptr][14:0] <= {zero_count, 9'b0}; // last count is correct, store
-                        run_length_buf[wpage][curr_ptr][15] <= 1'b1;
-                        run_length_buf[wpage][curr_ptr + 1] <= {{PAD_WIDTH{1'b0}}, curr_data0}; // store the current data
-                        run_length_buf[wpage][curr_ptr + 2] <= {{PAD_WIDTH{1'b0}}, curr_data1};
-                        // increment current pointer by 3!
-                        curr_ptr <= (curr_ptr + 3) % 2**ADDR_WIDTH;
-                        zero_count <= 0; // reset the zero count
-                    end
-                    4'b1100: begin
-                        // last data zero, next data zero, data1 not zero
-                        // run_length_buf[wpage][curr_ptr] <= {1'b1, zero_count+1, 9'b0}; // write current value + 1
-                        run_length_buf[wpage][curr_ptr][14:0] <= {zero_count+1, 9'b0};
-                        run_length_buf[wpage][curr_ptr][15] <= 1'b1;
-                        run_length_buf[wpage][curr_ptr + 1] <= {{PAD_WIDTH{1'b0}}, curr_data1};
-                        // increment current pointer by 2
-                        curr_ptr <= (curr_ptr + 2) % 2**ADDR_WIDTH;
-                        zero_count <= 0;
-                    end
-                    4'b1010: begin
-                        // last data zero, next data not zero, data1 zero, not at max count
-                        run_length_buf[wpage][curr_ptr][14:0] <= {zero_count, 9'b0};
-                        run_length_buf[wpage][curr_ptr][15] <= 1'b1;
-                        run_length_buf[wpage][curr_ptr + 1] <= {{PAD_WIDTH{1'b0}}, curr_data0};
-                        // increment current pointer by 2
-                        curr_ptr <= (curr_ptr + 2) % 2**ADDR_WIDTH;
-                        zero_count <= 1; // reset to one for data1 value
+                if (LANES == 2 && last_data && zero_count == 0 && curr_zero == 2'b10) begin
+                    // last data0 is non-zero, data1 is zero, as the 2-value encoder did it
+                    run_length_buf[wpage][curr_ptr] <= {{PAD_WIDTH{1'b0}}, curr_data[DATA_WIDTH-1 : 0]};
+                    run_length_buf[wpage][curr_ptr + 1][14:0] <= {6'b1, 9'b0}; // indicate the zero
+                    run_length_buf[wpage][curr_ptr][15] <= 1'b1;
+                    run_length_buf[wpage][curr_ptr + 2] <= EOF;
+                end
+                else begin
+                    for (k = 0; k < LANES+2; k=k+1) begin
+                        if (k < n_words)
+                            run_length_buf[wpage][curr_ptr + k] <= rl_word[k];
                     end
-                    // default:
-                endcase
+                end
+                if (last_data) begin
+                    // is end of packet, last_ptr is on the EOF
+                    curr_ptr <= 0;
+                    last_ptr <= curr_ptr + n_words - 1;
+                    // update wpage and zero count
+                    wpage <= ~wpage;
+                    zero_count <= 0;
+                end
+                else begin
+                    // not end of packet, increment the current pointer
+                    curr_ptr <= (curr_ptr + n_words) % 2**ADDR_WIDTH;
+                    zero_count <= run;
+                end
             end
         end
     end
 
 
 
-endmodule
\ No newline at end of file
+endmodule
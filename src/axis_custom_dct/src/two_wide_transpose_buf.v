@@ -8,6 +8,8 @@
 //  2-port transpose buffer
 //  The writer can control the block. Once a block is written it's assumed that
 //  the reader will accept one set of read data per clock cycle
+//  Moves LANES values per cycle (2, 4 or 8) on each side, two by default as
+//  the name says
 //
 // Last Modified: 2021-03-02
 //
@@ -16,18 +18,19 @@
 
 module two_wide_transpose_buf #(
     DATA_WIDTH = 8,
-    ADDR_WIDTH = 6
+    ADDR_WIDTH = 6,
+    LANES = 2 // values per cycle, 2, 4 or 8
 )(
     input i_clk,
     input i_resetn,
-    // to avoid conflicts we write two values at once at sequential addresses
-    input [DATA_WIDTH-1 : 0] wdata0, wdata1,
+    // to avoid conflicts we write LANES values at once at sequential addresses
+    input [LANES*DATA_WIDTH-1 : 0] wdata, // first value in the low bits
     // input [ADDR_WIDTH-1 : 0] waddr,
     input wen,
     // output wsync, // sync the writer writes
 
     // reading
-    output [DATA_WIDTH-1 : 0] rdata0, rdata1,
+    output [LANES*DATA_WIDTH-1 : 0] rdata,
     // output [ADDR_WIDTH-1 : 0] raddr,
     output reg rsync // sync the reader reads
 
@@ -40,7 +43,7 @@ module two_wide_transpose_buf #(
     // transpose buffer
     reg [DATA_WIDTH-1 : 0] ram_buf [0: 1][0 : 2**ADDR_WIDTH_HALF-1][0 : 2**ADDR_WIDTH_HALF-1];
     // output buffers
-    reg [DATA_WIDTH-1 : 0] reg_rdata0, reg_rdata1;
+    reg [DATA_WIDTH-1 : 0] reg_rdata [0 : LANES-1];
     // internal waddr and raddr
     reg [ADDR_WIDTH-1 : 0] waddr, raddr;
     // which page of memory to read/write from
@@ -53,8 +56,12 @@ module two_wide_transpose_buf #(
     assign rpage = ~wpage;
 
     // assign outputs
-    assign rdata0 = reg_rdata0;
-    assign rdata1 = reg_rdata1;
+    genvar g;
+    generate
+        for (g = 0; g < LANES; g = g + 1) begin : out_lane
+            assign rdata[g*DATA_WIDTH +: DATA_WIDTH] = reg_rdata[g];
+        end
+    endgenerate
 
     // handle wpage
     initial wpage = 0;
@@ -63,7 +70,7 @@ module two_wide_transpose_buf #(
             wpage <= 0;
         end
         else begin
-            if (waddr == 2**ADDR_WIDTH-2 && wen) begin
+            if (waddr == 2**ADDR_WIDTH-LANES && wen) begin
                 // we're at the last write address and are writing
                 wpage <= ~wpage;
             end
@@ -80,13 +87,13 @@ module two_wide_transpose_buf #(
         else begin
             if (wen) begin
                 // should wrap once it's full?
-                waddr <= waddr + 2;
+                waddr <= waddr + LANES;
             end
         end
     end
 
     // handle writing to the ram
-    integer i;
+    integer i, l;
     initial begin
         for (i=0; i<2**ADDR_WIDTH-1 ; i=i+1) begin
             ram_buf[wpage][(i%8)][i>>DATA_NBITS] <= 0;
@@ -95,9 +102,10 @@ module two_wide_transpose_buf #(
     always @(posedge i_clk) begin
         if (~i_resetn) begin
             // reset the buffers
-            for (i = 0; i < 2**ADDR_WIDTH-1 ; i=i+2) begin
-                ram_buf[wpage][(i%8)+0][i>>DATA_NBITS] <= 0;
-                ram_buf[wpage][(i%8)+1][i>>DATA_NBITS] <= 0;
+            for (i = 0; i < 2**ADDR_WIDTH-1 ; i=i+LANES) begin
+                for (l = 0; l < LANES; l=l+1) begin
+                    ram_buf[wpage][(i%8)+l][i>>DATA_NBITS] <= 0;
+                end
             end 
         end
         else begin
@@ -106,8 +114,9 @@ module two_wide_transpose_buf #(
 //                ram_buf[wpage][row][col]
 //                 normally we would increment columns, and write a row at a time
 //                  for the double buffer we want to increment rows, and write a column at a time
-                ram_buf[wpage][(waddr%8)+0][waddr>>DATA_NBITS] <= wdata0;
-                ram_buf[wpage][(waddr%8)+1][waddr>>DATA_NBITS] <= wdata1;
+                for (l = 0; l < LANES; l=l+1) begin
+                    ram_buf[wpage][(waddr%8)+l][waddr>>DATA_NBITS] <= wdata[l*DATA_WIDTH +: DATA_WIDTH];
+                end
             end
         end
     end
@@ -123,7 +132,7 @@ module two_wide_transpose_buf #(
         else begin
             if (rsync_ready) begin
                 // should wrap once full, write once we're ready to write
-                raddr <= raddr + 2;
+                raddr <= raddr + LANES;
             end
         end
     end
@@ -155,7 +164,7 @@ module two_wide_transpose_buf #(
             w_done <= 0;
         end
         else begin
-            if (waddr == 2**ADDR_WIDTH-2 && wen)
+            if (waddr == 2**ADDR_WIDTH-LANES && wen)
                 w_done <= 1;
             else if (waddr == 0)
                 w_done <= 0;
@@ -171,11 +180,11 @@ module two_wide_transpose_buf #(
             rsync_ready <= 0;
         end
         else begin
-            if (waddr == 2**ADDR_WIDTH-2 && wen && !rsync_ready) begin
+            if (waddr == 2**ADDR_WIDTH-LANES && wen && !rsync_ready) begin
                 // if rsync is low and we finished writing a block, set high
                 rsync_ready <= 1;
             end
-            else if (raddr == 2**ADDR_WIDTH-2 && rsync_ready && !w_done && !(waddr == 2**ADDR_WIDTH-2)) begin
+            else if (raddr == 2**ADDR_WIDTH-LANES && rsync_ready && !w_done && !(waddr == 2**ADDR_WIDTH-LANES)) begin
                 // we're about to finish reading, but have not completed a write this cycle
                 rsync_ready <= 0;
             end
@@ -187,11 +196,14 @@ module two_wide_transpose_buf #(
     end
 
     // handle reading from the ram
-    initial reg_rdata0 = 0;
-    initial reg_rdata1 = 0;
+    integer r;
+    initial begin
+        for (r = 0; r < LANES; r=r+1) reg_rdata[r] = 0;
+    end
     always @(posedge i_clk) begin
-        reg_rdata0 <= ram_buf[rpage][raddr>>DATA_NBITS][(raddr%8)+0];
-        reg_rdata1 <= ram_buf[rpage][raddr>>DATA_NBITS][(raddr%8)+1];
+        for (r = 0; r < LANES; r=r+1) begin
+            reg_rdata[r] <= ram_buf[rpage][raddr>>DATA_NBITS][(raddr%8)+r];
+        end
     end
 
 
@@ -6,6 +6,7 @@
 // Module Name: zig_zag_stage.v
 // Description:
 //  performs zig-zag ordering of the DCT coefficient
+//  Moves LANES coefficients per cycle (2, 4 or 8) on each side
 //
 // Last Modified: 2021-03-16
 //
@@ -14,16 +15,17 @@
 
 module zig_zag_stage #(
     DATA_WIDTH = 8, // this is an illusion of choice
-    ADDR_WIDTH = 6 // this is also and illusion of choice
+    ADDR_WIDTH = 6, // this is also and illusion of choice
+    LANES = 2 // values per cycle, 2, 4 or 8
 )(
     input i_clk,
     input i_resetn,
-    // to avoid conflicts we write two values at once at sequential addresses
-    input signed [DATA_WIDTH-1 : 0] wdata0, wdata1,
+    // to avoid conflicts we write LANES values at once at sequential addresses
+    input [LANES*DATA_WIDTH-1 : 0] wdata, // first value in the low bits
     input wen,
 
     // reading
-    output signed [DATA_WIDTH-1 : 0] rdata0, rdata1,
+    output [LANES*DATA_WIDTH-1 : 0] rdata,
     output reg rsync // sync the reader reads
 
     );
@@ -35,9 +37,10 @@ module zig_zag_stage #(
     // transpose buffer
     reg [DATA_WIDTH-1 : 0] ram_buf [0: 1][0 : 2**ADDR_WIDTH_HALF-1][0 : 2**ADDR_WIDTH_HALF-1];
     // output buffers
-    reg [DATA_WIDTH-1 : 0] reg_rdata0, reg_rdata1;
+    reg [DATA_WIDTH-1 : 0] reg_rdata [0 : LANES-1];
     // internal waddr and raddr
-    reg [ADDR_WIDTH-1 : 0] waddr, raddr, zz_raddr0, zz_raddr1;
+    reg [ADDR_WIDTH-1 : 0] waddr, raddr;
+    reg [ADDR_WIDTH-1 : 0] zz_raddr [0 : LANES-1];
     // which page of memory to read/write from
     reg wpage;
     wire rpage;
@@ -54,8 +57,12 @@ module zig_zag_stage #(
     assign rpage = ~wpage;
 
     // assign outputs
-    assign rdata0 = reg_rdata0;
-    assign rdata1 = reg_rdata1;
+    genvar g;
+    generate
+        for (g = 0; g < LANES; g = g + 1) begin : out_lane
+            assign rdata[g*DATA_WIDTH +: DATA_WIDTH] = reg_rdata[g];
+        end
+    endgenerate
 
     // handle wpage
     always @(posedge i_clk) begin
@@ -63,7 +70,7 @@ module zig_zag_stage #(
             wpage <= 0;
         end
         else begin
-            if (waddr == 2**ADDR_WIDTH-2 && wen) begin
+            if (waddr == 2**ADDR_WIDTH-LANES && wen) begin
                 // we're at the last write address and are writing
                 wpage <= ~wpage;
             end
@@ -79,19 +86,20 @@ module zig_zag_stage #(
         else begin
             if (wen) begin
                 // should wrap once it's full?
-                waddr <= waddr + 2;
+                waddr <= waddr + LANES;
             end
         end
     end
 
     // handle writing to the ram
-    integer i;
+    integer i, l;
     always @(posedge i_clk) begin
         if (~i_resetn) begin
             // reset the buffers
-            for (i = 0; i < 2**ADDR_WIDTH-1 ; i=i+1) begin
-                ram_buf[wpage][(i%8)+0][i>>DATA_NBITS] <= 0;
-                ram_buf[wpage][(i%8)+1][i>>DATA_NBITS] <= 0;
+            for (i = 0; i < 2**ADDR_WIDTH-1 ; i=i+LANES) begin
+                for (l = 0; l < LANES; l=l+1) begin
+                    ram_buf[wpage][(i%8)+l][i>>DATA_NBITS] <= 0;
+                end
             end 
         end
         else begin
@@ -100,28 +108,32 @@ module zig_zag_stage #(
 //                ram_buf[wpage][row][col]
 //                 normally we would increment columns, and write a row at a time
 //                  for the double buffer we want to increment rows, and write a column at a time
-                ram_buf[wpage][(waddr%8)+0][waddr>>DATA_NBITS] <= wdata0;
-                ram_buf[wpage][(waddr%8)+1][waddr>>DATA_NBITS] <= wdata1;
+                for (l = 0; l < LANES; l=l+1) begin
+                    ram_buf[wpage][(waddr%8)+l][waddr>>DATA_NBITS] <= wdata[l*DATA_WIDTH +: DATA_WIDTH];
+                end
             end
         end
     end
 
     // handle incrementing raddr
+    integer z;
     always @(posedge i_clk) begin
         if (~i_resetn) begin
             // reset raddr
             raddr <= 0;
-            zz_raddr0 <= 0;
-            zz_raddr1 <= 1;
+            for (z = 0; z < LANES; z=z+1) begin
+                zz_raddr[z] <= z;
+            end
         end
         else begin
             if (rsync_ready) begin
                 // should wrap once full, write once we're ready to write
-                raddr <= (raddr + 2) % 2**ADDR_WIDTH;
+                raddr <= (raddr + LANES) % 2**ADDR_WIDTH;
                 // fetch the correct zig-zag read addresses from memory
                 // this works because the data is written into the buffer transposed
-                zz_raddr0 <= zigzag_lut[(raddr + 2) % 2**ADDR_WIDTH];
-                zz_raddr1 <= zigzag_lut[(raddr + 3) % 2**ADDR_WIDTH];
+                for (z = 0; z < LANES; z=z+1) begin
+                    zz_raddr[z] <= zigzag_lut[(raddr + LANES + z) % 2**ADDR_WIDTH];
+                end
             end
         end
     end
@@ -152,7 +164,7 @@ module zig_zag_stage #(
             w_done <= 0;
         end
         else begin
-            if (waddr == 2**ADDR_WIDTH-2 && wen)
+            if (waddr == 2**ADDR_WIDTH-LANES && wen)
                 w_done <= 1;
             else if (waddr == 0)
                 w_done <= 0;
@@ -166,11 +178,11 @@ module zig_zag_stage #(
             rsync_ready <= 0;
         end
         else begin
-            if (waddr == 2**ADDR_WIDTH-2 && wen && !rsync_ready) begin
+            if (waddr == 2**ADDR_WIDTH-LANES && wen && !rsync_ready) begin
                 // if rsync is low and we finished writing a block, set high
                 rsync_ready <= 1;
             end
-            else if (raddr == 2**ADDR_WIDTH-2 && rsync_ready && !w_done && !(waddr == 2**ADDR_WIDTH-2)) begin
+            else if (raddr == 2**ADDR_WIDTH-LANES && rsync_ready && !w_done && !(waddr == 2**ADDR_WIDTH-LANES)) begin
                 // if we're about to finish reading, but not done writing, clear
                 rsync_ready <= 0;
             end
@@ -182,9 +194,11 @@ module zig_zag_stage #(
     end
 
     // handle reading from the ram
+    integer r;
     always @(posedge i_clk) begin
-        reg_rdata0 <= ram_buf[rpage][zz_raddr0>>DATA_NBITS][zz_raddr0%8];
-        reg_rdata1 <= ram_buf[rpage][zz_raddr1>>DATA_NBITS][zz_raddr1%8];
+        for (r = 0; r < LANES; r=r+1) begin
+            reg_rdata[r] <= ram_buf[rpage][zz_raddr[r]>>DATA_NBITS][zz_raddr[r]%8];
+        end
     end
 
 
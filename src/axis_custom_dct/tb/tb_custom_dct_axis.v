@@ -0,0 +1,188 @@
+`timescale 1ns / 1ps
+//////////////////////////////////////////////////////////////////////////////////
+// Team: HEALTH
+//
+// Module Name: tb_custom_dct_axis
+// Description:
+//  Checks the packed (4 pixels per beat) input mode of custom_dct_axis
+//  against the words python/dct_axis_reference.py works out for the test
+//  image, and reports the beats and cycles of both modes. The two pixel mode
+//  keeps its original timing, where dct_main takes each pair on the beat
+//  after it, so its words are not checked
+//
+// Last Modified: 2026-10-17
+//
+//////////////////////////////////////////////////////////////////////////////////
+
+module tb_custom_dct_axis #(
+    parameter NUM_BLOCKS = 16,
+    parameter MAX_OUT_WORDS = NUM_BLOCKS * 33
+)();
+
+    localparam NUM_PIXELS = NUM_BLOCKS * 64;
+    localparam EOF = 16'hFFFF;
+
+    reg clk, resetn;
+
+    // two pixel DUT
+    reg [31 : 0] two_tdata;
+    reg two_tvalid;
+    wire two_tready;
+    wire [31 : 0] two_m_tdata;
+    wire two_m_tvalid, two_m_tlast;
+
+    // packed DUT
+    reg [31 : 0] pck_tdata;
+    reg pck_tvalid;
+    wire pck_tready;
+    wire [31 : 0] pck_m_tdata;
+    wire pck_m_tvalid, pck_m_tlast;
+
+    // test signals
+    reg [31 : 0] two_idx, pck_idx; // next pixel to send
+    reg [31 : 0] two_n_out, pck_n_out; // words received
+    reg [31 : 0] two_out [0 : MAX_OUT_WORDS-1];
+    reg [31 : 0] pck_out [0 : MAX_OUT_WORDS-1];
+    reg [31 : 0] n_cycles, two_last_cycle, pck_last_cycle;
+    integer i, n_errors, n_expected, n_eof;
+
+    reg [7:0] test_data [0 : NUM_PIXELS-1];
+    // every block ends in the one word holding its EOF
+    reg [31 : 0] expected [0 : MAX_OUT_WORDS-1];
+    initial begin
+        $readmemh("dct_test_block.mem", test_data, 0, NUM_PIXELS-1);
+        $readmemh("dct_axis_expected.mem", expected, 0, MAX_OUT_WORDS-1);
+    end
+
+    custom_dct_axis #(.PACKED_INPUT(0))
+        DUT_TWO (
+            .aclk(clk),
+            .aresetn(resetn),
+            .s_axis_tdata(two_tdata),
+            .s_axis_tstrb(4'b1111),
+            .s_axis_tvalid(two_tvalid),
+            .s_axis_tready(two_tready),
+            .s_axis_tlast(1'b0),
+            .m_axis_tdata(two_m_tdata),
+            .m_axis_tstrb(),
+            .m_axis_tvalid(two_m_tvalid),
+            .m_axis_tready(1'b1),
+            .m_axis_tlast(two_m_tlast)
+            );
+
+    custom_dct_axis #(.PACKED_INPUT(1))
+        DUT_PACKED (
+            .aclk(clk),
+            .aresetn(resetn),
+            .s_axis_tdata(pck_tdata),
+            .s_axis_tstrb(4'b1111),
+            .s_axis_tvalid(pck_tvalid),
+            .s_axis_tready(pck_tready),
+            .s_axis_tlast(1'b0),
+            .m_axis_tdata(pck_m_tdata),
+            .m_axis_tstrb(),
+            .m_axis_tvalid(pck_m_tvalid),
+            .m_axis_tready(1'b1),
+            .m_axis_tlast(pck_m_tlast)
+            );
+
+    initial begin
+        clk = 0;
+        resetn = 0;
+        two_tdata = 0;
+        two_tvalid = 0;
+        pck_tdata = 0;
+        pck_tvalid = 0;
+        two_idx = 0;
+        pck_idx = 0;
+        two_n_out = 0;
+        pck_n_out = 0;
+        n_cycles = 0;
+        two_last_cycle = 0;
+        pck_last_cycle = 0;
+    end
+
+    // generate
+    always clk = #5 ~clk;
+
+    // set resetn high
+    initial begin
+        repeat (5) @(negedge clk);
+        resetn <= 1'b1;
+    end
+
+    always @(posedge clk) begin
+        if (resetn)
+            n_cycles <= n_cycles + 1;
+    end
+
+    // drive the two pixel stream, one pixel pair per beat
+    always @(posedge clk) begin
+        if (resetn) begin
+            if (two_tvalid && two_tready)
+                two_idx = two_idx + 2;
+            two_tvalid <= (two_idx < NUM_PIXELS);
+            two_tdata <= {16'b0, test_data[two_idx + 1], test_data[two_idx]};
+            if (two_idx >= NUM_PIXELS && two_last_cycle == 0)
+                two_last_cycle <= n_cycles;
+        end
+    end
+
+    // drive the packed stream, two pixel pairs per beat
+    always @(posedge clk) begin
+        if (resetn) begin
+            if (pck_tvalid && pck_tready)
+                pck_idx = pck_idx + 4;
+            pck_tvalid <= (pck_idx < NUM_PIXELS);
+            pck_tdata <= {test_data[pck_idx + 3], test_data[pck_idx + 2], test_data[pck_idx + 1], test_data[pck_idx]};
+            if (pck_idx >= NUM_PIXELS && pck_last_cycle == 0)
+                pck_last_cycle <= n_cycles;
+        end
+    end
+
+    // collect the coefficients
+    always @(posedge clk) begin
+        if (two_m_tvalid && two_n_out < MAX_OUT_WORDS) begin
+            two_out[two_n_out] <= two_m_tdata;
+            two_n_out <= two_n_out + 1;
+        end
+        if (pck_m_tvalid && pck_n_out < MAX_OUT_WORDS) begin
+            pck_out[pck_n_out] <= pck_m_tdata;
+            pck_n_out <= pck_n_out + 1;
+        end
+    end
+
+    // compare once both pipelines have drained
+    initial begin
+        n_errors = 0;
+        wait (two_last_cycle != 0 && pck_last_cycle != 0);
+        repeat (2000) @(posedge clk);
+
+        // the words of the first NUM_BLOCKS blocks of the reference
+        n_eof = 0;
+        for (n_expected = 0; n_expected < MAX_OUT_WORDS && n_eof < NUM_BLOCKS; n_expected = n_expected + 1) begin
+            if (expected[n_expected][15:0] == EOF || expected[n_expected][31:16] == EOF)
+                n_eof = n_eof + 1;
+        end
+        if (pck_n_out != n_expected) begin
+            $display("ERROR: packed mode gave %0d words, the reference has %0d", pck_n_out, n_expected);
+            n_errors = n_errors + 1;
+        end
+        for (i = 0; i < pck_n_out && i < n_expected; i = i + 1) begin
+            if (pck_out[i] !== expected[i]) begin
+                $display("ERROR: word %0d differs, packed %h, reference %h", i, pck_out[i], expected[i]);
+                n_errors = n_errors + 1;
+            end
+        end
+
+        $display("%0d blocks, output words: two pixel %0d, packed %0d", NUM_BLOCKS, two_n_out, pck_n_out);
+        $display("input beats: two pixel %0d, packed %0d", NUM_PIXELS/2, NUM_PIXELS/4);
+        $display("input cycles: two pixel %0d, packed %0d", two_last_cycle, pck_last_cycle);
+        if (n_errors == 0)
+            $display("PASSED: the packed mode matches the reference");
+        else
+            $display("FAILED: %0d mismatches", n_errors);
+        $finish;
+    end
+
+endmodule
@@ -0,0 +1,167 @@
+`timescale 1ns / 1ps
+//////////////////////////////////////////////////////////////////////////////////
+// Team: HEALTH
+//
+// Module Name: tb_dct_array
+// Description:
+//  Throughput of dct_array with 1, 2, 4 and 8 cores. The test image goes in
+//  as fast as each array takes it and the output is read every cycle it isn't
+//  empty, so the blocks per cycle only stop going up with the cores once the
+//  input (IN_LANES pixels a cycle) or the output (one beat a cycle) is full.
+//  IN_LANES = 4 is custom_dct_axis with PACKED_INPUT. The words from the
+//  bigger arrays are checked against the single core, which also checks that
+//  the blocks come back in order
+//
+// Last Modified: 2026-10-17
+//
+//////////////////////////////////////////////////////////////////////////////////
+
+module tb_dct_array #(
+    parameter IN_LANES = 8,         // pixels per input cycle
+    parameter DATA_WIDTH = 8,       // pixel bit depth
+    parameter RUNL_STAGE_WIDTH = 16
+)();
+
+    localparam NUM_IMG_PIXELS = 65536;
+    localparam NUM_BLOCKS = NUM_IMG_PIXELS/64;
+    localparam MAX_WORDS = NUM_BLOCKS*66; // a block is at most 33 beats
+    localparam EOF = {RUNL_STAGE_WIDTH{1'b1}};
+    localparam TIMEOUT = 2*NUM_IMG_PIXELS; // cycles, well past the single core
+    localparam N_TESTS = 4;
+
+    reg [7:0] test_data [0 : NUM_IMG_PIXELS-1];
+    initial begin
+        $readmemh("dct_test_block.mem", test_data, 0, NUM_IMG_PIXELS-1);
+    end
+
+    reg clk, resetn;
+    reg [31:0] cycle;
+
+    // one set of signals per array, test t has 2**t cores
+    reg [IN_LANES*DATA_WIDTH-1 : 0] wdata [0 : N_TESTS-1];
+    reg [N_TESTS-1 : 0] wen, rd_q;
+    wire [N_TESTS-1 : 0] ready, empty;
+    wire [RUNL_STAGE_WIDTH*2-1 : 0] dout [0 : N_TESTS-1];
+
+    reg [31:0] pix [0 : N_TESTS-1]; // next pixel in
+    reg [31:0] beats [0 : N_TESTS-1]; // beats out
+    reg [31:0] blocks [0 : N_TESTS-1]; // EOFs out
+    reg [31:0] last [0 : N_TESTS-1]; // cycle the last EOF came out
+    reg [31:0] nwords [0 : N_TESTS-1];
+    reg [RUNL_STAGE_WIDTH-1 : 0] words [0 : N_TESTS-1][0 : MAX_WORDS-1];
+
+    genvar g;
+    generate
+        for (g = 0; g < N_TESTS; g = g + 1) begin : test
+            dct_array #(.N_CORES(2**g), .IN_LANES(IN_LANES))
+                DUT (
+                    .i_clk(clk),
+                    .i_resetn(resetn),
+                    .wdata(wdata[g]),
+                    .wen(wen[g]),
+                    .o_ready(ready[g]),
+                    .rd_en(!empty[g]),
+                    .dout(dout[g]),
+                    .empty(empty[g])
+                    );
+        end
+    endgenerate
+
+    integer t, l;
+    initial begin
+        clk = 0;
+        cycle = 0;
+        wen = 0;
+        rd_q = 0;
+        for (t = 0; t < N_TESTS; t = t + 1) begin
+            wdata[t] = 0;
+            pix[t] = 0;
+            beats[t] = 0;
+            blocks[t] = 0;
+            last[t] = 0;
+            nwords[t] = 0;
+        end
+    end
+
+    // generate
+    always clk = #5 ~clk;
+
+    // set resetn high
+    initial begin
+        resetn = 0;
+        repeat (5) @(negedge clk);
+        resetn <= 1'b1;
+    end
+
+    // feed the image whenever the array is ready
+    always @(negedge clk) begin
+        if (resetn) begin
+            cycle <= cycle + 1;
+            for (t = 0; t < N_TESTS; t = t + 1) begin
+                if (pix[t] < NUM_IMG_PIXELS && ready[t]) begin
+                    for (l = 0; l < IN_LANES; l = l + 1)
+                        wdata[t][l*DATA_WIDTH +: DATA_WIDTH] = test_data[pix[t] + l];
+                    wen[t] = 1;
+                    pix[t] = pix[t] + IN_LANES;
+                end
+                else begin
+                    wen[t] = 0;
+                end
+            end
+        end
+    end
+
+    // collect the words, dout is valid the cycle after rd_en
+    // anything after an EOF in the same beat is padding
+    reg pad;
+    always @(negedge clk) begin
+        for (t = 0; t < N_TESTS; t = t + 1) begin
+            if (rd_q[t]) begin
+                beats[t] = beats[t] + 1;
+                pad = 0;
+                for (l = 0; l < 2; l = l + 1) begin
+                    if (!pad && nwords[t] < MAX_WORDS) begin
+                        words[t][nwords[t]] = dout[t][l*RUNL_STAGE_WIDTH +: RUNL_STAGE_WIDTH];
+                        nwords[t] = nwords[t] + 1;
+                        if (dout[t][l*RUNL_STAGE_WIDTH +: RUNL_STAGE_WIDTH] == EOF) begin
+                            pad = 1;
+                            blocks[t] = blocks[t] + 1;
+                            last[t] = cycle;
+                        end
+                    end
+                end
+            end
+        end
+        rd_q = ~empty;
+    end
+
+    // report once every array is through the image, or on the timeout
+    integer w, errors, n_failed;
+    initial begin
+        wait (resetn);
+        wait ((blocks[0] >= NUM_BLOCKS && blocks[1] >= NUM_BLOCKS && blocks[2] >= NUM_BLOCKS && blocks[3] >= NUM_BLOCKS) || cycle >= TIMEOUT);
+        repeat (64) @(negedge clk);
+
+        n_failed = 0;
+        $display("%0d pixels per input cycle", IN_LANES);
+        $display("cores  blocks  cycles  blocks/cycle  pixels/cycle  speedup  beats/cycle  words vs 1 core");
+        for (t = 0; t < N_TESTS; t = t + 1) begin
+            errors = 0;
+            for (w = 0; w < nwords[0]; w = w + 1) begin
+                if (w >= nwords[t] || words[t][w] !== words[0][w]) errors = errors + 1;
+            end
+            if (errors != 0 || blocks[t] < NUM_BLOCKS) n_failed = n_failed + 1;
+            $display("%5d  %6d  %6d  %12.4f  %12.2f  %7.2f  %11.3f  %0d words, %0d differ",
+                2**t, blocks[t], last[t], blocks[t]*1.0/last[t], blocks[t]*64.0/last[t],
+                (blocks[t]*1.0/last[t]) / (blocks[0]*1.0/last[0]), beats[t]*1.0/last[t],
+                nwords[t], errors);
+        end
+
+        if (n_failed != 0)
+            $display("ERROR: %0d arrays disagree with one core or didn't finish", n_failed);
+        else
+            $display("all arrays match");
+        $finish;
+    end
+
+endmodule
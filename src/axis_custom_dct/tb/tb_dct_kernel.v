@@ -0,0 +1,140 @@
+`timescale 1ns / 1ps
+//////////////////////////////////////////////////////////////////////////////////
+// Team: HEALTH
+//
+// Module Name: tb_dct_kernel
+// Description:
+//  The test image through dct_main with the coefficient matrix (KERNEL = 0)
+//  and the fast kernel (KERNEL = 1) side by side. The kernels round
+//  differently so a few quantized coefficients are off by one, this counts
+//  the blocks whose run-length words differ. python/dct_kernel_compare.py
+//  models both bit for bit and says which coefficients, and how far each
+//  kernel is from the exact DCT
+//
+// Last Modified: 2026-10-17
+//
+//////////////////////////////////////////////////////////////////////////////////
+
+module tb_dct_kernel #(
+    parameter LANES = 2,            // pixels per cycle
+    parameter DATA_WIDTH = 8,       // pixel bit depth
+    parameter RUNL_STAGE_WIDTH = 16
+)();
+
+    localparam NUM_IMG_PIXELS = 65536;
+    localparam NUM_BLOCKS = NUM_IMG_PIXELS/64;
+    localparam MAX_WORDS = NUM_BLOCKS*65; // a block is at most 64 words and EOF
+    localparam EOF = {RUNL_STAGE_WIDTH{1'b1}};
+    localparam TIMEOUT = 2*NUM_IMG_PIXELS; // cycles
+
+    reg [7:0] test_data [0 : NUM_IMG_PIXELS-1];
+    initial begin
+        $readmemh("dct_test_block.mem", test_data, 0, NUM_IMG_PIXELS-1);
+    end
+
+    reg clk, resetn;
+    reg [31:0] cycle;
+
+    reg vld;
+    reg [31:0] pix; // next pixel in
+    reg [LANES*DATA_WIDTH-1 : 0] wdata;
+    wire [1:0] sync;
+    wire [LANES*RUNL_STAGE_WIDTH-1 : 0] rdata [0:1];
+
+    // run-length words out of each kernel, EOF padding removed
+    reg [RUNL_STAGE_WIDTH-1 : 0] words [0:1][0 : MAX_WORDS-1];
+    reg [31:0] start [0:1][0 : NUM_BLOCKS]; // first word of each block
+    reg [31:0] nwords [0:1];
+    reg [31:0] blocks [0:1];
+
+    dct_main #(.LANES(LANES), .KERNEL(0))
+        DUT0 (.i_clk(clk), .i_resetn(resetn), .wdata(wdata), .wen(vld), .rdata(rdata[0]), .rsync(sync[0]));
+    dct_main #(.LANES(LANES), .KERNEL(1))
+        DUT1 (.i_clk(clk), .i_resetn(resetn), .wdata(wdata), .wen(vld), .rdata(rdata[1]), .rsync(sync[1]));
+
+    integer k;
+    initial begin
+        clk = 0;
+        cycle = 0;
+        vld = 0;
+        pix = 0;
+        wdata = 0;
+        for (k = 0; k < 2; k = k + 1) begin
+            nwords[k] = 0;
+            blocks[k] = 0;
+            start[k][0] = 0;
+        end
+    end
+
+    // generate
+    always clk = #5 ~clk;
+
+    // set resetn high
+    initial begin
+        resetn = 0;
+        repeat (5) @(negedge clk);
+        resetn <= 1'b1;
+    end
+
+    // feed the image to both, LANES pixels a cycle
+    integer l;
+    always @(negedge clk) begin
+        if (resetn) begin
+            cycle <= cycle + 1;
+            vld <= (pix < NUM_IMG_PIXELS);
+            for (l = 0; l < LANES; l = l + 1) begin
+                if (pix < NUM_IMG_PIXELS) wdata[l*DATA_WIDTH +: DATA_WIDTH] <= test_data[pix + l];
+            end
+            if (pix < NUM_IMG_PIXELS) pix <= pix + LANES;
+        end
+    end
+
+    // collect the words, anything after an EOF in the same beat is padding
+    reg [1:0] pad;
+    always @(negedge clk) begin
+        pad = 0;
+        for (k = 0; k < 2; k = k + 1) begin
+            for (l = 0; l < LANES; l = l + 1) begin
+                if (sync[k] && !pad[k] && nwords[k] < MAX_WORDS) begin
+                    words[k][nwords[k]] = rdata[k][l*RUNL_STAGE_WIDTH +: RUNL_STAGE_WIDTH];
+                    nwords[k] = nwords[k] + 1;
+                    if (rdata[k][l*RUNL_STAGE_WIDTH +: RUNL_STAGE_WIDTH] == EOF && blocks[k] < NUM_BLOCKS) begin
+                        pad[k] = 1;
+                        blocks[k] = blocks[k] + 1;
+                        start[k][blocks[k]] = nwords[k];
+                    end
+                end
+            end
+        end
+    end
+
+    // report once both are through the image, or on the timeout
+    integer b, w, differ;
+    reg diff;
+    initial begin
+        wait (resetn);
+        wait ((blocks[0] >= NUM_BLOCKS && blocks[1] >= NUM_BLOCKS) || cycle >= TIMEOUT);
+        repeat (64) @(negedge clk);
+
+        // compare block by block, a differing coefficient can change the
+        // number of words in its block
+        differ = 0;
+        for (b = 0; b < blocks[0] && b < blocks[1]; b = b + 1) begin
+            diff = (start[0][b+1] - start[0][b] != start[1][b+1] - start[1][b]);
+            for (w = 0; w < start[0][b+1] - start[0][b]; w = w + 1) begin
+                if (words[0][start[0][b] + w] !== words[1][start[1][b] + w]) diff = 1;
+            end
+            if (diff) differ = differ + 1;
+        end
+
+        $display("kernel  blocks  words  multipliers per stage");
+        $display("matrix  %6d  %5d  %21d", blocks[0], nwords[0], 8*LANES/2);
+        $display("fast    %6d  %5d  %21d", blocks[1], nwords[1], LANES == 8 ? 11 : 3*4/(8/LANES));
+        $display("%0d of %0d blocks differ", differ, blocks[1]);
+
+        if (blocks[0] < NUM_BLOCKS || blocks[1] < NUM_BLOCKS)
+            $display("ERROR: a kernel didn't finish");
+        $finish;
+    end
+
+endmodule
@@ -0,0 +1,200 @@
+`timescale 1ns / 1ps
+//////////////////////////////////////////////////////////////////////////////////
+// Team: HEALTH
+//
+// Module Name: tb_dct_lanes
+// Description:
+//  Throughput of dct_main at 2, 4 and 8 lanes. The test image goes into all
+//  three without gaps, and for each width we print the blocks per cycle and
+//  the multipliers and fifos it needs (worked out from the parameters, the
+//  same count the synthesis report gives). The run-length words of the wider
+//  versions are checked against the 2-lane one, EOF padding is skipped (a
+//  block ending in a value and one zero would differ, 2 lanes keep the old
+//  encoding of it, the test image has none). The
+//  2-lane beats, padding and all, are checked against dct_axis_expected.mem
+//  (python/dct_axis_reference.py), the output of the 2-pixel pipeline from
+//  before LANES
+//
+// Last Modified: 2026-10-17
+//
+//////////////////////////////////////////////////////////////////////////////////
+
+module tb_dct_lanes #(
+    parameter DATA_WIDTH = 8,       // pixel bit depth
+    parameter COEFF_WIDTH = 9,
+    parameter FIRST_STAGE_WIDTH = 21,
+    parameter SECOND_STAGE_WIDTH = 25,
+    parameter QUANT_STAGE_WIDTH = 14,
+    parameter RUNL_STAGE_WIDTH = 16
+)();
+
+    localparam NUM_IMG_PIXELS = 65536;
+    localparam NUM_BLOCKS = NUM_IMG_PIXELS/64;
+    localparam MAX_WORDS = NUM_BLOCKS*65; // a block is at most 64 words and EOF
+    localparam EOF = {RUNL_STAGE_WIDTH{1'b1}};
+    localparam TIMEOUT = 3*NUM_IMG_PIXELS; // cycles, well past the 2-lane drain
+    localparam MAX_BEATS = NUM_BLOCKS*33; // 2-lane beats, 66 words a block at most
+
+    reg [7:0] test_data [0 : NUM_IMG_PIXELS-1];
+    reg [2*RUNL_STAGE_WIDTH-1 : 0] expected [0 : MAX_BEATS-1];
+    initial begin
+        $readmemh("dct_test_block.mem", test_data, 0, NUM_IMG_PIXELS-1);
+        $readmemh("dct_axis_expected.mem", expected, 0, MAX_BEATS-1);
+    end
+
+    reg clk, resetn;
+    reg [31:0] cycle;
+
+    // one set of signals per width
+    reg vld2, vld4, vld8;
+    reg [31:0] pix2, pix4, pix8; // next pixel in
+    reg [2*DATA_WIDTH-1 : 0] wdata2;
+    reg [4*DATA_WIDTH-1 : 0] wdata4;
+    reg [8*DATA_WIDTH-1 : 0] wdata8;
+    wire sync2, sync4, sync8;
+    wire [2*RUNL_STAGE_WIDTH-1 : 0] rdata2;
+    wire [4*RUNL_STAGE_WIDTH-1 : 0] rdata4;
+    wire [8*RUNL_STAGE_WIDTH-1 : 0] rdata8;
+
+    // run-length words out, EOF padding removed
+    reg [RUNL_STAGE_WIDTH-1 : 0] words2 [0 : MAX_WORDS-1];
+    reg [RUNL_STAGE_WIDTH-1 : 0] words4 [0 : MAX_WORDS-1];
+    reg [RUNL_STAGE_WIDTH-1 : 0] words8 [0 : MAX_WORDS-1];
+    reg [31:0] nwords2, nwords4, nwords8;
+    reg [31:0] blocks2, blocks4, blocks8;
+    reg [31:0] last2, last4, last8; // cycle the last EOF came out
+    // 2-lane beats as they came out
+    reg [2*RUNL_STAGE_WIDTH-1 : 0] beats2 [0 : MAX_BEATS-1];
+    reg [31:0] nbeats2;
+
+    dct_main #(DATA_WIDTH, COEFF_WIDTH, FIRST_STAGE_WIDTH, SECOND_STAGE_WIDTH, QUANT_STAGE_WIDTH, RUNL_STAGE_WIDTH, 2)
+        DUT2 (.i_clk(clk), .i_resetn(resetn), .wdata(wdata2), .wen(vld2), .rdata(rdata2), .rsync(sync2));
+    dct_main #(DATA_WIDTH, COEFF_WIDTH, FIRST_STAGE_WIDTH, SECOND_STAGE_WIDTH, QUANT_STAGE_WIDTH, RUNL_STAGE_WIDTH, 4)
+        DUT4 (.i_clk(clk), .i_resetn(resetn), .wdata(wdata4), .wen(vld4), .rdata(rdata4), .rsync(sync4));
+    dct_main #(DATA_WIDTH, COEFF_WIDTH, FIRST_STAGE_WIDTH, SECOND_STAGE_WIDTH, QUANT_STAGE_WIDTH, RUNL_STAGE_WIDTH, 8)
+        DUT8 (.i_clk(clk), .i_resetn(resetn), .wdata(wdata8), .wen(vld8), .rdata(rdata8), .rsync(sync8));
+
+    initial begin
+        clk = 0;
+        cycle = 0;
+        vld2 = 0; vld4 = 0; vld8 = 0;
+        pix2 = 0; pix4 = 0; pix8 = 0;
+        wdata2 = 0; wdata4 = 0; wdata8 = 0;
+        nwords2 = 0; nwords4 = 0; nwords8 = 0;
+        blocks2 = 0; blocks4 = 0; blocks8 = 0;
+        last2 = 0; last4 = 0; last8 = 0;
+        nbeats2 = 0;
+    end
+
+    // generate
+    always clk = #5 ~clk;
+
+    // set resetn high
+    initial begin
+        resetn = 0;
+        repeat (5) @(negedge clk);
+        resetn <= 1'b1;
+    end
+
+    // feed the image, LANES pixels a cycle from the first cycle out of reset
+    integer l;
+    always @(negedge clk) begin
+        if (resetn) begin
+            cycle <= cycle + 1;
+
+            vld2 <= (pix2 < NUM_IMG_PIXELS);
+            vld4 <= (pix4 < NUM_IMG_PIXELS);
+            vld8 <= (pix8 < NUM_IMG_PIXELS);
+            for (l = 0; l < 8; l = l + 1) begin
+                if (l < 2 && pix2 < NUM_IMG_PIXELS) wdata2[l*DATA_WIDTH +: DATA_WIDTH] <= test_data[pix2 + l];
+                if (l < 4 && pix4 < NUM_IMG_PIXELS) wdata4[l*DATA_WIDTH +: DATA_WIDTH] <= test_data[pix4 + l];
+                if (pix8 < NUM_IMG_PIXELS) wdata8[l*DATA_WIDTH +: DATA_WIDTH] <= test_data[pix8 + l];
+            end
+            if (pix2 < NUM_IMG_PIXELS) pix2 <= pix2 + 2;
+            if (pix4 < NUM_IMG_PIXELS) pix4 <= pix4 + 4;
+            if (pix8 < NUM_IMG_PIXELS) pix8 <= pix8 + 8;
+        end
+    end
+
+    // collect the words, anything after an EOF in the same beat is padding
+    reg pad2, pad4, pad8;
+    always @(negedge clk) begin
+        pad2 = 0; pad4 = 0; pad8 = 0;
+        if (sync2 && nbeats2 < MAX_BEATS) begin
+            beats2[nbeats2] = rdata2;
+            nbeats2 = nbeats2 + 1;
+        end
+        for (l = 0; l < 8; l = l + 1) begin
+            if (sync2 && l < 2 && !pad2 && nwords2 < MAX_WORDS) begin
+                words2[nwords2] = rdata2[l*RUNL_STAGE_WIDTH +: RUNL_STAGE_WIDTH];
+                nwords2 = nwords2 + 1;
+                if (rdata2[l*RUNL_STAGE_WIDTH +: RUNL_STAGE_WIDTH] == EOF) begin
+                    pad2 = 1; blocks2 = blocks2 + 1; last2 = cycle;
+                end
+            end
+            if (sync4 && l < 4 && !pad4 && nwords4 < MAX_WORDS) begin
+                words4[nwords4] = rdata4[l*RUNL_STAGE_WIDTH +: RUNL_STAGE_WIDTH];
+                nwords4 = nwords4 + 1;
+                if (rdata4[l*RUNL_STAGE_WIDTH +: RUNL_STAGE_WIDTH] == EOF) begin
+                    pad4 = 1; blocks4 = blocks4 + 1; last4 = cycle;
+                end
+            end
+            if (sync8 && !pad8 && nwords8 < MAX_WORDS) begin
+                words8[nwords8] = rdata8[l*RUNL_STAGE_WIDTH +: RUNL_STAGE_WIDTH];
+                nwords8 = nwords8 + 1;
+                if (rdata8[l*RUNL_STAGE_WIDTH +: RUNL_STAGE_WIDTH] == EOF) begin
+                    pad8 = 1; blocks8 = blocks8 + 1; last8 = cycle;
+                end
+            end
+        end
+    end
+
+    // report once every width is through the image, or on the timeout
+    integer w, errors4, errors8, errors_ref, nexpected, neof;
+    initial begin
+        wait (resetn);
+        wait ((blocks2 >= NUM_BLOCKS && blocks4 >= NUM_BLOCKS && blocks8 >= NUM_BLOCKS) || cycle >= TIMEOUT);
+        repeat (64) @(negedge clk);
+
+        errors4 = 0;
+        errors8 = 0;
+        for (w = 0; w < nwords2; w = w + 1) begin
+            if (w >= nwords4 || words4[w] !== words2[w]) errors4 = errors4 + 1;
+            if (w >= nwords8 || words8[w] !== words2[w]) errors8 = errors8 + 1;
+        end
+
+        // the reference beats of the first NUM_BLOCKS blocks, each block ends
+        // in the one beat holding its EOF
+        neof = 0;
+        for (nexpected = 0; nexpected < MAX_BEATS && neof < NUM_BLOCKS; nexpected = nexpected + 1) begin
+            if (expected[nexpected][RUNL_STAGE_WIDTH-1 : 0] == EOF ||
+                expected[nexpected][2*RUNL_STAGE_WIDTH-1 : RUNL_STAGE_WIDTH] == EOF)
+                neof = neof + 1;
+        end
+        errors_ref = (nbeats2 != nexpected);
+        for (w = 0; w < nbeats2 && w < nexpected; w = w + 1) begin
+            if (beats2[w] !== expected[w]) begin
+                if (errors_ref < 10)
+                    $display("ERROR: 2-lane beat %0d is %h, reference %h", w, beats2[w], expected[w]);
+                errors_ref = errors_ref + 1;
+            end
+        end
+
+        $display("lanes  blocks  cycles  blocks/cycle  ideal     multipliers  fifos  words vs 2-lane");
+        $display("%5d  %6d  %6d  %12.4f  %8.4f  %11d  %5d  %0d words, reference",
+            2, blocks2, last2, blocks2*1.0/last2, 2/64.0, 2*8*2/2, 2/2, nwords2);
+        $display("%5d  %6d  %6d  %12.4f  %8.4f  %11d  %5d  %0d words, %0d differ",
+            4, blocks4, last4, blocks4*1.0/last4, 4/64.0, 2*8*4/2, 4/2, nwords4, errors4);
+        $display("%5d  %6d  %6d  %12.4f  %8.4f  %11d  %5d  %0d words, %0d differ",
+            8, blocks8, last8, blocks8*1.0/last8, 8/64.0, 2*8*8/2, 8/2, nwords8, errors8);
+
+        $display("2 lanes: %0d beats, reference %0d beats, %0d differ", nbeats2, nexpected, errors_ref);
+
+        if (cycle >= TIMEOUT || errors4 != 0 || errors8 != 0 || errors_ref != 0)
+            $display("ERROR: lane widths disagree with each other or the reference, or didn't finish");
+        else
+            $display("all widths match");
+        $finish;
+    end
+
+endmodule
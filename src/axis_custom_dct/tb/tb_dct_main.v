@@ -42,13 +42,11 @@ module tb_dct_main #(
     
     dct_main #(DATA_WIDTH, COEFF_WIDTH, FIRST_STAGE_WIDTH, SECOND_STAGE_WIDTH, QUANT_STAGE_WIDTH, RUNL_STAGE_WIDTH)
         DUT (
-            .wdata0(wdata0),
-            .wdata1(wdata1),
+            .wdata({wdata1, wdata0}),
             .i_clk(clk),
             .wen(data_vld),
             .i_resetn(resetn),
-            .rdata0(rdata0),
-            .rdata1(rdata1),
+            .rdata({rdata1, rdata0}),
             .rsync(sync)
             );
     
@@ -32,13 +32,11 @@ reg test_failed, failed;
 
 dct_stage #(DATA_WIDTH, OUTPUT_WIDTH, COEFF_WIDTH)
     DUT (
-        .i_p0(p0),
-        .i_p1(p1),
+        .i_p({p1, p0}),
         .i_clk(clk),
         .i_vld(data_vld),
         .i_resetn(resetn),
-        .o_c0(c0),
-        .o_c1(c1),
+        .o_c({c1, c0}),
         .o_sync(sync)
         );
 
@@ -0,0 +1,305 @@
+`timescale 1ns / 1ps
+//////////////////////////////////////////////////////////////////////////////////
+// Team: HEALTH
+//
+// Module Name: tb_quant_regs
+// Description:
+//  Loads quantization tables into a dct_main through quant_regs and runs the
+//  test image through it next to a dct_main with the default table. The
+//  first half of the image goes through a table one shift coarser than
+//  quant_coeff.mem, then the default table is loaded again while the image is
+//  going in, so every block from some point on has to match the default
+//  dct_main and the ones before it should take fewer words
+//
+// Last Modified: 2026-10-17
+//
+//////////////////////////////////////////////////////////////////////////////////
+
+module tb_quant_regs #(
+    parameter DATA_WIDTH = 8,       // pixel bit depth
+    parameter RUNL_STAGE_WIDTH = 16
+)();
+
+    localparam LANES = 2;
+    localparam NUM_IMG_PIXELS = 65536;
+    localparam NUM_BLOCKS = NUM_IMG_PIXELS/64;
+    localparam MAX_WORDS = NUM_BLOCKS*65; // a block is at most 64 words and EOF
+    localparam EOF = {RUNL_STAGE_WIDTH{1'b1}};
+    localparam TIMEOUT = 4*NUM_IMG_PIXELS; // cycles
+
+    // register map, see quant_regs
+    localparam QUANT_CTRL = 7'h00;
+    localparam QUANT_TABLE = 7'h40;
+
+    reg [7:0] test_data [0 : NUM_IMG_PIXELS-1];
+    reg [7:0] quant_default [0 : 63];
+    initial begin
+        $readmemh("dct_test_block.mem", test_data, 0, NUM_IMG_PIXELS-1);
+        $readmemh("quant_coeff.mem", quant_default, 0, 63);
+    end
+
+    reg clk, resetn;
+    reg [31:0] cycle;
+
+    reg vld;
+    reg [31:0] pix; // next pixel in
+    reg [LANES*DATA_WIDTH-1 : 0] wdata;
+    wire [1:0] sync;
+    wire [LANES*RUNL_STAGE_WIDTH-1 : 0] rdata [0:1];
+
+    // AXI-Lite master
+    reg [6:0] awaddr, araddr;
+    reg awvalid, wvalid, bready, arvalid, rready;
+    reg [31:0] wdata_axi;
+    wire awready, wready, bvalid, arready, rvalid;
+    wire [1:0] bresp, rresp;
+    wire [31:0] rdata_axi;
+
+    wire [64*8-1 : 0] q_table;
+    wire q_load, q_pending;
+
+    // run-length words out of each dct_main, EOF padding removed
+    reg [RUNL_STAGE_WIDTH-1 : 0] words [0:1][0 : MAX_WORDS-1];
+    reg [31:0] start [0:1][0 : NUM_BLOCKS]; // first word of each block
+    reg [31:0] nwords [0:1];
+    reg [31:0] blocks [0:1];
+
+    dct_main #(.LANES(LANES))
+        DUT0 (.i_clk(clk), .i_resetn(resetn), .wdata(wdata), .wen(vld), .rdata(rdata[0]), .rsync(sync[0]),
+              .i_qtable({64{8'h00}}), .i_qload(1'b0), .o_qpending());
+    dct_main #(.LANES(LANES))
+        DUT1 (.i_clk(clk), .i_resetn(resetn), .wdata(wdata), .wen(vld), .rdata(rdata[1]), .rsync(sync[1]),
+              .i_qtable(q_table), .i_qload(q_load), .o_qpending(q_pending));
+
+    quant_regs
+        REGS (
+            .i_clk(clk),
+            .i_resetn(resetn),
+            .o_table(q_table),
+            .o_load(q_load),
+            .i_pending(q_pending),
+            .s_axi_awaddr(awaddr),
+            .s_axi_awprot(3'b000),
+            .s_axi_awvalid(awvalid),
+            .s_axi_awready(awready),
+            .s_axi_wdata(wdata_axi),
+            .s_axi_wstrb(4'b1111),
+            .s_axi_wvalid(wvalid),
+            .s_axi_wready(wready),
+            .s_axi_bresp(bresp),
+            .s_axi_bvalid(bvalid),
+            .s_axi_bready(bready),
+            .s_axi_araddr(araddr),
+            .s_axi_arprot(3'b000),
+            .s_axi_arvalid(arvalid),
+            .s_axi_arready(arready),
+            .s_axi_rdata(rdata_axi),
+            .s_axi_rresp(rresp),
+            .s_axi_rvalid(rvalid),
+            .s_axi_rready(rready)
+            );
+
+    integer k;
+    initial begin
+        clk = 0;
+        cycle = 0;
+        vld = 0;
+        pix = 0;
+        wdata = 0;
+        awaddr = 0;
+        araddr = 0;
+        awvalid = 0;
+        wvalid = 0;
+        bready = 0;
+        arvalid = 0;
+        rready = 0;
+        wdata_axi = 0;
+        for (k = 0; k < 2; k = k + 1) begin
+            nwords[k] = 0;
+            blocks[k] = 0;
+            start[k][0] = 0;
+        end
+    end
+
+    // generate
+    always clk = #5 ~clk;
+
+    // set resetn high
+    initial begin
+        resetn = 0;
+        repeat (5) @(negedge clk);
+        resetn <= 1'b1;
+    end
+
+    // one AXI-Lite write, address and data together
+    task axi_write(input [6:0] addr, input [31:0] data);
+        begin
+            @(negedge clk);
+            awaddr = addr;
+            wdata_axi = data;
+            awvalid = 1;
+            wvalid = 1;
+            bready = 1;
+            // held through the edge that takes them
+            wait (awready && wready);
+            @(posedge clk);
+            @(negedge clk);
+            awvalid = 0;
+            wvalid = 0;
+            wait (bvalid);
+            @(negedge clk);
+            bready = 0;
+        end
+    endtask
+
+    // one AXI-Lite read
+    task axi_read(input [6:0] addr, output [31:0] data);
+        begin
+            @(negedge clk);
+            araddr = addr;
+            arvalid = 1;
+            rready = 1;
+            wait (arready);
+            @(posedge clk);
+            @(negedge clk);
+            arvalid = 0;
+            wait (rvalid);
+            data = rdata_axi;
+            @(negedge clk);
+            rready = 0;
+        end
+    endtask
+
+    // the table word n should hold, off is added to every shift
+    function [31:0] table_word(input integer n, input integer off);
+        begin
+            table_word = {quant_default[4*n+3] + off[7:0], quant_default[4*n+2] + off[7:0],
+                          quant_default[4*n+1] + off[7:0], quant_default[4*n] + off[7:0]};
+        end
+    endfunction
+
+    // feed the image to both once the first table is in, LANES pixels a cycle
+    reg go;
+    integer l;
+    initial go = 0;
+    always @(negedge clk) begin
+        if (resetn) begin
+            cycle <= cycle + 1;
+            vld <= go && (pix < NUM_IMG_PIXELS);
+            for (l = 0; l < LANES; l = l + 1) begin
+                if (go && pix < NUM_IMG_PIXELS) wdata[l*DATA_WIDTH +: DATA_WIDTH] <= test_data[pix + l];
+            end
+            if (go && pix < NUM_IMG_PIXELS) pix <= pix + LANES;
+        end
+    end
+
+    // collect the words, anything after an EOF in the same beat is padding
+    reg [1:0] pad;
+    always @(negedge clk) begin
+        pad = 0;
+        for (k = 0; k < 2; k = k + 1) begin
+            for (l = 0; l < LANES; l = l + 1) begin
+                if (sync[k] && !pad[k] && nwords[k] < MAX_WORDS) begin
+                    words[k][nwords[k]] = rdata[k][l*RUNL_STAGE_WIDTH +: RUNL_STAGE_WIDTH];
+                    nwords[k] = nwords[k] + 1;
+                    if (rdata[k][l*RUNL_STAGE_WIDTH +: RUNL_STAGE_WIDTH] == EOF && blocks[k] < NUM_BLOCKS) begin
+                        pad[k] = 1;
+                        blocks[k] = blocks[k] + 1;
+                        start[k][blocks[k]] = nwords[k];
+                    end
+                end
+            end
+        end
+    end
+
+    // load the tables, then report once both are through the image
+    integer n, b, w, errors, first_match, polls;
+    reg [31:0] rd;
+    reg diff;
+    initial begin
+        errors = 0;
+        wait (resetn);
+
+        // the registers come up as quant_coeff.mem
+        for (n = 0; n < 16; n = n + 1) begin
+            axi_read(QUANT_TABLE + 4*n, rd);
+            if (rd !== table_word(n, 0)) begin
+                $display("ERROR: table word %0d reads %h after reset, expected %h", n, rd, table_word(n, 0));
+                errors = errors + 1;
+            end
+        end
+
+        // one shift coarser everywhere, loaded while the DCT is idle
+        for (n = 0; n < 16; n = n + 1) axi_write(QUANT_TABLE + 4*n, table_word(n, 1));
+        for (n = 0; n < 16; n = n + 1) begin
+            axi_read(QUANT_TABLE + 4*n, rd);
+            if (rd !== table_word(n, 1)) begin
+                $display("ERROR: table word %0d reads %h, wrote %h", n, rd, table_word(n, 1));
+                errors = errors + 1;
+            end
+        end
+        axi_write(QUANT_CTRL, 1);
+        polls = 0;
+        rd = 1;
+        while (rd[0] && polls < 100) begin
+            axi_read(QUANT_CTRL, rd);
+            polls = polls + 1;
+        end
+        if (rd[0]) begin
+            $display("ERROR: the idle DCT never took the table");
+            errors = errors + 1;
+        end
+        go = 1;
+
+        // back to the default table half way through the image
+        wait (pix >= NUM_IMG_PIXELS/2);
+        for (n = 0; n < 16; n = n + 1) axi_write(QUANT_TABLE + 4*n, table_word(n, 0));
+        axi_write(QUANT_CTRL, 1);
+        polls = 0;
+        rd = 1;
+        while (rd[0] && polls < 100) begin
+            axi_read(QUANT_CTRL, rd);
+            polls = polls + 1;
+        end
+        if (rd[0]) begin
+            $display("ERROR: the running DCT never took the table");
+            errors = errors + 1;
+        end
+
+        wait ((blocks[0] >= NUM_BLOCKS && blocks[1] >= NUM_BLOCKS) || cycle >= TIMEOUT);
+        repeat (64) @(negedge clk);
+
+        // every block from first_match on matches the default dct_main
+        first_match = blocks[1];
+        diff = 0;
+        for (b = blocks[1] - 1; b >= 0 && !diff; b = b - 1) begin
+            diff = (start[0][b+1] - start[0][b] != start[1][b+1] - start[1][b]);
+            for (w = 0; w < start[0][b+1] - start[0][b]; w = w + 1) begin
+                if (words[0][start[0][b] + w] !== words[1][start[1][b] + w]) diff = 1;
+            end
+            if (!diff) first_match = b;
+        end
+
+        $display("table    blocks  words");
+        $display("default  %6d  %5d", first_match, start[0][first_match]);
+        $display("coarser  %6d  %5d", first_match, start[1][first_match]);
+        $display("blocks %0d to %0d match the default table", first_match, blocks[1] - 1);
+
+        if (blocks[0] < NUM_BLOCKS || blocks[1] < NUM_BLOCKS) begin
+            $display("ERROR: a dct_main didn't finish");
+            errors = errors + 1;
+        end
+        if (first_match == 0 || first_match > NUM_BLOCKS/2 + 16) begin
+            $display("ERROR: the second table went in at block %0d", first_match);
+            errors = errors + 1;
+        end
+        if (start[1][first_match] >= start[0][first_match]) begin
+            $display("ERROR: the coarser table didn't take fewer words");
+            errors = errors + 1;
+        end
+        if (errors == 0)
+            $display("all tables loaded");
+        $finish;
+    end
+
+endmodule
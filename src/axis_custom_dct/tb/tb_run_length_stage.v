@@ -21,7 +21,7 @@ module tb_run_length_stage #(
     reg [DATA_WIDTH-1 : 0] wdata0, wdata1;
     // output signals
     wire sync;
-    wire [DATA_WIDTH-1 : 0] rdata0, rdata1;
+    wire [OUTPUT_WIDTH-1 : 0] rdata0, rdata1;
     // test signals
     reg [15:0] tstcase;
     reg [7:0] num_iter;
@@ -36,11 +36,9 @@ module tb_run_length_stage #(
         DUT (
             .i_clk(clk),
             .i_resetn(resetn),
-            .i_data0(wdata0),
-            .i_data1(wdata1),
+            .i_data({wdata1, wdata0}),
             .wen(data_vld),
-            .o_data0(rdata0),
-            .o_data1(rdata1),
+            .o_data({rdata1, rdata0}),
             .rsync(sync)
             );
     
@@ -30,13 +30,11 @@ module tb_two_wide_bufs #(
     
     two_wide_transpose_buf #(DATA_WIDTH, ADDR_WIDTH)
         DUT (
-            .wdata0(wdata0),
-            .wdata1(wdata1),
+            .wdata({wdata1, wdata0}),
             .i_clk(clk),
             .wen(data_vld),
             .i_resetn(resetn),
-            .rdata0(rdata0),
-            .rdata1(rdata1),
+            .rdata({rdata1, rdata0}),
             .rsync(sync)
             );
     
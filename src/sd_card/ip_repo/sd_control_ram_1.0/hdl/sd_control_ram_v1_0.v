@@ -20,9 +20,17 @@
         output wire mosi,
         input wire miso,
         output wire spi_sclk, //For spi connection
-        input wire sd_clock, //25Mhz
+        input wire sd_clock, //50Mhz, the SPI clock is divided down from it
         // SDIO lines
         output wire sd_reset, dat1, dat2,
+        // Command done, level high while enabled in the command register
+        output wire sd_irq,
+        // Sector pixels to the DCT's s_axis, clocked by s00_axi_aclk
+        output wire [C_S00_AXI_DATA_WIDTH-1 : 0] m00_axis_tdata,
+        output wire [(C_S00_AXI_DATA_WIDTH/8)-1 : 0] m00_axis_tstrb,
+        output wire m00_axis_tvalid,
+        input wire m00_axis_tready,
+        output wire m00_axis_tlast,
 		// User ports ends
 		// Do not modify the ports beyond this line
 
@@ -54,6 +62,7 @@
 	assign sd_reset = 0;
 	assign dat1 = 0;
 	assign dat2 = 0;
+	assign m00_axis_tstrb = {(C_S00_AXI_DATA_WIDTH/8){1'b1}};
 	// SD card controller
     wire ready, ready_for_next_byte, byte_available;
     wire [4:0] sd_status;
@@ -63,6 +72,14 @@
     wire[C_S00_AXI_DATA_WIDTH-1:0] slv_reg0, slv_reg2;
     // RAM communication
     wire[8:0] wr_addr_off, rd_addr_off;
+    // Multiple block read
+    wire[15:0] block_count, blocks_read;
+    wire sector_free;
+    // Multiple block write
+    wire[15:0] blocks_written;
+    wire sector_ready;
+    wire sd_error;
+    wire[7:0] spi_div;
     
     // Instantiation of Axi Bus Interface S00_AXI
 	sd_control_ram_v1_0_S00_AXI # ( 
@@ -71,6 +88,18 @@
 	) sd_control_ram_v1_0_S00_AXI_inst (
 	    .rd_addr_off(rd_addr_off),
         .wr_addr_off(wr_addr_off),
+        .block_count(block_count),
+        .sector_free(sector_free),
+        .blocks_read(blocks_read),
+        .sector_ready(sector_ready),
+        .blocks_written(blocks_written),
+        .error(sd_error),
+        .irq(sd_irq),
+        .m_axis_tdata(m00_axis_tdata),
+        .m_axis_tvalid(m00_axis_tvalid),
+        .m_axis_tready(m00_axis_tready),
+        .m_axis_tlast(m00_axis_tlast),
+        .spi_div(spi_div),
         .din(din),
 	    .ready(ready),
         .ready_for_next_byte(ready_for_next_byte),
@@ -113,16 +142,25 @@
         .miso(miso),
         .sclk(spi_sclk),
         .rd(slv_reg0[2:2]),
+        .rd_multi(slv_reg0[3:3]),
+        .block_count(block_count),
+        .sector_free(sector_free),
+        .blocks_read(blocks_read),
         .dout(dout),
         .byte_available(byte_available),
         .wr(slv_reg0[1:1]),
+        .wr_multi(slv_reg0[4:4]),
+        .sector_ready(sector_ready),
+        .blocks_written(blocks_written),
+        .error(sd_error),
         .din(din),
         .reset(slv_reg0[0:0]),
         .ready_for_next_byte(ready_for_next_byte),
         .ready(ready),
         .address(slv_reg2[31:0]),
         .clk(sd_clock),
-        .status(sd_status)
+        .status(sd_status),
+        .clk_div(spi_div)
       );
 	// User logic ends
 
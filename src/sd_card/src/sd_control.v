@@ -10,7 +10,12 @@ http://web.mit.edu/6.111/www/f2015/tools/sd_controller.v
 
 `timescale 1ns / 1ps
 
-module sd_controller1(
+module sd_controller1 #(
+    // Modified from original: sd_clock cycles before the card is powered up
+    // and INIT starts, shorten it to simulate
+    parameter BOOT_CYCLES = 27'd100_000_000
+    // End of modification
+)(
     output reg cs, // Connect to SD_DAT[3].
     output mosi, // Connect to SD_CMD.
     input miso, // Connect to SD_DAT[0].
@@ -36,12 +41,42 @@ module sd_controller1(
     output ready, // HIGH if the SD card is ready for a read or write operation.
     input [31:0] address,   // Memory address for read/write operation. This MUST 
                             // be a multiple of 512 bytes, due to SD sectoring.
-    input clk,  // 25 MHz clock.
+    input clk,  // 50 MHz clock.
     output [4:0] status, // For debug purposes: Current state of controller.
     
     // Modified from original source: Added registers to incorporate RAM Buffer:
     output reg[8:0] rd_addr_off, //RAM address offset for SD read operation
-    output reg[8:0] wr_addr_off
+    output reg[8:0] wr_addr_off,
+    // End of modification
+
+    // Modified from original: multiple block read
+    input rd_multi, // Like [rd], but reads [block_count] consecutive 512-byte
+                    // blocks from [address] with READ_MULTIPLE_BLOCK, then
+                    // sends STOP_TRANSMISSION.
+    input [15:0] block_count,
+    input sector_free, // HIGH when the RAM has room for another block. The
+                       // clock is held between blocks until it is.
+    output reg [15:0] blocks_read, // Blocks finished since [rd]/[rd_multi].
+    // End of modification
+
+    // Modified from original: multiple block write
+    input wr_multi, // Like [wr], but starts a WRITE_MULTIPLE_BLOCK at
+                    // [address]. A block is written whenever [sector_ready]
+                    // is HIGH. Releasing [wr_multi] with no block ready sends
+                    // the stop token.
+    input sector_ready, // HIGH when the RAM holds a block not written yet.
+    output reg [15:0] blocks_written, // Blocks written since [wr]/[wr_multi].
+    // End of modification
+
+    // Modified from original
+    output reg error, // The card rejected the last read/write command or a
+                      // written block. Cleared when the next one starts.
+    // End of modification
+
+    // Modified from original: programmable SPI clock
+    input [7:0] clk_div // [sclk] is [clk]/(2*([clk_div]+1)). Keep it at or
+                        // below 400 kHz until the card is initialized, 0
+                        // gives 25 MHz from a 50 MHz [clk].
     // End of modification
 );
 
@@ -73,6 +108,13 @@ module sd_controller1(
     parameter RECEIVE_MSG_WAIT = 20; // For command whose message isn't R1 (instead of R7 for cmd8)
     parameter SEND_CMD_MSG = 21;
     parameter CMD58 = 22; // SD card state
+    parameter READ_MULTI_NEXT = 23; // Between blocks of a multiple block read
+    parameter STOP_TRANSMISSION = 24; // CMD12, ends a multiple block read
+    parameter STOP_WAIT = 25; // Card busy after CMD12 or the stop token
+    parameter WRITE_MULTI_NEXT = 26; // Between blocks of a multiple block write
+    parameter WRITE_STOP_BYTE = 27; // Stop token, ends a multiple block write
+    parameter READ_BLOCK_R1 = 28; // Check the response to CMD17/CMD18
+    parameter WRITE_BLOCK_R1 = 29; // Check the response to CMD24/CMD25
     // End of modification
     
     reg [4:0] state = RST;
@@ -88,15 +130,34 @@ module sd_controller1(
     
     reg [9:0] byte_counter;
     reg [9:0] bit_counter;
+    // Modified from original
+    reg multi = 0; // Current read/write is a multiple block read/write
+    reg [15:0] block_total; // Blocks to read
+    // End of modification
     
-    reg [26:0] boot_counter = 27'd100_000_000;
+    // Modified from original
+    // The state machine moves once every [clk_div]+1 clocks, each move is
+    // half an SPI clock. The power up wait runs at the full clock rate
+    reg [7:0] div_counter = 0;
+    wire step = (state == RST) || (div_counter == 0);
+    always @(posedge clk) begin
+        if (reset == 1 || div_counter == 0)
+            div_counter <= clk_div;
+        else
+            div_counter <= div_counter - 1;
+    end
+    // End of modification
+
+    reg [26:0] boot_counter = BOOT_CYCLES;
     always @(posedge clk) begin
         if(reset == 1) begin
             state <= RST;
             sclk_sig <= 0;
-            boot_counter <= 27'd100_000_000;
+            boot_counter <= BOOT_CYCLES;
         end
-        else begin
+        // Modified from original
+        else if (step) begin
+        // End of modification
             case(state)
                 RST: begin
                     if(boot_counter == 0) begin
@@ -112,6 +173,10 @@ module sd_controller1(
                         // Modified from original
                         rd_addr_off <= 0;
                         wr_addr_off <= 0;
+                        blocks_read <= 0;
+                        blocks_written <= 0;
+                        multi <= 0;
+                        error <= 0;
                         // End of modification
                     end
                     else begin
@@ -176,25 +241,53 @@ module sd_controller1(
                     end
                 end
                 IDLE: begin
-                    if(rd == 1) begin
+                    // Modified from original
+                    if(rd == 1 || rd_multi == 1) begin
                         state <= READ_BLOCK;
+                        blocks_read <= 0;
+                        error <= 0;
                     end
-                    else if(wr == 1) begin
+                    // End of modifications
+                    // Modified from original
+                    else if(wr == 1 || wr_multi == 1) begin
                         state <= WRITE_BLOCK_CMD;
+                        blocks_written <= 0;
+                        error <= 0;
                     end
+                    // End of modifications
                     else begin
                         state <= IDLE;
                     end
                 end
                 READ_BLOCK: begin
-                    cmd_out <= {16'hFF_51, address, 8'hFF};
+                    // Modified from original
+                    // CMD18 instead of CMD17 for a multiple block read
+                    cmd_out <= {8'hFF, (rd_multi ? 8'h52 : 8'h51), address, 8'hFF};
+                    multi <= rd_multi;
+                    block_total <= (block_count == 0) ? 16'd1 : block_count;
+                    // End of modifications
                     bit_counter <= 55;
-                    return_state <= READ_BLOCK_WAIT;
+                    // Modified from original
+                    return_state <= READ_BLOCK_R1;
+                    // End of modifications
                     state <= SEND_CMD;
                     // Modified from original
                     rd_addr_off <= 0; // Added for read RAM buffer
                     // End of modifications
                 end
+                // Modified from original
+                // No data token follows a rejected command
+                READ_BLOCK_R1: begin
+                    if (recv_data[6:0] != 0) begin
+                        error <= 1;
+                        multi <= 0;
+                        state <= IDLE;
+                    end
+                    else begin
+                        state <= READ_BLOCK_WAIT;
+                    end
+                end
+                // End of modifications
                 READ_BLOCK_WAIT: begin
                     if(sclk_sig == 1 && miso == 0) begin
                         byte_counter <= 511;
@@ -223,10 +316,51 @@ module sd_controller1(
                     end
                 end
                 READ_BLOCK_CRC: begin
-                    bit_counter <= 7;
-                    return_state <= IDLE;
+                    // Modified from original
+                    // Both CRC bytes are clocked out before the next block's
+                    // token of a multiple block read
+                    blocks_read <= blocks_read + 1;
+                    if (multi == 1) begin
+                        bit_counter <= 15;
+                        return_state <= READ_MULTI_NEXT;
+                    end
+                    else begin
+                        bit_counter <= 7;
+                        return_state <= IDLE;
+                    end
+                    // End of modifications
                     state <= RECEIVE_BYTE;
                 end
+                // Modified from original
+                // Hold the clock until the next block fits in the RAM
+                READ_MULTI_NEXT: begin
+                    if (blocks_read == block_total) begin
+                        state <= STOP_TRANSMISSION;
+                    end
+                    else if (sector_free == 1) begin
+                        rd_addr_off <= 0;
+                        state <= READ_BLOCK_WAIT;
+                    end
+                end
+                // The 8 extra 1 bits skip the stuff byte the card sends
+                // after CMD12, the R1 follows with the card busy after it
+                STOP_TRANSMISSION: begin
+                    cmd_out <= 56'hFF_4C_00_00_00_00_61;
+                    bit_counter <= 63;
+                    multi <= 0;
+                    return_state <= STOP_WAIT;
+                    state <= SEND_CMD;
+                end
+                STOP_WAIT: begin
+                    if (sclk_sig == 1) begin
+                        if (miso == 1) begin
+                            state <= IDLE;
+                            cmd_mode <= 1;
+                        end
+                    end
+                    sclk_sig <= ~sclk_sig;
+                end
+                // End of modifications
                 SEND_CMD: begin
                     if (sclk_sig == 1) begin
                         if (bit_counter == 0) begin
@@ -292,15 +426,42 @@ module sd_controller1(
                     sclk_sig <= ~sclk_sig;
                 end
                 WRITE_BLOCK_CMD: begin
-                    cmd_out <= {16'hFF_58, address, 8'hFF};
+                    // Modified from original
+                    // CMD25 instead of CMD24 for a multiple block write, which
+                    // waits for its first block after the response
+                    if (wr_multi == 1) begin
+                        cmd_out <= {16'hFF_59, address, 8'hFF};
+                    end
+                    else begin
+                        cmd_out <= {16'hFF_58, address, 8'hFF};
+                    end
+                    return_state <= WRITE_BLOCK_R1;
+                    multi <= wr_multi;
+                    // End of modifications
                     bit_counter <= 55;
-                    return_state <= WRITE_BLOCK_INIT;
                     state <= SEND_CMD;
 		            ready_for_next_byte <= 1;
 		            // Modified from original
 		            wr_addr_off <= 0; // Added for write RAM buffer
 		            // End of modifications
                 end
+                // Modified from original
+                WRITE_BLOCK_R1: begin
+                    ready_for_next_byte <= 0;
+                    if (recv_data[6:0] != 0) begin
+                        error <= 1;
+                        multi <= 0;
+                        state <= IDLE;
+                    end
+                    else if (multi == 1) begin
+                        state <= WRITE_MULTI_NEXT;
+                    end
+                    else begin
+                        ready_for_next_byte <= 1;
+                        state <= WRITE_BLOCK_INIT;
+                    end
+                end
+                // End of modifications
                 WRITE_BLOCK_INIT: begin
                     cmd_mode <= 0;
                     byte_counter <= WRITE_DATA_SIZE; 
@@ -317,7 +478,9 @@ module sd_controller1(
                             data_sig <= 8'hFF;
                         end
                         else if (byte_counter == WRITE_DATA_SIZE) begin
-                            data_sig <= 8'hFE;
+                            // Modified from original
+                            data_sig <= (multi == 1) ? 8'hFC : 8'hFE; // Start token
+                            // End of modifications
                         end
                         else begin
                             // Modified from original
@@ -345,14 +508,61 @@ module sd_controller1(
                     sclk_sig <= ~sclk_sig;
                 end
                 WRITE_BLOCK_WAIT: begin
+                    // Modified from original
+                    // Data response is xxx0_0101 when the block was accepted,
+                    // its last 7 bits are in recv_data
+                    if (recv_data[6:4] != 3'b010) begin
+                        error <= 1;
+                    end
+                    // End of modifications
                     if (sclk_sig == 1) begin
                         if (miso == 1) begin
-                            state <= IDLE;
-                            cmd_mode <= 1;
+                            // Modified from original
+                            blocks_written <= blocks_written + 1;
+                            if (multi == 1) begin
+                                state <= WRITE_MULTI_NEXT;
+                            end
+                            else begin
+                                state <= IDLE;
+                                cmd_mode <= 1;
+                            end
+                            // End of modifications
                         end
                     end
                     sclk_sig = ~sclk_sig;
                 end
+                // Modified from original
+                // Hold the clock until the next block is in the RAM, and
+                // load its first byte on [din] before the start token
+                WRITE_MULTI_NEXT: begin
+                    cmd_mode <= 0;
+                    data_sig <= 8'hFF;
+                    if (sector_ready == 1) begin
+                        ready_for_next_byte <= 1;
+                        wr_addr_off <= 0;
+                        state <= WRITE_BLOCK_INIT;
+                    end
+                    else if (wr_multi == 0) begin
+                        // Stop token and one byte before the card goes busy
+                        data_sig <= 8'hFD;
+                        bit_counter <= 15;
+                        multi <= 0;
+                        state <= WRITE_STOP_BYTE;
+                    end
+                end
+                WRITE_STOP_BYTE: begin
+                    if (sclk_sig == 1) begin
+                        if (bit_counter == 0) begin
+                            state <= STOP_WAIT;
+                        end
+                        else begin
+                            data_sig <= {data_sig[6:0], 1'b1};
+                            bit_counter <= bit_counter - 1;
+                        end
+                    end
+                    sclk_sig <= ~sclk_sig;
+                end
+                // End of modifications
             endcase
         end
     end
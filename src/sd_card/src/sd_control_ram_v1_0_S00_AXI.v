@@ -4,6 +4,9 @@
 	module sd_control_ram_v1_0_S00_AXI #
 	(
 		// Users to add parameters here
+		// SPI clock divider until the firmware changes it, 397 kHz from a
+		// 50 MHz sd_clock
+		parameter [7:0] C_SPI_INIT_DIV = 8'd62,
 
 		// User parameters ends
 		// Do not modify the parameters beyond this line
@@ -27,6 +30,23 @@
 		// For RAM communication
 		input wire[8:0] rd_addr_off, 
 		input wire[8:0] wr_addr_off,
+		// For multiple block reads
+		output wire[15:0] block_count,
+		output wire sector_free,
+		input wire[15:0] blocks_read,
+		// For multiple block writes
+		output wire sector_ready,
+		input wire[15:0] blocks_written,
+		// Command status
+		input wire error,
+		output wire irq,
+		// Sector data streamed to the DCT, see user logic
+		output wire [C_S_AXI_DATA_WIDTH-1:0] m_axis_tdata,
+		output wire m_axis_tvalid,
+		input wire m_axis_tready,
+		output wire m_axis_tlast,
+		// SPI clock divider for the controller, on sd_clock, see user logic
+		output reg [7:0] spi_div = C_SPI_INIT_DIV,
 		// User ports ends
 		// Do not modify the ports beyond this line
 
@@ -134,6 +154,22 @@
 	wire	 slv_reg_rden;
 	wire	 slv_reg_wren;
 	reg [C_S_AXI_DATA_WIDTH-1:0]	 reg_data_out;
+	// Burst read port data, see user logic
+	wire [C_S_AXI_DATA_WIDTH-1:0]	 rd_word;
+	// Sectors sent out of m_axis, see user logic
+	reg [15:0]	 strm_sectors;
+	wire	 stream_en;
+	// blocks_read, blocks_written and the status flags brought over to
+	// S_AXI_ACLK, see user logic
+	wire [15:0]	 blocks_read_axi;
+	wire [15:0]	 blocks_written_axi;
+	wire	 ready_axi;
+	wire	 sd_done_axi;
+	wire	 error_axi;
+	// SPI clock divider as written, brought over to sd_clock as spi_div, and
+	// spi_div brought back for reg 3
+	reg [7:0]	 spi_div_axi;
+	wire [7:0]	 spi_div_used;
 	integer	 byte_index;
 	reg	 aw_en;
 
@@ -247,20 +283,31 @@
 	      //slv_reg1 <= 0;
 	      slv_reg2 <= 0;
 	      //slv_reg3 <= 0;
+	      spi_div_axi <= C_SPI_INIT_DIV;
 	      slv_reg4 <= 0;
 	      //slv_reg5 <= 0;
 	      slv_reg6 <= 0;
 	      slv_reg7 <= 0;
 	      slv_reg8 <= 0;
-	      slv_reg9 <= 0;
+	      //slv_reg9 <= 0;
 	      slv_reg10 <= 0;
 	      slv_reg11 <= 0;
 	      slv_reg12 <= 0;
-	      slv_reg13 <= 0;
+	      //slv_reg13 <= 0;
 	      slv_reg14 <= 0;
-	      slv_reg15 <= 0;
+	      //slv_reg15 <= 0;
 	    end 
 	  else begin
+	    // Burst ports step the RAM address by one word per access, a write
+	    // to the address register in the same cycle takes priority. Reads
+	    // wrap inside the 512 byte sector
+	    if (slv_reg_rden && axi_araddr[ADDR_LSB+OPT_MEM_ADDR_BITS:ADDR_LSB] == 4'h9)
+	      slv_reg8[8:0] <= slv_reg8[8:0] + 4;
+	    if (slv_reg_wren && axi_awaddr[ADDR_LSB+OPT_MEM_ADDR_BITS:ADDR_LSB] == 4'hA)
+	      slv_reg7 <= slv_reg7 + 4;
+	    // The card is identified again after a reset command, at the slow clock
+	    if (slv_reg_wren && axi_awaddr[ADDR_LSB+OPT_MEM_ADDR_BITS:ADDR_LSB] == 4'h0 && S_AXI_WSTRB[0] == 1 && S_AXI_WDATA[0] == 1)
+	      spi_div_axi <= C_SPI_INIT_DIV;
 	    if (slv_reg_wren)
 	      begin
 	        case ( axi_awaddr[ADDR_LSB+OPT_MEM_ADDR_BITS:ADDR_LSB] )
@@ -292,6 +339,10 @@
 	                // Slave register 3
 	                slv_reg3[(byte_index*8) +: 8] <= S_AXI_WDATA[(byte_index*8) +: 8];
 	              end  */
+	          4'h3:
+	            // Only the SPI clock divider in bits [15:8] is writable
+	            if ( S_AXI_WSTRB[1] == 1 )
+	              spi_div_axi <= S_AXI_WDATA[15:8];
 	          4'h4:
 	            for ( byte_index = 0; byte_index <= (C_S_AXI_DATA_WIDTH/8)-1; byte_index = byte_index+1 )
 	              if ( S_AXI_WSTRB[byte_index] == 1 ) begin
@@ -327,13 +378,13 @@
 	                // Slave register 8
 	                slv_reg8[(byte_index*8) +: 8] <= S_AXI_WDATA[(byte_index*8) +: 8];
 	              end  
-	          4'h9:
+	          /*4'h9:
 	            for ( byte_index = 0; byte_index <= (C_S_AXI_DATA_WIDTH/8)-1; byte_index = byte_index+1 )
 	              if ( S_AXI_WSTRB[byte_index] == 1 ) begin
 	                // Respective byte enables are asserted as per write strobes 
 	                // Slave register 9
 	                slv_reg9[(byte_index*8) +: 8] <= S_AXI_WDATA[(byte_index*8) +: 8];
-	              end  
+	              end  */
 	          4'hA:
 	            for ( byte_index = 0; byte_index <= (C_S_AXI_DATA_WIDTH/8)-1; byte_index = byte_index+1 )
 	              if ( S_AXI_WSTRB[byte_index] == 1 ) begin
@@ -355,13 +406,13 @@
 	                // Slave register 12
 	                slv_reg12[(byte_index*8) +: 8] <= S_AXI_WDATA[(byte_index*8) +: 8];
 	              end  
-	          4'hD:
+	          /*4'hD:
 	            for ( byte_index = 0; byte_index <= (C_S_AXI_DATA_WIDTH/8)-1; byte_index = byte_index+1 )
 	              if ( S_AXI_WSTRB[byte_index] == 1 ) begin
 	                // Respective byte enables are asserted as per write strobes 
 	                // Slave register 13
 	                slv_reg13[(byte_index*8) +: 8] <= S_AXI_WDATA[(byte_index*8) +: 8];
-	              end  
+	              end  */
 	          4'hE:
 	            for ( byte_index = 0; byte_index <= (C_S_AXI_DATA_WIDTH/8)-1; byte_index = byte_index+1 )
 	              if ( S_AXI_WSTRB[byte_index] == 1 ) begin
@@ -369,13 +420,13 @@
 	                // Slave register 14
 	                slv_reg14[(byte_index*8) +: 8] <= S_AXI_WDATA[(byte_index*8) +: 8];
 	              end  
-	          4'hF:
+	          /*4'hF:
 	            for ( byte_index = 0; byte_index <= (C_S_AXI_DATA_WIDTH/8)-1; byte_index = byte_index+1 )
 	              if ( S_AXI_WSTRB[byte_index] == 1 ) begin
 	                // Respective byte enables are asserted as per write strobes 
 	                // Slave register 15
 	                slv_reg15[(byte_index*8) +: 8] <= S_AXI_WDATA[(byte_index*8) +: 8];
-	              end  
+	              end  */
 	          default : begin
 	                      slv_reg0 <= slv_reg0;
 	                      //slv_reg1 <= slv_reg1;
@@ -386,13 +437,13 @@
 	                      slv_reg6 <= slv_reg6;
 	                      slv_reg7 <= slv_reg7;
 	                      slv_reg8 <= slv_reg8;
-	                      slv_reg9 <= slv_reg9;
+	                      //slv_reg9 <= slv_reg9;
 	                      slv_reg10 <= slv_reg10;
 	                      slv_reg11 <= slv_reg11;
 	                      slv_reg12 <= slv_reg12;
-	                      slv_reg13 <= slv_reg13;
+	                      //slv_reg13 <= slv_reg13;
 	                      slv_reg14 <= slv_reg14;
-	                      slv_reg15 <= slv_reg15;
+	                      //slv_reg15 <= slv_reg15;
 	                    end
 	        endcase
 	      end
@@ -502,21 +553,21 @@
 	      // Address decoding for reading registers
 	      case ( axi_araddr[ADDR_LSB+OPT_MEM_ADDR_BITS:ADDR_LSB] )
 	        4'h0   : reg_data_out <= slv_reg0;
-	        4'h1   : reg_data_out <= slv_reg1;
+	        4'h1   : reg_data_out <= {slv_reg1[31:6], error_axi, sd_done_axi, ~ready_axi, slv_reg1[2:0]};
 	        4'h2   : reg_data_out <= slv_reg2;
-	        4'h3   : reg_data_out <= slv_reg3;
+	        4'h3   : reg_data_out <= {16'b0, spi_div_used, 3'b0, slv_reg3[4:0]};
 	        4'h4   : reg_data_out <= slv_reg4;
 	        4'h5   : reg_data_out <= slv_reg5;
 	        4'h6   : reg_data_out <= slv_reg6;
 	        4'h7   : reg_data_out <= slv_reg7;
 	        4'h8   : reg_data_out <= slv_reg8;
-	        4'h9   : reg_data_out <= slv_reg9;
+	        4'h9   : reg_data_out <= rd_word;
 	        4'hA   : reg_data_out <= slv_reg10;
-	        4'hB   : reg_data_out <= slv_reg11;
+	        4'hB   : reg_data_out <= stream_en ? {16'b0, strm_sectors} : slv_reg11;
 	        4'hC   : reg_data_out <= slv_reg12;
-	        4'hD   : reg_data_out <= slv_reg13;
+	        4'hD   : reg_data_out <= {16'b0, blocks_read_axi};
 	        4'hE   : reg_data_out <= slv_reg14;
-	        4'hF   : reg_data_out <= slv_reg15;
+	        4'hF   : reg_data_out <= {16'b0, blocks_written_axi};
 	        default : reg_data_out <= 0;
 	      endcase
 	end
@@ -542,49 +593,343 @@
 
 	// Add user logic here
 	// RAM Buffer
+	// Each RAM is split into four byte lanes (byte address % 4) so a whole
+	// 32-bit word can be moved per AXI access through the burst ports:
+	//  reg 9  (read):  4 bytes of rd_ram starting at slv_reg8, first byte in
+	//                  bits [7:0], then slv_reg8 += 4. Any byte alignment.
+	//  reg 10 (write): 4 bytes into wr_ram at slv_reg7 (word aligned, WSTRB
+	//                  picks the bytes), then slv_reg7 += 4.
+	// rd_ram holds C_RD_SECTORS sectors as a FIFO for multiple block reads,
+	// block n goes to sector n % C_RD_SECTORS (slv_reg8[10:9]):
+	//  reg 11 (write): blocks the firmware is done with
+	//  reg 11 (read):  the same, or blocks sent out of m_axis while streaming
+	//  reg 12 (write): blocks to read with CMD_READ_MULTI
+	//  reg 13 (read):  blocks read so far
+	// wr_ram holds C_WR_SECTORS sectors the same way for multiple block
+	// writes, block n comes from sector n % C_WR_SECTORS (slv_reg7[10:9]):
+	//  reg 14 (write): blocks the firmware has put in wr_ram
+	//  reg 15 (read):  blocks written so far
+	// SPI clock
+	//  reg 3 (write): divider in bits [15:8], the SPI clock is
+	//                 sd_clock/(2*(divider+1)). It resets to C_SPI_INIT_DIV,
+	//                 and goes back to it with CMD_RESET, so the card is
+	//                 always identified at or below 400 kHz. The firmware
+	//                 speeds it up once the controller is ready
+	//  reg 3 (read):  the divider, and the controller state in bits [4:0]
 	parameter C_DATA_WIDTH = 8; //8-bit
 	parameter C_ADDR_WIDTH = 512; //512 address spaces
-	(* ram_style = "block" *) reg[C_DATA_WIDTH-1:0] rd_ram [C_ADDR_WIDTH-1:0];
-	(* ram_style = "block" *) reg[C_DATA_WIDTH-1:0] wr_ram [C_ADDR_WIDTH-1:0];
+	localparam C_RD_SECTOR_BITS = 2;
+	localparam C_RD_SECTORS = 1 << C_RD_SECTOR_BITS; //sectors in rd_ram
+	localparam C_WR_SECTOR_BITS = 2;
+	localparam C_WR_SECTORS = 1 << C_WR_SECTOR_BITS; //sectors in wr_ram
+	localparam C_LANES = 4;
+	localparam C_LANE_DEPTH = C_ADDR_WIDTH / C_LANES;
+
+	// Clock crossings
+	// The sector counts go between sd_clock and S_AXI_ACLK as gray code
+	// through two flip-flops, so a count caught while it changes is either the
+	// old one or the new one. Each side only ever sees the other's count late,
+	// which only holds a sector back a little longer. The counts step by one,
+	// apart from going back to 0 when a command starts, and nothing looks at
+	// them until the command has been sent to the card
+	function [15:0] bin2gray(input [15:0] bin);
+	    bin2gray = bin ^ (bin >> 1);
+	endfunction
+
+	function [15:0] gray2bin(input [15:0] gray);
+	    integer i;
+	    begin
+	        gray2bin[15] = gray[15];
+	        for (i = 14; i >= 0; i = i - 1)
+	            gray2bin[i] = gray2bin[i+1] ^ gray[i];
+	    end
+	endfunction
+
+	// Read sectors the card has filled, to the AXI side
+	reg ready_q = 0; // ready on sd_clock, see the status registers
+	reg sd_done = 0; // see the status registers
+	reg [15:0] blocks_read_gray = 0;
+	(* ASYNC_REG = "TRUE" *) reg [15:0] blocks_read_meta = 0, blocks_read_sync = 0;
+	(* ASYNC_REG = "TRUE" *) reg ready_meta = 0, ready_sync = 0;
+	(* ASYNC_REG = "TRUE" *) reg sd_done_meta = 0, sd_done_sync = 0;
+	(* ASYNC_REG = "TRUE" *) reg error_meta = 0, error_sync = 0;
+	always @( posedge sd_clock )
+	begin
+	   blocks_read_gray <= bin2gray(blocks_read);
+	end
+	always @( posedge S_AXI_ACLK )
+	begin
+	   blocks_read_meta <= blocks_read_gray;
+	   blocks_read_sync <= blocks_read_meta;
+	   // ready_q, registered like blocks_read_gray so they come over together
+	   ready_meta <= ready_q;
+	   ready_sync <= ready_meta;
+	   // sd_done is set on the edge ready_q rises, error before it, so done
+	   // doesn't come over ahead of busy or of the error it reports
+	   sd_done_meta <= sd_done;
+	   sd_done_sync <= sd_done_meta;
+	   error_meta <= error;
+	   error_sync <= error_meta;
+	end
+	assign blocks_read_axi = gray2bin(blocks_read_sync);
+	// busy reads back from here, so once the firmware sees a command start
+	// reg 13 doesn't hold the last one's count
+	assign ready_axi = ready_sync;
+	assign sd_done_axi = sd_done_sync;
+	assign error_axi = error_sync;
+
+	// SPI clock divider to sd_clock. The firmware only writes it while the
+	// controller is idle, and the controller only takes it while idle or
+	// held in RST and once two samples agree, so no command runs on a
+	// divider still coming over. Reg 3 reads back the divider in use, so the
+	// firmware can wait for it before the next command
+	(* ASYNC_REG = "TRUE" *) reg [7:0] spi_div_meta = C_SPI_INIT_DIV, spi_div_sync = C_SPI_INIT_DIV;
+	reg [7:0] spi_div_q = C_SPI_INIT_DIV;
+	always @( posedge sd_clock )
+	begin
+	   spi_div_meta <= spi_div_axi;
+	   spi_div_sync <= spi_div_meta;
+	   spi_div_q <= spi_div_sync;
+	   if ((ready == 1 || status == 5'd0) && spi_div_sync == spi_div_q)
+	       spi_div <= spi_div_sync;
+	end
+	(* ASYNC_REG = "TRUE" *) reg [7:0] spi_div_used_meta = C_SPI_INIT_DIV, spi_div_used_sync = C_SPI_INIT_DIV;
+	always @( posedge S_AXI_ACLK )
+	begin
+	   spi_div_used_meta <= spi_div;
+	   spi_div_used_sync <= spi_div_used_meta;
+	end
+	assign spi_div_used = spi_div_used_sync;
+
+	// Read sectors given back, by the firmware (reg 11) or the stream, to the
+	// card side. Either is only switched or cleared between commands
+	reg [15:0] rd_released_gray = 0;
+	(* ASYNC_REG = "TRUE" *) reg [15:0] rd_released_meta = 0, rd_released_sync = 0;
+	always @( posedge S_AXI_ACLK )
+	begin
+	   rd_released_gray <= bin2gray(stream_en ? strm_sectors : slv_reg11[15:0]);
+	end
+	always @( posedge sd_clock )
+	begin
+	   rd_released_meta <= rd_released_gray;
+	   rd_released_sync <= rd_released_meta;
+	end
+
+	// Write sectors the card has written, to the AXI side
+	reg [15:0] blocks_written_gray = 0;
+	(* ASYNC_REG = "TRUE" *) reg [15:0] blocks_written_meta = 0, blocks_written_sync = 0;
+	always @( posedge sd_clock )
+	begin
+	   blocks_written_gray <= bin2gray(blocks_written);
+	end
+	always @( posedge S_AXI_ACLK )
+	begin
+	   blocks_written_meta <= blocks_written_gray;
+	   blocks_written_sync <= blocks_written_meta;
+	end
+	assign blocks_written_axi = gray2bin(blocks_written_sync);
+
+	// Write sectors the firmware has put in wr_ram (reg 14), to the card side.
+	// It is cleared before the write command is given
+	reg [15:0] wr_queued_gray = 0;
+	(* ASYNC_REG = "TRUE" *) reg [15:0] wr_queued_meta = 0, wr_queued_sync = 0;
+	always @( posedge S_AXI_ACLK )
+	begin
+	   wr_queued_gray <= bin2gray(slv_reg14[15:0]);
+	end
+	always @( posedge sd_clock )
+	begin
+	   wr_queued_meta <= wr_queued_gray;
+	   wr_queued_sync <= wr_queued_meta;
+	end
+
+	// sector_free and sector_ready on the card side, rd_sectors_held on the
+	// AXI side
+	wire [15:0] rd_sectors_held_sd = blocks_read - gray2bin(rd_released_sync);
+	wire [15:0] rd_sectors_held = blocks_read_axi - (stream_en ? strm_sectors : slv_reg11[15:0]);
+	assign block_count = slv_reg12[15:0];
+	assign sector_free = (rd_sectors_held_sd < C_RD_SECTORS);
+	wire [15:0] wr_sectors_held = gray2bin(wr_queued_sync) - blocks_written;
+	assign sector_ready = (wr_sectors_held != 0);
+	wire [C_LANES*C_DATA_WIDTH-1:0] rd_lane_q;
+	wire [C_LANES*C_DATA_WIDTH-1:0] wr_lane_q;
+	reg [1:0] rd_rot;
+	reg [1:0] wr_lane_sel;
+	wire [2*C_LANES*C_DATA_WIDTH-1:0] rd_lane_q2 = {rd_lane_q, rd_lane_q};
+	// rd_ram read address, the burst port's or the stream's
+	wire [8+C_RD_SECTOR_BITS:0] rd_ptr;
+	// rd_ram[rd_ptr], rd_ram[rd_ptr+1], ... one cycle after rd_ptr changes
+	assign rd_word = rd_lane_q2 >> {rd_rot, 3'b000};
+
+	// Stream to the DCT
+	// While bit 5 of the command register is set, the sectors of a multiple
+	// block read go out of m_axis instead of the burst port, 4 pixels per beat
+	// for custom_dct_axis with PACKED_INPUT. Only the first C_STREAM_BYTES of
+	// each sector are sent, SD_BLOCKS_PER_SECTOR 8x8 blocks. A sector goes
+	// back to the card once its last beat is taken, so the DCT holds the card
+	// clock through m_axis_tready the same way the firmware does with reg 11.
+	// Writes to reg 11 set the number of blocks the stream may send. The DCT
+	// only raises TLAST once it's empty, so the firmware keeps this a few
+	// blocks ahead of the coefficients it has taken, or they overflow its
+	// RX FIFO
+	localparam C_STREAM_BYTES = 448;
+	localparam S_WAIT = 0, S_FETCH = 1, S_SEND = 2;
+	reg [1:0] strm_state;
+	reg strm_armed; // the read has started and blocks_read_axi counts its sectors
+	reg [8:0] strm_off; // RAM byte of the next beat, the card data starts at 1
+	reg [15:0] strm_blocks; // 8x8 blocks sent
+	wire strm_last_beat = ({1'b0, strm_off} + 10'd4 > C_STREAM_BYTES);
+	wire strm_block_end = (strm_off[5:0] == 6'd61); // last beat of a 64 byte block
+	wire strm_credit = (strm_blocks != slv_reg11[15:0]);
+	assign stream_en = slv_reg0[5];
+	assign rd_ptr = stream_en ? {strm_sectors[C_RD_SECTOR_BITS-1:0], strm_off} : slv_reg8[8+C_RD_SECTOR_BITS:0];
+	assign m_axis_tdata = rd_word;
+	assign m_axis_tvalid = (strm_state == S_SEND);
+	assign m_axis_tlast = (strm_state == S_SEND) && strm_last_beat && (strm_sectors + 1 == block_count);
+
+	always @( posedge S_AXI_ACLK )
+	begin
+	   if ( S_AXI_ARESETN == 1'b0 || stream_en == 0 ) begin
+	       strm_state <= S_WAIT;
+	       strm_armed <= 0;
+	       strm_sectors <= 0;
+	       strm_blocks <= 0;
+	       strm_off <= 1;
+	   end
+	   else begin
+	       // blocks_read still holds the last read's count until the controller
+	       // leaves idle, and its clearing may come over after ready
+	       if (ready_axi == 0 && blocks_read_axi == 0)
+	           strm_armed <= 1;
+	       case (strm_state)
+	           S_WAIT: begin
+	               if (strm_armed && rd_sectors_held != 0 && strm_credit)
+	                   strm_state <= S_FETCH;
+	           end
+	           S_FETCH: begin
+	               // rd_word follows rd_ptr a cycle later
+	               strm_state <= S_SEND;
+	           end
+	           S_SEND: begin
+	               if (m_axis_tready) begin
+	                   if (strm_last_beat) begin
+	                       strm_off <= 1;
+	                       strm_sectors <= strm_sectors + 1;
+	                       strm_blocks <= strm_blocks + 1;
+	                       strm_state <= S_WAIT;
+	                   end
+	                   else if (strm_block_end) begin
+	                       // the sector stays held while the next block waits
+	                       strm_off <= strm_off + 4;
+	                       strm_blocks <= strm_blocks + 1;
+	                       strm_state <= S_WAIT;
+	                   end
+	                   else begin
+	                       strm_off <= strm_off + 4;
+	                       strm_state <= S_FETCH;
+	                   end
+	               end
+	           end
+	           default: strm_state <= S_WAIT;
+	       endcase
+	   end
+	end
+
 	// SD card status registers
+	//  [3] busy:  a command is running (or the card is being initialised)
+	//  [4] done:  set when the controller goes back to idle, cleared when
+	//             the next command starts
+	//  [5] error: the card rejected the last command or a written block
+	// irq is done while enabled by bit 8 of the command register. Busy, done
+	// and error are read, and irq raised, from their S_AXI_ACLK copies
+	always @(posedge sd_clock) begin
+       ready_q <= ready;
+       if (ready == 1 && ready_q == 0)
+           sd_done <= 1;
+       else if (ready == 0)
+           sd_done <= 0;
+    end
+    assign irq = sd_done_axi & slv_reg0[8];
+
 	always @(posedge sd_clock) begin
        slv_reg1[0:0] = ready;
        slv_reg1[1:1] = ready_for_next_byte;
        slv_reg1[2:2] = byte_available;
+       slv_reg1[3:3] = ~ready;
+       slv_reg1[4:4] = sd_done;
+       slv_reg1[5:5] = error;
     end
     
 	// Debug purposes
     always @(posedge sd_clock) begin
        slv_reg3[4:0] = status;
     end
-    
-    // Write to RAM for SD card read later
-    always @( posedge S_AXI_ACLK )
+
+	genvar lane;
+	generate
+	for (lane = 0; lane < C_LANES; lane = lane + 1) begin : ram_lane
+	    (* ram_style = "block" *) reg[C_DATA_WIDTH-1:0] rd_ram [C_RD_SECTORS*C_LANE_DEPTH-1:0];
+	    (* ram_style = "block" *) reg[C_DATA_WIDTH-1:0] wr_ram [C_WR_SECTORS*C_LANE_DEPTH-1:0];
+	    reg[C_DATA_WIDTH-1:0] rd_q, wr_q;
+	    assign rd_lane_q[lane*C_DATA_WIDTH +: C_DATA_WIDTH] = rd_q;
+	    assign wr_lane_q[lane*C_DATA_WIDTH +: C_DATA_WIDTH] = wr_q;
+
+	    // Write to RAM for SD card read later
+	    always @( posedge S_AXI_ACLK )
+	    begin
+	       if (slv_reg_wren && axi_awaddr[ADDR_LSB+OPT_MEM_ADDR_BITS:ADDR_LSB] == 4'hA) begin
+	           if (S_AXI_WSTRB[lane] == 1)
+	               wr_ram[slv_reg7[8+C_WR_SECTOR_BITS:2]] <= S_AXI_WDATA[lane*C_DATA_WIDTH +: C_DATA_WIDTH];
+	       end
+	       else if (slv_reg6[1:1] == 1 && slv_reg7[1:0] == lane)
+	           wr_ram[slv_reg7[8+C_WR_SECTOR_BITS:2]] <= slv_reg4[7:0];
+	    end
+
+	    // Read RAM, lanes below the start byte come from the next word
+	    always @( posedge S_AXI_ACLK )
+	    begin
+	       rd_q <= rd_ram[{rd_ptr[8+C_RD_SECTOR_BITS:9], rd_ptr[8:2] + (lane < rd_ptr[1:0])}];
+	    end
+
+	    // Commands from SD card controller
+	    // Data read from SD card
+	    always @( negedge sd_clock )
+	    begin
+	       if (byte_available == 1 && rd_addr_off[1:0] == lane)
+	           rd_ram[{blocks_read[C_RD_SECTOR_BITS-1:0], rd_addr_off[8:2]}] <= dout;
+	    end
+
+	    // Data to write to SD card
+	    always @( posedge sd_clock )
+	    begin
+	       if (ready_for_next_byte == 1)
+	           wr_q <= wr_ram[{blocks_written[C_WR_SECTOR_BITS-1:0], wr_addr_off[8:2]}];
+	    end
+	end
+	endgenerate
+
+	always @( posedge S_AXI_ACLK )
 	begin
-	   if (slv_reg6[1:1] == 1)
-	       wr_ram[slv_reg7[8:0]] <= slv_reg4[7:0];
+	   rd_rot <= rd_ptr[1:0];
 	end
-	
+
 	// Read RAM
 	always @( posedge S_AXI_ACLK )
 	begin
 	   if (slv_reg6[2:2] == 1)
-	       slv_reg5[8:0] <= rd_ram[slv_reg8[8:0]];
+	       slv_reg5[8:0] <= rd_word[7:0];
 	end
-	
-	// Commands from SD card controller
-	// Data read from SD card
-	always @( negedge sd_clock )
+
+	always @( posedge sd_clock )
 	begin
-	   if (byte_available == 1)
-	       rd_ram[rd_addr_off] <= dout;
+	   if (ready_for_next_byte == 1)
+	       wr_lane_sel <= wr_addr_off[1:0];
 	end
-	
+
 	// Data to write to SD card
-	always @( posedge sd_clock )
+	always @(*)
 	begin
-	   if (ready_for_next_byte == 1)
-	       din <= wr_ram[wr_addr_off];
+	   din = wr_lane_q[wr_lane_sel*C_DATA_WIDTH +: C_DATA_WIDTH];
 	end
 	// User logic ends
 
@@ -0,0 +1,306 @@
+`timescale 1ns / 1ps
+//////////////////////////////////////////////////////////////////////////////////
+// Team: HEALTH
+//
+// Module Name: sd_card_model
+// Description:
+//  Behavioural SPI mode SDHC card for simulating sd_controller1. Answers the
+//  init sequence (CMD0, CMD8, CMD58, CMD55/ACMD41), single and multiple block
+//  reads and writes (CMD17/18/24/25) and CMD12, with sector addresses. The
+//  card holds MEM_SECTORS sectors in mem, the testbench can fill it directly.
+//  MOSI is sampled on the rising SCLK edge and MISO changes on the falling
+//  edge, so the card only moves while the controller clocks it. SCLK faster
+//  than F_OD_KHZ before ACMD41 has finished, or F_PP_KHZ after, is counted
+//  in n_clk_errors
+//
+// Last Modified: 2026-10-17
+//
+//////////////////////////////////////////////////////////////////////////////////
+
+module sd_card_model #(
+    parameter MEM_SECTORS = 256,
+    parameter INIT_POLLS = 2, // ACMD41s answered with the idle bit before the card is ready
+    parameter NAC_BYTES = 4, // 0xFF bytes before each data token
+    parameter BUSY_BYTES = 4, // busy bytes after a written block, CMD12 and the stop token
+    parameter F_OD_KHZ = 400, // fastest SCLK while the card is identified
+    parameter F_PP_KHZ = 25000 // fastest SCLK afterwards, default speed
+)(
+    input cs,
+    input sclk,
+    input mosi,
+    output reg miso
+);
+
+    localparam M_CMD = 0; // waiting for a command
+    localparam M_WR_TOKEN = 1; // waiting for a data token
+    localparam M_WR_DATA = 2; // receiving a written block and its CRC
+
+    localparam TX_LEN = 2048;
+
+    reg [7:0] mem [0 : MEM_SECTORS*512-1];
+
+    // bytes queued for MISO
+    reg [7:0] tx_q [0 : TX_LEN-1];
+    integer tx_head, tx_tail;
+    reg [7:0] tx_byte;
+    integer tx_bits; // bits of tx_byte left to send
+
+    reg [47:0] cmd_sr;
+    integer cmd_bits; // bits of the command received, 0 while waiting for a start bit
+    reg [7:0] rx_byte;
+    integer rx_bits, wr_count;
+
+    integer mode;
+    reg idle; // R1 idle bit, set until ACMD41 finishes initialization
+    integer polls;
+    reg rd_multi, wr_multi;
+    reg [31:0] rd_sector, wr_sector;
+
+    // for the testbench
+    integer n_cmds, n_blocks_read, n_blocks_written;
+    integer n_clk_errors;
+    realtime t_rise, t_min_init, t_min; // shortest SCLK periods seen, ns
+
+    integer i;
+
+    initial begin
+        miso = 1;
+        tx_head = 0;
+        tx_tail = 0;
+        tx_bits = 0;
+        tx_byte = 8'hFF;
+        cmd_bits = 0;
+        cmd_sr = 0;
+        rx_byte = 8'hFF;
+        rx_bits = 0;
+        wr_count = 0;
+        mode = M_CMD;
+        idle = 1;
+        polls = INIT_POLLS;
+        rd_multi = 0;
+        wr_multi = 0;
+        rd_sector = 0;
+        wr_sector = 0;
+        n_cmds = 0;
+        n_blocks_read = 0;
+        n_blocks_written = 0;
+        n_clk_errors = 0;
+        t_rise = -1;
+        t_min_init = 0;
+        t_min = 0;
+        for (i = 0; i < MEM_SECTORS*512; i = i + 1)
+            mem[i] = 0;
+    end
+
+    task push(input [7:0] data);
+        begin
+            tx_q[tx_tail % TX_LEN] = data;
+            tx_tail = tx_tail + 1;
+        end
+    endtask
+
+    // drop everything queued, including the byte going out
+    task flush;
+        begin
+            tx_head = tx_tail;
+            tx_bits = 0;
+        end
+    endtask
+
+    // data token, sector and CRC of one read block
+    task push_block(input [31:0] sector);
+        begin
+            for (i = 0; i < NAC_BYTES; i = i + 1)
+                push(8'hFF);
+            push(8'hFE);
+            for (i = 0; i < 512; i = i + 1)
+                push(mem[(sector % MEM_SECTORS)*512 + i]);
+            // the controller doesn't check the CRC
+            push(8'h5A);
+            push(8'hA5);
+            n_blocks_read = n_blocks_read + 1;
+        end
+    endtask
+
+    task push_busy;
+        begin
+            for (i = 0; i < BUSY_BYTES; i = i + 1)
+                push(8'h00);
+        end
+    endtask
+
+    task command(input [5:0] index, input [31:0] arg);
+        begin
+            n_cmds = n_cmds + 1;
+            if (index == 12) begin
+                // the block being sent is cut off
+                flush;
+                rd_multi = 0;
+            end
+            // one byte before the response, the stuff byte after CMD12
+            push(8'hFF);
+            case (index)
+                0: begin
+                    idle = 1;
+                    polls = INIT_POLLS;
+                    push({7'b0, idle});
+                end
+                8: begin
+                    // R7, voltage accepted and the check pattern echoed
+                    push({7'b0, idle});
+                    push(8'h00);
+                    push(8'h00);
+                    push(arg[15:8]);
+                    push(arg[7:0]);
+                end
+                58: begin
+                    // R3, powered up and high capacity
+                    push({7'b0, idle});
+                    push(8'hC0);
+                    push(8'hFF);
+                    push(8'h80);
+                    push(8'h00);
+                end
+                55: push({7'b0, idle});
+                41: begin
+                    if (polls > 0)
+                        polls = polls - 1;
+                    else
+                        idle = 0;
+                    push({7'b0, idle});
+                end
+                12: begin
+                    push(8'h00);
+                    push_busy;
+                end
+                17, 18: begin
+                    if (arg >= MEM_SECTORS) begin
+                        push(8'h40); // address error, no data follows
+                    end
+                    else begin
+                        push(8'h00);
+                        rd_sector = arg;
+                        rd_multi = (index == 18);
+                        push_block(rd_sector);
+                    end
+                end
+                24, 25: begin
+                    if (arg >= MEM_SECTORS) begin
+                        push(8'h40);
+                    end
+                    else begin
+                        push(8'h00);
+                        wr_sector = arg;
+                        wr_multi = (index == 25);
+                        rx_byte = 8'hFF;
+                        mode = M_WR_TOKEN;
+                    end
+                end
+                default: push({7'b0000010, idle}); // illegal command
+            endcase
+        end
+    endtask
+
+    always @(posedge sclk) begin
+        if (!cs) begin
+            case (mode)
+                M_CMD: begin
+                    if (cmd_bits > 0 || mosi == 0) begin
+                        cmd_sr = {cmd_sr[46:0], mosi};
+                        cmd_bits = cmd_bits + 1;
+                        if (cmd_bits == 48) begin
+                            cmd_bits = 0;
+                            command(cmd_sr[45:40], cmd_sr[39:8]);
+                        end
+                    end
+                end
+                M_WR_TOKEN: begin
+                    rx_byte = {rx_byte[6:0], mosi};
+                    // the first 7 bits of 0xFC/0xFD look like 0xFE
+                    if ((!wr_multi && rx_byte == 8'hFE) || (wr_multi && rx_byte == 8'hFC)) begin
+                        rx_bits = 0;
+                        wr_count = 0;
+                        mode = M_WR_DATA;
+                    end
+                    else if (wr_multi && rx_byte == 8'hFD) begin
+                        wr_multi = 0;
+                        push_busy;
+                        mode = M_CMD;
+                    end
+                end
+                M_WR_DATA: begin
+                    rx_byte = {rx_byte[6:0], mosi};
+                    rx_bits = rx_bits + 1;
+                    if (rx_bits == 8) begin
+                        rx_bits = 0;
+                        if (wr_count < 512)
+                            mem[(wr_sector % MEM_SECTORS)*512 + wr_count] = rx_byte;
+                        wr_count = wr_count + 1;
+                        // block and CRC are in
+                        if (wr_count == 514) begin
+                            push(8'hE5); // data accepted
+                            push_busy;
+                            n_blocks_written = n_blocks_written + 1;
+                            if (wr_multi) begin
+                                wr_sector = wr_sector + 1;
+                                rx_byte = 8'hFF;
+                                mode = M_WR_TOKEN;
+                            end
+                            else begin
+                                mode = M_CMD;
+                            end
+                        end
+                    end
+                end
+            endcase
+        end
+    end
+
+    // SCLK period against the limit of the card's current mode
+    always @(posedge sclk) begin
+        if (t_rise >= 0) begin
+            if (idle) begin
+                if (t_min_init == 0 || $realtime - t_rise < t_min_init)
+                    t_min_init = $realtime - t_rise;
+                if ($realtime - t_rise < 1.0e6 / F_OD_KHZ - 0.001)
+                    n_clk_errors = n_clk_errors + 1;
+            end
+            else begin
+                if (t_min == 0 || $realtime - t_rise < t_min)
+                    t_min = $realtime - t_rise;
+                if ($realtime - t_rise < 1.0e6 / F_PP_KHZ - 0.001)
+                    n_clk_errors = n_clk_errors + 1;
+            end
+        end
+        t_rise = $realtime;
+    end
+
+    always @(negedge sclk) begin
+        if (cs) begin
+            miso = 1;
+        end
+        else begin
+            if (tx_bits == 0) begin
+                // keep the next block of a multiple block read queued
+                if (rd_multi && tx_tail - tx_head < 16) begin
+                    rd_sector = rd_sector + 1;
+                    push_block(rd_sector);
+                end
+                if (tx_head != tx_tail) begin
+                    tx_byte = tx_q[tx_head % TX_LEN];
+                    tx_head = tx_head + 1;
+                    tx_bits = 8;
+                end
+            end
+            if (tx_bits > 0) begin
+                miso = tx_byte[7];
+                tx_byte = {tx_byte[6:0], 1'b1};
+                tx_bits = tx_bits - 1;
+            end
+            else begin
+                miso = 1;
+            end
+        end
+    end
+
+endmodule
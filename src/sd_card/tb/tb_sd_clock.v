@@ -0,0 +1,301 @@
+`timescale 1ns / 1ps
+//////////////////////////////////////////////////////////////////////////////////
+// Team: HEALTH
+//
+// Module Name: tb_sd_clock
+// Description:
+//  SPI clock divider of sd_control_ram_v1_0 against sd_card_model. The card
+//  is identified at the reset divider, then one sector is written and read
+//  back at the slow clock and again at 25 MHz, as sd_card_init leaves it.
+//  A reset command has to put the divider back for the next identification.
+//  Checks the data, that the card never sees SCLK above its limits, and
+//  reports cycles per sector at both speeds
+//
+// Last Modified: 2026-10-17
+//
+//////////////////////////////////////////////////////////////////////////////////
+
+module tb_sd_clock #(
+    // bytes per sector as sd_read/sd_write see them, read data starts at RAM byte 1
+    parameter XFER_LEN = 511
+)();
+
+    localparam TEST_SECTOR = 5;
+
+    // register offsets and flags, as in sd_card.h
+    localparam SD_CMD_REG = 0;
+    localparam SD_STATUS_REG = 4;
+    localparam SD_ADDR_REG = 8;
+    localparam SD_DEBUG_REG = 12;
+    localparam SD_WRITE_REG = 16;
+    localparam SD_WADDR_REG = 28;
+    localparam SD_RADDR_REG = 32;
+    localparam SD_BURST_RD_REG = 36;
+    localparam SD_BURST_WR_REG = 40;
+    localparam CMD_RESET = 1;
+    localparam CMD_WRITE = 2;
+    localparam CMD_READ = 4;
+    localparam SD_STAT_READY = 1;
+    localparam SD_STAT_BUSY = 8;
+    localparam SD_STAT_DONE = 16;
+    localparam SD_STAT_ERROR = 32;
+    localparam SD_CLK_DIV_SHIFT = 8;
+    localparam SD_CLK_DIV_INIT = 62;
+    localparam SD_CLK_DIV_FAST = 0;
+
+    reg clk, sd_clk, resetn;
+
+    // AXI-Lite master
+    reg [5 : 0] awaddr, araddr;
+    reg awvalid, wvalid, arvalid;
+    reg [31 : 0] wdata;
+    wire awready, wready, bvalid, arready, rvalid;
+    wire [1 : 0] bresp, rresp;
+    wire [31 : 0] rdata;
+
+    // SPI
+    wire cs, mosi, miso, spi_sclk;
+
+    // test signals
+    reg [31 : 0] n_cycles, start_cycle;
+    reg [31 : 0] slow_wr_cycles, slow_rd_cycles, fast_wr_cycles, fast_rd_cycles;
+    reg [31 : 0] word;
+    reg [7 : 0] rd_buf [0 : XFER_LEN-1];
+    integer i, j, n_errors;
+
+    sd_control_ram_v1_0 DUT (
+        .cs(cs),
+        .mosi(mosi),
+        .miso(miso),
+        .spi_sclk(spi_sclk),
+        .sd_clock(sd_clk),
+        .sd_reset(),
+        .dat1(),
+        .dat2(),
+        .sd_irq(),
+        .m00_axis_tdata(),
+        .m00_axis_tstrb(),
+        .m00_axis_tvalid(),
+        .m00_axis_tready(1'b0),
+        .m00_axis_tlast(),
+        .s00_axi_aclk(clk),
+        .s00_axi_aresetn(resetn),
+        .s00_axi_awaddr(awaddr),
+        .s00_axi_awprot(3'b0),
+        .s00_axi_awvalid(awvalid),
+        .s00_axi_awready(awready),
+        .s00_axi_wdata(wdata),
+        .s00_axi_wstrb(4'b1111),
+        .s00_axi_wvalid(wvalid),
+        .s00_axi_wready(wready),
+        .s00_axi_bresp(bresp),
+        .s00_axi_bvalid(bvalid),
+        .s00_axi_bready(1'b1),
+        .s00_axi_araddr(araddr),
+        .s00_axi_arprot(3'b0),
+        .s00_axi_arvalid(arvalid),
+        .s00_axi_arready(arready),
+        .s00_axi_rdata(rdata),
+        .s00_axi_rresp(rresp),
+        .s00_axi_rvalid(rvalid),
+        .s00_axi_rready(1'b1)
+        );
+
+    // skip the 2 second power up
+    defparam DUT.SD.BOOT_CYCLES = 100;
+
+    sd_card_model #(.MEM_SECTORS(16))
+        CARD (
+            .cs(cs),
+            .sclk(spi_sclk),
+            .mosi(mosi),
+            .miso(miso)
+            );
+
+    initial begin
+        clk = 0;
+        sd_clk = 0;
+        resetn = 0;
+        awaddr = 0;
+        araddr = 0;
+        awvalid = 0;
+        wvalid = 0;
+        arvalid = 0;
+        wdata = 0;
+        n_cycles = 0;
+    end
+
+    // generate, 100MHz AXI and 50MHz SD
+    always clk = #5 ~clk;
+    always sd_clk = #10 ~sd_clk;
+
+    always @(posedge clk) begin
+        if (resetn)
+            n_cycles <= n_cycles + 1;
+    end
+
+    // byte written at a sector offset, differs per run
+    function [7:0] pattern(input [8:0] addr, input [7:0] run);
+        pattern = addr * 8'd13 + run;
+    endfunction
+
+    // one AXI-Lite write, returns after the write response
+    task axi_write(input [5:0] addr, input [31:0] data);
+        begin
+            @(negedge clk);
+            awaddr = addr;
+            wdata = data;
+            awvalid = 1;
+            wvalid = 1;
+            while (!(awready && wready))
+                @(negedge clk);
+            @(negedge clk);
+            awvalid = 0;
+            wvalid = 0;
+            while (!bvalid)
+                @(negedge clk);
+        end
+    endtask
+
+    // one AXI-Lite read, returns with the read data
+    task axi_read(input [5:0] addr, output [31:0] data);
+        begin
+            @(negedge clk);
+            araddr = addr;
+            arvalid = 1;
+            while (!arready)
+                @(negedge clk);
+            @(negedge clk);
+            arvalid = 0;
+            while (!rvalid)
+                @(negedge clk);
+            data = rdata;
+        end
+    endtask
+
+    task wait_idle;
+        begin
+            axi_read(SD_STATUS_REG, word);
+            while (word & SD_STAT_BUSY)
+                axi_read(SD_STATUS_REG, word);
+        end
+    endtask
+
+    // the divider reads back once the controller uses it, a few sd_clocks
+    // after it's written
+    task check_div(input [7:0] div);
+        integer n;
+        begin
+            axi_read(SD_DEBUG_REG, word);
+            for (n = 0; n < 20 && word[15:8] != div; n = n + 1)
+                axi_read(SD_DEBUG_REG, word);
+            if (word[15:8] != div) begin
+                $display("ERROR: divider %0d, expected %0d", word[15:8], div);
+                n_errors = n_errors + 1;
+            end
+        end
+    endtask
+
+    // sd_start in sd_card.c, then wait for the command to finish
+    task sd_command(input [31:0] cmd, input [31:0] addr);
+        begin
+            axi_write(SD_CMD_REG, 0);
+            wait_idle;
+            axi_write(SD_ADDR_REG, addr);
+            axi_write(SD_CMD_REG, cmd);
+            axi_read(SD_STATUS_REG, word);
+            while (!(word & SD_STAT_BUSY))
+                axi_read(SD_STATUS_REG, word);
+            axi_write(SD_CMD_REG, 0);
+            axi_read(SD_STATUS_REG, word);
+            while (!(word & SD_STAT_DONE))
+                axi_read(SD_STATUS_REG, word);
+            if (word & SD_STAT_ERROR) begin
+                $display("ERROR: card rejected command %0d", cmd);
+                n_errors = n_errors + 1;
+            end
+        end
+    endtask
+
+    // sd_write then sd_read of one sector, returns the cycles each took
+    task round_trip(input [7:0] run, output [31:0] wr_cycles, output [31:0] rd_cycles);
+        begin
+            axi_write(SD_WADDR_REG, 0);
+            for (i = 0; i < XFER_LEN; i = i + 4)
+                axi_write(SD_BURST_WR_REG, {pattern(i+3, run), pattern(i+2, run), pattern(i+1, run), pattern(i, run)});
+            axi_write(SD_WRITE_REG, 8'haa);
+            start_cycle = n_cycles;
+            sd_command(CMD_WRITE, TEST_SECTOR);
+            wr_cycles = n_cycles - start_cycle;
+            for (i = 0; i < XFER_LEN; i = i + 1) begin
+                if (CARD.mem[TEST_SECTOR*512 + i] != pattern(i, run)) begin
+                    $display("ERROR: run %0d card byte %0d = %h, expected %h", run, i, CARD.mem[TEST_SECTOR*512 + i], pattern(i, run));
+                    n_errors = n_errors + 1;
+                end
+            end
+
+            start_cycle = n_cycles;
+            sd_command(CMD_READ, TEST_SECTOR);
+            rd_cycles = n_cycles - start_cycle;
+            axi_write(SD_RADDR_REG, 1);
+            for (i = 0; i < XFER_LEN; i = i + 4) begin
+                axi_read(SD_BURST_RD_REG, word);
+                for (j = 0; j < 4 && i + j < XFER_LEN; j = j + 1)
+                    rd_buf[i+j] = word[j*8 +: 8];
+            end
+            for (i = 0; i < XFER_LEN; i = i + 1) begin
+                if (rd_buf[i] != pattern(i, run)) begin
+                    $display("ERROR: run %0d byte read %0d = %h, expected %h", run, i, rd_buf[i], pattern(i, run));
+                    n_errors = n_errors + 1;
+                end
+            end
+        end
+    endtask
+
+    initial begin
+        n_errors = 0;
+        repeat (5) @(negedge clk);
+        resetn = 1;
+
+        // identification at the reset divider
+        check_div(SD_CLK_DIV_INIT);
+        axi_read(SD_STATUS_REG, word);
+        while (!(word & SD_STAT_READY))
+            axi_read(SD_STATUS_REG, word);
+        $display("card ready after %0d cycles, shortest SCLK period %0t ns", n_cycles, CARD.t_min_init);
+
+        // a sector at the slow clock
+        round_trip(1, slow_wr_cycles, slow_rd_cycles);
+
+        // sd_card_init: 25 MHz from here on
+        axi_write(SD_DEBUG_REG, SD_CLK_DIV_FAST << SD_CLK_DIV_SHIFT);
+        check_div(SD_CLK_DIV_FAST);
+        round_trip(2, fast_wr_cycles, fast_rd_cycles);
+        $display("shortest SCLK period after init %0t ns", CARD.t_min);
+
+        // sd_card_reset: the card is identified at the slow clock again
+        axi_write(SD_CMD_REG, CMD_RESET);
+        check_div(SD_CLK_DIV_INIT);
+        axi_write(SD_CMD_REG, 0);
+        repeat (10) @(negedge clk);
+        wait_idle;
+        axi_write(SD_DEBUG_REG, SD_CLK_DIV_FAST << SD_CLK_DIV_SHIFT);
+        check_div(SD_CLK_DIV_FAST);
+        round_trip(3, fast_wr_cycles, fast_rd_cycles);
+
+        if (CARD.n_clk_errors != 0) begin
+            $display("ERROR: %0d SCLK periods too short for the card", CARD.n_clk_errors);
+            n_errors = n_errors + 1;
+        end
+
+        $display("%0d bytes per sector", XFER_LEN);
+        $display("divider %0d: write %0d cycles, read %0d cycles", SD_CLK_DIV_INIT, slow_wr_cycles, slow_rd_cycles);
+        $display("divider %0d: write %0d cycles, read %0d cycles", SD_CLK_DIV_FAST, fast_wr_cycles, fast_rd_cycles);
+        if (n_errors == 0)
+            $display("PASSED: sectors move at both SPI clocks within the card's limits");
+        else
+            $display("FAILED: %0d errors", n_errors);
+        $finish;
+    end
+
+endmodule
@@ -0,0 +1,291 @@
+`timescale 1ns / 1ps
+//////////////////////////////////////////////////////////////////////////////////
+// Team: HEALTH
+//
+// Module Name: tb_sd_control_ram_burst
+// Description:
+//  Moves one sector through the sd_control_ram AXI slave RAMs the old way
+//  (one byte per register access) and through the burst ports (one 32-bit
+//  word per access), checks the data and reports AXI cycles per sector
+//
+// Last Modified: 2026-10-17
+//
+//////////////////////////////////////////////////////////////////////////////////
+
+module tb_sd_control_ram_burst #(
+    // bytes per sector as sd_read/sd_write see them, read data starts at RAM byte 1
+    parameter XFER_LEN = 511
+)();
+
+    // register offsets, as in sd_card.h
+    localparam SD_WRITE_REG = 16;
+    localparam SD_RD_DATA_REG = 20;
+    localparam SD_RAM_CMD_REG = 24;
+    localparam SD_WADDR_REG = 28;
+    localparam SD_RADDR_REG = 32;
+    localparam SD_BURST_RD_REG = 36;
+    localparam SD_BURST_WR_REG = 40;
+    localparam CMD_RAM_WRITE = 2;
+    localparam CMD_RAM_READ = 4;
+
+    reg clk, sd_clk, resetn;
+
+    // AXI-Lite master
+    reg [5 : 0] awaddr, araddr;
+    reg awvalid, wvalid, arvalid;
+    reg [31 : 0] wdata;
+    reg [3 : 0] wstrb;
+    wire awready, wready, bvalid, arready, rvalid;
+    wire [1 : 0] bresp, rresp;
+    wire [31 : 0] rdata;
+
+    // SD controller side
+    reg byte_available, ready_for_next_byte;
+    reg [8 : 0] rd_addr_off, wr_addr_off;
+    reg [7 : 0] dout;
+    wire [7 : 0] din;
+
+    // test signals
+    reg [31 : 0] n_cycles, n_trans;
+    reg [31 : 0] start_cycle, start_trans;
+    reg [31 : 0] old_rd_cycles, old_rd_trans, old_wr_cycles, old_wr_trans;
+    reg [31 : 0] new_rd_cycles, new_rd_trans, new_wr_cycles, new_wr_trans;
+    reg [31 : 0] word;
+    reg [7 : 0] rd_buf [0 : XFER_LEN-1];
+    integer i, j, n_errors;
+
+    sd_control_ram_v1_0_S00_AXI DUT (
+        .slv_reg0(),
+        .slv_reg2(),
+        .sd_clock(sd_clk),
+        .ready(1'b1),
+        .ready_for_next_byte(ready_for_next_byte),
+        .byte_available(byte_available),
+        .status(5'd6),
+        .dout(dout),
+        .din(din),
+        .rd_addr_off(rd_addr_off),
+        .wr_addr_off(wr_addr_off),
+        .block_count(),
+        .sector_free(),
+        .blocks_read(16'd0),
+        .sector_ready(),
+        .blocks_written(16'd0),
+        .error(1'b0),
+        .irq(),
+        .m_axis_tdata(),
+        .m_axis_tvalid(),
+        .m_axis_tready(1'b0),
+        .m_axis_tlast(),
+        .spi_div(),
+        .S_AXI_ACLK(clk),
+        .S_AXI_ARESETN(resetn),
+        .S_AXI_AWADDR(awaddr),
+        .S_AXI_AWPROT(3'b0),
+        .S_AXI_AWVALID(awvalid),
+        .S_AXI_AWREADY(awready),
+        .S_AXI_WDATA(wdata),
+        .S_AXI_WSTRB(wstrb),
+        .S_AXI_WVALID(wvalid),
+        .S_AXI_WREADY(wready),
+        .S_AXI_BRESP(bresp),
+        .S_AXI_BVALID(bvalid),
+        .S_AXI_BREADY(1'b1),
+        .S_AXI_ARADDR(araddr),
+        .S_AXI_ARPROT(3'b0),
+        .S_AXI_ARVALID(arvalid),
+        .S_AXI_ARREADY(arready),
+        .S_AXI_RDATA(rdata),
+        .S_AXI_RRESP(rresp),
+        .S_AXI_RVALID(rvalid),
+        .S_AXI_RREADY(1'b1)
+        );
+
+    // byte the card "returns" at a RAM address
+    function [7:0] rd_pattern(input [8:0] addr);
+        rd_pattern = addr * 8'd7 + 8'd3;
+    endfunction
+
+    // byte the firmware writes at a RAM address
+    function [7:0] wr_pattern(input [8:0] addr);
+        wr_pattern = ~(addr * 8'd5);
+    endfunction
+
+    // one AXI-Lite write, returns after the write response
+    task axi_write(input [5:0] addr, input [31:0] data);
+        begin
+            @(negedge clk);
+            awaddr = addr;
+            wdata = data;
+            wstrb = 4'b1111;
+            awvalid = 1;
+            wvalid = 1;
+            while (!(awready && wready))
+                @(negedge clk);
+            @(negedge clk);
+            awvalid = 0;
+            wvalid = 0;
+            while (!bvalid)
+                @(negedge clk);
+            n_trans = n_trans + 1;
+        end
+    endtask
+
+    // one AXI-Lite read, returns with the read data
+    task axi_read(input [5:0] addr, output [31:0] data);
+        begin
+            @(negedge clk);
+            araddr = addr;
+            arvalid = 1;
+            while (!arready)
+                @(negedge clk);
+            @(negedge clk);
+            arvalid = 0;
+            while (!rvalid)
+                @(negedge clk);
+            data = rdata;
+            n_trans = n_trans + 1;
+        end
+    endtask
+
+    initial begin
+        clk = 0;
+        sd_clk = 0;
+        resetn = 0;
+        awaddr = 0;
+        araddr = 0;
+        awvalid = 0;
+        wvalid = 0;
+        arvalid = 0;
+        wdata = 0;
+        wstrb = 0;
+        byte_available = 0;
+        ready_for_next_byte = 0;
+        rd_addr_off = 0;
+        wr_addr_off = 0;
+        dout = 0;
+        n_cycles = 0;
+        n_trans = 0;
+    end
+
+    // generate, 100MHz AXI and 25MHz SD
+    always clk = #5 ~clk;
+    always sd_clk = #20 ~sd_clk;
+
+    always @(posedge clk) begin
+        if (resetn)
+            n_cycles <= n_cycles + 1;
+    end
+
+    // check that RAM byte addr reaches the controller's din
+    task check_din(input [8:0] addr);
+        begin
+            @(negedge sd_clk);
+            wr_addr_off = addr;
+            ready_for_next_byte = 1;
+            @(negedge sd_clk);
+            ready_for_next_byte = 0;
+            if (din != wr_pattern(addr)) begin
+                $display("ERROR: wr_ram[%0d] = %h, expected %h", addr, din, wr_pattern(addr));
+                n_errors = n_errors + 1;
+            end
+        end
+    endtask
+
+    initial begin
+        n_errors = 0;
+        repeat (5) @(negedge clk);
+        resetn = 1;
+
+        // fill the read RAM from the SD side, as the controller does
+        for (i = 0; i < 512; i = i + 1) begin
+            @(negedge sd_clk);
+            rd_addr_off = i;
+            dout = rd_pattern(i);
+            byte_available = 1;
+        end
+        @(negedge sd_clk);
+        byte_available = 0;
+
+        // old sd_read: one byte per RAM index
+        start_cycle = n_cycles;
+        start_trans = n_trans;
+        for (i = 1; i <= XFER_LEN; i = i + 1) begin
+            axi_write(SD_RADDR_REG, i);
+            axi_write(SD_RAM_CMD_REG, CMD_RAM_READ);
+            axi_read(SD_RD_DATA_REG, word);
+            rd_buf[i-1] = word[7:0];
+            axi_write(SD_RAM_CMD_REG, 0);
+        end
+        old_rd_cycles = n_cycles - start_cycle;
+        old_rd_trans = n_trans - start_trans;
+        for (i = 0; i < XFER_LEN; i = i + 1) begin
+            if (rd_buf[i] != rd_pattern(i + 1)) begin
+                $display("ERROR: byte read %0d = %h, expected %h", i, rd_buf[i], rd_pattern(i + 1));
+                n_errors = n_errors + 1;
+            end
+        end
+
+        // burst sd_read: set the address once, 4 bytes per read
+        start_cycle = n_cycles;
+        start_trans = n_trans;
+        axi_write(SD_RADDR_REG, 1);
+        for (i = 0; i < XFER_LEN; i = i + 4) begin
+            axi_read(SD_BURST_RD_REG, word);
+            for (j = 0; j < 4 && i + j < XFER_LEN; j = j + 1)
+                rd_buf[i+j] = word[j*8 +: 8];
+        end
+        new_rd_cycles = n_cycles - start_cycle;
+        new_rd_trans = n_trans - start_trans;
+        for (i = 0; i < XFER_LEN; i = i + 1) begin
+            if (rd_buf[i] != rd_pattern(i + 1)) begin
+                $display("ERROR: burst read %0d = %h, expected %h", i, rd_buf[i], rd_pattern(i + 1));
+                n_errors = n_errors + 1;
+            end
+        end
+
+        // old sd_write: one byte per RAM index
+        start_cycle = n_cycles;
+        start_trans = n_trans;
+        for (i = 0; i < XFER_LEN; i = i + 1) begin
+            axi_write(SD_WADDR_REG, i);
+            axi_write(SD_WRITE_REG, wr_pattern(i));
+            axi_write(SD_RAM_CMD_REG, CMD_RAM_WRITE);
+            axi_write(SD_RAM_CMD_REG, 0);
+        end
+        old_wr_cycles = n_cycles - start_cycle;
+        old_wr_trans = n_trans - start_trans;
+        for (i = 0; i < XFER_LEN; i = i + 1)
+            check_din(i);
+
+        // clear it so the burst write has to put every byte back
+        for (i = 0; i < XFER_LEN; i = i + 4) begin
+            axi_write(SD_WADDR_REG, i);
+            axi_write(SD_BURST_WR_REG, 0);
+        end
+
+        // burst sd_write: set the address once, 4 bytes per write
+        start_cycle = n_cycles;
+        start_trans = n_trans;
+        axi_write(SD_WADDR_REG, 0);
+        for (i = 0; i < XFER_LEN; i = i + 4) begin
+            axi_write(SD_BURST_WR_REG, {wr_pattern(i+3), wr_pattern(i+2), wr_pattern(i+1), wr_pattern(i)});
+        end
+        new_wr_cycles = n_cycles - start_cycle;
+        new_wr_trans = n_trans - start_trans;
+        for (i = 0; i < XFER_LEN; i = i + 1)
+            check_din(i);
+
+        $display("%0d bytes per sector", XFER_LEN);
+        $display("read:  byte port %0d transactions %0d cycles, burst port %0d transactions %0d cycles",
+                 old_rd_trans, old_rd_cycles, new_rd_trans, new_rd_cycles);
+        $display("write: byte port %0d transactions %0d cycles, burst port %0d transactions %0d cycles",
+                 old_wr_trans, old_wr_cycles, new_wr_trans, new_wr_cycles);
+        if (n_errors == 0)
+            $display("PASSED: burst ports move the same data as the byte port");
+        else
+            $display("FAILED: %0d mismatches", n_errors);
+        $finish;
+    end
+
+endmodule
@@ -0,0 +1,436 @@
+`timescale 1ns / 1ps
+//////////////////////////////////////////////////////////////////////////////////
+// Team: HEALTH
+//
+// Module Name: tb_sd_prefetch
+// Description:
+//  End to end image compression time, SD card to DCT coefficients. Plays the
+//  firmware over AXI-Lite against sd_control_ram_v1_0 and sd_card_model and
+//  feeds each sector's blocks to custom_dct_axis, first with one sd_read per
+//  sector and then with the read-ahead stream of sd_stream_start/
+//  sd_stream_next, where the controller reads the next sectors into its RAM
+//  while the current one is copied out and compressed, and last with the
+//  controller's m00_axis streaming the sectors into the DCT with no copies.
+//  Checks the pixels and that all runs give the same coefficients, and
+//  reports cycles per image.
+//  Needs the custom_dct_axis sources and FIFO IP, like tb_custom_dct_axis
+//
+// Last Modified: 2026-10-17
+//
+//////////////////////////////////////////////////////////////////////////////////
+
+module tb_sd_prefetch #(
+    parameter NUM_BLOCKS = 1024, // 256x256 test image
+    parameter MAX_OUT_WORDS = NUM_BLOCKS * 33
+)();
+
+    localparam BLOCKS_PER_SECTOR = 7;
+    localparam SECTOR_BYTES = BLOCKS_PER_SECTOR * 64;
+    localparam NUM_PIXELS = NUM_BLOCKS * 64;
+    localparam NUM_SECTORS = (NUM_BLOCKS + BLOCKS_PER_SECTOR - 1) / BLOCKS_PER_SECTOR;
+    localparam IMG_SECTOR = 16; // first pixel sector on the card
+    localparam PIPELINE_BLOCKS = 3; // DCT_MAX_PIPELINE_BLOCKS, blocks the stream may run ahead
+
+    // register offsets and flags, as in sd_card.h
+    localparam SD_CMD_REG = 0;
+    localparam SD_STATUS_REG = 4;
+    localparam SD_ADDR_REG = 8;
+    localparam SD_DEBUG_REG = 12;
+    localparam SD_RADDR_REG = 32;
+    localparam SD_BURST_RD_REG = 36;
+    localparam SD_RD_ACK_REG = 44;
+    localparam SD_BLOCK_CNT_REG = 48;
+    localparam SD_RD_CNT_REG = 52;
+    localparam CMD_READ = 4;
+    localparam CMD_READ_MULTI = 8;
+    localparam CMD_STREAM = 32;
+    localparam SD_STAT_READY = 1;
+    localparam SD_STAT_BUSY = 8;
+    localparam SD_STAT_DONE = 16;
+    localparam SD_STAT_ERROR = 32;
+    localparam SD_RD_SECTORS = 4;
+    localparam SD_CLK_DIV_SHIFT = 8;
+    localparam SD_CLK_DIV_FAST = 0;
+
+    reg clk, sd_clk, resetn;
+
+    // AXI-Lite master
+    reg [5 : 0] awaddr, araddr;
+    reg awvalid, wvalid, arvalid;
+    reg [31 : 0] wdata;
+    wire awready, wready, bvalid, arready, rvalid;
+    wire [1 : 0] bresp, rresp;
+    wire [31 : 0] rdata;
+
+    // SPI
+    wire cs, mosi, miso, spi_sclk;
+
+    // DCT, fed by the testbench or by the SD controller when bridge is set
+    reg bridge;
+    reg [31 : 0] s_tdata;
+    reg s_tvalid;
+    wire s_tready;
+    wire [31 : 0] sd_tdata;
+    wire sd_tvalid, sd_tlast;
+    wire [31 : 0] dct_tdata = bridge ? sd_tdata : s_tdata;
+    wire dct_tvalid = bridge ? sd_tvalid : s_tvalid;
+    wire [31 : 0] m_tdata;
+    wire m_tvalid, m_tlast;
+
+    // test signals
+    reg [31 : 0] n_cycles, n_trans, start_cycle, start_trans;
+    reg [31 : 0] read_cycles, read_trans, stream_cycles, stream_trans, bridge_cycles, bridge_trans;
+    reg [31 : 0] n_blocks_out, n_out, first_out;
+    reg [31 : 0] word;
+    reg [7 : 0] sector_buf [0 : SECTOR_BYTES-1];
+    reg [31 : 0] ref_out [0 : MAX_OUT_WORDS-1];
+    reg [31 : 0] dct_out [0 : 3*MAX_OUT_WORDS-1]; // all runs
+    integer i, j, sec, n, n_errors, n_ref;
+
+    reg [7:0] test_data [0 : NUM_PIXELS-1];
+    initial begin
+        $readmemh("dct_test_block.mem", test_data, 0, NUM_PIXELS-1);
+    end
+
+    sd_control_ram_v1_0 DUT (
+        .cs(cs),
+        .mosi(mosi),
+        .miso(miso),
+        .spi_sclk(spi_sclk),
+        .sd_clock(sd_clk),
+        .sd_reset(),
+        .dat1(),
+        .dat2(),
+        .sd_irq(),
+        .m00_axis_tdata(sd_tdata),
+        .m00_axis_tstrb(),
+        .m00_axis_tvalid(sd_tvalid),
+        .m00_axis_tready(bridge & s_tready),
+        .m00_axis_tlast(sd_tlast),
+        .s00_axi_aclk(clk),
+        .s00_axi_aresetn(resetn),
+        .s00_axi_awaddr(awaddr),
+        .s00_axi_awprot(3'b0),
+        .s00_axi_awvalid(awvalid),
+        .s00_axi_awready(awready),
+        .s00_axi_wdata(wdata),
+        .s00_axi_wstrb(4'b1111),
+        .s00_axi_wvalid(wvalid),
+        .s00_axi_wready(wready),
+        .s00_axi_bresp(bresp),
+        .s00_axi_bvalid(bvalid),
+        .s00_axi_bready(1'b1),
+        .s00_axi_araddr(araddr),
+        .s00_axi_arprot(3'b0),
+        .s00_axi_arvalid(arvalid),
+        .s00_axi_arready(arready),
+        .s00_axi_rdata(rdata),
+        .s00_axi_rresp(rresp),
+        .s00_axi_rvalid(rvalid),
+        .s00_axi_rready(1'b1)
+        );
+
+    // skip the 2 second power up
+    defparam DUT.SD.BOOT_CYCLES = 100;
+
+    sd_card_model #(.MEM_SECTORS(IMG_SECTOR + NUM_SECTORS))
+        CARD (
+            .cs(cs),
+            .sclk(spi_sclk),
+            .mosi(mosi),
+            .miso(miso)
+            );
+
+    custom_dct_axis #(.PACKED_INPUT(1))
+        DCT (
+            .aclk(clk),
+            .aresetn(resetn),
+            .s_axis_tdata(dct_tdata),
+            .s_axis_tstrb(4'b1111),
+            .s_axis_tvalid(dct_tvalid),
+            .s_axis_tready(s_tready),
+            .s_axis_tlast(1'b0),
+            .m_axis_tdata(m_tdata),
+            .m_axis_tstrb(),
+            .m_axis_tvalid(m_tvalid),
+            .m_axis_tready(1'b1),
+            .m_axis_tlast(m_tlast)
+            );
+
+    initial begin
+        clk = 0;
+        sd_clk = 0;
+        resetn = 0;
+        awaddr = 0;
+        araddr = 0;
+        awvalid = 0;
+        wvalid = 0;
+        arvalid = 0;
+        wdata = 0;
+        s_tdata = 0;
+        s_tvalid = 0;
+        bridge = 0;
+        n_cycles = 0;
+        n_trans = 0;
+        n_blocks_out = 0;
+        n_out = 0;
+    end
+
+    // generate, 100MHz AXI and 50MHz SD
+    always clk = #5 ~clk;
+    always sd_clk = #10 ~sd_clk;
+
+    always @(posedge clk) begin
+        if (resetn)
+            n_cycles <= n_cycles + 1;
+    end
+
+    // collect the coefficients, one EOF per block
+    always @(posedge clk) begin
+        if (m_tvalid) begin
+            if (n_out < 3*MAX_OUT_WORDS)
+                dct_out[n_out] <= m_tdata;
+            n_out <= n_out + 1;
+            if (m_tdata[31:16] == 16'hFFFF || m_tdata[15:0] == 16'hFFFF)
+                n_blocks_out <= n_blocks_out + 1;
+        end
+    end
+
+    // one AXI-Lite write, returns after the write response
+    task axi_write(input [5:0] addr, input [31:0] data);
+        begin
+            @(negedge clk);
+            awaddr = addr;
+            wdata = data;
+            awvalid = 1;
+            wvalid = 1;
+            while (!(awready && wready))
+                @(negedge clk);
+            @(negedge clk);
+            awvalid = 0;
+            wvalid = 0;
+            while (!bvalid)
+                @(negedge clk);
+            n_trans = n_trans + 1;
+        end
+    endtask
+
+    // one AXI-Lite read, returns with the read data
+    task axi_read(input [5:0] addr, output [31:0] data);
+        begin
+            @(negedge clk);
+            araddr = addr;
+            arvalid = 1;
+            while (!arready)
+                @(negedge clk);
+            @(negedge clk);
+            arvalid = 0;
+            while (!rvalid)
+                @(negedge clk);
+            data = rdata;
+            n_trans = n_trans + 1;
+        end
+    endtask
+
+    task wait_idle;
+        begin
+            axi_read(SD_STATUS_REG, word);
+            while (word & SD_STAT_BUSY)
+                axi_read(SD_STATUS_REG, word);
+        end
+    endtask
+
+    // sd_start in sd_card.c
+    task sd_start(input [31:0] cmd, input [31:0] addr);
+        begin
+            axi_write(SD_CMD_REG, 0);
+            wait_idle;
+            axi_write(SD_ADDR_REG, addr);
+            axi_write(SD_CMD_REG, cmd);
+            axi_read(SD_STATUS_REG, word);
+            while (!(word & SD_STAT_BUSY))
+                axi_read(SD_STATUS_REG, word);
+            axi_write(SD_CMD_REG, 0);
+        end
+    endtask
+
+    // sd_copy_sector, then check the pixels of the sector
+    task copy_sector(input [31:0] ram_addr, input [31:0] sector);
+        begin
+            axi_write(SD_RADDR_REG, ram_addr + 1);
+            for (i = 0; i < SECTOR_BYTES; i = i + 4) begin
+                axi_read(SD_BURST_RD_REG, word);
+                for (j = 0; j < 4; j = j + 1)
+                    sector_buf[i+j] = word[j*8 +: 8];
+            end
+            for (i = 0; i < SECTOR_BYTES && sector*SECTOR_BYTES + i < NUM_PIXELS; i = i + 1) begin
+                if (sector_buf[i] != test_data[sector*SECTOR_BYTES + i]) begin
+                    $display("ERROR: sector %0d byte %0d = %h, expected %h", sector, i, sector_buf[i], test_data[sector*SECTOR_BYTES + i]);
+                    n_errors = n_errors + 1;
+                end
+            end
+        end
+    endtask
+
+    // the CPU writing the sector's blocks into the AXIS FIFO, 4 pixels per beat
+    task feed_dct(input [31:0] sector);
+        begin
+            for (i = 0; i < SECTOR_BYTES && sector*SECTOR_BYTES + i < NUM_PIXELS; i = i + 4) begin
+                @(negedge clk);
+                s_tdata = {sector_buf[i+3], sector_buf[i+2], sector_buf[i+1], sector_buf[i]};
+                s_tvalid = 1;
+                // taken on the next rising edge
+                while (!s_tready)
+                    @(negedge clk);
+            end
+            @(negedge clk);
+            s_tvalid = 0;
+        end
+    endtask
+
+    // wait for the last block of the image to come out of the DCT
+    task wait_dct(input [31:0] blocks_before, input [31:0] n_blocks);
+        begin
+            while (n_blocks_out < blocks_before + n_blocks)
+                @(posedge clk);
+        end
+    endtask
+
+    // compare the coefficients of a run from first_out on with the first run,
+    // blocks past the image aren't compared
+    task check_run(input [31:0] run_words);
+        begin
+            if (run_words < n_ref) begin
+                $display("ERROR: per sector reads gave %0d words, this run gave %0d", n_ref, run_words);
+                n_errors = n_errors + 1;
+            end
+            for (i = 0; i < n_ref && first_out + i < 3*MAX_OUT_WORDS; i = i + 1) begin
+                if (ref_out[i] != dct_out[first_out + i]) begin
+                    $display("ERROR: word %0d differs, per sector %h, this run %h", i, ref_out[i], dct_out[first_out + i]);
+                    n_errors = n_errors + 1;
+                end
+            end
+        end
+    endtask
+
+    initial begin
+        n_errors = 0;
+
+        // image on the card, zero padded to whole sectors
+        for (i = 0; i < NUM_SECTORS*512; i = i + 1)
+            CARD.mem[IMG_SECTOR*512 + i] = 0;
+        for (i = 0; i < NUM_PIXELS; i = i + 1)
+            CARD.mem[(IMG_SECTOR + i/SECTOR_BYTES)*512 + i%SECTOR_BYTES] = test_data[i];
+
+        repeat (5) @(negedge clk);
+        resetn = 1;
+
+        // card init
+        axi_read(SD_STATUS_REG, word);
+        while (!(word & SD_STAT_READY))
+            axi_read(SD_STATUS_REG, word);
+        $display("card ready after %0d cycles, %0d commands", n_cycles, CARD.n_cmds);
+        // sd_card_init
+        axi_write(SD_DEBUG_REG, SD_CLK_DIV_FAST << SD_CLK_DIV_SHIFT);
+
+        // sd_read per sector: the card waits while the sector is copied and compressed
+        start_cycle = n_cycles;
+        start_trans = n_trans;
+        first_out = n_out;
+        n = n_blocks_out;
+        for (sec = 0; sec < NUM_SECTORS; sec = sec + 1) begin
+            sd_start(CMD_READ, IMG_SECTOR + sec);
+            axi_read(SD_STATUS_REG, word);
+            while (!(word & SD_STAT_DONE))
+                axi_read(SD_STATUS_REG, word);
+            if (word & SD_STAT_ERROR) begin
+                $display("ERROR: card rejected the read of sector %0d", sec);
+                n_errors = n_errors + 1;
+            end
+            copy_sector(0, sec);
+            feed_dct(sec);
+        end
+        wait_dct(n, NUM_BLOCKS);
+        read_cycles = n_cycles - start_cycle;
+        read_trans = n_trans - start_trans;
+        n_ref = n_out - first_out;
+        for (i = 0; i < n_ref && i < MAX_OUT_WORDS; i = i + 1)
+            ref_out[i] = dct_out[first_out + i];
+
+        // read-ahead stream: one CMD18, the card fills the free RAM sectors meanwhile
+        start_cycle = n_cycles;
+        start_trans = n_trans;
+        first_out = n_out;
+        n = n_blocks_out;
+        axi_write(SD_CMD_REG, 0);
+        wait_idle;
+        axi_write(SD_BLOCK_CNT_REG, NUM_SECTORS);
+        axi_write(SD_RD_ACK_REG, 0);
+        sd_start(CMD_READ_MULTI, IMG_SECTOR);
+        for (sec = 0; sec < NUM_SECTORS; sec = sec + 1) begin
+            axi_read(SD_RD_CNT_REG, word);
+            while (word <= sec)
+                axi_read(SD_RD_CNT_REG, word);
+            copy_sector((sec % SD_RD_SECTORS)*512, sec);
+            axi_write(SD_RD_ACK_REG, sec + 1);
+            feed_dct(sec);
+        end
+        wait_idle;
+        wait_dct(n, NUM_BLOCKS);
+        stream_cycles = n_cycles - start_cycle;
+        stream_trans = n_trans - start_trans;
+        axi_read(SD_STATUS_REG, word);
+        if (word & SD_STAT_ERROR) begin
+            $display("ERROR: card rejected the multiple block read");
+            n_errors = n_errors + 1;
+        end
+
+        check_run(n_out - first_out);
+
+        // SD to DCT bridge: the controller sends the sectors into the DCT
+        // itself, the firmware only starts it and waits for the count
+        start_cycle = n_cycles;
+        start_trans = n_trans;
+        first_out = n_out;
+        n = n_blocks_out;
+        bridge = 1;
+        axi_write(SD_CMD_REG, 0);
+        wait_idle;
+        axi_write(SD_BLOCK_CNT_REG, NUM_SECTORS);
+        axi_write(SD_ADDR_REG, IMG_SECTOR);
+        axi_write(SD_RD_ACK_REG, PIPELINE_BLOCKS);
+        axi_write(SD_CMD_REG, CMD_READ_MULTI | CMD_STREAM);
+        axi_read(SD_STATUS_REG, word);
+        while (!(word & SD_STAT_BUSY))
+            axi_read(SD_STATUS_REG, word);
+        axi_write(SD_CMD_REG, CMD_STREAM);
+        axi_read(SD_RD_ACK_REG, word);
+        while (word < NUM_SECTORS) begin
+            // poll about as often as a main loop would, letting the stream
+            // send as many blocks as have come out of the DCT
+            repeat (1000) @(posedge clk);
+            axi_write(SD_RD_ACK_REG, n_blocks_out - n + PIPELINE_BLOCKS);
+            axi_read(SD_RD_ACK_REG, word);
+        end
+        // the zero padding of the last sector goes through the DCT too
+        wait_dct(n, NUM_SECTORS * BLOCKS_PER_SECTOR);
+        axi_write(SD_CMD_REG, 0);
+        wait_idle;
+        bridge = 0;
+        bridge_cycles = n_cycles - start_cycle;
+        bridge_trans = n_trans - start_trans;
+        check_run(n_out - first_out);
+
+        $display("%0d blocks in %0d sectors, %0d output words", NUM_BLOCKS, NUM_SECTORS, n_ref);
+        $display("sd_read per sector: %0d cycles, %0d AXI transactions", read_cycles, read_trans);
+        $display("read-ahead stream:   %0d cycles, %0d AXI transactions", stream_cycles, stream_trans);
+        $display("SD to DCT bridge:    %0d cycles, %0d AXI transactions", bridge_cycles, bridge_trans);
+        $display("card commands %0d, blocks sent %0d", CARD.n_cmds, CARD.n_blocks_read);
+        if (n_errors == 0)
+            $display("PASSED: all runs compress the image the same");
+        else
+            $display("FAILED: %0d mismatches", n_errors);
+        $finish;
+    end
+
+endmodule